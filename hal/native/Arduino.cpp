@@ -0,0 +1,463 @@
+/**
+    Arduino (native HAL):
+    The subset of the Arduino core for the ESP32 used by the application,
+    implemented for a Linux host: time, serial console, strings, logging,
+    GPIO with levels injected by tests and the FreeRTOS API.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "NativeHal.h"
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <malloc.h>
+#include <poll.h>
+#include <unistd.h>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+/** Heap of an ESP32 without PSRAM in bytes (model of 'ESP.getHeapSize') */
+const uint32_t kHeapSize = 327680;
+
+/** Number of GPIOs */
+const uint8_t kNumPins = GPIO_NUM_MAX;
+
+/** Interrupt handler attached to a pin */
+struct PinInterrupt {
+    void (*handler)(void*);
+    void (*plainHandler)();
+    void *arg;
+    int mode;
+};
+
+// Start of the program
+static std::chrono::steady_clock::time_point startTime() {
+    static std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    return start;
+}
+
+// Input levels and interrupt handlers of the pins
+static volatile uint8_t pinLevels_[kNumPins];
+static PinInterrupt pinInterrupts_[kNumPins];
+static bool pinsInitialized_ = false;
+
+// Serializes the interrupt handlers like the interrupts of a core
+static std::recursive_mutex interruptMutex_;
+
+// Serializes the log output
+static std::mutex logMutex_;
+
+// Heap model: allocations at the start and lowest free heap seen
+static size_t heapBase_ = 0;
+static uint32_t minFreeHeap_ = kHeapSize;
+
+/**
+ * Idle levels of the inputs of the M5StickC Plus: buttons A and B and the IRQ line of the AXP192 are pulled up,
+ * the buttons of the dual button unit are low while released.
+ */
+static void initPins() {
+    if (pinsInitialized_) {
+        return;
+    }
+
+    for (uint8_t pin = 0; pin < kNumPins; ++pin) {
+        pinLevels_[pin] = (pin == GPIO_NUM_32 || pin == GPIO_NUM_33) ? LOW : HIGH;
+        pinInterrupts_[pin] = {nullptr, nullptr, nullptr, 0};
+    }
+
+    pinsInitialized_ = true;
+}
+
+unsigned long millis() {
+    auto elapsed = std::chrono::steady_clock::now() - startTime();
+
+    return (uint32_t) std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+unsigned long micros() {
+    return (uint32_t) esp_timer_get_time();
+}
+
+int64_t esp_timer_get_time() {
+    auto elapsed = std::chrono::steady_clock::now() - startTime();
+
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+void delay(uint32_t ms) {
+    vTaskDelay(ms / portTICK_PERIOD_MS);
+}
+
+void delayMicroseconds(uint32_t us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield() {
+    taskYIELD();
+}
+
+uint32_t esp_random() {
+    static std::mutex mutex;
+    static std::mt19937 generator((uint32_t) std::chrono::system_clock::now().time_since_epoch().count());
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return generator();
+}
+
+void configTime(long gmtOffset, int daylightOffset, const char *server1, const char *server2, const char *server3) {
+    log_d("Clock of the host is used instead of '%s'", server1);
+}
+
+#ifdef NATIVE_HAL_STRLCPY
+size_t strlcpy(char *dst, const char *src, size_t size) {
+    size_t length = strlen(src);
+
+    if (size > 0) {
+        size_t n = (length < size - 1) ? length : size - 1;
+
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+
+    return length;
+}
+
+size_t strlcat(char *dst, const char *src, size_t size) {
+    size_t length = strnlen(dst, size);
+
+    if (length == size) {
+        return size + strlen(src);
+    }
+
+    return length + strlcpy(dst + length, src, size - length);
+}
+#endif
+
+void log_printf(char level, const char *file, int line, const char *function, const char *format, ...) {
+    char message[512];
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+
+    const char *name = strrchr(file, '/');
+
+    std::lock_guard<std::mutex> lock(logMutex_);
+
+    fprintf(stdout, "[%6lu][%c][%s:%d] %s(): %s\n", millis(), level, name != nullptr ? name + 1 : file, line, function, message);
+    fflush(stdout);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    initPins();
+}
+
+int digitalRead(uint8_t pin) {
+    initPins();
+
+    return (pin < kNumPins) ? pinLevels_[pin] : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+    initPins();
+
+    if (pin < kNumPins) {
+        pinLevels_[pin] = level ? HIGH : LOW;
+    }
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(), int mode) {
+    initPins();
+
+    if (pin < kNumPins) {
+        std::lock_guard<std::recursive_mutex> lock(interruptMutex_);
+        pinInterrupts_[pin] = {nullptr, handler, nullptr, mode};
+    }
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void *arg, int mode) {
+    initPins();
+
+    if (pin < kNumPins) {
+        std::lock_guard<std::recursive_mutex> lock(interruptMutex_);
+        pinInterrupts_[pin] = {handler, nullptr, arg, mode};
+    }
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin < kNumPins) {
+        std::lock_guard<std::recursive_mutex> lock(interruptMutex_);
+        pinInterrupts_[pin] = {nullptr, nullptr, nullptr, 0};
+    }
+}
+
+void NativeHal::setPin(uint8_t pin, int level) {
+    initPins();
+
+    if (pin >= kNumPins) {
+        return;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(interruptMutex_);
+
+    uint8_t previous = pinLevels_[pin];
+
+    pinLevels_[pin] = level ? HIGH : LOW;
+
+    if (previous == pinLevels_[pin]) {
+        return;
+    }
+
+    const PinInterrupt &interrupt = pinInterrupts_[pin];
+    bool rising = (pinLevels_[pin] == HIGH);
+
+    if ( interrupt.mode == CHANGE || (interrupt.mode == RISING && rising) || (interrupt.mode == FALLING && !rising) ) {
+        if (interrupt.handler != nullptr) {
+            interrupt.handler(interrupt.arg);
+        }
+        else if (interrupt.plainHandler != nullptr) {
+            interrupt.plainHandler();
+        }
+    }
+}
+
+int NativeHal::pin(uint8_t pin) {
+    return digitalRead(pin);
+}
+
+size_t NativeHal::heapUsed() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+
+    return info.uordblks + info.hblkhd;
+#elif defined(__GLIBC__)
+    struct mallinfo info = mallinfo();
+
+    return (size_t) (unsigned int) info.uordblks + (size_t) (unsigned int) info.hblkhd;
+#else
+    return 0; // Not available: the heap model shows the full heap as free
+#endif
+}
+
+void String::trim() {
+    size_t start = str_.find_first_not_of(" \t\r\n");
+    size_t end = str_.find_last_not_of(" \t\r\n");
+
+    str_ = (start == std::string::npos) ? std::string() : str_.substr(start, end - start + 1);
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+
+    while (n < size && write(buffer[n]) == 1) {
+        ++n;
+    }
+
+    return n;
+}
+
+size_t Print::printf(const char *format, ...) {
+    char buffer[256];
+    va_list args;
+
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if (length < 0) {
+        return 0;
+    }
+
+    if ((size_t) length < sizeof(buffer)) {
+        return write((const uint8_t*) buffer, length);
+    }
+
+    std::string text(length + 1, '\0');
+
+    va_start(args, format);
+    vsnprintf(&text[0], text.size(), format, args);
+    va_end(args);
+
+    return write((const uint8_t*) text.data(), length);
+}
+
+int Stream::timedRead() {
+    unsigned long start = millis();
+
+    do {
+        if (available() > 0) {
+            return read();
+        }
+
+        delay(1);
+    } while (millis() - start < timeout_);
+
+    return -1;
+}
+
+size_t Stream::readBytes(uint8_t *buffer, size_t length) {
+    size_t n = 0;
+
+    while (n < length) {
+        int c = timedRead();
+
+        if (c < 0) {
+            break;
+        }
+
+        buffer[n++] = (uint8_t) c;
+    }
+
+    return n;
+}
+
+size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length) {
+    size_t n = 0;
+
+    while (n < length) {
+        int c = timedRead();
+
+        if (c < 0 || c == terminator) {
+            break;
+        }
+
+        buffer[n++] = (char) c;
+    }
+
+    return n;
+}
+
+String Stream::readStringUntil(char terminator) {
+    std::string str;
+    int c = timedRead();
+
+    while (c >= 0 && c != terminator) {
+        str += (char) c;
+        c = timedRead();
+    }
+
+    return String(str);
+}
+
+// Input queued by 'NativeHal::serialInput'
+static std::mutex serialInputMutex_;
+static std::string serialInput_;
+
+void NativeHal::serialInput(const char *text) {
+    std::lock_guard<std::mutex> lock(serialInputMutex_);
+
+    serialInput_ += text;
+}
+
+void HardwareSerial::fill() {
+    if (inputPos_ < inputLen_) {
+        return;
+    }
+
+    struct pollfd fd = {STDIN_FILENO, POLLIN, 0};
+
+    inputPos_ = 0;
+    inputLen_ = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(serialInputMutex_);
+
+        if ( !serialInput_.empty() ) {
+            inputLen_ = serialInput_.copy((char*) input_, sizeof(input_));
+            serialInput_.erase(0, inputLen_);
+            return;
+        }
+    }
+
+    if (poll(&fd, 1, 0) == 1 && (fd.revents & POLLIN)) {
+        ssize_t n = ::read(STDIN_FILENO, input_, sizeof(input_));
+
+        inputLen_ = (n > 0) ? (size_t) n : 0;
+    }
+}
+
+int HardwareSerial::available() {
+    fill();
+
+    return (int) (inputLen_ - inputPos_);
+}
+
+int HardwareSerial::read() {
+    fill();
+
+    return (inputPos_ < inputLen_) ? input_[inputPos_++] : -1;
+}
+
+int HardwareSerial::peek() {
+    fill();
+
+    return (inputPos_ < inputLen_) ? input_[inputPos_] : -1;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+    return fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush() {
+    fflush(stdout);
+}
+
+uint32_t EspClass::getHeapSize() {
+    return kHeapSize;
+}
+
+uint32_t EspClass::getFreeHeap() {
+    size_t used = NativeHal::heapUsed();
+
+    // The allocations before the first call are taken as the use of the system
+    if (heapBase_ == 0) {
+        heapBase_ = used;
+    }
+
+    uint32_t freeHeap = (used > heapBase_) ? (uint32_t) (kHeapSize - min(used - heapBase_, (size_t) kHeapSize)) : kHeapSize;
+
+    minFreeHeap_ = min(minFreeHeap_, freeHeap);
+
+    return freeHeap;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+    getFreeHeap();
+
+    return minFreeHeap_;
+}
+
+uint32_t EspClass::getMaxAllocHeap() {
+    return getFreeHeap(); // The fragmentation of the heap is not modelled
+}
+
+uint32_t EspClass::getCycleCount() {
+    auto elapsed = std::chrono::steady_clock::now() - startTime();
+
+    return (uint32_t) (std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() * getCpuFreqMHz() / 1000);
+}
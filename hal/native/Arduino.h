@@ -0,0 +1,337 @@
+/**
+    Arduino (native HAL):
+    The subset of the Arduino core for the ESP32 used by the application,
+    implemented for a Linux host: time, serial console, strings, logging,
+    GPIO with levels injected by tests and the FreeRTOS API.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <type_traits>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+
+#define ARDUINO 10806
+#define ARDUINO_ARCH_NATIVE
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define PROGMEM
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+/**
+ * 'min' and 'max' accept operands of different integer types: types that are identical on the ESP32
+ * (e.g. 'size_t' and 'uint32_t') differ on a 64 bit host.
+ */
+template <typename A, typename B>
+inline typename std::common_type<A, B>::type min(const A &a, const B &b) {
+    return (b < a) ? b : a;
+}
+
+template <typename A, typename B>
+inline typename std::common_type<A, B>::type max(const A &a, const B &b) {
+    return (a < b) ? b : a;
+}
+
+// Time since the start of the program, wrapping around like on the ESP32 (32 bit)
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+uint32_t esp_random();
+
+// Sets the clock from NTP on the ESP32, the clock of the host is already set
+void configTime(long gmtOffset, int daylightOffset, const char *server1, const char *server2 = nullptr, const char *server3 = nullptr);
+
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+#define NATIVE_HAL_STRLCPY
+size_t strlcpy(char *dst, const char *src, size_t size);
+size_t strlcat(char *dst, const char *src, size_t size);
+#endif
+
+// Log levels of the Arduino core ('CORE_DEBUG_LEVEL' selects the lowest level that is printed)
+#define ARDUHAL_LOG_LEVEL_NONE 0
+#define ARDUHAL_LOG_LEVEL_ERROR 1
+#define ARDUHAL_LOG_LEVEL_WARN 2
+#define ARDUHAL_LOG_LEVEL_INFO 3
+#define ARDUHAL_LOG_LEVEL_DEBUG 4
+#define ARDUHAL_LOG_LEVEL_VERBOSE 5
+
+#ifndef CORE_DEBUG_LEVEL
+#define CORE_DEBUG_LEVEL ARDUHAL_LOG_LEVEL_INFO
+#endif
+
+void log_printf(char level, const char *file, int line, const char *function, const char *format, ...) __attribute__ ((format (printf, 5, 6)));
+
+#if CORE_DEBUG_LEVEL >= ARDUHAL_LOG_LEVEL_VERBOSE
+#define log_v(format, ...) log_printf('V', __FILE__, __LINE__, __FUNCTION__, format, ##__VA_ARGS__)
+#else
+#define log_v(format, ...)
+#endif
+
+#if CORE_DEBUG_LEVEL >= ARDUHAL_LOG_LEVEL_DEBUG
+#define log_d(format, ...) log_printf('D', __FILE__, __LINE__, __FUNCTION__, format, ##__VA_ARGS__)
+#else
+#define log_d(format, ...)
+#endif
+
+#if CORE_DEBUG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
+#define log_i(format, ...) log_printf('I', __FILE__, __LINE__, __FUNCTION__, format, ##__VA_ARGS__)
+#else
+#define log_i(format, ...)
+#endif
+
+#if CORE_DEBUG_LEVEL >= ARDUHAL_LOG_LEVEL_WARN
+#define log_w(format, ...) log_printf('W', __FILE__, __LINE__, __FUNCTION__, format, ##__VA_ARGS__)
+#else
+#define log_w(format, ...)
+#endif
+
+#if CORE_DEBUG_LEVEL >= ARDUHAL_LOG_LEVEL_ERROR
+#define log_e(format, ...) log_printf('E', __FILE__, __LINE__, __FUNCTION__, format, ##__VA_ARGS__)
+#else
+#define log_e(format, ...)
+#endif
+
+// GPIO
+#define LOW 0x0
+#define HIGH 0x1
+
+#define INPUT 0x01
+#define OUTPUT 0x02
+#define PULLUP 0x04
+#define INPUT_PULLUP 0x05
+#define PULLDOWN 0x08
+#define INPUT_PULLDOWN 0x09
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+typedef enum {
+    GPIO_NUM_0 = 0, GPIO_NUM_1, GPIO_NUM_2, GPIO_NUM_3, GPIO_NUM_4, GPIO_NUM_5, GPIO_NUM_6, GPIO_NUM_7,
+    GPIO_NUM_8, GPIO_NUM_9, GPIO_NUM_10, GPIO_NUM_11, GPIO_NUM_12, GPIO_NUM_13, GPIO_NUM_14, GPIO_NUM_15,
+    GPIO_NUM_16, GPIO_NUM_17, GPIO_NUM_18, GPIO_NUM_19, GPIO_NUM_20, GPIO_NUM_21, GPIO_NUM_22, GPIO_NUM_23,
+    GPIO_NUM_25 = 25, GPIO_NUM_26, GPIO_NUM_27,
+    GPIO_NUM_32 = 32, GPIO_NUM_33, GPIO_NUM_34, GPIO_NUM_35, GPIO_NUM_36, GPIO_NUM_37, GPIO_NUM_38, GPIO_NUM_39,
+    GPIO_NUM_MAX
+} gpio_num_t;
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+void attachInterrupt(uint8_t pin, void (*handler)(), int mode);
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+/**
+ * Arduino string, based on 'std::string'.
+ */
+class String {
+    public:
+        String(const char *str = "") : str_(str != nullptr ? str : "") {}
+        String(const std::string &str) : str_(str) {}
+        String(char c) : str_(1, c) {}
+        String(int value) : str_(std::to_string(value)) {}
+        String(unsigned int value) : str_(std::to_string(value)) {}
+        String(long value) : str_(std::to_string(value)) {}
+        String(unsigned long value) : str_(std::to_string(value)) {}
+
+        const char* c_str() const { return str_.c_str(); }
+        unsigned int length() const { return (unsigned int) str_.length(); }
+        bool isEmpty() const { return str_.empty(); }
+
+        char operator[](unsigned int index) const { return index < str_.length() ? str_[index] : '\0'; }
+        char charAt(unsigned int index) const { return (*this)[index]; }
+
+        String& operator+=(const String &str) { str_ += str.str_; return *this; }
+        String& operator+=(const char *str) { str_ += (str != nullptr ? str : ""); return *this; }
+        String& operator+=(char c) { str_ += c; return *this; }
+        bool concat(const String &str) { str_ += str.str_; return true; }
+
+        friend String operator+(const String &a, const String &b) { return String(a.str_ + b.str_); }
+        friend String operator+(const String &a, const char *b) { return String(a.str_ + (b != nullptr ? b : "")); }
+        friend String operator+(const char *a, const String &b) { return String((a != nullptr ? a : "") + b.str_); }
+
+        bool operator==(const String &str) const { return str_ == str.str_; }
+        bool operator==(const char *str) const { return str_ == (str != nullptr ? str : ""); }
+        bool operator!=(const String &str) const { return str_ != str.str_; }
+        bool operator!=(const char *str) const { return !(*this == str); }
+        bool equals(const String &str) const { return str_ == str.str_; }
+        bool equalsIgnoreCase(const String &str) const { return strcasecmp(c_str(), str.c_str()) == 0; }
+
+        bool startsWith(const String &prefix) const { return str_.compare(0, prefix.str_.length(), prefix.str_) == 0; }
+        bool endsWith(const String &suffix) const {
+            return str_.length() >= suffix.str_.length()
+                && str_.compare(str_.length() - suffix.str_.length(), suffix.str_.length(), suffix.str_) == 0;
+        }
+
+        int indexOf(char c, unsigned int from = 0) const { return toIndex(str_.find(c, from)); }
+        int indexOf(const String &str, unsigned int from = 0) const { return toIndex(str_.find(str.str_, from)); }
+        int lastIndexOf(char c) const { return toIndex(str_.rfind(c)); }
+
+        String substring(unsigned int from) const { return from < str_.length() ? String(str_.substr(from)) : String(); }
+        String substring(unsigned int from, unsigned int to) const {
+            return from < str_.length() && from < to ? String(str_.substr(from, to - from)) : String();
+        }
+
+        long toInt() const { return strtol(c_str(), nullptr, 10); }
+        void toLowerCase() { for (char &c : str_) c = (char) tolower((unsigned char) c); }
+        void toUpperCase() { for (char &c : str_) c = (char) toupper((unsigned char) c); }
+        void trim();
+
+    private:
+        static int toIndex(size_t pos) { return pos == std::string::npos ? -1 : (int) pos; }
+
+        std::string str_;
+};
+
+/**
+ * Formatted output to a byte sink.
+ */
+class Print {
+    public:
+        virtual ~Print() {}
+
+        virtual size_t write(uint8_t c) = 0;
+        virtual size_t write(const uint8_t *buffer, size_t size);
+        size_t write(const char *str) { return str != nullptr ? write((const uint8_t*) str, strlen(str)) : 0; }
+        size_t write(const char *buffer, size_t size) { return write((const uint8_t*) buffer, size); }
+
+        virtual void flush() {}
+
+        size_t print(const char *str) { return write(str); }
+        size_t print(const String &str) { return write(str.c_str()); }
+        size_t print(char c) { return write((uint8_t) c); }
+        size_t print(int value) { return printf("%d", value); }
+        size_t print(unsigned int value) { return printf("%u", value); }
+        size_t print(long value) { return printf("%ld", value); }
+        size_t print(unsigned long value) { return printf("%lu", value); }
+        size_t print(long long value) { return printf("%lld", value); }
+        size_t print(unsigned long long value) { return printf("%llu", value); }
+        size_t print(double value, int digits = 2) { return printf("%.*f", digits, value); }
+
+        size_t println() { return write("\r\n"); }
+        template <typename T>
+        size_t println(const T &value) { size_t n = print(value); return n + println(); }
+
+        size_t printf(const char *format, ...) __attribute__ ((format (printf, 2, 3)));
+};
+
+/**
+ * Byte source with formatted output.
+ */
+class Stream : public Print {
+    public:
+        Stream() : timeout_(1000) {}
+
+        virtual int available() = 0;
+        virtual int read() = 0;
+        virtual int peek() = 0;
+
+        void setTimeout(unsigned long timeout) { timeout_ = timeout; }
+
+        /** Reads up to 'length' bytes, waiting up to the timeout for each byte */
+        virtual size_t readBytes(uint8_t *buffer, size_t length);
+        size_t readBytes(char *buffer, size_t length) { return readBytes((uint8_t*) buffer, length); }
+        size_t readBytesUntil(char terminator, char *buffer, size_t length);
+        String readStringUntil(char terminator);
+
+    protected:
+        // Reads a byte, waiting up to the timeout (-1 = timeout)
+        int timedRead();
+
+        unsigned long timeout_;
+};
+
+/**
+ * Serial console on standard input and output.
+ */
+class HardwareSerial : public Stream {
+    public:
+        void begin(unsigned long baud) {}
+        void end() {}
+
+        int available() override;
+        int read() override;
+        int peek() override;
+
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t *buffer, size_t size) override;
+        void flush() override;
+
+        using Print::write;
+
+    private:
+        // Reads pending input from standard input without blocking
+        void fill();
+
+        uint8_t input_[256];
+        size_t inputPos_ = 0;
+        size_t inputLen_ = 0;
+};
+
+extern HardwareSerial Serial;
+
+/**
+ * System functions. The heap is modelled on the size of an ESP32 without PSRAM: the allocations of the
+ * program since the start are taken from it. The cycle counter counts at 240 MHz in the time of the host.
+ */
+class EspClass {
+    public:
+        uint32_t getHeapSize();
+        uint32_t getFreeHeap();
+        uint32_t getMinFreeHeap();
+        uint32_t getMaxAllocHeap();
+
+        uint32_t getCycleCount();
+        uint32_t getCpuFreqMHz() { return 240; }
+        const char* getSdkVersion() { return "native"; }
+
+        /** Starts the program again with the same arguments (the flash directory is kept) */
+        void restart();
+};
+
+extern EspClass ESP;
+
+// Entry points of the sketch
+void setup();
+void loop();
@@ -0,0 +1,966 @@
+/**
+    Audio (native HAL):
+    Model of the 'ESP32-audioI2S' library: web streams over HTTP with ICY
+    metadata and playlists (M3U, PLS), files from the flash file system,
+    WAV decoding (MP3 with libmpg123 if built with 'HAL_MPG123') and an I2S
+    output that plays the DMA buffers in real time and counts underruns.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Audio.h"
+#include "NativeHal.h"
+#include <esp_timer.h>
+#include <stdarg.h>
+
+#ifdef HAL_MPG123
+#include <mpg123.h>
+#endif
+
+const uint32_t Audio::kDmaBufCount;
+const uint32_t Audio::kDmaBufLen;
+
+/** Default size of the input buffer in bytes (library default without PSRAM) */
+const size_t kDefaultBufferSize = 16000;
+
+/** Data in the input buffer in bytes before decoding of a stream starts (maximum size of an MP3 frame) */
+const size_t kStartFill = 1600;
+
+/** Timeout in ms for connecting to a host */
+const int32_t kConnectTimeout = 2000;
+
+/** Maximum size in bytes of a playlist and of a header line */
+const size_t kMaxPlaylist = 4096;
+const size_t kMaxHeaderLine = 1024;
+
+/** Maximum number of redirects and playlists followed for one station */
+const uint8_t kMaxRedirects = 5;
+
+/** Volume curve of the library (0 ... 21), unity gain = 64 */
+const uint8_t kVolumeTable[22] = {0, 1, 2, 3, 4, 6, 8, 10, 12, 14, 17, 20, 23, 27, 30, 34, 38, 43, 48, 52, 58, 64};
+
+/** Decoder state of the current stream */
+struct AudioDecoder {
+    bool headerDone;        // WAV: header parsed
+    uint32_t dataRemaining; // WAV: bytes of the data chunk still to play
+    uint8_t redirects;      // Redirects and playlists followed since the station has been requested
+    bool drained;           // All data up to the end of the file has been decoded
+
+#ifdef HAL_MPG123
+    mpg123_handle *pMpg;
+    std::vector<int16_t> pcm;   // Decoded frames not yet written to I2S
+    size_t pcmPos;
+#endif
+
+    AudioDecoder() :
+        headerDone(false),
+        dataRemaining(0),
+        redirects(0),
+        drained(false)
+#ifdef HAL_MPG123
+        , pMpg(nullptr),
+        pcmPos(0)
+#endif
+    {
+    }
+};
+
+void Audio::info(const char *format, ...) {
+    if (audio_info == nullptr) {
+        return;
+    }
+
+    char text[256];
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    audio_info(text);
+}
+
+Audio::Audio(bool internalDAC, i2s_dac_mode_t channelEnabled) :
+    buffer_(kDefaultBufferSize),
+    readPos_(0),
+    fill_(0),
+    source_(SOURCE_NONE),
+    webState_(WEB_HEADER),
+    codec_(CODEC_NONE),
+    running_(false),
+    decoding_(false),
+    endOfData_(false),
+    statusCode_(0),
+    metaint_(0),
+    metaCounter_(0),
+    metaLength_(-1),
+    sampleRate_(0),
+    bitsPerSample_(16),
+    channels_(2),
+    bitRate_(0),
+    volume_(21),
+    pDecoder_(new AudioDecoder()),
+    dmaFill_(0),
+    dmaTime_(0),
+    framesWritten_(0),
+    underruns_(0)
+{
+#ifdef HAL_MPG123
+    mpg123_init();
+#endif
+}
+
+Audio::~Audio() {
+    stopSong();
+
+    delete pDecoder_;
+}
+
+bool Audio::setBufsize(int rambuf_sz, int psrambuf_sz) {
+    if (source_ != SOURCE_NONE || rambuf_sz <= 0) {
+        return false;
+    }
+
+    buffer_.assign(rambuf_sz, 0);
+    buffer_.shrink_to_fit();
+    readPos_ = 0;
+    fill_ = 0;
+
+    return true;
+}
+
+bool Audio::setPinout(uint8_t BCLK, uint8_t LRC, uint8_t DOUT, int8_t DIN) {
+    return true;
+}
+
+void Audio::setVolume(uint8_t volume) {
+    volume_ = min(volume, (uint8_t) 21);
+}
+
+bool Audio::connecttohost(const char *host, const char *user, const char *pwd) {
+    return connect(host, 0);
+}
+
+bool Audio::connect(const char *host, uint8_t redirects) {
+    stopSong();
+
+    pDecoder_->redirects = redirects;
+
+    std::string url = host;
+
+    if (strncasecmp(url.c_str(), "http://", 7) == 0) {
+        url = url.substr(7);
+    }
+    else if (strncasecmp(url.c_str(), "https://", 8) == 0) {
+        info("SSL is not available on the host: %s", host);
+        return false;
+    }
+
+    size_t slash = url.find('/');
+    std::string hostname = url.substr(0, slash);
+    std::string path = (slash == std::string::npos) ? "/" : url.substr(slash);
+    uint16_t port = 80;
+    size_t colon = hostname.rfind(':');
+
+    if (colon != std::string::npos) {
+        port = (uint16_t) atoi(hostname.c_str() + colon + 1);
+        hostname = hostname.substr(0, colon);
+    }
+
+    info("Connect to new host: \"%s\"", host);
+
+    if ( !client_.connect(hostname.c_str(), port, kConnectTimeout) ) {
+        info("Request %s failed!", host);
+        return false;
+    }
+
+    std::string request = "GET " + path + " HTTP/1.1\r\n"
+        + "Host: " + hostname + "\r\n"
+        + "Icy-MetaData:1\r\n"
+        + "Accept: */*\r\n"
+        + "User-Agent: VLC/3.0.8 LibVLC/3.0.8\r\n"
+        + "Connection: keep-alive\r\n\r\n";
+
+    if (client_.write((const uint8_t*) request.data(), request.size()) != request.size()) {
+        client_.stop();
+        info("Request %s failed!", host);
+        return false;
+    }
+
+    host_ = host;
+    source_ = SOURCE_WEB;
+    webState_ = WEB_HEADER;
+    running_ = true;
+
+    // The codec may be set by the file extension and corrected by the content type
+    size_t end = path.find_first_of("?#");
+    std::string file = path.substr(0, end);
+
+    if (file.size() >= 4 && strcasecmp(file.c_str() + file.size() - 4, ".m3u") == 0) {
+        codec_ = CODEC_M3U;
+    }
+    else if (file.size() >= 4 && strcasecmp(file.c_str() + file.size() - 4, ".pls") == 0) {
+        codec_ = CODEC_PLS;
+    }
+
+    if (audio_lasthost != nullptr) {
+        audio_lasthost(host);
+    }
+
+    return true;
+}
+
+bool Audio::connecttoFS(fs::FS &fs, const char *path, uint32_t resumeFilePos) {
+    stopSong();
+
+    file_ = fs.open(path, "r");
+
+    if (!file_) {
+        info("File doesn't exist: \"%s\"", path);
+        return false;
+    }
+
+    if (resumeFilePos > 0) {
+        file_.seek(resumeFilePos);
+    }
+
+    // The content decides the codec: RIFF header or MP3 (ID3 tag or frame sync)
+    uint8_t magic[4] = {0};
+
+    file_.read(magic, sizeof(magic));
+    file_.seek(resumeFilePos);
+
+    codec_ = (memcmp(magic, "RIFF", 4) == 0) ? CODEC_WAV : CODEC_MP3;
+
+#ifndef HAL_MPG123
+    if (codec_ == CODEC_MP3) {
+        info("MP3 is not available on the host (build with 'HAL_MPG123'): \"%s\"", path);
+        file_.close();
+        return false;
+    }
+#endif
+
+    info("Reading file: \"%s\"", path);
+
+    source_ = SOURCE_FILE;
+    running_ = true;
+
+    return true;
+}
+
+uint32_t Audio::stopSong() {
+    uint32_t position = file_ ? file_.position() : 0;
+
+    closeSource();
+
+    readPos_ = 0;
+    fill_ = 0;
+    running_ = false;
+    decoding_ = false;
+    endOfData_ = false;
+    source_ = SOURCE_NONE;
+    codec_ = CODEC_NONE;
+    sampleRate_ = 0;
+    bitRate_ = 0;
+    metaint_ = 0;
+    metaCounter_ = 0;
+    metaLength_ = -1;
+    metadata_.clear();
+    headerLine_.clear();
+    playlist_.clear();
+    location_.clear();
+    statusCode_ = 0;
+
+    // The DMA buffers play out
+    updateI2s();
+
+    return position;
+}
+
+bool Audio::pauseResume() {
+    if (source_ == SOURCE_NONE || (source_ == SOURCE_WEB && webState_ != WEB_DATA)) {
+        return false;
+    }
+
+    running_ = !running_;
+
+    if (running_) {
+        dmaTime_ = esp_timer_get_time();
+    }
+    else {
+        // The DMA buffers are cleared, the output is silent while paused
+        updateI2s();
+        dmaFill_ = 0;
+    }
+
+    return true;
+}
+
+void Audio::loop() {
+    if (!running_) {
+        return;
+    }
+
+    updateI2s();
+
+    if (source_ == SOURCE_WEB) {
+        processWeb();
+    }
+    else if (source_ == SOURCE_FILE) {
+        processFile();
+    }
+
+    if (running_) {
+        decode();
+    }
+
+    // End of a file as soon as everything has been decoded
+    if (running_ && source_ == SOURCE_FILE && pDecoder_->drained) {
+        std::string name = file_ ? file_.name() : "";
+
+        stopSong();
+
+        if (audio_eof_mp3 != nullptr) {
+            audio_eof_mp3(name.c_str());
+        }
+    }
+
+    NativeHal::updateI2sStats({framesWritten_, underruns_, sampleRate_, dmaFill_});
+}
+
+void Audio::processWeb() {
+    // The header line by line, then the playlist or the audio data
+    while (webState_ == WEB_HEADER && client_.available() > 0) {
+        int c = client_.read();
+
+        if (c == '\n') {
+            if (!headerLine_.empty() && headerLine_.back() == '\r') {
+                headerLine_.pop_back();
+            }
+
+            std::string line;
+
+            line.swap(headerLine_);
+            processHeaderLine(line);
+
+            if (source_ != SOURCE_WEB) {
+                return; // Redirected or failed
+            }
+        }
+        else if (c >= 0 && headerLine_.size() < kMaxHeaderLine) {
+            headerLine_ += (char) c;
+        }
+    }
+
+    if (webState_ == WEB_PLAYLIST) {
+        processPlaylist();
+    }
+    else if (webState_ == WEB_DATA) {
+        receiveData();
+    }
+}
+
+void Audio::processHeaderLine(const std::string &line) {
+    if (statusCode_ == 0) {
+        // Status line
+        if (sscanf(line.c_str(), "HTTP/%*d.%*d %d", &statusCode_) != 1 && sscanf(line.c_str(), "ICY %d", &statusCode_) != 1) {
+            statusCode_ = -1;
+        }
+
+        return;
+    }
+
+    if ( !line.empty() ) {
+        size_t colon = line.find(':');
+
+        if (colon == std::string::npos) {
+            return;
+        }
+
+        std::string name = line.substr(0, colon);
+        size_t start = line.find_first_not_of(' ', colon + 1);
+        std::string value = (start != std::string::npos) ? line.substr(start) : std::string();
+
+        if (strcasecmp(name.c_str(), "location") == 0) {
+            location_ = value;
+        }
+        else if (strcasecmp(name.c_str(), "content-type") == 0) {
+            const char *type = value.c_str();
+
+            if (strcasestr(type, "mpegurl") != nullptr) {
+                codec_ = CODEC_M3U;
+            }
+            else if (strcasestr(type, "scpls") != nullptr) {
+                codec_ = CODEC_PLS;
+            }
+            else if (strcasestr(type, "audio/mpeg") != nullptr || strcasestr(type, "audio/mp3") != nullptr) {
+                codec_ = CODEC_MP3;
+            }
+            else if (strcasestr(type, "wav") != nullptr) {
+                codec_ = CODEC_WAV;
+            }
+
+            info("%s", line.c_str());
+        }
+        else if (strcasecmp(name.c_str(), "icy-name") == 0) {
+            if (audio_showstation != nullptr) {
+                audio_showstation(value.c_str());
+            }
+        }
+        else if (strcasecmp(name.c_str(), "icy-br") == 0) {
+            if (audio_bitrate != nullptr) {
+                audio_bitrate(value.c_str());
+            }
+        }
+        else if (strcasecmp(name.c_str(), "icy-metaint") == 0) {
+            metaint_ = strtoul(value.c_str(), nullptr, 10);
+            metaCounter_ = metaint_;
+
+            info("%s", line.c_str());
+        }
+        else if (strcasecmp(name.c_str(), "icy-url") == 0) {
+            if (audio_icyurl != nullptr) {
+                audio_icyurl(value.c_str());
+            }
+        }
+
+        return;
+    }
+
+    // End of the header
+    if (statusCode_ >= 300 && statusCode_ < 400 && !location_.empty()) {
+        uint8_t redirects = pDecoder_->redirects + 1;
+        std::string location = location_;
+
+        if (redirects > kMaxRedirects) {
+            info("Too many redirects: %s", host_.c_str());
+            stopSong();
+            return;
+        }
+
+        info("redirect to new host \"%s\"", location.c_str());
+        connect(location.c_str(), redirects);
+        return;
+    }
+
+    if (statusCode_ != 200) {
+        info("Host replied with status %d: %s", statusCode_, host_.c_str());
+        stopSong();
+        return;
+    }
+
+    if (codec_ == CODEC_M3U || codec_ == CODEC_PLS) {
+        webState_ = WEB_PLAYLIST;
+    }
+    else if (codec_ == CODEC_MP3 || codec_ == CODEC_WAV) {
+#ifndef HAL_MPG123
+        if (codec_ == CODEC_MP3) {
+            info("MP3 is not available on the host (build with 'HAL_MPG123'): %s", host_.c_str());
+            stopSong();
+            return;
+        }
+#endif
+        info("%s has been started", codec_ == CODEC_MP3 ? "MP3" : "WAV");
+        webState_ = WEB_DATA;
+    }
+    else {
+        info("Unknown content type: %s", host_.c_str());
+        stopSong();
+    }
+}
+
+void Audio::processPlaylist() {
+    uint8_t chunk[256];
+
+    while (playlist_.size() < kMaxPlaylist && client_.available() > 0) {
+        int n = client_.read(chunk, min(sizeof(chunk), kMaxPlaylist - playlist_.size()));
+
+        if (n <= 0) {
+            break;
+        }
+
+        playlist_.append((const char*) chunk, n);
+    }
+
+    // The playlist is complete when the host has closed the connection
+    if (client_.connected() && playlist_.size() < kMaxPlaylist) {
+        return;
+    }
+
+    std::string url;
+    size_t pos = 0;
+
+    while (url.empty() && pos < playlist_.size()) {
+        size_t end = playlist_.find('\n', pos);
+        std::string line = playlist_.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+
+        pos = (end == std::string::npos) ? playlist_.size() : end + 1;
+
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) {
+            line.pop_back();
+        }
+
+        if (codec_ == CODEC_PLS && strncasecmp(line.c_str(), "File1=", 6) == 0) {
+            url = line.substr(6);
+        }
+        else if (codec_ == CODEC_M3U && strncasecmp(line.c_str(), "http", 4) == 0) {
+            url = line;
+        }
+    }
+
+    if ( url.empty() ) {
+        info("No stream URL in playlist: %s", host_.c_str());
+        stopSong();
+        return;
+    }
+
+    uint8_t redirects = pDecoder_->redirects + 1;
+
+    if (redirects > kMaxRedirects) {
+        info("Too many playlists: %s", host_.c_str());
+        stopSong();
+        return;
+    }
+
+    info("Playlist: \"%s\"", url.c_str());
+    connect(url.c_str(), redirects);
+}
+
+void Audio::receiveData() {
+    uint8_t chunk[1024];
+
+    while (fill_ < buffer_.size()) {
+        if (metaint_ > 0 && metaCounter_ == 0) {
+            // Metadata block: length byte (in units of 16 bytes), then the text
+            if (metaLength_ < 0) {
+                int length = client_.read();
+
+                if (length < 0) {
+                    break;
+                }
+
+                metaLength_ = length * 16;
+                metadata_.clear();
+            }
+
+            while ((int32_t) metadata_.size() < metaLength_) {
+                int n = client_.read(chunk, min(sizeof(chunk), (size_t) (metaLength_ - metadata_.size())));
+
+                if (n <= 0) {
+                    break;
+                }
+
+                metadata_.append((const char*) chunk, n);
+            }
+
+            if ((int32_t) metadata_.size() < metaLength_) {
+                break;
+            }
+
+            if ( !metadata_.empty() ) {
+                processMetadata(metadata_.c_str()); // Padded with '\0'
+            }
+
+            metaLength_ = -1;
+            metaCounter_ = metaint_;
+            continue;
+        }
+
+        size_t length = min(sizeof(chunk), buffer_.size() - fill_);
+
+        if (metaint_ > 0) {
+            length = min(length, (size_t) metaCounter_);
+        }
+
+        int n = client_.read(chunk, length);
+
+        if (n <= 0) {
+            break;
+        }
+
+        bufferWrite(chunk, n);
+
+        if (metaint_ > 0) {
+            metaCounter_ -= n;
+        }
+    }
+}
+
+void Audio::processMetadata(const std::string &metadata) {
+    const char *key = "StreamTitle='";
+    size_t start = metadata.find(key);
+
+    if (start == std::string::npos) {
+        return;
+    }
+
+    start += strlen(key);
+
+    size_t end = metadata.find("';", start);
+    std::string title = metadata.substr(start, end == std::string::npos ? std::string::npos : end - start);
+
+    if (audio_showstreamtitle != nullptr) {
+        audio_showstreamtitle(title.c_str());
+    }
+}
+
+void Audio::processFile() {
+    uint8_t chunk[1024];
+
+    while (!endOfData_ && fill_ < buffer_.size()) {
+        size_t n = file_.read(chunk, min(sizeof(chunk), buffer_.size() - fill_));
+
+        if (n == 0) {
+            endOfData_ = true;
+            break;
+        }
+
+        bufferWrite(chunk, n);
+    }
+}
+
+void Audio::decode() {
+    if (!decoding_) {
+        // Streams start with some data in the buffer, files right away
+        if (fill_ < kStartFill && !(source_ == SOURCE_FILE && (endOfData_ || fill_ > 0))) {
+            return;
+        }
+
+        decoding_ = true;
+    }
+
+    if (codec_ == CODEC_WAV) {
+        decodeWav();
+    }
+    else if (codec_ == CODEC_MP3) {
+        decodeMp3();
+    }
+}
+
+bool Audio::decodeWavHeader() {
+    uint8_t header[12];
+
+    // RIFF header followed by chunks: 'fmt ' with the format, 'data' with the samples
+    if (bufferPeek(header, sizeof(header)) < sizeof(header)) {
+        return false;
+    }
+
+    if (memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) {
+        info("WAV: no RIFF header");
+        stopSong();
+        return false;
+    }
+
+    std::vector<uint8_t> data(fill_);
+
+    bufferPeek(data.data(), data.size());
+
+    size_t pos = 12;
+
+    while (pos + 8 <= data.size()) {
+        const uint8_t *pChunk = data.data() + pos;
+        uint32_t size = pChunk[4] | (pChunk[5] << 8) | (pChunk[6] << 16) | ((uint32_t) pChunk[7] << 24);
+
+        if (memcmp(pChunk, "data", 4) == 0) {
+            bufferRead(nullptr, pos + 8);
+
+            pDecoder_->headerDone = true;
+            pDecoder_->dataRemaining = size; // 0xFFFFFFFF for a stream of unknown length
+
+            if (sampleRate_ == 0) {
+                info("WAV: no format chunk");
+                stopSong();
+                return false;
+            }
+
+            return true;
+        }
+
+        if (pos + 8 + size > data.size()) {
+            return false; // Wait for the rest of the chunk
+        }
+
+        if (memcmp(pChunk, "fmt ", 4) == 0 && size >= 16) {
+            uint16_t format = pChunk[8] | (pChunk[9] << 8);
+            uint8_t channels = pChunk[10];
+            uint32_t sampleRate = pChunk[12] | (pChunk[13] << 8) | (pChunk[14] << 16) | ((uint32_t) pChunk[15] << 24);
+            uint8_t bitsPerSample = pChunk[22];
+
+            if (format != 1 || channels < 1 || channels > 2 || (bitsPerSample != 8 && bitsPerSample != 16)) {
+                info("WAV: format %u with %u channels and %u bits is not supported", format, channels, bitsPerSample);
+                stopSong();
+                return false;
+            }
+
+            setFormat(sampleRate, bitsPerSample, channels);
+        }
+
+        pos += 8 + size + (size & 1);
+    }
+
+    return false;
+}
+
+void Audio::decodeWav() {
+    if (!pDecoder_->headerDone && !decodeWavHeader()) {
+        return;
+    }
+
+    uint8_t bytesPerFrame = channels_ * bitsPerSample_ / 8;
+    uint8_t frame[4];
+
+    while (fill_ >= bytesPerFrame && pDecoder_->dataRemaining >= bytesPerFrame) {
+        bufferPeek(frame, bytesPerFrame);
+
+        int16_t left;
+        int16_t right;
+
+        if (bitsPerSample_ == 8) {
+            left = (int16_t) ((frame[0] - 128) << 8);
+            right = (channels_ == 2) ? (int16_t) ((frame[1] - 128) << 8) : left;
+        }
+        else {
+            left = (int16_t) (frame[0] | (frame[1] << 8));
+            right = (channels_ == 2) ? (int16_t) (frame[2] | (frame[3] << 8)) : left;
+        }
+
+        if ( !writeFrame(left, right) ) {
+            break;
+        }
+
+        bufferRead(nullptr, bytesPerFrame);
+
+        if (pDecoder_->dataRemaining != 0xFFFFFFFF) {
+            pDecoder_->dataRemaining -= bytesPerFrame;
+        }
+    }
+
+    // End of the data chunk (the rest of the file is not audio) or of the file
+    if (pDecoder_->dataRemaining < bytesPerFrame || (endOfData_ && fill_ < bytesPerFrame)) {
+        bufferRead(nullptr, fill_);
+        endOfData_ = true;
+        pDecoder_->drained = true;
+    }
+}
+
+void Audio::decodeMp3() {
+#ifdef HAL_MPG123
+    AudioDecoder &decoder = *pDecoder_;
+
+    if (decoder.pMpg == nullptr) {
+        decoder.pMpg = mpg123_new(nullptr, nullptr);
+
+        if (decoder.pMpg == nullptr || mpg123_open_feed(decoder.pMpg) != MPG123_OK) {
+            info("MP3: decoder could not be started");
+            stopSong();
+            return;
+        }
+
+        mpg123_format_none(decoder.pMpg);
+        mpg123_format(decoder.pMpg, 44100, MPG123_STEREO | MPG123_MONO, MPG123_ENC_SIGNED_16);
+        mpg123_format(decoder.pMpg, 48000, MPG123_STEREO | MPG123_MONO, MPG123_ENC_SIGNED_16);
+        mpg123_format(decoder.pMpg, 32000, MPG123_STEREO | MPG123_MONO, MPG123_ENC_SIGNED_16);
+        mpg123_format(decoder.pMpg, 22050, MPG123_STEREO | MPG123_MONO, MPG123_ENC_SIGNED_16);
+        mpg123_format(decoder.pMpg, 24000, MPG123_STEREO | MPG123_MONO, MPG123_ENC_SIGNED_16);
+        mpg123_format(decoder.pMpg, 16000, MPG123_STEREO | MPG123_MONO, MPG123_ENC_SIGNED_16);
+    }
+
+    while (true) {
+        // Write the decoded frames, then decode the next MP3 frame
+        while (decoder.pcmPos + channels_ <= decoder.pcm.size()) {
+            int16_t left = decoder.pcm[decoder.pcmPos];
+            int16_t right = (channels_ == 2) ? decoder.pcm[decoder.pcmPos + 1] : left;
+
+            if ( !writeFrame(left, right) ) {
+                return;
+            }
+
+            decoder.pcmPos += channels_;
+        }
+
+        decoder.pcm.clear();
+        decoder.pcmPos = 0;
+
+        unsigned char *pAudio = nullptr;
+        size_t bytes = 0;
+        off_t frameNumber;
+        int result = mpg123_decode_frame(decoder.pMpg, &frameNumber, &pAudio, &bytes);
+
+        if (result == MPG123_NEW_FORMAT) {
+            long rate;
+            int channels;
+            int encoding;
+
+            mpg123_getformat(decoder.pMpg, &rate, &channels, &encoding);
+            setFormat(rate, 16, channels);
+        }
+        else if (result == MPG123_OK && bytes > 0) {
+            decoder.pcm.assign((int16_t*) pAudio, (int16_t*) (pAudio + bytes));
+
+            struct mpg123_frameinfo frameInfo;
+
+            if (mpg123_info(decoder.pMpg, &frameInfo) == MPG123_OK && (uint32_t) frameInfo.bitrate * 1000 != bitRate_) {
+                bitRate_ = frameInfo.bitrate * 1000;
+
+                if (audio_bitrate != nullptr) {
+                    audio_bitrate(String(bitRate_).c_str());
+                }
+            }
+        }
+        else if (result == MPG123_NEED_MORE) {
+            uint8_t chunk[1024];
+            size_t n = bufferRead(chunk, sizeof(chunk));
+
+            if (n == 0) {
+                decoder.drained = endOfData_;
+                return; // Wait for data
+            }
+
+            mpg123_feed(decoder.pMpg, chunk, n);
+        }
+        else if (result != MPG123_OK) {
+            log_d("MP3: %s", mpg123_strerror(decoder.pMpg));
+            mpg123_feed(decoder.pMpg, nullptr, 0); // Resynchronizes with the next frame
+
+            if (fill_ == 0) {
+                return;
+            }
+        }
+    }
+#endif
+}
+
+bool Audio::writeFrame(int16_t left, int16_t right) {
+    if (dmaFill_ >= kDmaBufCount * kDmaBufLen) {
+        return false;
+    }
+
+    left = (int16_t) (left * kVolumeTable[volume_] / 64);
+    right = (int16_t) (right * kVolumeTable[volume_] / 64);
+
+    int16_t frame[2] = {left, right};
+    bool continueI2S = true;
+
+    if (audio_process_i2s != nullptr) {
+        audio_process_i2s((uint32_t*) frame, &continueI2S);
+    }
+
+    // A frame the application has taken over is not written
+    if (continueI2S) {
+        if (dmaFill_ == 0) {
+            dmaTime_ = esp_timer_get_time();
+        }
+
+        ++dmaFill_;
+        ++framesWritten_;
+    }
+
+    return true;
+}
+
+void Audio::updateI2s() {
+    if (dmaFill_ == 0 || sampleRate_ == 0) {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    uint64_t played = (uint64_t) (now - dmaTime_) * sampleRate_ / 1000000;
+
+    if (played < dmaFill_) {
+        dmaFill_ -= played;
+        dmaTime_ += (int64_t) played * 1000000 / sampleRate_;
+        return;
+    }
+
+    dmaFill_ = 0;
+    dmaTime_ = now;
+
+    // The DMA buffers have run empty while playing: I2S outputs silence
+    if (running_) {
+        ++underruns_;
+    }
+}
+
+void Audio::setFormat(uint32_t sampleRate, uint8_t bitsPerSample, uint8_t channels) {
+    if (sampleRate != sampleRate_) {
+        info("SampleRate=%u", sampleRate);
+    }
+
+    if (channels != channels_) {
+        info("Channels=%u", channels);
+    }
+
+    sampleRate_ = sampleRate;
+    bitsPerSample_ = bitsPerSample;
+    channels_ = channels;
+
+    if (codec_ == CODEC_WAV) {
+        bitRate_ = sampleRate * bitsPerSample * channels;
+        info("BitRate=%u", bitRate_);
+
+        if (audio_bitrate != nullptr) {
+            audio_bitrate(String(bitRate_).c_str());
+        }
+    }
+}
+
+void Audio::closeSource() {
+    client_.stop();
+    file_.close();
+
+#ifdef HAL_MPG123
+    if (pDecoder_->pMpg != nullptr) {
+        mpg123_delete(pDecoder_->pMpg);
+    }
+#endif
+
+    *pDecoder_ = AudioDecoder();
+}
+
+size_t Audio::bufferWrite(const uint8_t *data, size_t length) {
+    length = min(length, buffer_.size() - fill_);
+
+    for (size_t i = 0; i < length; ++i) {
+        buffer_[(readPos_ + fill_ + i) % buffer_.size()] = data[i];
+    }
+
+    fill_ += length;
+
+    return length;
+}
+
+size_t Audio::bufferRead(uint8_t *data, size_t length) {
+    length = min(length, fill_);
+
+    if (data != nullptr) {
+        bufferPeek(data, length);
+    }
+
+    readPos_ = (readPos_ + length) % buffer_.size();
+    fill_ -= length;
+
+    return length;
+}
+
+size_t Audio::bufferPeek(uint8_t *data, size_t length) const {
+    length = min(length, fill_);
+
+    for (size_t i = 0; i < length; ++i) {
+        data[i] = buffer_[(readPos_ + i) % buffer_.size()];
+    }
+
+    return length;
+}
@@ -0,0 +1,172 @@
+/**
+    Audio (native HAL):
+    Model of the 'ESP32-audioI2S' library: web streams over HTTP with ICY
+    metadata and playlists (M3U, PLS), files from the flash file system,
+    WAV decoding (MP3 with libmpg123 if built with 'HAL_MPG123') and an I2S
+    output that plays the DMA buffers in real time and counts underruns.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <WiFi.h>
+#include <driver/i2s.h>
+#include <string>
+#include <vector>
+
+// Callbacks of the library (optional, implemented by the application)
+extern __attribute__((weak)) void audio_info(const char*);
+extern __attribute__((weak)) void audio_id3data(const char*);
+extern __attribute__((weak)) void audio_eof_mp3(const char*);
+extern __attribute__((weak)) void audio_showstation(const char*);
+extern __attribute__((weak)) void audio_showstreamtitle(const char*);
+extern __attribute__((weak)) void audio_bitrate(const char*);
+extern __attribute__((weak)) void audio_commercial(const char*);
+extern __attribute__((weak)) void audio_icyurl(const char*);
+extern __attribute__((weak)) void audio_lasthost(const char*);
+extern __attribute__((weak)) void audio_eof_speech(const char*);
+extern __attribute__((weak)) void audio_process_i2s(uint32_t *sample, bool *continueI2S);
+
+struct AudioDecoder;
+
+class Audio {
+    public:
+        /** Number and length in frames of the I2S DMA buffers */
+        const static uint32_t kDmaBufCount = 8;
+        const static uint32_t kDmaBufLen = 512;
+
+        Audio(bool internalDAC = false, i2s_dac_mode_t channelEnabled = I2S_DAC_CHANNEL_LEFT_EN);
+        ~Audio();
+
+        /** Sets the size of the input buffer (before connecting, PSRAM is not available) */
+        bool setBufsize(int rambuf_sz, int psrambuf_sz);
+
+        /**
+         * Connects to a web stream or a playlist (blocks while connecting and sending the request,
+         * the response is processed by 'loop').
+         */
+        bool connecttohost(const char *host, const char *user = "", const char *pwd = "");
+
+        /** Plays a file (MP3 or WAV) */
+        bool connecttoFS(fs::FS &fs, const char *path, uint32_t resumeFilePos = 0);
+
+        bool setPinout(uint8_t BCLK, uint8_t LRC, uint8_t DOUT, int8_t DIN = I2S_PIN_NO_CHANGE);
+
+        /** Receives stream data and decodes until the DMA buffers are full */
+        void loop();
+
+        /** Pauses or resumes the current stream (receiving stops while paused) */
+        bool pauseResume();
+
+        /** @return Position in the file that has been played */
+        uint32_t stopSong();
+
+        bool isRunning() const { return running_; }
+
+        /** @param volume 0 ... 21 */
+        void setVolume(uint8_t volume);
+        uint8_t getVolume() const { return volume_; }
+
+        uint32_t getSampleRate() const { return sampleRate_; }
+        uint8_t getBitsPerSample() const { return bitsPerSample_; }
+        uint8_t getChannels() const { return channels_; }
+        uint32_t getBitRate() const { return bitRate_; }
+
+        uint32_t inBufferFilled() const { return fill_; }
+        uint32_t inBufferFree() const { return buffer_.size() - fill_; }
+
+    private:
+        enum Source {SOURCE_NONE, SOURCE_WEB, SOURCE_FILE};
+        enum WebState {WEB_HEADER, WEB_PLAYLIST, WEB_DATA};
+        enum Codec {CODEC_NONE, CODEC_MP3, CODEC_WAV, CODEC_M3U, CODEC_PLS};
+
+        // Connects to a stream, a playlist or the target of a redirect
+        bool connect(const char *host, uint8_t redirects);
+
+        // Processes the response of the host
+        void processWeb();
+        void processHeaderLine(const std::string &line);
+        void processPlaylist();
+        void receiveData();
+        void processMetadata(const std::string &metadata);
+
+        // Moves data from the file into the input buffer
+        void processFile();
+
+        // Decodes the input buffer until the DMA buffers are full
+        void decode();
+        bool decodeWavHeader();
+        void decodeWav();
+        void decodeMp3();
+
+        // Writes a frame to I2S after the sample hook of the application (false if the DMA buffers are full)
+        bool writeFrame(int16_t left, int16_t right);
+
+        // Plays the DMA buffers up to now
+        void updateI2s();
+
+        void setFormat(uint32_t sampleRate, uint8_t bitsPerSample, uint8_t channels);
+        void closeSource();
+
+        // Input buffer (ring)
+        size_t bufferWrite(const uint8_t *data, size_t length);
+        size_t bufferRead(uint8_t *data, size_t length);
+        size_t bufferPeek(uint8_t *data, size_t length) const;
+
+        static void info(const char *format, ...) __attribute__ ((format (printf, 1, 2)));
+
+        std::vector<uint8_t> buffer_;
+        size_t readPos_;
+        size_t fill_;
+
+        Source source_;
+        WebState webState_;
+        Codec codec_;
+        bool running_;
+        bool decoding_;     // Enough data has arrived to start decoding
+        bool endOfData_;    // The file has been read completely
+
+        WiFiClient client_;
+        fs::File file_;
+        std::string host_;
+        std::string headerLine_;
+        std::string playlist_;
+        int statusCode_;
+        std::string location_;
+
+        // ICY metadata: audio bytes until the next metadata block, length and content of the block
+        uint32_t metaint_;
+        uint32_t metaCounter_;
+        int32_t metaLength_;
+        std::string metadata_;
+
+        uint32_t sampleRate_;
+        uint8_t bitsPerSample_;
+        uint8_t channels_;
+        uint32_t bitRate_;
+        uint8_t volume_;
+
+        AudioDecoder *pDecoder_;
+
+        // Frames in the DMA buffers and time up to which they have been played (in us)
+        uint32_t dmaFill_;
+        int64_t dmaTime_;
+        uint64_t framesWritten_;
+        uint32_t underruns_;
+};
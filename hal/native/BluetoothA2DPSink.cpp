@@ -0,0 +1,55 @@
+/**
+    BluetoothA2DPSink (native HAL):
+    Interface of the 'ESP32-A2DP' library. The host has no bluetooth
+    controller: the sink starts without a source, like a device nobody
+    has paired with, and the controller reports that it is not enabled.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BluetoothA2DPSink.h"
+
+esp_bt_controller_status_t esp_bt_controller_get_status() {
+    return ESP_BT_CONTROLLER_STATUS_IDLE;
+}
+
+BluetoothA2DPSink::BluetoothA2DPSink() :
+    pinConfig_(),
+    i2sConfig_(),
+    taskPriority_(configMAX_PRIORITIES - 3),
+    pMetadataCallback_(nullptr),
+    pVolumeControl_(nullptr),
+    pConnectionCallback_(nullptr),
+    pConnectionObj_(nullptr),
+    pVolumeCallback_(nullptr),
+    running_(false)
+{
+}
+
+void BluetoothA2DPSink::set_on_connection_state_changed(void (*callback)(esp_a2d_connection_state_t, void*), void *obj) {
+    pConnectionCallback_ = callback;
+    pConnectionObj_ = obj;
+}
+
+void BluetoothA2DPSink::start(const char *name) {
+    log_w("Bluetooth is not available on the host - '%s' waits without a source.", name);
+
+    running_ = true;
+}
+
+void BluetoothA2DPSink::end(bool releaseMemory) {
+    running_ = false;
+}
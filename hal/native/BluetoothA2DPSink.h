@@ -0,0 +1,111 @@
+/**
+    BluetoothA2DPSink (native HAL):
+    Interface of the 'ESP32-A2DP' library. The host has no bluetooth
+    controller: the sink starts without a source, like a device nobody
+    has paired with, and the controller reports that it is not enabled.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <driver/i2s.h>
+
+typedef enum {
+    ESP_A2D_CONNECTION_STATE_DISCONNECTED = 0,
+    ESP_A2D_CONNECTION_STATE_CONNECTING,
+    ESP_A2D_CONNECTION_STATE_CONNECTED,
+    ESP_A2D_CONNECTION_STATE_DISCONNECTING
+} esp_a2d_connection_state_t;
+
+typedef enum {
+    ESP_A2D_AUDIO_STATE_REMOTE_SUSPEND = 0,
+    ESP_A2D_AUDIO_STATE_STOPPED,
+    ESP_A2D_AUDIO_STATE_STARTED
+} esp_a2d_audio_state_t;
+
+typedef enum {
+    ESP_AVRC_MD_ATTR_TITLE = 0x1,
+    ESP_AVRC_MD_ATTR_ARTIST = 0x2,
+    ESP_AVRC_MD_ATTR_ALBUM = 0x4,
+    ESP_AVRC_MD_ATTR_TRACK_NUM = 0x8,
+    ESP_AVRC_MD_ATTR_NUM_TRACKS = 0x10,
+    ESP_AVRC_MD_ATTR_GENRE = 0x20,
+    ESP_AVRC_MD_ATTR_PLAYING_TIME = 0x40
+} esp_avrc_md_attr_mask_t;
+
+typedef enum {
+    ESP_BT_CONTROLLER_STATUS_IDLE = 0,
+    ESP_BT_CONTROLLER_STATUS_INITED,
+    ESP_BT_CONTROLLER_STATUS_ENABLED,
+    ESP_BT_CONTROLLER_STATUS_NUM
+} esp_bt_controller_status_t;
+
+/** Status of the bluetooth controller (never enabled on the host) */
+esp_bt_controller_status_t esp_bt_controller_get_status();
+
+/** Stereo frame of 16 bit samples */
+struct Frame {
+    int16_t channel1;
+    int16_t channel2;
+};
+
+/** Volume control of the sink, applied to each block of received audio data */
+class A2DPVolumeControl {
+    public:
+        virtual ~A2DPVolumeControl() {}
+
+        virtual void update_audio_data(Frame* data, uint16_t frameCount, uint8_t volume, bool mono_downmix, bool is_volume_used) = 0;
+        virtual int32_t get_volume_factor(uint8_t volume) = 0;
+        virtual int32_t get_volume_factor_max() = 0;
+};
+
+class BluetoothA2DPSink {
+    public:
+        BluetoothA2DPSink();
+
+        void set_pin_config(i2s_pin_config_t pinConfig) { pinConfig_ = pinConfig; }
+        void set_i2s_config(i2s_config_t i2sConfig) { i2sConfig_ = i2sConfig; }
+        void set_task_priority(UBaseType_t priority) { taskPriority_ = priority; }
+
+        void set_avrc_metadata_attribute_mask(int flags) {}
+        void set_avrc_metadata_callback(void (*callback)(uint8_t, const uint8_t*)) { pMetadataCallback_ = callback; }
+        void set_volume_control(A2DPVolumeControl *pVolumeControl) { pVolumeControl_ = pVolumeControl; }
+        void set_on_connection_state_changed(void (*callback)(esp_a2d_connection_state_t, void*), void *obj = nullptr);
+        void set_on_volumechange(void (*callback)(int)) { pVolumeCallback_ = callback; }
+
+        void start(const char *name);
+
+        /** @param releaseMemory true = release the memory of the controller (cannot be started again) */
+        void end(bool releaseMemory = false);
+
+        esp_a2d_audio_state_t get_audio_state() const { return ESP_A2D_AUDIO_STATE_REMOTE_SUSPEND; }
+        esp_a2d_connection_state_t get_connection_state() const { return ESP_A2D_CONNECTION_STATE_DISCONNECTED; }
+
+    private:
+        i2s_pin_config_t pinConfig_;
+        i2s_config_t i2sConfig_;
+        UBaseType_t taskPriority_;
+
+        void (*pMetadataCallback_)(uint8_t, const uint8_t*);
+        A2DPVolumeControl *pVolumeControl_;
+        void (*pConnectionCallback_)(esp_a2d_connection_state_t, void*);
+        void *pConnectionObj_;
+        void (*pVolumeCallback_)(int);
+
+        bool running_;
+};
@@ -0,0 +1,86 @@
+/**
+    EEPROM (native HAL):
+    EEPROM emulation of the Arduino core, stored in a file in the NVS
+    directory of the HAL.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <EEPROM.h>
+#include "NativeHal.h"
+#include <stdio.h>
+#include <string>
+
+EEPROMClass EEPROM;
+
+/** Path of the EEPROM file */
+static std::string eepromPath() {
+    return std::string(NativeHal::nvsDir()) + "/eeprom.bin";
+}
+
+bool EEPROMClass::begin(size_t size) {
+    if (size == 0) {
+        return false;
+    }
+
+    data_.assign(size, 0xff);
+
+    FILE *pFile = fopen(eepromPath().c_str(), "rb");
+
+    if (pFile != nullptr) {
+        size_t n = fread(data_.data(), 1, size, pFile);
+
+        (void) n; // A shorter file leaves the rest erased
+        fclose(pFile);
+    }
+
+    return true;
+}
+
+void EEPROMClass::end() {
+    commit();
+    data_.clear();
+}
+
+uint8_t EEPROMClass::readByte(int address) {
+    return (address >= 0 && (size_t) address < data_.size()) ? data_[address] : 0;
+}
+
+size_t EEPROMClass::writeByte(int address, uint8_t value) {
+    if (address < 0 || (size_t) address >= data_.size()) {
+        return 0;
+    }
+
+    data_[address] = value;
+
+    return 1;
+}
+
+bool EEPROMClass::commit() {
+    if ( data_.empty() ) {
+        return false;
+    }
+
+    FILE *pFile = fopen(eepromPath().c_str(), "wb");
+
+    if (pFile == nullptr) {
+        return false;
+    }
+
+    bool ok = (fwrite(data_.data(), 1, data_.size(), pFile) == data_.size());
+
+    return (fclose(pFile) == 0) && ok;
+}
@@ -0,0 +1,45 @@
+/**
+    EEPROM (native HAL):
+    EEPROM emulation of the Arduino core, stored in a file in the NVS
+    directory of the HAL.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+class EEPROMClass {
+    public:
+        /** Loads 'size' bytes (0xff where nothing has been written yet) */
+        bool begin(size_t size);
+        void end();
+
+        uint8_t readByte(int address);
+        size_t writeByte(int address, uint8_t value);
+
+        /** Writes the bytes to the file */
+        bool commit();
+
+        size_t length() const { return data_.size(); }
+
+    private:
+        std::vector<uint8_t> data_;
+};
+
+extern EEPROMClass EEPROM;
@@ -0,0 +1,142 @@
+/**
+    FS (native HAL):
+    File system interface of the Arduino core on a directory of the host.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <FS.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace fs;
+
+File::File(FILE *pFile, const char *path) :
+    pFile_(pFile, fclose),
+    path_(path)
+{
+}
+
+size_t File::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *buffer, size_t size) {
+    return pFile_ ? fwrite(buffer, 1, size, pFile_.get()) : 0;
+}
+
+int File::available() {
+    return pFile_ ? (int) (size() - position()) : 0;
+}
+
+int File::read() {
+    return pFile_ ? fgetc(pFile_.get()) : -1;
+}
+
+int File::peek() {
+    if (!pFile_) {
+        return -1;
+    }
+
+    int c = fgetc(pFile_.get());
+
+    if (c != EOF) {
+        ungetc(c, pFile_.get());
+    }
+
+    return c;
+}
+
+size_t File::read(uint8_t *buffer, size_t size) {
+    return pFile_ ? fread(buffer, 1, size, pFile_.get()) : 0;
+}
+
+void File::flush() {
+    if (pFile_) {
+        fflush(pFile_.get());
+    }
+}
+
+bool File::seek(uint32_t position, SeekMode mode) {
+    static const int kWhence[] = {SEEK_SET, SEEK_CUR, SEEK_END};
+
+    return pFile_ && fseek(pFile_.get(), position, kWhence[mode]) == 0;
+}
+
+size_t File::position() const {
+    return pFile_ ? ftell(pFile_.get()) : 0;
+}
+
+size_t File::size() const {
+    struct stat info;
+
+    if (!pFile_ || fstat(fileno(pFile_.get()), &info) != 0) {
+        return 0;
+    }
+
+    return info.st_size;
+}
+
+void File::close() {
+    pFile_.reset();
+}
+
+File FS::open(const char *path, const char *mode) {
+    std::string file = hostPath(path);
+
+    if ( file.empty() ) {
+        return File();
+    }
+
+    // Binary mode, reading and writing like the LittleFS modes "r", "w", "a" and their update modes ("r+", "w+", "a+")
+    std::string hostMode = std::string(mode).substr(0, 1) + (strchr(mode, '+') != nullptr ? "+b" : "b");
+
+    FILE *pFile = fopen(file.c_str(), hostMode.c_str());
+
+    if (pFile == nullptr) {
+        return File();
+    }
+
+    return File(pFile, path);
+}
+
+bool FS::exists(const char *path) {
+    std::string file = hostPath(path);
+    struct stat info;
+
+    return !file.empty() && stat(file.c_str(), &info) == 0;
+}
+
+bool FS::remove(const char *path) {
+    std::string file = hostPath(path);
+
+    return !file.empty() && unlink(file.c_str()) == 0;
+}
+
+bool FS::rename(const char *pathFrom, const char *pathTo) {
+    std::string from = hostPath(pathFrom);
+    std::string to = hostPath(pathTo);
+
+    return !from.empty() && !to.empty() && ::rename(from.c_str(), to.c_str()) == 0;
+}
+
+std::string FS::hostPath(const char *path) const {
+    if (dir_.empty() || path == nullptr || path[0] != '/') {
+        return std::string();
+    }
+
+    return dir_ + path;
+}
@@ -0,0 +1,92 @@
+/**
+    FS (native HAL):
+    File system interface of the Arduino core on a directory of the host.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+#include <stdio.h>
+#include <string>
+
+namespace fs {
+    enum SeekMode {
+        SeekSet = 0,
+        SeekCur = 1,
+        SeekEnd = 2
+    };
+
+    /** Open file, closed when the last copy is closed or destroyed */
+    class File : public Stream {
+        public:
+            File() {}
+            File(FILE *pFile, const char *path);
+
+            size_t write(uint8_t c) override;
+            size_t write(const uint8_t *buffer, size_t size) override;
+            using Print::write;
+
+            int available() override;
+            int read() override;
+            int peek() override;
+            size_t read(uint8_t *buffer, size_t size);
+            size_t readBytes(uint8_t *buffer, size_t length) override { return read(buffer, length); }
+            using Stream::readBytes;
+
+            void flush() override;
+            bool seek(uint32_t position, SeekMode mode = SeekSet);
+            size_t position() const;
+            size_t size() const;
+            void close();
+
+            const char* name() const { return path_.c_str(); }
+
+            operator bool() const { return (bool) pFile_; }
+
+        private:
+            std::shared_ptr<FILE> pFile_;
+            std::string path_;
+    };
+
+    /** File system on a directory of the host, paths are relative to the directory */
+    class FS {
+        public:
+            FS() {}
+
+            /** Sets the directory of the file system (called by 'begin' of the implementation) */
+            void mount(const char *dir) { dir_ = dir; }
+
+            /** @param mode "r", "w" or "a" */
+            File open(const char *path, const char *mode = "r");
+            File open(const String &path, const char *mode = "r") { return open(path.c_str(), mode); }
+
+            bool exists(const char *path);
+            bool remove(const char *path);
+            bool rename(const char *pathFrom, const char *pathTo);
+
+        protected:
+            // Path on the host ("" if not mounted)
+            std::string hostPath(const char *path) const;
+
+            std::string dir_;
+    };
+}
+
+using fs::FS;
+using fs::File;
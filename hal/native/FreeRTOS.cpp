@@ -0,0 +1,423 @@
+/**
+    FreeRTOS (native HAL):
+    The subset of the FreeRTOS API used by the application, implemented on
+    POSIX threads. One tick is one millisecond.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+
+/** Stack added to the requested stack size of a task (host code needs more stack than the ESP32) */
+const size_t kHostStackReserve = 256 * 1024;
+
+/** Longest single wait in ms, after which a blocked task checks whether it has been deleted */
+const uint32_t kDeleteCheckInterval = 50;
+
+struct NativeTask {
+    std::string name;
+    uint32_t stackSize;
+    UBaseType_t priority;
+    BaseType_t core;
+    TaskFunction_t function;
+    void *param;
+
+    // Notification value and its wake-up
+    std::mutex mutex;
+    std::condition_variable notified;
+    uint32_t notifyValue;
+
+    // Set by 'vTaskDelete' from another task
+    std::atomic<bool> deleted;
+
+    NativeTask() : stackSize(0), priority(0), core(tskNO_AFFINITY), function(nullptr), param(nullptr),
+        notifyValue(0), deleted(false) {}
+};
+
+struct NativeQueue {
+    std::mutex mutex;
+    std::condition_variable itemAdded;
+    std::condition_variable itemRemoved;
+
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    std::vector<uint8_t> items;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+// Task object of the calling thread
+static thread_local NativeTask *pCurrentTask_ = nullptr;
+
+// Serializes the id assignment of the critical sections
+static std::atomic<uint32_t> nextThreadId_(1);
+static thread_local uint32_t threadId_ = 0;
+
+/**
+ * Ends the calling thread if its task has been deleted by another task.
+ */
+static void checkDeleted() {
+    if (pCurrentTask_ != nullptr && pCurrentTask_->deleted) {
+        pthread_exit(nullptr);
+    }
+}
+
+/**
+ * Deadline of a wait of the given number of ticks.
+ */
+static std::chrono::steady_clock::time_point deadline(TickType_t ticks) {
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds(ticks * portTICK_PERIOD_MS);
+}
+
+/**
+ * Waits on a condition variable until the predicate holds or the wait times out, checking for a deletion
+ * of the calling task in between. The lock is held when the function returns.
+ */
+template <typename Predicate>
+static bool waitFor(std::unique_lock<std::mutex> &lock, std::condition_variable &cv, TickType_t ticks, Predicate predicate) {
+    std::chrono::steady_clock::time_point end = deadline(ticks == portMAX_DELAY ? 0 : ticks);
+
+    while ( !predicate() ) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        if (ticks != portMAX_DELAY && now >= end) {
+            return false;
+        }
+
+        std::chrono::steady_clock::time_point wake = now + std::chrono::milliseconds(kDeleteCheckInterval);
+
+        cv.wait_until(lock, (ticks != portMAX_DELAY && end < wake) ? end : wake);
+
+        if (pCurrentTask_ != nullptr && pCurrentTask_->deleted) {
+            lock.unlock();
+            checkDeleted();
+        }
+    }
+
+    return true;
+}
+
+static void* taskEntry(void *p) {
+    NativeTask *pTask = (NativeTask*) p;
+
+    pCurrentTask_ = pTask;
+    pthread_setname_np(pthread_self(), pTask->name.substr(0, 15).c_str());
+
+    pTask->function(pTask->param);
+
+    // A task function must not return
+    log_e("Task '%s' returned from its function.", pTask->name.c_str());
+
+    return nullptr;
+}
+
+void vPortEnterCritical(portMUX_TYPE *mux) {
+    if (threadId_ == 0) {
+        threadId_ = nextThreadId_++;
+    }
+
+    // Nested sections of the same thread are counted like on the ESP32
+    if (__atomic_load_n(&mux->owner, __ATOMIC_ACQUIRE) == threadId_) {
+        mux->count++;
+        return;
+    }
+
+    uint32_t expected = 0;
+
+    while ( !__atomic_compare_exchange_n(&mux->owner, &expected, threadId_, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) ) {
+        expected = 0;
+        sched_yield(); // The owner may be preempted on the host
+    }
+
+    mux->count = 1;
+}
+
+void vPortExitCritical(portMUX_TYPE *mux) {
+    if (--mux->count == 0) {
+        __atomic_store_n(&mux->owner, 0, __ATOMIC_RELEASE);
+    }
+}
+
+void taskYIELD() {
+    sched_yield();
+}
+
+BaseType_t xPortGetCoreID() {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+
+    return (task->core == tskNO_AFFINITY) ? 1 : task->core; // Unpinned work runs on the application core by default
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackSize, void *param,
+    UBaseType_t priority, TaskHandle_t *pHandle, BaseType_t core) {
+    NativeTask *pTask = new NativeTask();
+
+    pTask->name = (name != nullptr) ? name : "";
+    pTask->stackSize = stackSize;
+    pTask->priority = priority;
+    pTask->core = core;
+    pTask->function = function;
+    pTask->param = param;
+
+    pthread_attr_t attr;
+    pthread_t thread;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, stackSize + kHostStackReserve);
+
+    // The handle is valid before the task runs (the task may use it right away)
+    if (pHandle != nullptr) {
+        *pHandle = pTask;
+    }
+
+    int result = pthread_create(&thread, &attr, taskEntry, pTask);
+
+    pthread_attr_destroy(&attr);
+
+    if (result != 0) {
+        if (pHandle != nullptr) {
+            *pHandle = nullptr;
+        }
+
+        delete pTask;
+        return pdFAIL;
+    }
+
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stackSize, void *param,
+    UBaseType_t priority, TaskHandle_t *pHandle) {
+    return xTaskCreatePinnedToCore(function, name, stackSize, param, priority, pHandle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == nullptr || task == pCurrentTask_) {
+        // The task object is kept: other tasks may still hold the handle
+        pthread_exit(nullptr);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->deleted = true;
+    }
+
+    task->notified.notify_all();
+}
+
+void vTaskDelay(TickType_t ticks) {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(task->mutex);
+
+    // Sleeps on the notification to be woken up by a deletion (notifications do not end a delay)
+    waitFor(lock, task->notified, ticks, []() { return false; });
+}
+
+void vTaskDelayUntil(TickType_t *pPreviousWakeTime, TickType_t increment) {
+    TickType_t wakeTime = *pPreviousWakeTime + increment;
+    TickType_t now = xTaskGetTickCount();
+
+    if ((int32_t) (wakeTime - now) > 0) {
+        vTaskDelay(wakeTime - now);
+    }
+
+    *pPreviousWakeTime = wakeTime;
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t) millis() / portTICK_PERIOD_MS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    if (pCurrentTask_ == nullptr) {
+        char name[16] = "";
+
+        pthread_getname_np(pthread_self(), name, sizeof(name));
+
+        pCurrentTask_ = new NativeTask();
+        pCurrentTask_->name = name;
+        pCurrentTask_->priority = 1;
+    }
+
+    return pCurrentTask_;
+}
+
+const char* pcTaskGetTaskName(TaskHandle_t task) {
+    return (task != nullptr ? task : xTaskGetCurrentTaskHandle())->name.c_str();
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return (task != nullptr ? task : xTaskGetCurrentTaskHandle())->stackSize;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(task->mutex);
+
+    waitFor(lock, task->notified, ticks, [task]() { return task->notifyValue > 0; });
+
+    uint32_t value = task->notifyValue;
+
+    if (value > 0) {
+        task->notifyValue = (clearOnExit == pdTRUE) ? 0 : value - 1;
+    }
+
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->notifyValue++;
+    }
+
+    task->notified.notify_all();
+
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *pHigherPriorityTaskWoken) {
+    xTaskNotifyGive(task);
+
+    if (pHigherPriorityTaskWoken != nullptr) {
+        *pHigherPriorityTaskWoken = pdTRUE;
+    }
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    if (length == 0) {
+        return nullptr;
+    }
+
+    NativeQueue *pQueue = new NativeQueue();
+
+    pQueue->length = length;
+    pQueue->itemSize = itemSize;
+    pQueue->items.resize((size_t) length * itemSize);
+    pQueue->head = 0;
+    pQueue->count = 0;
+
+    return pQueue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *pItem, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+
+    if ( !waitFor(lock, queue->itemRemoved, ticks, [queue]() { return queue->count < queue->length; }) ) {
+        return errQUEUE_FULL;
+    }
+
+    UBaseType_t index = (queue->head + queue->count) % queue->length;
+
+    if (queue->itemSize > 0) {
+        memcpy(&queue->items[(size_t) index * queue->itemSize], pItem, queue->itemSize);
+    }
+
+    queue->count++;
+    lock.unlock();
+
+    queue->itemAdded.notify_one();
+
+    return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *pItem, BaseType_t *pHigherPriorityTaskWoken) {
+    BaseType_t result = xQueueSend(queue, pItem, 0);
+
+    if (result == pdPASS && pHigherPriorityTaskWoken != nullptr) {
+        *pHigherPriorityTaskWoken = pdTRUE;
+    }
+
+    return result;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *pItem, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+
+    if ( !waitFor(lock, queue->itemAdded, ticks, [queue]() { return queue->count > 0; }) ) {
+        return pdFALSE;
+    }
+
+    if (queue->itemSize > 0) {
+        memcpy(pItem, &queue->items[(size_t) queue->head * queue->itemSize], queue->itemSize);
+    }
+
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    lock.unlock();
+
+    queue->itemRemoved.notify_one();
+
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+
+    return queue->count;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+
+        queue->head = 0;
+        queue->count = 0;
+    }
+
+    queue->itemRemoved.notify_all();
+
+    return pdPASS;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    SemaphoreHandle_t semaphore = xQueueCreate(1, 0);
+
+    if (semaphore != nullptr) {
+        semaphore->count = 1; // Available
+    }
+
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return xQueueCreate(1, 0); // Taken until given for the first time
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    return xQueueReceive(semaphore, nullptr, ticks);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    return xQueueSend(semaphore, nullptr, 0);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t *pHigherPriorityTaskWoken) {
+    return xQueueSendFromISR(semaphore, nullptr, pHigherPriorityTaskWoken);
+}
@@ -0,0 +1,238 @@
+/**
+    HTTPClient (native HAL):
+    HTTP/1.1 client of the Arduino core on a 'WiFiClient' (plain HTTP only,
+    the host build has no TLS).
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <HTTPClient.h>
+
+/** Maximum number of redirects followed */
+const uint8_t kMaxRedirects = 10;
+
+/** Maximum length of a header line */
+const size_t kMaxHeaderLine = 1024;
+
+HTTPClient::HTTPClient() :
+    port_(80),
+    followRedirects_(HTTPC_DISABLE_FOLLOW_REDIRECTS),
+    timeout_(5000),
+    connectTimeout_(5000),
+    size_(-1)
+{
+}
+
+HTTPClient::~HTTPClient() {
+    end();
+}
+
+bool HTTPClient::begin(const String &url) {
+    end();
+
+    headers_.clear();
+
+    return parseUrl(url);
+}
+
+void HTTPClient::end() {
+    client_.stop();
+    size_ = -1;
+}
+
+void HTTPClient::addHeader(const String &name, const String &value) {
+    headers_ += std::string(name.c_str()) + ": " + value.c_str() + "\r\n";
+}
+
+int HTTPClient::GET() {
+    return sendRequest("GET", nullptr, 0);
+}
+
+int HTTPClient::POST(uint8_t *payload, size_t size) {
+    return sendRequest("POST", payload, size);
+}
+
+String HTTPClient::getString() {
+    std::string body;
+    uint8_t buffer[512];
+    unsigned long start = millis();
+
+    while (connected() && (size_ < 0 || body.size() < (size_t) size_) && millis() - start < timeout_) {
+        int n = client_.read(buffer, sizeof(buffer));
+
+        if (n > 0) {
+            body.append((const char*) buffer, n);
+            start = millis();
+        }
+        else {
+            delay(1);
+        }
+    }
+
+    return String(body);
+}
+
+String HTTPClient::errorToString(int error) {
+    switch (error) {
+        case HTTPC_ERROR_CONNECTION_REFUSED: return String("connection refused");
+        case HTTPC_ERROR_SEND_HEADER_FAILED: return String("send header failed");
+        case HTTPC_ERROR_SEND_PAYLOAD_FAILED: return String("send payload failed");
+        case HTTPC_ERROR_NOT_CONNECTED: return String("not connected");
+        case HTTPC_ERROR_CONNECTION_LOST: return String("connection lost");
+        case HTTPC_ERROR_NO_STREAM: return String("no stream");
+        case HTTPC_ERROR_NO_HTTP_SERVER: return String("no HTTP server");
+        case HTTPC_ERROR_TOO_LESS_RAM: return String("too less ram");
+        case HTTPC_ERROR_ENCODING: return String("Transfer-Encoding not supported");
+        case HTTPC_ERROR_STREAM_WRITE: return String("Stream write error");
+        case HTTPC_ERROR_READ_TIMEOUT: return String("read Timeout");
+        default: return String();
+    }
+}
+
+int HTTPClient::sendRequest(const char *method, const uint8_t *payload, size_t size) {
+    for (uint8_t redirects = 0; redirects <= kMaxRedirects; ++redirects) {
+        client_.stop();
+        size_ = -1;
+
+        if ( !client_.connect(host_.c_str(), port_, connectTimeout_) ) {
+            return HTTPC_ERROR_CONNECTION_REFUSED;
+        }
+
+        client_.setTimeout(timeout_);
+
+        std::string request = std::string(method) + " " + path_ + " HTTP/1.1\r\n"
+            + "Host: " + host_ + (port_ != 80 ? ":" + std::to_string(port_) : std::string()) + "\r\n"
+            + "User-Agent: ESP32HTTPClient\r\n"
+            + "Connection: close\r\n"
+            + headers_;
+
+        if (payload != nullptr) {
+            request += "Content-Length: " + std::to_string(size) + "\r\n";
+        }
+
+        request += "\r\n";
+
+        if (client_.write((const uint8_t*) request.data(), request.size()) != request.size()) {
+            return HTTPC_ERROR_SEND_HEADER_FAILED;
+        }
+
+        if (payload != nullptr && client_.write(payload, size) != size) {
+            return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+        }
+
+        std::string line;
+
+        if ( !readLine(line) ) {
+            return HTTPC_ERROR_READ_TIMEOUT;
+        }
+
+        int code = 0;
+
+        if (sscanf(line.c_str(), "HTTP/%*d.%*d %d", &code) != 1 && sscanf(line.c_str(), "ICY %d", &code) != 1) {
+            return HTTPC_ERROR_NO_HTTP_SERVER;
+        }
+
+        std::string location;
+
+        while ( readLine(line) && !line.empty() ) {
+            size_t colon = line.find(':');
+
+            if (colon == std::string::npos) {
+                continue;
+            }
+
+            size_t start = line.find_first_not_of(' ', colon + 1);
+            std::string value = (start != std::string::npos) ? line.substr(start) : std::string();
+
+            if (strncasecmp(line.c_str(), "Content-Length", colon) == 0) {
+                size_ = atoi(value.c_str());
+            }
+            else if (strncasecmp(line.c_str(), "Location", colon) == 0) {
+                location = value;
+            }
+        }
+
+        bool redirect = (code == HTTP_CODE_MOVED_PERMANENTLY || code == HTTP_CODE_FOUND || code == HTTP_CODE_SEE_OTHER
+            || code == HTTP_CODE_TEMPORARY_REDIRECT || code == HTTP_CODE_PERMANENT_REDIRECT);
+        bool follow = (followRedirects_ == HTTPC_FORCE_FOLLOW_REDIRECTS)
+            || (followRedirects_ == HTTPC_STRICT_FOLLOW_REDIRECTS && strcmp(method, "GET") == 0);
+
+        if (!redirect || !follow || location.empty() || !parseUrl(String(location))) {
+            return code;
+        }
+
+        log_d("Redirect %d to '%s'", code, location.c_str());
+    }
+
+    return HTTPC_ERROR_CONNECTION_LOST;
+}
+
+bool HTTPClient::parseUrl(const String &url) {
+    std::string str = url.c_str();
+
+    if (strncasecmp(str.c_str(), "https://", 8) == 0) {
+        log_w("HTTPS is not available on the host: '%s'", str.c_str());
+        return false;
+    }
+
+    if (strncasecmp(str.c_str(), "http://", 7) != 0) {
+        return false;
+    }
+
+    str = str.substr(7);
+
+    size_t slash = str.find('/');
+    std::string authority = str.substr(0, slash);
+
+    path_ = (slash == std::string::npos) ? "/" : str.substr(slash);
+
+    size_t colon = authority.rfind(':');
+
+    if (colon != std::string::npos) {
+        host_ = authority.substr(0, colon);
+        port_ = (uint16_t) atoi(authority.c_str() + colon + 1);
+    }
+    else {
+        host_ = authority;
+        port_ = 80;
+    }
+
+    return !host_.empty() && port_ != 0;
+}
+
+bool HTTPClient::readLine(std::string &line) {
+    line.clear();
+
+    while (line.size() < kMaxHeaderLine) {
+        uint8_t c;
+
+        if (client_.readBytes(&c, 1) != 1) {
+            return false;
+        }
+
+        if (c == '\n') {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+
+            return true;
+        }
+
+        line += (char) c;
+    }
+
+    return true;
+}
@@ -0,0 +1,112 @@
+/**
+    HTTPClient (native HAL):
+    HTTP/1.1 client of the Arduino core on a 'WiFiClient' (plain HTTP only,
+    the host build has no TLS).
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_STREAM (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM (-8)
+#define HTTPC_ERROR_ENCODING (-9)
+#define HTTPC_ERROR_STREAM_WRITE (-10)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+typedef enum {
+    HTTP_CODE_OK = 200,
+    HTTP_CODE_NO_CONTENT = 204,
+    HTTP_CODE_MOVED_PERMANENTLY = 301,
+    HTTP_CODE_FOUND = 302,
+    HTTP_CODE_SEE_OTHER = 303,
+    HTTP_CODE_TEMPORARY_REDIRECT = 307,
+    HTTP_CODE_PERMANENT_REDIRECT = 308,
+    HTTP_CODE_BAD_REQUEST = 400,
+    HTTP_CODE_NOT_FOUND = 404,
+    HTTP_CODE_INTERNAL_SERVER_ERROR = 500
+} t_http_codes;
+
+typedef enum {
+    HTTPC_DISABLE_FOLLOW_REDIRECTS,
+    HTTPC_STRICT_FOLLOW_REDIRECTS,
+    HTTPC_FORCE_FOLLOW_REDIRECTS
+} followRedirects_t;
+
+class HTTPClient {
+    public:
+        HTTPClient();
+        ~HTTPClient();
+
+        /**
+         * @param url 'http://host[:port]/path'.
+         * @return false if the URL cannot be parsed or uses HTTPS.
+         */
+        bool begin(const String &url);
+        void end();
+
+        void setFollowRedirects(followRedirects_t follow) { followRedirects_ = follow; }
+        void setTimeout(uint16_t timeout) { timeout_ = timeout; }
+        void setConnectTimeout(int32_t timeout) { connectTimeout_ = timeout; }
+        void addHeader(const String &name, const String &value);
+
+        /** @return HTTP status code or 'HTTPC_ERROR_*' */
+        int GET();
+        int POST(uint8_t *payload, size_t size);
+        int POST(const String &payload) { return POST((uint8_t*) payload.c_str(), payload.length()); }
+
+        /** Content length from the response header (-1 = unknown) */
+        int getSize() const { return size_; }
+
+        /** Connection for reading the body */
+        WiFiClient* getStreamPtr() { return connected() ? &client_ : nullptr; }
+        WiFiClient& getStream() { return client_; }
+        String getString();
+
+        bool connected() { return client_.connected(); }
+
+        static String errorToString(int error);
+
+    private:
+        // Sends a request and reads the response header, following redirects
+        int sendRequest(const char *method, const uint8_t *payload, size_t size);
+
+        // Splits the URL into host, port and path
+        bool parseUrl(const String &url);
+
+        // Reads one header line without CR/LF (false on timeout or closed connection)
+        bool readLine(std::string &line);
+
+        WiFiClient client_;
+        std::string host_;
+        uint16_t port_;
+        std::string path_;
+        std::string headers_;
+
+        followRedirects_t followRedirects_;
+        uint16_t timeout_;
+        int32_t connectTimeout_;
+        int size_;
+};
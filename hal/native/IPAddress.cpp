@@ -0,0 +1,50 @@
+/**
+    IPAddress (native HAL):
+    IPv4 address of the Arduino core.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <IPAddress.h>
+
+const IPAddress INADDR_NONE = IPAddress(0, 0, 0, 0);
+
+bool IPAddress::fromString(const char *address) {
+    unsigned int octets[4];
+    char end;
+
+    if (sscanf(address, "%u.%u.%u.%u%c", &octets[0], &octets[1], &octets[2], &octets[3], &end) != 4) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < 4; ++i) {
+        if (octets[i] > 255) {
+            return false;
+        }
+    }
+
+    *this = IPAddress(octets[0], octets[1], octets[2], octets[3]);
+
+    return true;
+}
+
+String IPAddress::toString() const {
+    char str[16];
+
+    snprintf(str, sizeof(str), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+
+    return String(str);
+}
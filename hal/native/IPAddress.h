@@ -0,0 +1,49 @@
+/**
+    IPAddress (native HAL):
+    IPv4 address of the Arduino core.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+class IPAddress {
+    public:
+        IPAddress() : address_(0) {}
+        IPAddress(uint32_t address) : address_(address) {}
+        IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) :
+            address_((uint32_t) a | ((uint32_t) b << 8) | ((uint32_t) c << 16) | ((uint32_t) d << 24)) {}
+
+        /** Address in network byte order (first octet in the lowest byte) */
+        operator uint32_t() const { return address_; }
+
+        uint8_t operator[](int index) const { return (uint8_t) (address_ >> (8 * index)); }
+
+        bool operator==(const IPAddress &address) const { return address_ == address.address_; }
+        bool operator!=(const IPAddress &address) const { return address_ != address.address_; }
+
+        /** Parses a dotted decimal address */
+        bool fromString(const char *address);
+
+        String toString() const;
+
+    private:
+        uint32_t address_;
+};
+
+extern const IPAddress INADDR_NONE;
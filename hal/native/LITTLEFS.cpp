@@ -0,0 +1,74 @@
+/**
+    LITTLEFS (native HAL):
+    LittleFS of the 'LittleFS_esp32' library on the flash directory of the
+    HAL (filled from 'data/' like 'Upload Filesystem Image').
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <LITTLEFS.h>
+#include "NativeHal.h"
+#include <dirent.h>
+#include <sys/stat.h>
+
+fs::LITTLEFSFS LITTLEFS;
+
+/** Size of the file system partition of 'huge_app.csv' */
+const size_t kFlashSize = 0x30000;
+
+using namespace fs;
+
+bool LITTLEFSFS::begin(bool formatOnFail, const char *basePath, uint8_t maxOpenFiles) {
+    struct stat info;
+
+    if (stat(NativeHal::flashDir(), &info) != 0 || !S_ISDIR(info.st_mode)) {
+        log_e("Flash directory '%s' not found", NativeHal::flashDir());
+        return false;
+    }
+
+    mount(NativeHal::flashDir());
+
+    return true;
+}
+
+void LITTLEFSFS::end() {
+    dir_.clear();
+}
+
+size_t LITTLEFSFS::totalBytes() {
+    return kFlashSize;
+}
+
+size_t LITTLEFSFS::usedBytes() {
+    DIR *pDir = dir_.empty() ? nullptr : opendir(dir_.c_str());
+    size_t used = 0;
+
+    if (pDir == nullptr) {
+        return 0;
+    }
+
+    while (struct dirent *pEntry = readdir(pDir)) {
+        struct stat info;
+
+        if (pEntry->d_name[0] != '.' && stat((dir_ + "/" + pEntry->d_name).c_str(), &info) == 0) {
+            used += info.st_size;
+        }
+    }
+
+    closedir(pDir);
+
+    return used;
+}
@@ -0,0 +1,38 @@
+/**
+    LITTLEFS (native HAL):
+    LittleFS of the 'LittleFS_esp32' library on the flash directory of the
+    HAL (filled from 'data/' like 'Upload Filesystem Image').
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <FS.h>
+
+namespace fs {
+    class LITTLEFSFS : public FS {
+        public:
+            /** Mounts the flash directory (false if it does not exist) */
+            bool begin(bool formatOnFail = false, const char *basePath = "/littlefs", uint8_t maxOpenFiles = 5);
+            void end();
+
+            size_t totalBytes();
+            size_t usedBytes();
+    };
+}
+
+extern fs::LITTLEFSFS LITTLEFS;
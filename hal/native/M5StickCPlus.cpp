@@ -0,0 +1,186 @@
+/**
+    M5StickCPlus (native HAL):
+    Board library of the M5StickC Plus with a headless model of the ST7789
+    display (frame buffer only). Text is drawn as blocks with the metrics
+    of the fonts, there are no glyph shapes.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <M5StickCPlus.h>
+
+M5StickCPlus M5;
+
+const int16_t TFT_eSPI::kWidth;
+const int16_t TFT_eSPI::kHeight;
+
+/** Character cell of the fonts 1, 2 and 4 of TFT_eSPI at text size 1 (width, height) */
+struct FontMetrics {
+    uint8_t font;
+    uint8_t width;
+    uint8_t height;
+};
+
+const FontMetrics kFontMetrics[] = {
+    {1, 6, 8},
+    {2, 8, 16},
+    {4, 14, 26}
+};
+
+TFT_eSPI::TFT_eSPI(int16_t width, int16_t height) :
+    width_(width),
+    height_(height),
+    pixels_((size_t) width * height, TFT_BLACK),
+    font_(1),
+    textSize_(1),
+    textColor_(TFT_WHITE),
+    textBgColor_(TFT_WHITE),
+    cursorX_(0),
+    cursorY_(0),
+    textWrap_(true)
+{
+}
+
+void TFT_eSPI::setRotation(uint8_t rotation) {
+    // Landscape for 1 and 3, the content is not rotated
+    bool landscape = (rotation % 2) != 0;
+
+    width_ = landscape ? kHeight : kWidth;
+    height_ = landscape ? kWidth : kHeight;
+}
+
+void TFT_eSPI::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+    for (int32_t row = max(y, (int32_t) 0); row < min(y + h, (int32_t) height_); ++row) {
+        for (int32_t column = max(x, (int32_t) 0); column < min(x + w, (int32_t) width_); ++column) {
+            pixels_[row * width_ + column] = color;
+        }
+    }
+}
+
+void TFT_eSPI::drawPixel(int32_t x, int32_t y, uint32_t color) {
+    if (x >= 0 && x < width_ && y >= 0 && y < height_) {
+        pixels_[y * width_ + x] = color;
+    }
+}
+
+uint16_t TFT_eSPI::readPixel(int32_t x, int32_t y) {
+    return (x >= 0 && x < width_ && y >= 0 && y < height_) ? pixels_[y * width_ + x] : 0;
+}
+
+void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data) {
+    for (int32_t row = 0; row < h; ++row) {
+        for (int32_t column = 0; column < w; ++column) {
+            drawPixel(x + column, y + row, data[row * w + column]);
+        }
+    }
+}
+
+int16_t TFT_eSPI::fontHeight(uint8_t font) const {
+    for (const FontMetrics &metrics : kFontMetrics) {
+        if (metrics.font == font) {
+            return metrics.height * textSize_;
+        }
+    }
+
+    return 0;
+}
+
+int16_t TFT_eSPI::textWidth(const char *str, uint8_t font) const {
+    return (int16_t) strlen(str) * charWidth(font);
+}
+
+int16_t TFT_eSPI::charWidth(uint8_t font) const {
+    for (const FontMetrics &metrics : kFontMetrics) {
+        if (metrics.font == font) {
+            return metrics.width * textSize_;
+        }
+    }
+
+    return 0;
+}
+
+int16_t TFT_eSPI::drawChar(uint16_t c, int32_t x, int32_t y, uint8_t font) {
+    int16_t w = charWidth(font);
+    int16_t h = fontHeight(font);
+
+    if (textBgColor_ != textColor_) {
+        fillRect(x, y, w, h, textBgColor_);
+    }
+
+    // Block with a gap of one pixel to the next character and line
+    if (c > ' ') {
+        fillRect(x, y, w - textSize_, h - textSize_, textColor_);
+    }
+
+    return w;
+}
+
+size_t TFT_eSPI::write(uint8_t c) {
+    if (c == '\n') {
+        cursorX_ = 0;
+        cursorY_ += fontHeight();
+    }
+    else if (c != '\r') {
+        if (textWrap_ && cursorX_ + charWidth(font_) > width_) {
+            cursorX_ = 0;
+            cursorY_ += fontHeight();
+        }
+
+        cursorX_ += drawChar(c, cursorX_, cursorY_, font_);
+    }
+
+    return 1;
+}
+
+TFT_eSprite::TFT_eSprite(TFT_eSPI *pTft) :
+    TFT_eSPI(0, 0),
+    pTft_(pTft)
+{
+}
+
+void* TFT_eSprite::createSprite(int16_t width, int16_t height) {
+    if (width <= 0 || height <= 0) {
+        return nullptr;
+    }
+
+    width_ = width;
+    height_ = height;
+    pixels_.assign((size_t) width * height, TFT_BLACK);
+
+    return pixels_.data();
+}
+
+void TFT_eSprite::deleteSprite() {
+    pixels_.clear();
+    pixels_.shrink_to_fit();
+    width_ = 0;
+    height_ = 0;
+}
+
+void TFT_eSprite::pushSprite(int32_t x, int32_t y) {
+    if (pTft_ != nullptr && !pixels_.empty()) {
+        pTft_->pushImage(x, y, width_, height_, pixels_.data());
+    }
+}
+
+void M5StickCPlus::begin(bool lcdEnable, bool powerEnable, bool serialEnable) {
+    Lcd.init();
+    Wire1.begin(21, 22);
+
+    if (serialEnable) {
+        Serial.begin(115200);
+    }
+}
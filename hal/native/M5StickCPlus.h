@@ -0,0 +1,142 @@
+/**
+    M5StickCPlus (native HAL):
+    Board library of the M5StickC Plus with a headless model of the ST7789
+    display (frame buffer only). Text is drawn as blocks with the metrics
+    of the fonts, there are no glyph shapes.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <vector>
+
+#define TFT_BLACK       0x0000
+#define TFT_NAVY        0x000F
+#define TFT_DARKGREEN   0x03E0
+#define TFT_MAROON      0x7800
+#define TFT_PURPLE      0x780F
+#define TFT_DARKGREY    0x7BEF
+#define TFT_LIGHTGREY   0xC618
+#define TFT_BLUE        0x001F
+#define TFT_GREEN       0x07E0
+#define TFT_CYAN        0x07FF
+#define TFT_RED         0xF800
+#define TFT_MAGENTA     0xF81F
+#define TFT_YELLOW      0xFFE0
+#define TFT_WHITE       0xFFFF
+#define TFT_ORANGE      0xFDA0
+
+class TFT_eSPI : public Print {
+    public:
+        /** Size of the display in the default orientation */
+        const static int16_t kWidth = 135;
+        const static int16_t kHeight = 240;
+
+        TFT_eSPI(int16_t width = kWidth, int16_t height = kHeight);
+        virtual ~TFT_eSPI() {}
+
+        void init() {}
+        void setRotation(uint8_t rotation);
+
+        int16_t width() const { return width_; }
+        int16_t height() const { return height_; }
+
+        void fillScreen(uint32_t color) { fillRect(0, 0, width_, height_, color); }
+        void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+        void drawPixel(int32_t x, int32_t y, uint32_t color);
+        uint16_t readPixel(int32_t x, int32_t y);
+
+        /** Copies an image of RGB565 pixels */
+        void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data);
+
+        void setTextFont(uint8_t font) { font_ = font; }
+        void setTextSize(uint8_t size) { textSize_ = max(size, (uint8_t) 1); }
+
+        /** Only the foreground color: the background is not drawn (transparent) */
+        void setTextColor(uint16_t color) { textColor_ = color; textBgColor_ = color; }
+        void setTextColor(uint16_t color, uint16_t bgColor) { textColor_ = color; textBgColor_ = bgColor; }
+
+        void setCursor(int16_t x, int16_t y) { cursorX_ = x; cursorY_ = y; }
+        void setTextWrap(bool wrap) { textWrap_ = wrap; }
+
+        int16_t fontHeight() const { return fontHeight(font_); }
+        int16_t fontHeight(uint8_t font) const;
+        int16_t textWidth(const char *str) const { return textWidth(str, font_); }
+        int16_t textWidth(const char *str, uint8_t font) const;
+
+        /** @return Width of the character */
+        int16_t drawChar(uint16_t c, int32_t x, int32_t y, uint8_t font);
+
+        size_t write(uint8_t c) override;
+        using Print::write;
+
+    protected:
+        // Width of a character of a font
+        int16_t charWidth(uint8_t font) const;
+
+        int16_t width_;
+        int16_t height_;
+
+        std::vector<uint16_t> pixels_;
+
+        uint8_t font_;
+        uint8_t textSize_;
+        uint16_t textColor_;
+        uint16_t textBgColor_;
+        int16_t cursorX_;
+        int16_t cursorY_;
+        bool textWrap_;
+};
+
+class TFT_eSprite : public TFT_eSPI {
+    public:
+        TFT_eSprite(TFT_eSPI *pTft);
+
+        /** @return Pointer to the pixels, nullptr if the memory cannot be allocated */
+        void* createSprite(int16_t width, int16_t height);
+        void deleteSprite();
+
+        void fillSprite(uint32_t color) { fillScreen(color); }
+
+        /** Copies the sprite to the display */
+        void pushSprite(int32_t x, int32_t y);
+
+    private:
+        TFT_eSPI *pTft_;
+};
+
+/** Power management chip AXP192 */
+class AXP192 {
+    public:
+        /** Brightness of the backlight (7 ... 12) */
+        void ScreenBreath(uint8_t brightness) { brightness_ = brightness; }
+
+    private:
+        uint8_t brightness_ = 12;
+};
+
+class M5StickCPlus {
+    public:
+        void begin(bool lcdEnable = true, bool powerEnable = true, bool serialEnable = true);
+
+        TFT_eSPI Lcd;
+        AXP192 Axp;
+};
+
+extern M5StickCPlus M5;
@@ -0,0 +1,172 @@
+/**
+    NativeHal:
+    Control of the native HAL by the host program and the tests: flash
+    directory, input levels of the buttons, WiFi link and the statistics
+    of the modelled I2S output.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "NativeHal.h"
+#include "IftttHook.h"
+#include "WifiCredentials.h"
+#include <dirent.h>
+#include <errno.h>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+/** Default directory of the flash file system (relative to the project) */
+const char kDefaultFlashDir[] = ".pio/native_flash";
+
+/** Directory with the files of the flash file system ('Upload Filesystem Image') */
+const char kDataDir[] = "data";
+
+// Credentials of the modelled access point, unless the application defines its own
+__attribute__((weak)) const char* WifiCredentials::SSID = "native";
+__attribute__((weak)) const char* WifiCredentials::PASSWORD = "";
+
+// No webhook unless the application defines one (song infos stay in the outbox)
+__attribute__((weak)) const char* IftttHook::IFTTT_ADD_SONG = "";
+
+static std::string flashDir_ = kDefaultFlashDir;
+static std::string nvsDir_ = std::string(kDefaultFlashDir) + "_nvs";
+
+// Arguments of the program for 'ESP.restart'
+static std::vector<char*> arguments_;
+
+static NativeHal::I2sStats i2sStats_ = {0, 0, 0, 0};
+static std::mutex i2sMutex_;
+
+/**
+ * Creates a directory and its parents.
+ */
+static bool makeDirs(const std::string &dir) {
+    for (size_t pos = dir.find('/', 1); ; pos = dir.find('/', pos + 1)) {
+        std::string part = dir.substr(0, pos);
+
+        if (mkdir(part.c_str(), 0755) != 0 && errno != EEXIST) {
+            return false;
+        }
+
+        if (pos == std::string::npos) {
+            return true;
+        }
+    }
+}
+
+/**
+ * Copies the files of a directory (not recursive).
+ */
+static void copyFiles(const char *fromDir, const std::string &toDir) {
+    DIR *pDir = opendir(fromDir);
+
+    if (pDir == nullptr) {
+        log_w("No '%s' directory: the flash file system is empty", fromDir);
+        return;
+    }
+
+    while (struct dirent *pEntry = readdir(pDir)) {
+        std::string from = std::string(fromDir) + "/" + pEntry->d_name;
+        struct stat info;
+
+        if (pEntry->d_name[0] == '.' || stat(from.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+            continue;
+        }
+
+        FILE *pFrom = fopen(from.c_str(), "rb");
+        FILE *pTo = fopen((toDir + "/" + pEntry->d_name).c_str(), "wb");
+        char buffer[4096];
+        size_t n;
+
+        while (pFrom != nullptr && pTo != nullptr && (n = fread(buffer, 1, sizeof(buffer), pFrom)) > 0) {
+            fwrite(buffer, 1, n, pTo);
+        }
+
+        if (pFrom != nullptr) {
+            fclose(pFrom);
+        }
+
+        if (pTo != nullptr) {
+            fclose(pTo);
+        }
+    }
+
+    closedir(pDir);
+}
+
+bool NativeHal::begin(int argc, char **argv) {
+    arguments_.assign(argv, argv + argc);
+    arguments_.push_back(nullptr);
+
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (strcmp(argv[i], "--flash") == 0) {
+            flashDir_ = argv[i + 1];
+            nvsDir_ = flashDir_ + "_nvs";
+        }
+    }
+
+    struct stat info;
+    bool fresh = (stat(flashDir_.c_str(), &info) != 0);
+
+    if (!makeDirs(flashDir_) || !makeDirs(nvsDir_)) {
+        log_e("Cannot create '%s'", flashDir_.c_str());
+        return false;
+    }
+
+    if (fresh) {
+        copyFiles(kDataDir, flashDir_);
+    }
+
+    log_i("Flash file system: '%s'", flashDir_.c_str());
+
+    return true;
+}
+
+const char* NativeHal::flashDir() {
+    return flashDir_.c_str();
+}
+
+const char* NativeHal::nvsDir() {
+    return nvsDir_.c_str();
+}
+
+NativeHal::I2sStats NativeHal::i2sStats() {
+    std::lock_guard<std::mutex> lock(i2sMutex_);
+
+    return i2sStats_;
+}
+
+void NativeHal::updateI2sStats(const I2sStats &stats) {
+    std::lock_guard<std::mutex> lock(i2sMutex_);
+
+    i2sStats_ = stats;
+}
+
+void EspClass::restart() {
+    log_i("Restart");
+
+    fflush(stdout);
+
+    if (arguments_.size() > 1) {
+        execv("/proc/self/exe", arguments_.data());
+    }
+
+    // Without the arguments (tests) or if the program cannot be started again
+    _exit(0);
+}
@@ -0,0 +1,101 @@
+/**
+    NativeHal:
+    Control of the native HAL by the host program and the tests: flash
+    directory, input levels of the buttons, WiFi link and the statistics
+    of the modelled I2S output.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+namespace NativeHal {
+    /** Association times of the modelled WiFi in ms (typical ESP32 values) */
+    struct WifiTiming {
+        uint32_t scan;      // Association with scan
+        uint32_t direct;    // Association with known channel and BSSID
+        uint32_t dhcp;      // DHCP after associating (skipped with a static IP)
+    };
+
+    /** Statistics of the modelled I2S output */
+    struct I2sStats {
+        uint64_t frames;        // Frames written to the DMA buffers
+        uint32_t underruns;     // Times the DMA buffers ran empty while playing
+        uint32_t sampleRate;    // Sample rate in Hz (0 = not configured)
+        uint32_t fill;          // Frames in the DMA buffers
+    };
+
+    /**
+     * Initializes the HAL before 'setup'. Arguments of the program (all optional):
+     *   --flash <dir>   Directory of the flash file system, the preferences and the EEPROM ('.pio/native_flash').
+     *                   A new directory is filled with the files from 'data/' like 'Upload Filesystem Image'.
+     *
+     * @return false if the flash directory cannot be created.
+     */
+    bool begin(int argc, char **argv);
+
+    /** Directory of the flash file system (LittleFS) */
+    const char* flashDir();
+
+    /** Directory of the non-volatile storage (Preferences, EEPROM) */
+    const char* nvsDir();
+
+    /**
+     * Sets the level of an input pin. An interrupt handler attached to the pin runs on the calling
+     * thread, like an interrupt service routine that interrupts the tasks.
+     */
+    void setPin(uint8_t pin, int level);
+
+    /** Level of a pin */
+    int pin(uint8_t pin);
+
+    /**
+     * Queues input of the serial console ('Serial'), read before the input from standard input.
+     * Used to send the console commands of the application (e.g. "r" to replay the capture).
+     */
+    void serialInput(const char *text);
+
+    /**
+     * Presses the power button of the AXP192: the chip reports the press on its IRQ line after the
+     * button has been released (short press) or the long press time has passed.
+     */
+    void pressPowerButton(bool longPress);
+
+    /**
+     * Sets the state of the WiFi link. While the link is down the access point is out of reach:
+     * the station is disconnected and no data is transferred on the open connections.
+     */
+    void setWifiLink(bool up);
+
+    /** State of the WiFi link */
+    bool wifiLink();
+
+    void setWifiTiming(const WifiTiming &timing);
+    const WifiTiming& wifiTiming();
+
+    /** Statistics of the modelled I2S output */
+    I2sStats i2sStats();
+
+    /** Used by the audio library model */
+    void updateI2sStats(const I2sStats &stats);
+
+    /**
+     * Allocations of the program in bytes (outstanding 'malloc' memory), the base of the heap model.
+     */
+    size_t heapUsed();
+}
@@ -0,0 +1,202 @@
+/**
+    Preferences (native HAL):
+    Non-volatile storage of the Arduino core. Each key of a namespace is a
+    file in the NVS directory of the HAL, so the values survive a restart.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <Preferences.h>
+#include "NativeHal.h"
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** Maximum length of a namespace or key like in the NVS library */
+const size_t kMaxNameLength = 15;
+
+Preferences::Preferences() :
+    readOnly_(false)
+{
+}
+
+Preferences::~Preferences() {
+    end();
+}
+
+bool Preferences::begin(const char *name, bool readOnly) {
+    if (name == nullptr || strlen(name) == 0 || strlen(name) > kMaxNameLength) {
+        log_e("Invalid namespace '%s'", name != nullptr ? name : "");
+        return false;
+    }
+
+    std::string dir = std::string(NativeHal::nvsDir()) + "/" + name;
+
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        log_e("Cannot create '%s'", dir.c_str());
+        return false;
+    }
+
+    dir_ = dir;
+    readOnly_ = readOnly;
+
+    return true;
+}
+
+void Preferences::end() {
+    dir_.clear();
+}
+
+bool Preferences::clear() {
+    if (dir_.empty() || readOnly_) {
+        return false;
+    }
+
+    DIR *pDir = opendir(dir_.c_str());
+
+    if (pDir == nullptr) {
+        return false;
+    }
+
+    while (struct dirent *pEntry = readdir(pDir)) {
+        if (pEntry->d_name[0] != '.') {
+            unlink((dir_ + "/" + pEntry->d_name).c_str());
+        }
+    }
+
+    closedir(pDir);
+
+    return true;
+}
+
+bool Preferences::remove(const char *key) {
+    std::string path = keyPath(key);
+
+    return !path.empty() && !readOnly_ && unlink(path.c_str()) == 0;
+}
+
+bool Preferences::isKey(const char *key) {
+    std::string path = keyPath(key);
+    struct stat info;
+
+    return !path.empty() && stat(path.c_str(), &info) == 0;
+}
+
+size_t Preferences::putUChar(const char *key, uint8_t value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+size_t Preferences::putUShort(const char *key, uint16_t value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+size_t Preferences::putUInt(const char *key, uint32_t value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t length) {
+    std::string path = keyPath(key);
+
+    if (path.empty() || readOnly_ || value == nullptr || length == 0) {
+        return 0;
+    }
+
+    // Write a new file and replace the old one, so a crash does not leave a partial value
+    std::string tmpPath = path + ".tmp";
+    FILE *pFile = fopen(tmpPath.c_str(), "wb");
+
+    if (pFile == nullptr) {
+        return 0;
+    }
+
+    bool ok = (fwrite(value, 1, length, pFile) == length);
+
+    ok = (fclose(pFile) == 0) && ok;
+
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        unlink(tmpPath.c_str());
+        return 0;
+    }
+
+    return length;
+}
+
+uint8_t Preferences::getUChar(const char *key, uint8_t defaultValue) {
+    uint8_t value;
+
+    return read(key, &value, sizeof(value)) ? value : defaultValue;
+}
+
+uint16_t Preferences::getUShort(const char *key, uint16_t defaultValue) {
+    uint16_t value;
+
+    return read(key, &value, sizeof(value)) ? value : defaultValue;
+}
+
+uint32_t Preferences::getUInt(const char *key, uint32_t defaultValue) {
+    uint32_t value;
+
+    return read(key, &value, sizeof(value)) ? value : defaultValue;
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+    std::string path = keyPath(key);
+    struct stat info;
+
+    if (path.empty() || stat(path.c_str(), &info) != 0) {
+        return 0;
+    }
+
+    return info.st_size;
+}
+
+size_t Preferences::getBytes(const char *key, void *buffer, size_t maxLength) {
+    size_t length = getBytesLength(key);
+
+    if (length == 0 || buffer == nullptr || length > maxLength) {
+        return 0;
+    }
+
+    return read(key, buffer, length) ? length : 0;
+}
+
+std::string Preferences::keyPath(const char *key) const {
+    if (dir_.empty() || key == nullptr || strlen(key) == 0 || strlen(key) > kMaxNameLength) {
+        return std::string();
+    }
+
+    return dir_ + "/" + key;
+}
+
+bool Preferences::read(const char *key, void *value, size_t length) {
+    if (getBytesLength(key) != length) {
+        return false;
+    }
+
+    FILE *pFile = fopen(keyPath(key).c_str(), "rb");
+
+    if (pFile == nullptr) {
+        return false;
+    }
+
+    bool ok = (fread(value, 1, length, pFile) == length);
+
+    fclose(pFile);
+
+    return ok;
+}
@@ -0,0 +1,62 @@
+/**
+    Preferences (native HAL):
+    Non-volatile storage of the Arduino core. Each key of a namespace is a
+    file in the NVS directory of the HAL, so the values survive a restart.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <string>
+
+class Preferences {
+    public:
+        Preferences();
+        ~Preferences();
+
+        /** Opens the namespace (created if needed) */
+        bool begin(const char *name, bool readOnly = false);
+        void end();
+
+        bool clear();
+        bool remove(const char *key);
+        bool isKey(const char *key);
+
+        size_t putUChar(const char *key, uint8_t value);
+        size_t putUShort(const char *key, uint16_t value);
+        size_t putUInt(const char *key, uint32_t value);
+        size_t putBytes(const char *key, const void *value, size_t length);
+
+        uint8_t getUChar(const char *key, uint8_t defaultValue = 0);
+        uint16_t getUShort(const char *key, uint16_t defaultValue = 0);
+        uint32_t getUInt(const char *key, uint32_t defaultValue = 0);
+        size_t getBytesLength(const char *key);
+
+        /** @return Length of the value, 0 if the key does not exist or 'maxLength' is too short */
+        size_t getBytes(const char *key, void *buffer, size_t maxLength);
+
+    private:
+        // Path of the file of a key ("" if the namespace is not open)
+        std::string keyPath(const char *key) const;
+
+        // Reads a value of exactly 'length' bytes
+        bool read(const char *key, void *value, size_t length);
+
+        std::string dir_;
+        bool readOnly_;
+};
@@ -0,0 +1,489 @@
+/**
+    StandinServer (native HAL):
+    Local stand-in for the hosts of the radio stations: an HTTP server on
+    127.0.0.2 that serves streams like Icecast (ICY header and metadata,
+    burst on connect, real-time data rate), playlists and redirects. Faults
+    of a host are configured per stream: slow connects, dropped and stalled
+    connections.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "StandinServer.h"
+#include <errno.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+const uint32_t StandinServer::kToneSampleRate;
+const uint32_t StandinServer::kToneFrequency;
+
+/** Interval in ms in which the connection threads check for the end of the server */
+const int kPollInterval = 50;
+
+/** Size of the chunks the stream data is sent in */
+const size_t kChunkSize = 512;
+
+/** Maximum time in ms for receiving the request header */
+const uint32_t kRequestTimeout = 2000;
+
+/** Header field of the body length of a POST request (with the preceding line break) */
+const char kContentLength[] = "\r\nContent-Length:";
+
+/** Address of the server (127.0.0.2): a host in the internet, whose connections depend on the WiFi link */
+const uint32_t kStandinAddress = 0x7F000002;
+
+StandinServer::Stream StandinServer::toneStream(const char *path, const char *name) {
+    Stream stream;
+
+    stream.path = path;
+    stream.byteRate = kToneSampleRate;
+    stream.burst = 2 * kToneSampleRate;
+    stream.connectDelay = 0;
+    stream.dropAfter = 0;
+    stream.stallAfter = 0;
+    stream.name = name;
+    stream.metaint = 8192;
+    stream.title = std::string(name) + " - Test Tone";
+
+    return stream;
+}
+
+StandinServer::StandinServer() :
+    listenFd_(-1),
+    port_(0),
+    stop_(false),
+    openConnections_(0)
+{
+}
+
+StandinServer::~StandinServer() {
+    end();
+}
+
+bool StandinServer::begin(uint16_t port) {
+    if (listenFd_ >= 0) {
+        return true;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(kStandinAddress);
+
+    if (fd < 0 || bind(fd, (struct sockaddr*) &address, sizeof(address)) != 0 || listen(fd, 16) != 0
+        || getsockname(fd, (struct sockaddr*) &address, &length) != 0) {
+        log_e("Stand-in server: cannot listen on port %u", port);
+
+        if (fd >= 0) {
+            close(fd);
+        }
+
+        return false;
+    }
+
+    listenFd_ = fd;
+    port_ = ntohs(address.sin_port);
+    stop_ = false;
+    acceptThread_ = std::thread(&StandinServer::acceptConnections, this);
+
+    log_i("Stand-in server on %s", url("/").c_str());
+
+    return true;
+}
+
+void StandinServer::end() {
+    if (listenFd_ < 0) {
+        return;
+    }
+
+    stop_ = true;
+    acceptThread_.join();
+
+    for (std::thread &thread : connectionThreads_) {
+        thread.join();
+    }
+
+    connectionThreads_.clear();
+    close(listenFd_);
+    listenFd_ = -1;
+}
+
+void StandinServer::addStream(const Stream &stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    resources_[stream.path] = {STREAM, stream, std::string(), 0};
+}
+
+void StandinServer::addPlaylist(const char *path, const char *streamUrl) {
+    std::string content;
+    size_t length = strlen(path);
+
+    if (length >= 4 && strcmp(path + length - 4, ".m3u") == 0) {
+        content = std::string("#EXTM3U\n#EXTINF:-1,Stand-in\n") + streamUrl + "\n";
+    }
+    else {
+        content = std::string("[playlist]\nNumberOfEntries=1\nFile1=") + streamUrl + "\nTitle1=Stand-in\nLength1=-1\nVersion=2\n";
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    resources_[path] = {PLAYLIST, Stream(), content, 0};
+}
+
+void StandinServer::addRedirect(const char *path, const char *location) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    resources_[path] = {REDIRECT, Stream(), location, 0};
+}
+
+void StandinServer::addWebhook(const char *path, int status) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry = resources_.find(path);
+
+    if (entry != resources_.end() && entry->second.kind == WEBHOOK) {
+        entry->second.status = status;
+    }
+    else {
+        resources_[path] = {WEBHOOK, Stream(), std::string(), 0, status, {}};
+    }
+}
+
+std::string StandinServer::url(const char *path) const {
+    return "http://127.0.0.2:" + std::to_string(port_) + path;
+}
+
+uint32_t StandinServer::requests(const char *path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto resource = resources_.find(path);
+
+    return (resource != resources_.end()) ? resource->second.requests : 0;
+}
+
+std::vector<std::string> StandinServer::posts(const char *path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto resource = resources_.find(path);
+
+    return (resource != resources_.end()) ? resource->second.posts : std::vector<std::string>();
+}
+
+void StandinServer::acceptConnections() {
+    while (!stop_) {
+        struct pollfd listener = {listenFd_, POLLIN, 0};
+
+        if (poll(&listener, 1, kPollInterval) <= 0) {
+            continue;
+        }
+
+        int fd = accept(listenFd_, nullptr, nullptr);
+
+        if (fd >= 0) {
+            connectionThreads_.push_back(std::thread(&StandinServer::serve, this, fd));
+        }
+    }
+}
+
+void StandinServer::serve(int fd) {
+    ++openConnections_;
+
+    // Sending blocks at most for the poll interval, so the thread notices the end of the server
+    struct timeval timeout = {0, kPollInterval * 1000};
+    int noDelay = 1;
+
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    // Request header
+    std::string request;
+    unsigned long startTime = millis();
+
+    while (!stop_ && request.find("\r\n\r\n") == std::string::npos && millis() - startTime < kRequestTimeout) {
+        if ( !receive(fd, request) ) {
+            break;
+        }
+    }
+
+    char method[8] = "";
+    char uri[256] = "";
+
+    if (sscanf(request.c_str(), "%7s %255s", method, uri) == 2) {
+        std::string path = uri;
+
+        path = path.substr(0, path.find('?'));
+
+        Resource resource;
+        bool found = false;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto entry = resources_.find(path);
+
+            if (entry != resources_.end()) {
+                ++entry->second.requests;
+                resource = entry->second;
+                found = true;
+            }
+        }
+
+        std::string response;
+
+        if (!found) {
+            response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            sendAll(fd, response.data(), response.size());
+        }
+        else if (resource.kind == REDIRECT) {
+            response = "HTTP/1.1 302 Found\r\nLocation: " + resource.content + "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            sendAll(fd, response.data(), response.size());
+        }
+        else if (resource.kind == WEBHOOK) {
+            serveWebhook(fd, path, request);
+        }
+        else if (resource.kind == PLAYLIST) {
+            bool m3u = (path.size() >= 4 && path.compare(path.size() - 4, 4, ".m3u") == 0);
+
+            response = std::string("HTTP/1.1 200 OK\r\nContent-Type: ") + (m3u ? "audio/x-mpegurl" : "audio/x-scpls")
+                + "\r\nContent-Length: " + std::to_string(resource.content.size()) + "\r\nConnection: close\r\n\r\n"
+                + resource.content;
+            sendAll(fd, response.data(), response.size());
+        }
+        else {
+            bool metadata = (strcasestr(request.c_str(), "Icy-MetaData: 1") != nullptr
+                || strcasestr(request.c_str(), "Icy-MetaData:1") != nullptr);
+
+            serveStream(fd, resource.stream, metadata);
+        }
+    }
+
+    close(fd);
+
+    --openConnections_;
+}
+
+void StandinServer::serveStream(int fd, const Stream &stream, bool metadata) {
+    FILE *pFile = nullptr;
+
+    if ( !stream.file.empty() ) {
+        pFile = fopen(stream.file.c_str(), "rb");
+
+        if (pFile == nullptr) {
+            std::string response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+            log_w("Stand-in server: cannot open '%s'", stream.file.c_str());
+            sendAll(fd, response.data(), response.size());
+            return;
+        }
+    }
+
+    // Slow host
+    for (uint32_t waited = 0; waited < stream.connectDelay && !stop_; waited += kPollInterval) {
+        delay(min((uint32_t) kPollInterval, stream.connectDelay - waited));
+    }
+
+    bool mp3 = (stream.file.size() >= 4 && strcasecmp(stream.file.c_str() + stream.file.size() - 4, ".mp3") == 0);
+    uint32_t metaint = metadata ? stream.metaint : 0;
+
+    std::string header = std::string("HTTP/1.0 200 OK\r\n")
+        + "Content-Type: " + (mp3 ? "audio/mpeg" : "audio/wav") + "\r\n"
+        + "icy-name: " + stream.name + "\r\n"
+        + "icy-br: " + std::to_string(stream.byteRate * 8 / 1000) + "\r\n"
+        + (metaint > 0 ? "icy-metaint: " + std::to_string(metaint) + "\r\n" : std::string())
+        + "Cache-Control: no-cache\r\n\r\n";
+
+    if ( !sendAll(fd, header.data(), header.size()) ) {
+        if (pFile != nullptr) {
+            fclose(pFile);
+        }
+
+        return;
+    }
+
+    // Audio data: WAV header with an unknown length (0xFFFFFFFF) followed by the tone, or the file in a loop
+    const uint8_t wavHeader[44] = {
+        'R', 'I', 'F', 'F', 0xFF, 0xFF, 0xFF, 0xFF, 'W', 'A', 'V', 'E',
+        'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, 1, 0,
+        kToneSampleRate & 0xFF, (kToneSampleRate >> 8) & 0xFF, 0, 0,
+        kToneSampleRate & 0xFF, (kToneSampleRate >> 8) & 0xFF, 0, 0, 1, 0, 8, 0,
+        'd', 'a', 't', 'a', 0xFF, 0xFF, 0xFF, 0xFF
+    };
+
+    uint64_t sent = 0;
+    uint64_t toneSample = 0;
+    uint32_t metaCounter = metaint;
+    unsigned long startTime = millis();
+
+    while (!stop_) {
+        if (stream.dropAfter > 0 && sent >= stream.dropAfter) {
+            break;
+        }
+
+        if (stream.stallAfter > 0 && sent >= stream.stallAfter) {
+            delay(kPollInterval);
+            continue;
+        }
+
+        // Data rate in real time after the burst
+        uint64_t allowed = (stream.byteRate > 0) ? stream.burst + (uint64_t) stream.byteRate * (millis() - startTime) / 1000 : UINT64_MAX;
+
+        if (sent >= allowed) {
+            delay(10);
+            continue;
+        }
+
+        uint8_t chunk[kChunkSize];
+        size_t length = (size_t) min((uint64_t) kChunkSize, allowed - sent);
+
+        if (stream.dropAfter > 0) {
+            length = (size_t) min((uint64_t) length, stream.dropAfter - sent);
+        }
+
+        if (stream.stallAfter > 0) {
+            length = (size_t) min((uint64_t) length, stream.stallAfter - sent);
+        }
+
+        if (metaint > 0) {
+            length = min(length, (size_t) metaCounter);
+        }
+
+        if (pFile != nullptr) {
+            length = fread(chunk, 1, length, pFile);
+
+            if (length == 0) {
+                rewind(pFile);
+                continue;
+            }
+        }
+        else {
+            for (size_t i = 0; i < length; ++i) {
+                uint64_t position = sent + i;
+
+                if (position < sizeof(wavHeader)) {
+                    chunk[i] = wavHeader[position];
+                }
+                else {
+                    chunk[i] = (uint8_t) (128 + 64 * sin(2 * PI * kToneFrequency * toneSample++ / kToneSampleRate));
+                }
+            }
+        }
+
+        if ( !sendAll(fd, chunk, length) ) {
+            break;
+        }
+
+        sent += length;
+
+        if (metaint > 0 && (metaCounter -= length) == 0) {
+            // Metadata block: length in units of 16 bytes, padded with '\0'
+            std::string text = "StreamTitle='" + stream.title + "';";
+            uint8_t blocks = (uint8_t) min((text.size() + 15) / 16, (size_t) 255);
+            std::string block(1 + blocks * 16, '\0');
+
+            block[0] = (char) blocks;
+            block.replace(1, min(text.size(), (size_t) blocks * 16), text, 0, blocks * 16);
+
+            if ( !sendAll(fd, block.data(), block.size()) ) {
+                break;
+            }
+
+            metaCounter = metaint;
+        }
+    }
+
+    if (pFile != nullptr) {
+        fclose(pFile);
+    }
+}
+
+void StandinServer::serveWebhook(int fd, const std::string &path, const std::string &request) {
+    // Body: 'Content-Length' bytes after the header
+    const char *pLength = strcasestr(request.c_str(), kContentLength);
+    size_t bodyStart = request.find("\r\n\r\n") + 4;
+    size_t bodyEnd = bodyStart + ((pLength != nullptr) ? strtoul(pLength + strlen(kContentLength), nullptr, 10) : 0);
+    std::string data = request;
+    unsigned long startTime = millis();
+
+    while (!stop_ && data.size() < bodyEnd && millis() - startTime < kRequestTimeout) {
+        if ( !receive(fd, data) ) {
+            break;
+        }
+    }
+
+    int status = 400;
+
+    if (data.size() >= bodyEnd) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Resource &resource = resources_[path];
+
+        resource.posts.push_back(data.substr(bodyStart, bodyEnd - bodyStart));
+        status = resource.status;
+    }
+
+    std::string response = "HTTP/1.1 " + std::to_string(status) + (status < 300 ? " OK" : " Error")
+        + "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+    sendAll(fd, response.data(), response.size());
+}
+
+bool StandinServer::receive(int fd, std::string &request) {
+    struct pollfd client = {fd, POLLIN, 0};
+    char buffer[512];
+
+    if (poll(&client, 1, kPollInterval) <= 0) {
+        return true;
+    }
+
+    ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+
+    if (n <= 0) {
+        return false;
+    }
+
+    request.append(buffer, n);
+    return true;
+}
+
+bool StandinServer::sendAll(int fd, const void *data, size_t length) {
+    const uint8_t *pData = (const uint8_t*) data;
+
+    while (length > 0 && !stop_) {
+        ssize_t n = send(fd, pData, length, MSG_NOSIGNAL);
+
+        if (n > 0) {
+            pData += n;
+            length -= n;
+        }
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            continue; // Send timeout: the client does not read (e.g. paused), check for the end of the server
+        }
+        else {
+            return false;
+        }
+    }
+
+    return length == 0;
+}
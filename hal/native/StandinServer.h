@@ -0,0 +1,136 @@
+/**
+    StandinServer (native HAL):
+    Local stand-in for the hosts of the radio stations: an HTTP server on
+    127.0.0.2 that serves streams like Icecast (ICY header and metadata,
+    burst on connect, real-time data rate), playlists, redirects and
+    webhooks (IFTTT) that record the posted bodies. Faults
+    of a host are configured per stream: slow connects, dropped and stalled
+    connections.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class StandinServer {
+    public:
+        /** Sample rate of the generated tone (mono, 8 bit: 16000 bytes/s = 128 kbit/s) */
+        const static uint32_t kToneSampleRate = 16000;
+
+        /** Frequency of the generated tone in Hz */
+        const static uint32_t kToneFrequency = 440;
+
+        struct Stream {
+            std::string path;           // Path of the request, e.g. "/tone"
+            std::string file;           // File on the host served in a loop ("" = generated WAV tone)
+            uint32_t byteRate;          // Data rate in bytes/s (0 = as fast as possible)
+            uint32_t burst;             // Bytes sent right away after the header (burst on connect)
+            uint32_t connectDelay;      // Time in ms before the response is sent
+            uint32_t dropAfter;         // Bytes after which the connection is closed (0 = never)
+            uint32_t stallAfter;        // Bytes after which no more data is sent, the connection stays open (0 = never)
+            std::string name;           // 'icy-name'
+            uint32_t metaint;           // Audio bytes between the metadata blocks (0 = no metadata)
+            std::string title;          // Stream title sent in the metadata
+        };
+
+        /** Tone stream of a typical Icecast host: 128 kbit/s with 2 s burst on connect and metadata */
+        static Stream toneStream(const char *path, const char *name);
+
+        StandinServer();
+        ~StandinServer();
+
+        /**
+         * Starts serving on 127.0.0.2 (a host in the internet: 127.0.0.1 is the device itself).
+         *
+         * @param port TCP port (0 = any free port, see 'port').
+         * @return false if the port cannot be opened.
+         */
+        bool begin(uint16_t port = 0);
+
+        /** Closes all connections and stops the server */
+        void end();
+
+        /** Adds or replaces a stream */
+        void addStream(const Stream &stream);
+
+        /** Serves a playlist (M3U for a path ending in '.m3u', otherwise PLS) */
+        void addPlaylist(const char *path, const char *streamUrl);
+
+        /** Answers requests of the path with a redirect */
+        void addRedirect(const char *path, const char *location);
+
+        /**
+         * Accepts POST requests of the path like a webhook: the bodies are recorded (see 'posts').
+         * Called again for the path, the status code is changed and the recorded bodies are kept.
+         *
+         * @param status HTTP status code of the responses (e.g. 503 for a failing host).
+         */
+        void addWebhook(const char *path, int status = 200);
+
+        /** Bodies of the POST requests received by a webhook (oldest first) */
+        std::vector<std::string> posts(const char *path);
+
+        uint16_t port() const { return port_; }
+
+        /** URL of a path on the server */
+        std::string url(const char *path) const;
+
+        /** Number of requests of a path */
+        uint32_t requests(const char *path);
+
+        /** Number of connections that are currently open */
+        uint32_t openConnections() const { return openConnections_; }
+
+    private:
+        enum Kind {STREAM, PLAYLIST, REDIRECT, WEBHOOK};
+
+        struct Resource {
+            Kind kind;
+            Stream stream;
+            std::string content;                // Playlist or location of the redirect
+            uint32_t requests;
+            int status;                         // Status code of the webhook
+            std::vector<std::string> posts;     // Bodies received by the webhook
+        };
+
+        void acceptConnections();
+        void serve(int fd);
+        void serveStream(int fd, const Stream &stream, bool metadata);
+        void serveWebhook(int fd, const std::string &path, const std::string &request);
+
+        // Appends the data received within the poll interval to the request (false if the connection has been closed)
+        bool receive(int fd, std::string &request);
+
+        // Sends all bytes (false if the connection has been closed or the server is stopping)
+        bool sendAll(int fd, const void *data, size_t length);
+
+        int listenFd_;
+        uint16_t port_;
+        std::atomic<bool> stop_;
+        std::atomic<uint32_t> openConnections_;
+        std::thread acceptThread_;
+        std::vector<std::thread> connectionThreads_;
+        std::map<std::string, Resource> resources_;
+        std::mutex mutex_;
+};
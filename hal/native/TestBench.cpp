@@ -0,0 +1,104 @@
+/**
+    TestBench (native HAL):
+    Common part of the host tests that run the application against the
+    stand-in server.
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TestBench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "Metrics.h"
+#include "NativeHal.h"
+
+extern Histogram metricTimeToAudio_;
+
+/** Station catalogue in the flash directory */
+const char kCataloguePath[] = "/stations.txt";
+
+StandinServer standin_;
+
+/**
+ * Runs 'setup' and 'loop' of the sketch like the loop task of the Arduino core.
+ */
+static void loopTask(void *p) {
+    setup();
+
+    while (true) {
+        loop();
+    }
+}
+
+bool TestBench::begin(const char *name, char *argv0) {
+    static char flashDir[64];
+
+    snprintf(flashDir, sizeof(flashDir), "/tmp/radio_%s_XXXXXX", name);
+
+    if (mkdtemp(flashDir) == nullptr || !standin_.begin()) {
+        return false;
+    }
+
+    char *args[] = {argv0, (char*) "--flash", flashDir, nullptr};
+
+    if ( !NativeHal::begin(3, args) ) {
+        return false;
+    }
+
+    // Replaces the stations copied from 'data/'
+    std::string path = std::string(flashDir) + kCataloguePath;
+    FILE *pFile = fopen(path.c_str(), "w");
+
+    if (pFile == nullptr) {
+        return false;
+    }
+
+    fclose(pFile);
+
+    NativeHal::setPin(kPinButtonA, HIGH);
+    return true;
+}
+
+bool TestBench::addStation(const char *name, const std::string &urls) {
+    std::string path = std::string(NativeHal::flashDir()) + kCataloguePath;
+    FILE *pFile = fopen(path.c_str(), "a");
+
+    if (pFile == nullptr) {
+        return false;
+    }
+
+    fprintf(pFile, "%s|wav/128|%s\n", name, urls.c_str());
+    return fclose(pFile) == 0;
+}
+
+void TestBench::startRadio() {
+    xTaskCreatePinnedToCore(loopTask, "loopTask", 8192, nullptr, 1, nullptr, 1);
+}
+
+bool TestBench::waitForAudio(uint32_t count, uint32_t timeout) {
+    return waitFor([count] { return metricTimeToAudio_.count() >= count; }, timeout);
+}
+
+void TestBench::pressButtonA() {
+    NativeHal::setPin(kPinButtonA, LOW);
+    delay(kPressTime);
+    NativeHal::setPin(kPinButtonA, HIGH);
+}
+
+void TestBench::exit(int failures) {
+    fflush(stdout);
+    _exit(failures);
+}
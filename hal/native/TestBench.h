@@ -0,0 +1,94 @@
+/**
+    TestBench (native HAL):
+    Common part of the host tests that run the application against the
+    stand-in server: a fresh flash directory with the station catalogue,
+    the loop task of the sketch, button presses and waiting for audio.
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <string>
+#include "StandinServer.h"
+
+/** Stand-in server of the test program (started by 'TestBench::begin') */
+extern StandinServer standin_;
+
+namespace TestBench {
+    /** GPIO of button A (active low) */
+    const uint8_t kPinButtonA = 37;
+
+    /** Time in ms the button is held down */
+    const uint32_t kPressTime = 80;
+
+    /** Maximum time in ms until audio is expected to be unmuted */
+    const uint32_t kAudioTimeout = 10000;
+
+    /**
+     * Creates a new flash directory ('/tmp/radio_<name>_XXXXXX'), starts the stand-in server and initializes
+     * the HAL on the directory. The catalogue of the directory is emptied and button A is released.
+     *
+     * @param name Name of the test, part of the directory name.
+     * @param argv0 Name of the test program.
+     * @return false if the directory, the server or the HAL could not be set up.
+     */
+    bool begin(const char *name, char *argv0);
+
+    /**
+     * Appends a station to the catalogue of the flash directory ('stations.txt', WAV at 128 kbit/s).
+     *
+     * @param name Name of the station.
+     * @param urls Stream URL, alternates are appended with '|'.
+     * @return false if the catalogue cannot be written.
+     */
+    bool addStation(const char *name, const std::string &urls);
+
+    /** Starts the application: 'setup' and 'loop' run in the loop task like on the Arduino core */
+    void startRadio();
+
+    /**
+     * Waits until the condition is met.
+     *
+     * @return false on timeout.
+     */
+    template <typename Condition> bool waitFor(Condition condition, uint32_t timeout) {
+        unsigned long start = millis();
+
+        while (!condition()) {
+            if (millis() - start > timeout) {
+                return false;
+            }
+
+            delay(1);
+        }
+
+        return true;
+    }
+
+    /**
+     * Waits until audio has been unmuted 'count' times (since the start of the application).
+     *
+     * @return false on timeout.
+     */
+    bool waitForAudio(uint32_t count, uint32_t timeout = kAudioTimeout);
+
+    /** Presses and releases button A */
+    void pressButtonA();
+
+    /** Ends the test program with the number of failures as exit code (the tasks of the application never end) */
+    void exit(int failures) __attribute__((noreturn));
+}
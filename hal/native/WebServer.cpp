@@ -0,0 +1,184 @@
+/**
+    WebServer (native HAL):
+    HTTP server of the Arduino core on a socket of the host. Privileged ports
+    (below 1024) are moved up by 'kPortOffset', e.g. port 80 is served on 8080.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <WebServer.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+const uint16_t WebServer::kPortOffset;
+
+/** Maximum time in ms for receiving the request header */
+const uint32_t kRequestTimeout = 2000;
+
+/** Text of the status codes sent */
+static const char* statusText(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        default: return "";
+    }
+}
+
+WebServer::WebServer(uint16_t port) :
+    port_(port < 1024 ? port + kPortOffset : port),
+    listenFd_(-1),
+    method_(HTTP_ANY),
+    contentLength_(0)
+{
+}
+
+WebServer::~WebServer() {
+    stop();
+}
+
+void WebServer::begin() {
+    if (listenFd_ >= 0) {
+        return;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in address;
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port_);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (fd < 0 || bind(fd, (struct sockaddr*) &address, sizeof(address)) != 0 || listen(fd, 4) != 0) {
+        log_w("Web server: cannot listen on port %u", port_);
+
+        if (fd >= 0) {
+            close(fd);
+        }
+
+        return;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    listenFd_ = fd;
+
+    log_i("Web server listening on port %u", port_);
+}
+
+void WebServer::stop() {
+    client_.stop();
+
+    if (listenFd_ >= 0) {
+        close(listenFd_);
+        listenFd_ = -1;
+    }
+}
+
+void WebServer::on(const char *uri, HTTPMethod method, THandlerFunction handler) {
+    routes_.push_back({uri, method, handler});
+}
+
+void WebServer::handleClient() {
+    if (listenFd_ < 0) {
+        return;
+    }
+
+    int fd = accept(listenFd_, nullptr, nullptr);
+
+    if (fd < 0) {
+        return;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    client_ = WiFiClient(fd);
+    contentLength_ = 0;
+
+    if ( readRequest() ) {
+        std::string path = uri_.substr(0, uri_.find('?'));
+        bool handled = false;
+
+        for (const Route &route : routes_) {
+            if (route.uri == path && (route.method == HTTP_ANY || route.method == method_)) {
+                route.handler();
+                handled = true;
+                break;
+            }
+        }
+
+        if (!handled && notFoundHandler_) {
+            notFoundHandler_();
+        }
+        else if (!handled) {
+            send(404, "text/plain", String("Not found"));
+        }
+    }
+
+    client_.stop();
+}
+
+void WebServer::send(int code, const char *contentType, const String &content) {
+    std::string header = "HTTP/1.1 " + std::to_string(code) + " " + statusText(code) + "\r\n";
+
+    if (contentType != nullptr && contentType[0] != '\0') {
+        header += std::string("Content-Type: ") + contentType + "\r\n";
+    }
+
+    if (contentLength_ != CONTENT_LENGTH_UNKNOWN) {
+        header += "Content-Length: " + std::to_string(content.length()) + "\r\n";
+    }
+
+    header += "Connection: close\r\n\r\n";
+
+    sendContent_P(header.data(), header.size());
+    sendContent(content);
+}
+
+void WebServer::sendContent_P(const char *content, size_t size) {
+    if (size > 0) {
+        client_.write((const uint8_t*) content, size);
+    }
+}
+
+bool WebServer::readRequest() {
+    client_.setTimeout(kRequestTimeout);
+
+    String line = client_.readStringUntil('\n');
+    char method[8] = "";
+    char uri[256] = "";
+
+    if (sscanf(line.c_str(), "%7s %255s", method, uri) != 2) {
+        return false;
+    }
+
+    uri_ = uri;
+    method_ = (strcmp(method, "GET") == 0) ? HTTP_GET : (strcmp(method, "POST") == 0) ? HTTP_POST
+        : (strcmp(method, "HEAD") == 0) ? HTTP_HEAD : HTTP_ANY;
+
+    // Skip the header fields
+    do {
+        line = client_.readStringUntil('\n');
+        line.trim();
+    } while ( !line.isEmpty() );
+
+    return true;
+}
@@ -0,0 +1,92 @@
+/**
+    WebServer (native HAL):
+    HTTP server of the Arduino core on a socket of the host. Privileged ports
+    (below 1024) are moved up by 'kPortOffset', e.g. port 80 is served on 8080.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <functional>
+#include <vector>
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t) -1)
+
+typedef enum {
+    HTTP_ANY,
+    HTTP_GET,
+    HTTP_HEAD,
+    HTTP_POST,
+    HTTP_PUT,
+    HTTP_DELETE
+} HTTPMethod;
+
+class WebServer {
+    public:
+        typedef std::function<void()> THandlerFunction;
+
+        /** Offset added to privileged ports */
+        const static uint16_t kPortOffset = 8000;
+
+        WebServer(uint16_t port = 80);
+        ~WebServer();
+
+        void begin();
+        void stop();
+
+        /** Accepts and handles one pending request (does not block) */
+        void handleClient();
+
+        void on(const char *uri, HTTPMethod method, THandlerFunction handler);
+        void on(const char *uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+        void onNotFound(THandlerFunction handler) { notFoundHandler_ = handler; }
+
+        void setContentLength(size_t length) { contentLength_ = length; }
+
+        /** Sends the response header and the content (with 'CONTENT_LENGTH_UNKNOWN' the content follows by 'sendContent') */
+        void send(int code, const char *contentType = nullptr, const String &content = String());
+        void sendContent(const String &content) { sendContent_P(content.c_str(), content.length()); }
+        void sendContent_P(const char *content, size_t size);
+
+        String uri() const { return String(uri_); }
+        HTTPMethod method() const { return method_; }
+
+        /** Port the server listens on */
+        uint16_t port() const { return port_; }
+
+    private:
+        struct Route {
+            std::string uri;
+            HTTPMethod method;
+            THandlerFunction handler;
+        };
+
+        // Reads the request line and the header of the client (false on timeout)
+        bool readRequest();
+
+        uint16_t port_;
+        int listenFd_;
+        WiFiClient client_;
+        std::vector<Route> routes_;
+        THandlerFunction notFoundHandler_;
+
+        std::string uri_;
+        HTTPMethod method_;
+        size_t contentLength_;
+};
@@ -0,0 +1,526 @@
+/**
+    WiFi (native HAL):
+    WiFi station and TCP client of the Arduino core. The connection of the
+    host is used; association, DHCP and outages of the link are modelled,
+    so the reconnect handling of the application runs like on the device.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <WiFi.h>
+#include "NativeHal.h"
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+WiFiClass WiFi;
+
+/** Channel and BSSID of the modelled access point */
+const int32_t kWifiChannel = 6;
+const uint8_t kWifiBssid[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+
+/** MAC address of the station */
+const char kWifiMac[] = "24:0A:C4:00:00:01";
+
+/** Length of the event queue */
+const UBaseType_t kEventQueueLength = 8;
+
+/** Interval in ms in which a blocked socket operation checks the link */
+const uint32_t kSocketPollInterval = 10;
+
+/**
+ * Receive window of lwIP in bytes (CONFIG_TCP_WND_DEFAULT): limits the data queued for a client that does not
+ * read, instead of the buffers of the host growing to megabytes.
+ */
+const int kTcpWindow = 5744;
+
+/** Association times: scan plus association and DHCP of an ESP32 at a home access point */
+static NativeHal::WifiTiming wifiTiming_ = {1500, 300, 200};
+
+// State of the modelled link
+static std::atomic<bool> wifiLink_(true);
+
+struct WifiEvent {
+    system_event_id_t event;
+    uint8_t reason;
+};
+
+struct WiFiClient::Socket {
+    int fd;
+    bool closed;    // Peer has closed the connection
+    bool loopback;  // Connection to a port of the device (127.0.0.1), not affected by the WiFi link
+
+    Socket(int fd, bool loopback = false) : fd(fd), closed(false), loopback(loopback) {}
+    ~Socket() { if (fd >= 0) ::close(fd); }
+
+    bool linkUp() const { return wifiLink_ || loopback; }
+};
+
+/** Address of the device itself (the stand-in server on 127.0.0.2 is a host in the internet) */
+static bool isLoopback(IPAddress ip) {
+    return ip[0] == 127 && ip[1] == 0 && ip[2] == 0 && ip[3] == 1;
+}
+
+void NativeHal::setWifiLink(bool up) {
+    if (wifiLink_.exchange(up) != up) {
+        log_i("WiFi link %s", up ? "up" : "down");
+        WiFi.linkChanged(up);
+    }
+}
+
+bool NativeHal::wifiLink() {
+    return wifiLink_;
+}
+
+void NativeHal::setWifiTiming(const WifiTiming &timing) {
+    wifiTiming_ = timing;
+}
+
+const NativeHal::WifiTiming& NativeHal::wifiTiming() {
+    return wifiTiming_;
+}
+
+WiFiClass::WiFiClass() :
+    mode_(WIFI_OFF),
+    state_(IDLE),
+    staticIp_(false),
+    autoReconnect_(true),
+    direct_(false),
+    connectStart_(0),
+    connectTime_(0),
+    eventQueue_(nullptr),
+    pEventTask_(nullptr)
+{
+    memcpy(bssid_, kWifiBssid, sizeof(bssid_));
+
+    for (uint8_t i = 0; i < kMaxCallbacks; ++i) {
+        callbacks_[i] = {nullptr, SYSTEM_EVENT_MAX};
+    }
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+    if (mode == WIFI_OFF) {
+        state_ = IDLE;
+    }
+
+    mode_ = mode;
+
+    return true;
+}
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *password, int32_t channel, const uint8_t *bssid, bool connect) {
+    if (mode_ == WIFI_OFF) {
+        mode_ = WIFI_STA;
+    }
+
+    // A wrong channel or BSSID lets the direct association fail like on the device
+    direct_ = (channel != 0 && bssid != nullptr);
+
+    if (direct_ && (channel != kWifiChannel || memcmp(bssid, kWifiBssid, sizeof(kWifiBssid)) != 0)) {
+        state_ = IDLE;
+        return WL_DISCONNECTED;
+    }
+
+    state_ = connect ? CONNECTING : IDLE;
+    connectStart_ = millis();
+    connectTime_ = (direct_ ? wifiTiming_.direct : wifiTiming_.scan) + (staticIp_ ? 0 : wifiTiming_.dhcp);
+
+    return status();
+}
+
+bool WiFiClass::config(IPAddress localIp, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2) {
+    staticIp_ = (uint32_t) localIp != 0;
+
+    return true;
+}
+
+bool WiFiClass::reconnect() {
+    if (mode_ == WIFI_OFF) {
+        return false;
+    }
+
+    if (state_ != CONNECTED) {
+        direct_ = true; // The access point is known
+        state_ = CONNECTING;
+        connectStart_ = millis();
+        connectTime_ = wifiTiming_.direct + (staticIp_ ? 0 : wifiTiming_.dhcp);
+    }
+
+    return true;
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAp) {
+    bool wasConnected = (state_ == CONNECTED);
+
+    state_ = IDLE;
+
+    if (wifiOff) {
+        mode_ = WIFI_OFF;
+    }
+
+    if (wasConnected) {
+        postEvent(SYSTEM_EVENT_STA_DISCONNECTED, WIFI_REASON_ASSOC_LEAVE);
+    }
+
+    return true;
+}
+
+bool WiFiClass::setAutoReconnect(bool autoReconnect) {
+    autoReconnect_ = autoReconnect;
+
+    return true;
+}
+
+bool WiFiClass::setHostname(const char *hostname) {
+    return true;
+}
+
+wl_status_t WiFiClass::status() {
+    if (state_ == CONNECTING) {
+        // The association only proceeds while the access point is in reach
+        if (!wifiLink_) {
+            connectStart_ = millis();
+        }
+        else if (millis() - connectStart_ >= connectTime_) {
+            state_ = CONNECTED;
+        }
+    }
+
+    switch (state_) {
+        case CONNECTED:
+            return WL_CONNECTED;
+
+        case CONNECTING:
+            return WL_DISCONNECTED;
+
+        default:
+            return (mode_ == WIFI_OFF) ? WL_NO_SHIELD : WL_IDLE_STATUS;
+    }
+}
+
+IPAddress WiFiClass::localIP() {
+    return (state_ == CONNECTED) ? IPAddress(127, 0, 0, 1) : IPAddress();
+}
+
+IPAddress WiFiClass::gatewayIP() {
+    return (state_ == CONNECTED) ? IPAddress(127, 0, 0, 1) : IPAddress();
+}
+
+IPAddress WiFiClass::subnetMask() {
+    return (state_ == CONNECTED) ? IPAddress(255, 0, 0, 0) : IPAddress();
+}
+
+IPAddress WiFiClass::dnsIP(uint8_t index) {
+    return (state_ == CONNECTED && index == 0) ? IPAddress(127, 0, 0, 1) : IPAddress();
+}
+
+String WiFiClass::macAddress() {
+    return String(kWifiMac);
+}
+
+uint8_t* WiFiClass::BSSID() {
+    return bssid_;
+}
+
+int32_t WiFiClass::channel() {
+    return kWifiChannel;
+}
+
+int WiFiClass::hostByName(const char *host, IPAddress &address) {
+    if (!wifiLink_ || status() != WL_CONNECTED) {
+        return 0;
+    }
+
+    struct addrinfo hints;
+    struct addrinfo *pResult = nullptr;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if (getaddrinfo(host, nullptr, &hints, &pResult) != 0 || pResult == nullptr) {
+        return 0;
+    }
+
+    address = IPAddress((uint32_t) ((struct sockaddr_in*) pResult->ai_addr)->sin_addr.s_addr);
+
+    freeaddrinfo(pResult);
+
+    return 1;
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventFuncCb callback, system_event_id_t event) {
+    if (eventQueue_ == nullptr) {
+        eventQueue_ = xQueueCreate(kEventQueueLength, sizeof(WifiEvent));
+        xTaskCreate(eventTask, "sys_evt", 4096, this, configMAX_PRIORITIES - 5, &pEventTask_);
+    }
+
+    for (uint8_t i = 0; i < kMaxCallbacks; ++i) {
+        if (callbacks_[i].callback == nullptr) {
+            callbacks_[i] = {callback, event};
+            return i + 1;
+        }
+    }
+
+    return 0;
+}
+
+void WiFiClass::removeEvent(WiFiEventFuncCb callback, system_event_id_t event) {
+    for (uint8_t i = 0; i < kMaxCallbacks; ++i) {
+        if (callbacks_[i].callback == callback && callbacks_[i].event == event) {
+            callbacks_[i] = {nullptr, SYSTEM_EVENT_MAX};
+        }
+    }
+}
+
+void WiFiClass::linkChanged(bool up) {
+    if (up) {
+        if (autoReconnect_ && state_ == IDLE && mode_ != WIFI_OFF) {
+            reconnect();
+        }
+
+        return;
+    }
+
+    // The station notices the lost access point by the missing beacons
+    if (state_ == CONNECTED) {
+        state_ = autoReconnect_ ? CONNECTING : IDLE;
+        postEvent(SYSTEM_EVENT_STA_DISCONNECTED, WIFI_REASON_BEACON_TIMEOUT);
+    }
+}
+
+void WiFiClass::postEvent(system_event_id_t event, uint8_t reason) {
+    if (eventQueue_ != nullptr) {
+        WifiEvent evt = {event, reason};
+
+        xQueueSend(eventQueue_, &evt, 0);
+    }
+}
+
+void WiFiClass::eventTask(void *p) {
+    WiFiClass *pWiFi = (WiFiClass*) p;
+    WifiEvent evt;
+
+    while (true) {
+        if (xQueueReceive(pWiFi->eventQueue_, &evt, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        WiFiEventInfo_t info;
+
+        memset(&info, 0, sizeof(info));
+        info.disconnected.reason = evt.reason;
+
+        for (uint8_t i = 0; i < kMaxCallbacks; ++i) {
+            Callback callback = pWiFi->callbacks_[i];
+
+            if (callback.callback != nullptr && (callback.event == evt.event || callback.event == SYSTEM_EVENT_MAX)) {
+                callback.callback(evt.event, info);
+            }
+        }
+    }
+}
+
+WiFiClient::WiFiClient() {
+}
+
+WiFiClient::WiFiClient(int fd) :
+    socket_(std::make_shared<Socket>(fd))
+{
+}
+
+WiFiClient::~WiFiClient() {
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port, int32_t timeout) {
+    stop();
+
+    if (!wifiLink_ && !isLoopback(ip)) {
+        return 0;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (fd < 0) {
+        return 0;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &kTcpWindow, sizeof(kTcpWindow)); // Before connecting (window scaling)
+
+    struct sockaddr_in address;
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = (uint32_t) ip;
+
+    if (::connect(fd, (struct sockaddr*) &address, sizeof(address)) != 0 && errno != EINPROGRESS) {
+        ::close(fd);
+        return 0;
+    }
+
+    struct pollfd pfd = {fd, POLLOUT, 0};
+    int error = 0;
+    socklen_t length = sizeof(error);
+
+    if (poll(&pfd, 1, timeout) != 1 || getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0) {
+        ::close(fd);
+        return 0;
+    }
+
+    int noDelay = 1;
+
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    socket_ = std::make_shared<Socket>(fd, isLoopback(ip));
+
+    return 1;
+}
+
+int WiFiClient::connect(const char *host, uint16_t port, int32_t timeout) {
+    IPAddress ip;
+
+    if (!ip.fromString(host) && WiFi.hostByName(host, ip) != 1) {
+        return 0;
+    }
+
+    return connect(ip, port, timeout);
+}
+
+size_t WiFiClient::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t WiFiClient::write(const uint8_t *buffer, size_t size) {
+    if (!socket_ || socket_->fd < 0) {
+        return 0;
+    }
+
+    size_t sent = 0;
+    unsigned long start = millis();
+
+    while (sent < size && millis() - start < timeout_) {
+        ssize_t n = socket_->linkUp() ? ::send(socket_->fd, buffer + sent, size - sent, MSG_NOSIGNAL) : -1;
+
+        if (n > 0) {
+            sent += n;
+        }
+        else if (socket_->linkUp() && errno != EAGAIN && errno != EWOULDBLOCK) {
+            break;
+        }
+        else {
+            struct pollfd pfd = {socket_->fd, POLLOUT, 0};
+
+            poll(&pfd, 1, kSocketPollInterval);
+        }
+    }
+
+    return sent;
+}
+
+int WiFiClient::available() {
+    if (!socket_ || socket_->fd < 0 || !socket_->linkUp()) {
+        return 0;
+    }
+
+    int count = 0;
+
+    if (ioctl(socket_->fd, FIONREAD, &count) != 0) {
+        return 0;
+    }
+
+    if (count == 0 && !socket_->closed) {
+        uint8_t c;
+        ssize_t n = ::recv(socket_->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+
+        socket_->closed = (n == 0) || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+    }
+
+    return count;
+}
+
+int WiFiClient::read(uint8_t *buffer, size_t size) {
+    if (available() <= 0) {
+        return -1;
+    }
+
+    ssize_t n = ::recv(socket_->fd, buffer, size, MSG_DONTWAIT);
+
+    return (n > 0) ? (int) n : -1;
+}
+
+int WiFiClient::read() {
+    uint8_t c;
+
+    return (read(&c, 1) == 1) ? c : -1;
+}
+
+int WiFiClient::peek() {
+    if (available() <= 0) {
+        return -1;
+    }
+
+    uint8_t c;
+
+    return (::recv(socket_->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 1) ? c : -1;
+}
+
+size_t WiFiClient::readBytes(uint8_t *buffer, size_t length) {
+    size_t n = 0;
+    unsigned long start = millis();
+
+    while (n < length && millis() - start < timeout_) {
+        int count = read(buffer + n, length - n);
+
+        if (count > 0) {
+            n += count;
+        }
+        else if (!connected()) {
+            break;
+        }
+        else {
+            delay(1);
+        }
+    }
+
+    return n;
+}
+
+uint8_t WiFiClient::connected() {
+    if (!socket_ || socket_->fd < 0) {
+        return 0;
+    }
+
+    int count = available();
+
+    return (count > 0 || !socket_->closed) ? 1 : 0;
+}
+
+void WiFiClient::stop() {
+    socket_.reset();
+}
+
+int WiFiClient::fd() const {
+    return socket_ ? socket_->fd : -1;
+}
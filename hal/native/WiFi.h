@@ -0,0 +1,204 @@
+/**
+    WiFi (native HAL):
+    WiFi station and TCP client of the Arduino core. The connection of the
+    host is used; association, DHCP and outages of the link are modelled,
+    so the reconnect handling of the application runs like on the device.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <memory>
+
+typedef enum {
+    WL_NO_SHIELD = 255,
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL,
+    WL_SCAN_COMPLETED,
+    WL_CONNECTED,
+    WL_CONNECT_FAILED,
+    WL_CONNECTION_LOST,
+    WL_DISCONNECTED
+} wl_status_t;
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA,
+    WIFI_AP,
+    WIFI_AP_STA
+} wifi_mode_t;
+
+typedef enum {
+    SYSTEM_EVENT_WIFI_READY = 0,
+    SYSTEM_EVENT_SCAN_DONE,
+    SYSTEM_EVENT_STA_START,
+    SYSTEM_EVENT_STA_STOP,
+    SYSTEM_EVENT_STA_CONNECTED,
+    SYSTEM_EVENT_STA_DISCONNECTED,
+    SYSTEM_EVENT_STA_AUTHMODE_CHANGE,
+    SYSTEM_EVENT_STA_GOT_IP,
+    SYSTEM_EVENT_STA_LOST_IP,
+    SYSTEM_EVENT_MAX
+} system_event_id_t;
+
+/** Reasons of a disconnect used by the model */
+typedef enum {
+    WIFI_REASON_ASSOC_LEAVE = 8,
+    WIFI_REASON_BEACON_TIMEOUT = 200
+} wifi_err_reason_t;
+
+typedef struct {
+    uint8_t ssid[33];
+    uint8_t ssid_len;
+    uint8_t bssid[6];
+    uint8_t reason;
+} system_event_sta_disconnected_t;
+
+typedef union {
+    system_event_sta_disconnected_t disconnected;
+} system_event_info_t;
+
+typedef system_event_id_t WiFiEvent_t;
+typedef system_event_info_t WiFiEventInfo_t;
+typedef void (*WiFiEventFuncCb)(WiFiEvent_t event, WiFiEventInfo_t info);
+typedef size_t wifi_event_id_t;
+
+class WiFiClass {
+    public:
+        WiFiClass();
+
+        bool mode(wifi_mode_t mode);
+        wifi_mode_t getMode() const { return mode_; }
+
+        /**
+         * Starts associating with the access point: with channel and BSSID the scan is skipped.
+         * The station is connected after the association time of the model (see 'NativeHal::setWifiTiming').
+         */
+        wl_status_t begin(const char *ssid, const char *password = nullptr, int32_t channel = 0, const uint8_t *bssid = nullptr, bool connect = true);
+
+        /** Static IP configuration (skips DHCP), all addresses 0 = DHCP */
+        bool config(IPAddress localIp, IPAddress gateway, IPAddress subnet, IPAddress dns1 = (uint32_t) 0, IPAddress dns2 = (uint32_t) 0);
+
+        bool reconnect();
+        bool disconnect(bool wifiOff = false, bool eraseAp = false);
+        bool setAutoReconnect(bool autoReconnect);
+        bool setHostname(const char *hostname);
+
+        wl_status_t status();
+
+        IPAddress localIP();
+        IPAddress gatewayIP();
+        IPAddress subnetMask();
+        IPAddress dnsIP(uint8_t index = 0);
+        String macAddress();
+        uint8_t* BSSID();
+        int32_t channel();
+
+        /**
+         * Resolves a host name by the resolver of the host (fails while the link is down).
+         *
+         * @return 1 if the host has been resolved.
+         */
+        int hostByName(const char *host, IPAddress &address);
+
+        /** Callbacks are run by the event task, like the system event loop of the ESP32 */
+        wifi_event_id_t onEvent(WiFiEventFuncCb callback, system_event_id_t event = SYSTEM_EVENT_MAX);
+        void removeEvent(WiFiEventFuncCb callback, system_event_id_t event = SYSTEM_EVENT_MAX);
+
+        /** Called by 'NativeHal::setWifiLink' */
+        void linkChanged(bool up);
+
+    private:
+        enum State {IDLE, CONNECTING, CONNECTED};
+
+        // Sends an event to the callbacks
+        void postEvent(system_event_id_t event, uint8_t reason);
+
+        // Task running the event callbacks
+        static void eventTask(void *p);
+
+        wifi_mode_t mode_;
+        State state_;
+        bool staticIp_;
+        bool autoReconnect_;
+        bool direct_;
+
+        // Start of the association and its duration in ms
+        unsigned long connectStart_;
+        uint32_t connectTime_;
+
+        uint8_t bssid_[6];
+
+        static const uint8_t kMaxCallbacks = 8;
+
+        struct Callback {
+            WiFiEventFuncCb callback;
+            system_event_id_t event;
+        };
+
+        Callback callbacks_[kMaxCallbacks];
+
+        QueueHandle_t eventQueue_;
+        TaskHandle_t pEventTask_;
+};
+
+extern WiFiClass WiFi;
+
+/**
+ * TCP client on a socket of the host. No data is transferred while the WiFi link is down,
+ * the connection itself is kept like a TCP connection across a short outage.
+ */
+class WiFiClient : public Stream {
+    public:
+        WiFiClient();
+
+        /** Takes over the socket of an accepted connection */
+        explicit WiFiClient(int fd);
+
+        ~WiFiClient();
+
+        int connect(IPAddress ip, uint16_t port, int32_t timeout = 3000);
+        int connect(const char *host, uint16_t port, int32_t timeout = 3000);
+
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t *buffer, size_t size) override;
+        using Print::write;
+
+        int available() override;
+        int read() override;
+        int read(uint8_t *buffer, size_t size);
+        int peek() override;
+        size_t readBytes(uint8_t *buffer, size_t length) override;
+        using Stream::readBytes;
+
+        /** true while the connection is open or received data is left */
+        uint8_t connected();
+        void stop();
+
+        operator bool() { return connected(); }
+
+        /** Socket of the connection (-1 = not connected) */
+        int fd() const;
+
+    private:
+        struct Socket;
+
+        // Shared by copies of the client like in the Arduino core
+        std::shared_ptr<Socket> socket_;
+};
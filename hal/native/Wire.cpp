@@ -0,0 +1,151 @@
+/**
+    Wire (native HAL):
+    I2C bus of the Arduino core. The internal bus 'Wire1' of the M5StickC
+    Plus carries a model of the IRQ registers of the AXP192 power chip.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <Wire.h>
+#include "NativeHal.h"
+#include <mutex>
+
+TwoWire Wire(0);
+TwoWire Wire1(1);
+
+/** I2C address of the AXP192 on 'Wire1' */
+const uint8_t kAxpAddress = 0x34;
+
+/** Pin of the IRQ line of the AXP192 (low while an enabled event is pending) */
+const uint8_t kAxpIrqPin = 35;
+
+/** IRQ enable and status register of the power button: bit 1 = short press, bit 0 = long press */
+const uint8_t kAxpIrqEnable3 = 0x42;
+const uint8_t kAxpIrqStatus3 = 0x46;
+const uint8_t kAxpShortPress = 0x02;
+const uint8_t kAxpLongPress = 0x01;
+
+/** IRQ status registers, cleared by writing 1 */
+static bool isAxpIrqStatus(uint8_t reg) {
+    return (reg >= 0x44 && reg <= 0x47) || reg == 0x4D;
+}
+
+// Registers of the AXP192 (written by the application and by 'NativeHal::pressPowerButton')
+static uint8_t axpRegisters_[256];
+static std::mutex axpMutex_;
+
+/**
+ * Drives the IRQ line from the pending events (called with 'axpMutex_' released).
+ */
+static void updateAxpIrq() {
+    bool pending;
+
+    {
+        std::lock_guard<std::mutex> lock(axpMutex_);
+        pending = (axpRegisters_[kAxpIrqStatus3] & axpRegisters_[kAxpIrqEnable3]) != 0;
+    }
+
+    if (NativeHal::pin(kAxpIrqPin) != (pending ? LOW : HIGH)) {
+        NativeHal::setPin(kAxpIrqPin, pending ? LOW : HIGH);
+    }
+}
+
+void NativeHal::pressPowerButton(bool longPress) {
+    {
+        std::lock_guard<std::mutex> lock(axpMutex_);
+        axpRegisters_[kAxpIrqStatus3] |= longPress ? kAxpLongPress : kAxpShortPress;
+    }
+
+    updateAxpIrq();
+}
+
+TwoWire::TwoWire(uint8_t bus) :
+    bus_(bus),
+    address_(0),
+    rxIndex_(0),
+    reg_(0)
+{
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    address_ = address;
+    txBuffer_.clear();
+}
+
+size_t TwoWire::write(uint8_t value) {
+    txBuffer_.push_back(value);
+
+    return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+    if (bus_ != 1 || address_ != kAxpAddress) {
+        return 2;
+    }
+
+    if ( txBuffer_.empty() ) {
+        return 0;
+    }
+
+    reg_ = txBuffer_[0];
+
+    // Register address followed by the values of consecutive registers
+    if (txBuffer_.size() > 1) {
+        {
+            std::lock_guard<std::mutex> lock(axpMutex_);
+
+            for (size_t i = 1; i < txBuffer_.size(); ++i) {
+                uint8_t reg = (uint8_t) (reg_ + i - 1);
+
+                if ( isAxpIrqStatus(reg) ) {
+                    axpRegisters_[reg] &= ~txBuffer_[i];
+                }
+                else {
+                    axpRegisters_[reg] = txBuffer_[i];
+                }
+            }
+        }
+
+        updateAxpIrq();
+    }
+
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, bool sendStop) {
+    rxBuffer_.clear();
+    rxIndex_ = 0;
+
+    if (bus_ != 1 || address != kAxpAddress) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(axpMutex_);
+
+    for (uint8_t i = 0; i < quantity; ++i) {
+        rxBuffer_.push_back(axpRegisters_[(uint8_t) (reg_ + i)]);
+    }
+
+    return quantity;
+}
+
+int TwoWire::available() {
+    return rxBuffer_.size() - rxIndex_;
+}
+
+int TwoWire::read() {
+    return (rxIndex_ < rxBuffer_.size()) ? rxBuffer_[rxIndex_++] : -1;
+}
@@ -0,0 +1,57 @@
+/**
+    Wire (native HAL):
+    I2C bus of the Arduino core. The internal bus 'Wire1' of the M5StickC
+    Plus carries a model of the IRQ registers of the AXP192 power chip.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+class TwoWire {
+    public:
+        TwoWire(uint8_t bus);
+
+        bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) { return true; }
+
+        void beginTransmission(uint8_t address);
+        size_t write(uint8_t value);
+
+        /** @return 0 = success, 2 = no device at the address */
+        uint8_t endTransmission(bool sendStop = true);
+
+        /** @return Number of bytes received */
+        uint8_t requestFrom(uint8_t address, uint8_t quantity, bool sendStop = true);
+
+        int available();
+        int read();
+
+    private:
+        uint8_t bus_;
+        uint8_t address_;
+        std::vector<uint8_t> txBuffer_;
+        std::vector<uint8_t> rxBuffer_;
+        size_t rxIndex_;
+
+        // Register pointer set by the last write (for the following read)
+        uint8_t reg_;
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
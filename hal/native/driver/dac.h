@@ -0,0 +1,34 @@
+/**
+    dac (native HAL):
+    DAC driver of the ESP-IDF (the host has no DAC: the functions do nothing).
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum {
+    DAC_CHANNEL_1 = 0,
+    DAC_CHANNEL_2,
+    DAC_CHANNEL_MAX
+} dac_channel_t;
+
+inline esp_err_t dac_output_enable(dac_channel_t channel) { return ESP_OK; }
+inline esp_err_t dac_output_disable(dac_channel_t channel) { return ESP_OK; }
+inline esp_err_t dac_output_voltage(dac_channel_t channel, uint8_t value) { return ESP_OK; }
@@ -0,0 +1,32 @@
+/**
+    esp_freertos_hooks (native HAL):
+    Idle hooks of the ESP-IDF. The host has no idle task, so hooks cannot be registered.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "esp_err.h"
+
+typedef bool (*esp_freertos_idle_cb_t)();
+
+/**
+ * @return 'ESP_ERR_NOT_SUPPORTED' (the CPU load of the host is not measured by idle hooks).
+ */
+inline esp_err_t esp_register_freertos_idle_hook_for_cpu(esp_freertos_idle_cb_t hook, unsigned int cpu) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
@@ -0,0 +1,130 @@
+/**
+    FreeRTOS (native HAL):
+    The subset of the FreeRTOS API used by the application, implemented on
+    POSIX threads. One tick is one millisecond.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+typedef void (*TaskFunction_t)(void*);
+
+// Handles point to the objects of the host implementation
+typedef struct NativeTask* TaskHandle_t;
+typedef struct NativeQueue* QueueHandle_t;
+typedef QueueHandle_t SemaphoreHandle_t;
+
+#define pdFALSE ((BaseType_t) 0)
+#define pdTRUE ((BaseType_t) 1)
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define errQUEUE_FULL ((BaseType_t) 0)
+
+#define configTICK_RATE_HZ 1000
+#define configMAX_PRIORITIES 25
+
+#define portMAX_DELAY ((TickType_t) 0xFFFFFFFF)
+#define portTICK_PERIOD_MS ((TickType_t) 1000 / configTICK_RATE_HZ)
+#define portTICK_RATE_MS portTICK_PERIOD_MS
+#define pdMS_TO_TICKS(ms) ((TickType_t) (ms) * configTICK_RATE_HZ / 1000)
+
+#define tskIDLE_PRIORITY ((UBaseType_t) 0)
+#define tskNO_AFFINITY ((BaseType_t) 0x7FFFFFFF)
+
+/**
+ * Spinlock of the critical sections. Interrupt handlers of the host run on the thread that
+ * injects the interrupt, so they are serialized with the tasks by the same lock.
+ */
+typedef struct {
+    volatile uint32_t owner;
+    volatile uint32_t count;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}
+
+void vPortEnterCritical(portMUX_TYPE *mux);
+void vPortExitCritical(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux) vPortExitCritical(mux)
+#define portYIELD_FROM_ISR() do {} while (0)
+
+void taskYIELD();
+BaseType_t xPortGetCoreID();
+
+/**
+ * Tasks are threads of the host. Priorities and core affinity are stored but left to the scheduler of the host;
+ * the stack of a thread is larger than requested because host code needs more stack than the ESP32.
+ */
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackSize, void *param,
+    UBaseType_t priority, TaskHandle_t *pHandle, BaseType_t core);
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stackSize, void *param,
+    UBaseType_t priority, TaskHandle_t *pHandle);
+
+/**
+ * Deletes a task. Another task ends at its next call of a blocking RTOS function.
+ */
+void vTaskDelete(TaskHandle_t task);
+
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *pPreviousWakeTime, TickType_t increment);
+TickType_t xTaskGetTickCount();
+
+/**
+ * Handle of the calling task (threads not created by 'xTaskCreate', e.g. the main thread, are adopted as tasks).
+ */
+TaskHandle_t xTaskGetCurrentTaskHandle();
+const char* pcTaskGetTaskName(TaskHandle_t task);
+
+/**
+ * The stack use is not measured on the host: returns the configured stack size.
+ */
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *pHigherPriorityTaskWoken);
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *pItem, TickType_t ticks);
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *pItem, BaseType_t *pHigherPriorityTaskWoken);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *pItem, TickType_t ticks);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+BaseType_t xQueueReset(QueueHandle_t queue);
+
+#define xQueueSendToBack xQueueSend
+
+/**
+ * Semaphores are queues without item data like in FreeRTOS (mutexes are not recursive).
+ */
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t *pHigherPriorityTaskWoken);
+
+#define vSemaphoreDelete vQueueDelete
@@ -0,0 +1,196 @@
+/**
+    main (native HAL):
+    Entry point of the host program: runs 'setup' and 'loop' of the sketch
+    like the loop task of the Arduino core.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PIO_UNIT_TESTING
+
+#include <Arduino.h>
+#include <unistd.h>
+#include "Metrics.h"
+#include "NativeHal.h"
+#include "StandinServer.h"
+
+extern const char* kCapturePath;
+extern Counter metricReplays_;
+extern Gauge metricReplayFrameTime_;
+extern Gauge metricReplayHeadroom_;
+extern Gauge metricReplayLoopMax_;
+extern Gauge metricReplayMargin_;
+extern Gauge metricReplayHeapPeak_;
+
+/** Station catalogue of the stand-in server (written to the flash directory) */
+const char kStandinCataloguePath[] = "/stations.txt";
+
+/** Maximum time in ms from the start until the replay of a capture is expected to be completed */
+const uint32_t kReplayToolTimeout = 90000;
+
+// Serves the stations while the program runs
+static StandinServer standin_;
+
+/**
+ * Starts the stand-in server and replaces the station catalogue with its streams.
+ */
+static bool startStandin() {
+    if ( !standin_.begin() ) {
+        return false;
+    }
+
+    standin_.addStream(StandinServer::toneStream("/tone", "Stand-in Tone"));
+    standin_.addPlaylist("/tone.m3u", standin_.url("/tone").c_str());
+    standin_.addPlaylist("/tone.pls", standin_.url("/tone").c_str());
+    standin_.addRedirect("/moved", standin_.url("/tone").c_str());
+
+    StandinServer::Stream slow = StandinServer::toneStream("/slow", "Stand-in Slow Host");
+
+    slow.connectDelay = 1500;
+    slow.burst = 0;
+    standin_.addStream(slow);
+
+    StandinServer::Stream drop = StandinServer::toneStream("/drop", "Stand-in Dropping Host");
+
+    drop.dropAfter = 20 * StandinServer::kToneSampleRate; // About 18 s of audio after the burst
+    standin_.addStream(drop);
+
+    std::string path = std::string(NativeHal::flashDir()) + kStandinCataloguePath;
+    FILE *pFile = fopen(path.c_str(), "w");
+
+    if (pFile == nullptr) {
+        return false;
+    }
+
+    fprintf(pFile, "# Stations of the stand-in server (written by '--standin')\n");
+    fprintf(pFile, "Stand-in Tone|wav/128|%s\n", standin_.url("/tone").c_str());
+    fprintf(pFile, "Stand-in M3U|wav/128|%s\n", standin_.url("/tone.m3u").c_str());
+    fprintf(pFile, "Stand-in PLS|wav/128|%s\n", standin_.url("/tone.pls").c_str());
+    fprintf(pFile, "Stand-in Redirect|wav/128|%s\n", standin_.url("/moved").c_str());
+    fprintf(pFile, "Stand-in Slow Host|wav/128|%s\n", standin_.url("/slow").c_str());
+    fprintf(pFile, "Stand-in Dropping Host|wav/128|%s|%s\n", standin_.url("/drop").c_str(), standin_.url("/tone").c_str());
+
+    return fclose(pFile) == 0;
+}
+
+/**
+ * Runs 'setup' and 'loop' of the sketch like the loop task of the Arduino core.
+ */
+static void loopTask(void *p) {
+    setup();
+
+    while (true) {
+        loop();
+    }
+}
+
+/**
+ * Replays a capture through the decode and output path of the radio ('r' on the serial console) and prints
+ * the results in one line, so that recorded captures can be compared across builds.
+ *
+ * @return Exit code of the program (0 = replay completed).
+ */
+static int replayTool(const char *capture) {
+    std::string path = std::string(NativeHal::flashDir()) + kCapturePath;
+    FILE *pIn = fopen(capture, "rb");
+    FILE *pOut = fopen(path.c_str(), "wb");
+    bool copied = (pIn != nullptr && pOut != nullptr);
+
+    while (copied) {
+        uint8_t chunk[4096];
+        size_t n = fread(chunk, 1, sizeof(chunk), pIn);
+
+        if (n == 0) {
+            break;
+        }
+
+        copied = (fwrite(chunk, 1, n, pOut) == n);
+    }
+
+    if (pIn != nullptr) {
+        fclose(pIn);
+    }
+
+    if (pOut != nullptr && fclose(pOut) != 0) {
+        copied = false;
+    }
+
+    if (!copied) {
+        log_e("Replay: cannot copy '%s' to '%s'", capture, path.c_str());
+        return 1;
+    }
+
+    xTaskCreatePinnedToCore(loopTask, "loopTask", 8192, nullptr, 1, nullptr, 1);
+
+    // Processed by the application when it is ready (radio mode)
+    NativeHal::serialInput("r");
+
+    while (metricReplays_.value() == 0 && millis() < kReplayToolTimeout) {
+        delay(10);
+    }
+
+    if (metricReplays_.value() == 0) {
+        log_e("Replay: no result for '%s'", capture);
+        return 1;
+    }
+
+    printf("replay '%s': %d.%03d ms/frame, headroom %d%%, longest loop %d us, underrun margin %d us, peak heap %d bytes\n",
+        capture, metricReplayFrameTime_.value() / 1000, metricReplayFrameTime_.value() % 1000, metricReplayHeadroom_.value(),
+        metricReplayLoopMax_.value(), metricReplayMargin_.value(), metricReplayHeapPeak_.value());
+
+    return metricReplayMargin_.value() > 0 ? 0 : 2;
+}
+
+/**
+ * Arguments (all optional):
+ *   --flash <dir>   Directory of the flash file system (see 'NativeHal::begin').
+ *   --standin       Plays the streams of a local stand-in server instead of the stations from 'data/'.
+ *   --replay <file> Replays a capture of a stream (see 'c' on the serial console) as decode benchmark, prints
+ *                   the results and exits (exit code 2 if the longest loop iteration would cause an underrun).
+ */
+int main(int argc, char **argv) {
+    if ( !NativeHal::begin(argc, argv) ) {
+        return 1;
+    }
+
+    const char *capture = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--standin") == 0 && !startStandin()) {
+            log_e("Stand-in server could not be started.");
+            return 1;
+        }
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            capture = argv[++i];
+        }
+    }
+
+    if (capture != nullptr) {
+        int result = replayTool(capture);
+
+        // The tasks of the application never end
+        fflush(stdout);
+        _exit(result);
+    }
+
+    setup();
+
+    while (true) {
+        loop();
+    }
+}
+
+#endif
@@ -0,0 +1,75 @@
+/**
+    A2dpGainControl:
+    Volume control of the bluetooth sink (A2DP) that runs the PCM chain,
+    applies the AVRC volume through the per-sample gain ramp and records the
+    arrival of the audio data for the buffering monitor.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include "BluetoothA2DPSink.h"
+#include "BufferingMonitor.h"
+#include "GainRamp.h"
+#include "PcmChain.h"
+
+class A2dpGainControl : public A2DPVolumeControl {
+    public:
+        /** Maximum AVRC volume */
+        const static uint8_t kVolumeMax = 127;
+
+        /**
+         * @param pChain PCM chain applied to the received audio data (before the gain stage).
+         * @param pRamp Gain stage applied to the received audio data.
+         * @param fadeInTime Duration in ms of the fade-in when the first audio data arrives.
+         * @param rampTime Duration in ms of a ramp after the volume has been changed.
+         * @param pMonitor Monitor of the buffering delay, informed about each block of audio data.
+         */
+        A2dpGainControl(PcmChain *pChain, GainRamp *pRamp, uint32_t fadeInTime, uint32_t rampTime, BufferingMonitor *pMonitor);
+
+        /**
+         * Mutes the output and fades in with the next audio data (e.g. after the sink has been started).
+         */
+        void reset();
+
+        /**
+         * Called by the A2DP sink for each block of received audio data before it is written to I2S.
+         * 
+         * @param data Stereo frames, processed in place.
+         * @param frameCount Number of frames.
+         * @param volume AVRC volume (0 ... 'kVolumeMax').
+         * @param mono_downmix true = mix both channels to mono.
+         * @param is_volume_used true = the volume has been set by the source.
+         */
+        void update_audio_data(Frame* data, uint16_t frameCount, uint8_t volume, bool mono_downmix, bool is_volume_used);
+
+        // The volume is not applied as factor by the sink
+        int32_t get_volume_factor(uint8_t volume) { return 0x1000; }
+        int32_t get_volume_factor_max() { return 0x1000; }
+
+    private:
+        PcmChain *pChain_;
+        GainRamp *pRamp_;
+        BufferingMonitor *pMonitor_;
+
+        uint32_t fadeInTime_;
+        uint32_t rampTime_;
+
+        // Volume the gain has been ramped to (-1 = none yet)
+        int16_t volume_;
+};
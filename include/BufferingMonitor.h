@@ -0,0 +1,86 @@
+/**
+    BufferingMonitor:
+    Estimates the audio buffered between the arrival of PCM data and its
+    output by the DAC (buffering delay) and detects underruns.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+class BufferingMonitor {
+    public:
+        /** Statistics of a measurement interval */
+        struct Report {
+            uint32_t dmaDelay;      // Delay of the full I2S DMA buffers in ms
+            uint32_t delayAvg;      // Average buffering delay in ms (measured after each arrival of data)
+            uint32_t delayMin;      // Lowest buffering delay in ms
+            uint32_t delayMax;      // Highest buffering delay in ms
+            uint32_t maxGap;        // Longest time between two arrivals of data in ms
+            uint32_t underruns;     // Number of times the buffers ran empty
+            uint32_t frames;        // Number of frames received
+        };
+
+        BufferingMonitor();
+
+        /**
+         * Starts a new measurement.
+         * 
+         * @param sampleRate Sample rate in Hz.
+         * @param dmaFrames Capacity of the I2S DMA buffers in frames.
+         */
+        void begin(uint32_t sampleRate, uint32_t dmaFrames);
+
+        /**
+         * Records the arrival of PCM data (called by the task writing the data to I2S).
+         * 
+         * @param frames Number of stereo frames.
+         */
+        void onData(uint32_t frames);
+
+        /**
+         * Provides the statistics since the last report and starts a new interval.
+         * 
+         * @param report Statistics of the interval.
+         * @return false if no data has arrived in the interval.
+         */
+        bool takeReport(Report &report);
+
+    private:
+        // Sample rate in Hz and capacity of the DMA buffers in frames
+        uint32_t sampleRate_;
+        uint32_t dmaFrames_;
+
+        // Estimated number of frames buffered (received frames minus frames played since then)
+        int32_t level_;
+
+        // Time of the last arrival of data in us (0 = none yet)
+        uint32_t lastTime_;
+
+        // Statistics of the current interval (levels in frames, gap in us)
+        uint64_t levelSum_;
+        uint32_t levelCount_;
+        int32_t levelMin_;
+        int32_t levelMax_;
+        uint32_t maxGap_;
+        uint32_t underruns_;
+        uint32_t frames_;
+
+        // Spinlock protecting the statistics (written by the bluetooth task, read by the main loop)
+        portMUX_TYPE mux_;
+};
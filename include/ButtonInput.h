@@ -0,0 +1,151 @@
+/**
+    ButtonInput:
+    Interrupt-driven input of the buttons (GPIO) and of the power button of
+    the AXP192 power management IC (IRQ line). Edges are debounced in the
+    interrupt handler and passed to the main loop through a queue, which
+    also wakes up the main loop.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include "Metrics.h"
+
+class ButtonInput {
+    public:
+        /** Maximum number of buttons */
+        const static uint8_t kMaxButtons = 6;
+
+        /** Hold time reported for a long press of the power button in ms (set by the AXP192: 1.5 s by default) */
+        const static uint32_t kAxpLongPressTime = 1500;
+
+        /**
+         * @param debounceTime Minimum time in ms between two accepted edges of a button.
+         * @param pLatency Histogram receiving the time in us from the interrupt until the event is taken by 'update' (optional).
+         */
+        ButtonInput(uint32_t debounceTime, Histogram *pLatency);
+
+        /**
+         * Adds a button connected to a GPIO. Must be called before 'begin'.
+         * 
+         * @param id Number of the button (< 'kMaxButtons').
+         * @param pin GPIO of the button.
+         * @param activeHigh true = the pin reads HIGH while the button is pressed.
+         * @param pullUp true = enable the internal pull-up resistor.
+         */
+        void addButton(uint8_t id, uint8_t pin, bool activeHigh, bool pullUp);
+
+        /**
+         * Adds the power button of the AXP192 (read over I2C when the IRQ line signals a press). Must be called
+         * before 'begin'. The IRQ line is enabled for the power button only.
+         * 
+         * @param id Number of the button (< 'kMaxButtons').
+         * @param irqPin GPIO connected to the IRQ line of the AXP192.
+         */
+        void addAxpButton(uint8_t id, uint8_t irqPin);
+
+        /**
+         * Creates the event queue and attaches the interrupt handlers.
+         * 
+         * @param notifyTask Task notified by the interrupt handlers (nullptr = none), e.g. the main loop waiting in 'ulTaskNotifyTake'.
+         * @return false if the queue could not be created.
+         */
+        bool begin(TaskHandle_t notifyTask);
+
+        /**
+         * Takes the pending events and updates the state of the buttons (called by the main loop each cycle).
+         * The 'was...' states refer to the events taken by the last call.
+         */
+        void update();
+
+        /** Button is held down */
+        bool isPressed(uint8_t id) const { return buttons_[id].pressed; }
+
+        /** Button has been pressed */
+        bool wasPressed(uint8_t id) const { return buttons_[id].wasPressed; }
+
+        /** Button has been released */
+        bool wasReleased(uint8_t id) const { return buttons_[id].wasReleased; }
+
+        /** Button has been released after it was held for at least 'ms' milliseconds */
+        bool wasReleasefor(uint8_t id, uint32_t ms) const { return buttons_[id].wasReleased && buttons_[id].holdTime >= ms; }
+
+    private:
+        // Edge of a button detected by an interrupt handler
+        struct Edge {
+            uint8_t id;
+            bool pressed;
+            uint32_t time; // in us
+        };
+
+        // Configuration and state of a button
+        struct Button {
+            ButtonInput *pOwner;
+            uint8_t id;
+            uint8_t pin;
+            bool activeHigh;
+            bool pullUp;
+            bool axp; // Power button of the AXP192
+            bool used;
+
+            // State of the interrupt handler (protected by 'mux_')
+            bool isrPressed;
+            uint32_t isrTime; // Time of the last accepted edge in us
+
+            // State seen by the main loop
+            bool pressed;
+            uint32_t pressTime; // in us
+            uint32_t holdTime; // Hold time of the last press in ms
+            bool wasPressed;
+            bool wasReleased;
+        };
+
+        // Interrupt handlers
+        static void IRAM_ATTR gpioIsr(void *p);
+        static void IRAM_ATTR axpIsr(void *p);
+
+        // Queues an edge and wakes up the task to be notified (called by the interrupt handlers)
+        void IRAM_ATTR pushFromIsr(const Edge &edge);
+
+        // Applies an edge to the state seen by the main loop
+        void apply(const Edge &edge);
+
+        // Reads the power button events of the AXP192 and clears them
+        void readAxp(Button &button, uint32_t time);
+
+        // Queues edges missed by the interrupt handler (level changed again within the debounce time)
+        void resync(Button &button);
+
+        // Minimum time between two accepted edges in us
+        uint32_t debounceTime_;
+
+        // Latency from the interrupt until 'update'
+        Histogram *pLatency_;
+
+        // Buttons, indexed by their number
+        Button buttons_[kMaxButtons];
+
+        // Edges from the interrupt handlers
+        QueueHandle_t queue_;
+
+        // Task notified by the interrupt handlers
+        TaskHandle_t notifyTask_;
+
+        // Spinlock protecting the state of the interrupt handlers
+        portMUX_TYPE mux_;
+};
@@ -0,0 +1,67 @@
+/**
+    CpuLoad:
+    Measures the CPU utilisation of both ESP32 cores from the run time of
+    the FreeRTOS idle tasks (via idle hooks).
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+class CpuLoad {
+    public:
+        /** Number of CPU cores */
+        const static uint8_t kNumCores = 2;
+
+        /**
+         * Registers the idle hooks for both cores.
+         * While registered, the idle tasks do not enter the 'waiti' power saving state.
+         * 
+         * @return false if the hooks could not be registered.
+         */
+        static bool begin();
+
+        /**
+         * Returns the CPU load of both cores since the previous call.
+         * 
+         * @param load Receives the load per core in percent (0...100).
+         */
+        static void sample(uint8_t load[kNumCores]);
+
+    private:
+        // Idle hook of core 0
+        static bool idleHookCore0();
+
+        // Idle hook of core 1
+        static bool idleHookCore1();
+
+        // Accumulates the idle time of a core
+        static void accumulate(uint8_t core);
+
+        // Time of the previous idle hook call per core in us
+        static volatile int64_t lastHookTime_[kNumCores];
+
+        // Accumulated idle time per core in us
+        static volatile int64_t idleTime_[kNumCores];
+
+        // Time of the previous sample in us
+        static int64_t lastSampleTime_;
+
+        // Accumulated idle time per core at the previous sample in us
+        static int64_t lastIdleTime_[kNumCores];
+};
@@ -0,0 +1,154 @@
+/**
+    GainRamp:
+    Per-sample gain stage in Q15 fixed point with ramps along selectable
+    curves (fade-in, fade-out and volume changes without audible steps).
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+class GainRamp {
+    public:
+        /** Shape of a ramp from the current gain to the target gain */
+        enum Curve : uint8_t {
+            LINEAR = 0,         // Gain changes linearly
+            EXPONENTIAL = 1,    // Level changes linearly in dB (48 dB range), sounds even for fades
+            S_CURVE = 2         // Smooth start and end (smoothstep)
+        };
+
+        /** Gain 1.0 in Q15 */
+        const static int16_t kUnity = 32767;
+
+        /** Number of points of the curve tables (the curves are interpolated linearly in between) */
+        const static uint8_t kCurvePoints = 33;
+
+        GainRamp();
+
+        /**
+         * Sets the sample rate used for converting ramp durations into samples (applies to the next ramp).
+         * 
+         * @param sampleRate Sample rate in Hz.
+         */
+        void setSampleRate(uint32_t sampleRate);
+
+        /**
+         * Starts a ramp from the current gain to the target gain. May be called from any task,
+         * the ramp starts with the next processed sample.
+         * 
+         * @param gain Target gain in Q15 (0 ... 'kUnity').
+         * @param duration Duration of the ramp in ms (0 = immediately).
+         * @param curve Shape of the ramp.
+         */
+        void rampTo(int16_t gain, uint32_t duration, Curve curve);
+
+        /**
+         * Sets the gain immediately.
+         * 
+         * @param gain Gain in Q15 (0 ... 'kUnity').
+         */
+        void setGain(int16_t gain) { rampTo(gain, 0, LINEAR); }
+
+        /** Target gain of the current ramp in Q15 */
+        int16_t target() const;
+
+        /** true while a ramp is in progress (or has been requested) */
+        bool isRamping() const { return ramping_ || pending_; }
+
+        /**
+         * Applies the gain to a stereo frame.
+         */
+        void processFrame(int16_t &left, int16_t &right) {
+            if (pending_) {
+                applyPending();
+            }
+
+            if (ramping_) {
+                step();
+            }
+            else if (gain_ == kUnity) {
+                return;
+            }
+
+            left = (int16_t) (((int32_t) left * gain_) >> 15);
+            right = (int16_t) (((int32_t) right * gain_) >> 15);
+        }
+
+        /**
+         * Applies the gain to interleaved stereo samples.
+         * 
+         * @param samples Interleaved 16 bit samples (left, right).
+         * @param frames Number of stereo frames.
+         */
+        void process(int16_t *samples, size_t frames);
+
+        /**
+         * Converts a volume step into a gain along the exponential curve.
+         * 
+         * @param volume Volume step (0 = mute).
+         * @param maxVolume Volume step corresponding to 'kUnity'.
+         * @return Gain in Q15.
+         */
+        static int16_t volumeToGain(uint8_t volume, uint8_t maxVolume);
+
+        /**
+         * Evaluates a curve.
+         * 
+         * @param curve Shape of the curve.
+         * @param position Position on the curve in Q16 (0 ... 65536).
+         * @return Value of the curve in Q15 (0 ... 'kUnity').
+         */
+        static int16_t curveValue(Curve curve, uint32_t position);
+
+    private:
+        // Takes over a ramp requested by 'rampTo'
+        void applyPending();
+
+        // Advances the ramp by one sample
+        void step();
+
+        // Curve tables in Q15
+        static const int16_t kCurves[3][kCurvePoints];
+
+        // Sample rate in Hz
+        uint32_t sampleRate_;
+
+        // Ramp requested by 'rampTo', taken over by the processing task
+        volatile bool pending_;
+        int16_t pendingGain_;
+        uint32_t pendingDuration_;
+        Curve pendingCurve_;
+
+        // Current gain, gain at the start of the ramp and target gain in Q15
+        int16_t gain_;
+        int16_t start_;
+        int16_t target_;
+
+        // Curve of the current ramp
+        const int16_t *pCurve_;
+
+        // Position in the curve table in Q16 and its increment per sample
+        uint32_t phase_;
+        uint32_t increment_;
+
+        // Flag indicating that a ramp is in progress
+        bool ramping_;
+
+        // Spinlock protecting the requested ramp (requested and processed on different cores)
+        mutable portMUX_TYPE mux_;
+};
@@ -0,0 +1,96 @@
+/**
+    GlyphAtlas:
+    1-bit per pixel copy of the printable ASCII glyphs of a display font,
+    stored column by column. Built once at startup from the font renderer
+    of the display library.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <M5StickCPlus.h>
+
+class GlyphAtlas {
+    public:
+        /** First character contained in the atlas */
+        const static uint8_t kFirstChar = 32;
+
+        /** Last character contained in the atlas */
+        const static uint8_t kLastChar = 126;
+
+        /** Maximum glyph height in pixels (one column is stored in 32 bits at most) */
+        const static uint8_t kMaxHeight = 32;
+
+        GlyphAtlas();
+
+        ~GlyphAtlas();
+
+        /**
+         * Renders all glyphs of the font and stores them in the atlas.
+         * 
+         * @param pTft Display whose font renderer is used.
+         * @param font Font number.
+         * @param size Text size (scaling factor).
+         * @return false if the font is too high or memory could not be allocated.
+         */
+        bool build(TFT_eSPI *pTft, uint8_t font, uint8_t size);
+
+        /** Height of all glyphs in pixels */
+        uint8_t height() const { return height_; }
+
+        /**
+         * Width of a glyph in pixels (0 for characters that are not contained in the atlas).
+         */
+        uint8_t width(uint8_t c) const {
+            return (c >= kFirstChar && c <= kLastChar) ? widths_[c - kFirstChar] : 0;
+        }
+
+        /**
+         * Returns one column of a glyph. Bit n is set if the pixel in row n is set.
+         * 
+         * @param c Character.
+         * @param x Column within the glyph (0 ... width(c) - 1).
+         */
+        uint32_t column(uint8_t c, uint8_t x) const;
+
+        /**
+         * Width of a text in pixels.
+         */
+        int16_t textWidth(const char *text) const;
+
+        /** Memory used by the atlas in bytes */
+        size_t memoryUsage() const;
+
+    private:
+        // Number of glyphs in the atlas
+        const static uint8_t kNumGlyphs = kLastChar - kFirstChar + 1;
+
+        // Glyph height in pixels
+        uint8_t height_;
+
+        // Bytes per glyph column
+        uint8_t bytesPerColumn_;
+
+        // Glyph widths in pixels
+        uint8_t widths_[kNumGlyphs];
+
+        // Offset of the first column of each glyph in 'pBits_' (in columns)
+        uint16_t offsets_[kNumGlyphs];
+
+        // Glyph columns, 'bytesPerColumn_' bytes each (least significant byte first)
+        uint8_t *pBits_;
+};
@@ -0,0 +1,103 @@
+/**
+    HostCache:
+    Keeps the recently resolved stream hosts with their IP addresses in
+    RAM, so that connecting to them needs no DNS lookup, and times the
+    lookups of the other hosts.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+class HostCache {
+    public:
+        /** Maximum length of a host name including the terminating zero */
+        const static size_t kMaxHostLength = 64;
+
+        /** Number of cached hosts */
+        const static uint8_t kNumEntries = 8;
+
+        /** Result of resolving a host name */
+        struct Result {
+            IPAddress ip;       // IP address of the host
+            uint32_t dnsTime;   // Duration of the DNS lookup in ms (0 = address from the cache)
+            bool recent;        // true = host has been resolved within the time to live before (e.g. by the standby task)
+        };
+
+        /**
+         * @param ttl Time in seconds for which a resolved host counts as recent.
+         */
+        HostCache(uint32_t ttl);
+
+        /**
+         * Initializes the cache.
+         * 
+         * @return false if the cache cannot be used.
+         */
+        bool begin();
+
+        /**
+         * Extracts the host name from a URL.
+         * 
+         * @param url URL of the form 'scheme://host[:port]/path'.
+         * @param host Buffer receiving the host name (at least 'kMaxHostLength' bytes).
+         * @return false if the URL does not contain a host name.
+         */
+        static bool parseHost(const char *url, char *host);
+
+        /**
+         * Returns the IP address of the host. A host resolved within the time to live is answered from the cache
+         * without a lookup. Otherwise the lookup goes through the resolver of the network stack and is measured;
+         * it leaves the address in the cache of the network stack for connections by host name (e.g. TLS).
+         * 
+         * @param host Host name.
+         * @param result Receives the IP address and the duration of the lookup.
+         * @return false if the DNS lookup has failed.
+         */
+        bool resolve(const char *host, Result &result);
+
+        /**
+         * Removes the host from the cache (e.g. after a failed connection to the cached address),
+         * so that the next 'resolve' looks it up again.
+         */
+        void invalidate(const char *host);
+
+    private:
+        // Cache entry
+        struct Entry {
+            char host[kMaxHostLength];
+            uint32_t ip;
+            uint32_t time; // Time of the DNS lookup in ms since boot
+        };
+
+        // Returns the entry for the host or nullptr
+        Entry* find(const char *host);
+
+        // Returns the entry to be replaced by a new host (least recently resolved)
+        Entry* findOldest();
+
+        // Cached hosts
+        Entry entries_[kNumEntries];
+
+        // Mutex protecting the entries
+        SemaphoreHandle_t mutex_;
+
+        // Time in ms for which a resolved host counts as recent
+        uint32_t ttl_;
+};
@@ -0,0 +1,166 @@
+/**
+    IftttOutbox:
+    Queue of song infos for the IFTTT webhook, persisted in NVS and
+    delivered by a background task. Pending entries are sent in batches
+    of up to three (value1...value3), failed deliveries are retried with
+    exponential backoff.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+class IftttOutbox {
+    public:
+        /** Maximum length of an entry including the terminating zero */
+        const static size_t kMaxTextLength = 128;
+
+        /** Maximum number of pending entries */
+        const static uint8_t kCapacity = 16;
+
+        /** Maximum number of entries sent in one request (IFTTT supports 'value1' to 'value3') */
+        const static uint8_t kBatchSize = 3;
+
+        /** Delay of the first retry in ms (doubled with each failure) */
+        const static uint32_t kRetryMin = 2000;
+
+        /** Maximum delay between retries in ms */
+        const static uint32_t kRetryMax = 300000;
+
+        /** Minimum time in ms between two writes of the queue to NVS (later changes are written when it has elapsed) */
+        const static uint32_t kSaveInterval = 60000;
+
+        /** Maximum time in ms 'end' waits for the outbox task (a request being sent is completed first) */
+        const static uint32_t kStopTimeout = 12000;
+
+        /**
+         * @param url URL of the IFTTT webhook.
+         */
+        IftttOutbox(const char *url);
+
+        /**
+         * Loads the pending entries from NVS and starts the background task.
+         * 
+         * @param priority RTOS priority of the outbox task.
+         * @param core Core the outbox task is pinned to ('tskNO_AFFINITY' = any core).
+         * @param stackSize Stack size of the outbox task in bytes.
+         * @return false if the task could not be created.
+         */
+        bool begin(UBaseType_t priority, BaseType_t core = tskNO_AFFINITY, uint32_t stackSize = 4096);
+
+        /**
+         * Stops the background task. A request being sent is completed first.
+         * Pending entries are written to NVS.
+         * 
+         * @return false if the task has not ended within 'kStopTimeout' (it ends by itself after the current request).
+         */
+        bool end();
+
+        /**
+         * Adds an entry to the outbox and wakes up the background task.
+         * The entry is written to NVS with the next save (see 'kSaveInterval').
+         * 
+         * @param text Text of the entry (truncated to 'kMaxTextLength' - 1 characters).
+         * @return false if the outbox is full.
+         */
+        bool add(const char *text);
+
+        /** Number of pending entries */
+        uint8_t pending() const { return count_; }
+
+        /** Handle of the outbox task (nullptr = not running) */
+        TaskHandle_t taskHandle() const { return pTask_; }
+
+        /**
+         * Writes the string as JSON string value including the quotes.
+         * 
+         * @param text Zero terminated UTF-8 string.
+         * @param out Output buffer.
+         * @param size Size of the output buffer.
+         * @return Number of characters written (without the terminating zero),
+         *         the string is truncated at an escape sequence boundary if the buffer is too small.
+         */
+        static size_t escapeJson(const char *text, char *out, size_t size);
+
+    private:
+        // Entries as stored in NVS (ring buffer)
+        struct Queue {
+            uint8_t head;
+            uint8_t count;
+            char text[kCapacity][kMaxTextLength];
+        };
+
+        // Function executed by the outbox task
+        static void task(void *p);
+
+        // Sends the next batch if possible and writes deferred changes, returns the number of ticks until the next call
+        TickType_t process();
+
+        // Sends the next batch if possible, returns the number of ticks until the next attempt
+        TickType_t deliver();
+
+        // Sends up to 'kBatchSize' entries, returns the number of entries delivered (or discarded) and 0 on failure
+        uint8_t sendBatch();
+
+        // Marks the queue as changed and writes it if 'kSaveInterval' has elapsed since the last write (called with the mutex taken),
+        // returns the number of ticks until the deferred write is due (portMAX_DELAY = nothing deferred)
+        TickType_t changed();
+
+        // Writes the queue to NVS (called with the mutex taken)
+        void save();
+
+        // URL of the webhook
+        const char *url_;
+
+        // NVS storage
+        Preferences prefs_;
+
+        // Flag indicating that NVS is available
+        bool open_;
+
+        // Pending entries
+        Queue queue_;
+
+        // Number of pending entries (copy of 'queue_.count' for reading without the mutex)
+        uint8_t count_;
+
+        // Flag indicating that the queue has changed since it has been written to NVS
+        bool dirty_;
+
+        // Time of the last write to NVS in ms
+        uint32_t saveTime_;
+
+        // Mutex protecting the queue
+        SemaphoreHandle_t mutex_;
+
+        // Handle to the RTOS outbox task (cleared by the task when it ends)
+        TaskHandle_t pTask_;
+
+        // Flag requesting the outbox task to end
+        volatile bool stop_;
+
+        // Current retry delay in ms (0 = last attempt succeeded)
+        uint32_t retryDelay_;
+
+        // Time of the next attempt in ms
+        uint32_t retryTime_;
+
+        // Request body (only used by the outbox task)
+        char body_[kBatchSize * (2 * kMaxTextLength + 16) + 8];
+};
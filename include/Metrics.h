@@ -0,0 +1,209 @@
+/**
+    Metrics:
+    Counters, gauges and histograms of the streaming pipeline, written
+    in the Prometheus text format (serial console and HTTP '/metrics').
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+/**
+ * Base class of all metrics. Each metric registers itself on construction (global objects),
+ * metrics with the same name but different labels must be defined consecutively.
+ */
+class Metric {
+    public:
+        /**
+         * Writes all registered metrics in the Prometheus text format (version 0.0.4).
+         */
+        static void writeAll(Print &out);
+
+        /** Name of the metric */
+        const char* name() const { return name_; }
+
+    protected:
+        /**
+         * @param name Name of the metric (e.g. "radio_underruns_total").
+         * @param help Description of the metric.
+         * @param type Prometheus type ("counter", "gauge" or "histogram").
+         * @param labels Labels of the metric (e.g. "task=\"audio\"") or nullptr.
+         */
+        Metric(const char *name, const char *help, const char *type, const char *labels);
+
+        // Writes the samples of the metric
+        virtual void writeSamples(Print &out) const = 0;
+
+        // Writes a single sample line, 'extraLabel' is appended to the labels of the metric
+        void writeSample(Print &out, const char *suffix, const char *extraLabel, long long value) const;
+
+    private:
+        // First and last registered metric
+        static Metric *pFirst_;
+        static Metric *pLast_;
+
+        // Next registered metric
+        Metric *pNext_;
+
+        const char *name_;
+        const char *help_;
+        const char *type_;
+        const char *labels_;
+};
+
+/** Monotonically increasing value (safe to increment from any task) */
+class Counter : public Metric {
+    public:
+        Counter(const char *name, const char *help, const char *labels = nullptr);
+
+        /** Increases the counter */
+        void inc(uint32_t n = 1) { value_ += n; }
+
+        /** Sets the counter to a value counted elsewhere (e.g. by a cache) */
+        void set(uint32_t value) { value_ = value; }
+
+        uint32_t value() const { return value_; }
+
+    protected:
+        void writeSamples(Print &out) const override;
+
+    private:
+        std::atomic<uint32_t> value_;
+};
+
+/** Value that can go up and down (safe to set from any task) */
+class Gauge : public Metric {
+    public:
+        Gauge(const char *name, const char *help, const char *labels = nullptr);
+
+        void set(int32_t value) { value_ = value; }
+
+        /** Raises the gauge to the value if it is larger (e.g. for maximum values) */
+        void setMax(int32_t value);
+
+        int32_t value() const { return value_; }
+
+    protected:
+        void writeSamples(Print &out) const override;
+
+    private:
+        std::atomic<int32_t> value_;
+};
+
+/** Distribution of values in fixed buckets (safe to observe from any task) */
+class Histogram : public Metric {
+    public:
+        /** Maximum number of buckets (without the '+Inf' bucket) */
+        const static uint8_t kMaxBuckets = 12;
+
+        /**
+         * @param name Name of the metric.
+         * @param help Description of the metric.
+         * @param bounds Upper bounds of the buckets in ascending order (static array).
+         * @param numBounds Number of bounds (at most 'kMaxBuckets').
+         */
+        Histogram(const char *name, const char *help, const uint32_t *bounds, uint8_t numBounds);
+
+        /** Adds a value to the distribution */
+        void observe(uint32_t value);
+
+        /** Number of observed values */
+        uint32_t count() const;
+
+        /** Sum of the observed values */
+        uint64_t sum() const;
+
+    protected:
+        void writeSamples(Print &out) const override;
+
+    private:
+        // Upper bounds of the buckets
+        const uint32_t *bounds_;
+
+        // Number of buckets
+        uint8_t numBounds_;
+
+        // Number of values per bucket (not cumulative), last entry = above all bounds
+        uint32_t counts_[kMaxBuckets + 1];
+
+        // Number and sum of observed values
+        uint32_t count_;
+        uint64_t sum_;
+
+        // Spinlock protecting the values (observed from tasks on both cores)
+        mutable portMUX_TYPE mux_;
+};
+
+class WebServer;
+
+/**
+ * Lightweight HTTP server answering 'GET /metrics' with all registered metrics (for scraping).
+ * Requests are served by a task of its own, so a slow client does not block the caller.
+ */
+class MetricsServer {
+    public:
+        /** Interval in ms at which the server task checks for new requests */
+        const static uint32_t kPollInterval = 50;
+
+        /** Maximum time in ms 'end' waits for the server task (a request being answered is completed first) */
+        const static uint32_t kStopTimeout = 6000;
+
+        /**
+         * @param port TCP port of the server.
+         */
+        MetricsServer(uint16_t port = 80);
+
+        /**
+         * Creates the server, starts listening (WiFi must be connected) and starts the server task.
+         * 
+         * @param priority RTOS priority of the server task (low, scraping is not time-critical).
+         * @param core Core the server task is pinned to ('tskNO_AFFINITY' = any core).
+         * @param stackSize Stack size of the server task in bytes.
+         * @return false if the task could not be created.
+         */
+        bool begin(UBaseType_t priority, BaseType_t core = tskNO_AFFINITY, uint32_t stackSize = 4096);
+
+        /**
+         * Stops the server task and the server and releases its memory.
+         * 
+         * @return false if the task has not ended within 'kStopTimeout' (the server is kept, the task ends by itself).
+         */
+        bool end();
+
+        /** Handle of the server task (nullptr = not running) */
+        TaskHandle_t taskHandle() const { return pTask_; }
+
+    private:
+        // Entry function of the RTOS server task
+        static void task(void *p);
+
+        // Writes the metrics as chunked HTTP response
+        void handleMetrics();
+
+        uint16_t port_;
+
+        // Server instance (nullptr = not running)
+        WebServer *pServer_;
+
+        // Handle to the RTOS server task (cleared by the task when it ends)
+        volatile TaskHandle_t pTask_;
+
+        // Flag requesting the server task to end
+        volatile bool stop_;
+};
@@ -0,0 +1,170 @@
+/**
+    PcmChain:
+    Chain of fixed-point processing stages applied to the PCM data before
+    it is written to the DAC, with a check of the CPU cycle budget.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * Processing stage of the chain. The samples are interleaved stereo frames (left, right) as 32 bit values
+ * scaled like 16 bit PCM, so stages may exceed the 16 bit range (e.g. EQ boost) before a later stage limits it.
+ */
+class PcmStage {
+    public:
+        PcmStage() : pNext_(nullptr) {}
+
+        /** Name of the stage (for the log) */
+        virtual const char* name() const = 0;
+
+        /**
+         * Sets the sample rate (coefficients depending on it are recalculated).
+         * 
+         * @param sampleRate Sample rate in Hz.
+         */
+        virtual void setSampleRate(uint32_t sampleRate) {}
+
+        /** Clears the state of the stage (e.g. after a station change) */
+        virtual void reset() {}
+
+        /**
+         * Processes the samples in place.
+         * 
+         * @param samples Interleaved stereo samples.
+         * @param frames Number of stereo frames.
+         */
+        virtual void process(int32_t *samples, size_t frames) = 0;
+
+    private:
+        friend class PcmChain;
+
+        // Next stage of the chain
+        PcmStage *pNext_;
+};
+
+class PcmChain {
+    public:
+        /** Number of frames converted to 32 bit at once (also the delay of 'processFrame') */
+        const static size_t kBlockFrames = 128;
+
+        /**
+         * @param cycleBudget Maximum average number of CPU cycles per frame for all stages together.
+         * @param blockCycleBudget Maximum number of CPU cycles per frame within a single block. A block is processed
+         *                         in one call ('processFrame': within the call of one frame), so its peak matters too.
+         */
+        PcmChain(uint32_t cycleBudget, uint32_t blockCycleBudget);
+
+        /**
+         * Appends a stage to the chain (stages are processed in the order they have been added).
+         * Must not be called while the chain is processing.
+         */
+        void add(PcmStage *pStage);
+
+        /**
+         * Sets the sample rate of all stages if it has changed (to be called by the processing task).
+         */
+        void setSampleRate(uint32_t sampleRate);
+
+        /**
+         * Clears the state of all stages and the frames collected by 'processFrame' (to be called by the processing task).
+         */
+        void reset();
+
+        /**
+         * Processes interleaved 16 bit stereo samples in place (results are saturated to 16 bit).
+         * 
+         * @param samples Interleaved stereo samples.
+         * @param frames Number of stereo frames.
+         */
+        void process(int16_t *samples, size_t frames);
+
+        /**
+         * Processes a single stereo frame in place for callers that get the audio frame by frame.
+         * The frames are collected and the stages run once per block of 'kBlockFrames' frames,
+         * so the frame returned is the processed frame from one block earlier (silence after 'reset').
+         */
+        void processFrame(int16_t &left, int16_t &right);
+
+        /**
+         * Runs a single stage on interleaved 16 bit stereo samples (used by the benchmark).
+         */
+        static void processStage(PcmStage *pStage, int16_t *samples, size_t frames);
+
+        /**
+         * Takes the average and the block maximum of the cycles per frame measured since the last call and checks them
+         * against the budgets. Logs a warning when a budget is exceeded (and when both are kept again).
+         * 
+         * @param cyclesPerFrame Average number of CPU cycles per frame (0 = nothing processed).
+         * @param maxCyclesPerFrame CPU cycles per frame of the slowest block (0 = nothing processed).
+         * @return false if a budget has been exceeded.
+         */
+        bool checkBudget(uint32_t &cyclesPerFrame, uint32_t &maxCyclesPerFrame);
+
+        /** true if the chain contains at least one stage */
+        bool isActive() const { return pFirst_ != nullptr; }
+
+        /** First stage of the chain */
+        PcmStage* first() const { return pFirst_; }
+
+        /** Stage following the given one */
+        static PcmStage* next(const PcmStage *pStage) { return pStage->pNext_; }
+
+    private:
+        // Runs all stages on 32 bit samples
+        void run(int32_t *samples, size_t frames);
+
+        // Adds the cycles measured for a block to the average and the block maximum
+        void measure(uint32_t cycles, size_t frames);
+
+        // Saturates a sample to 16 bit
+        static int16_t saturate(int32_t sample) {
+            return (int16_t) constrain(sample, (int32_t) -32768, (int32_t) 32767);
+        }
+
+        // First and last stage
+        PcmStage *pFirst_;
+        PcmStage *pLast_;
+
+        // Sample rate of the stages in Hz
+        uint32_t sampleRate_;
+
+        // Maximum average number of cycles per frame and maximum cycles per frame of a single block
+        uint32_t cycleBudget_;
+        uint32_t blockCycleBudget_;
+
+        // Cycles, frames and highest cycles per frame of a block measured since the last budget check
+        // (updated by the processing task only)
+        volatile uint32_t cycles_;
+        volatile uint32_t frames_;
+        volatile uint32_t maxCycles_;
+
+        // Result of the last budget check with processed frames
+        bool overBudget_;
+
+        // Conversion buffer
+        int32_t block_[2 * kBlockFrames];
+
+        // 'processFrame': frames collected for the next block and processed frames of the previous block
+        int32_t frameBlock_[2 * kBlockFrames];
+        int16_t frameOutput_[2 * kBlockFrames];
+
+        // 'processFrame': position of the next frame in the blocks
+        size_t framePos_;
+};
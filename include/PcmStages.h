@@ -0,0 +1,112 @@
+/**
+    PcmStages:
+    Fixed-point processing stages for the PCM chain: biquad EQ,
+    peak limiter and stereo-to-mono downmix.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include "PcmChain.h"
+
+/** Biquad filter (EQ band) with Q28 coefficients, both channels filtered with the same coefficients */
+class BiquadStage : public PcmStage {
+    public:
+        /** Filter types (RBJ audio EQ cookbook) */
+        enum Type : uint8_t {
+            PEAKING = 0,
+            LOW_SHELF = 1,
+            HIGH_SHELF = 2,
+            LOW_PASS = 3,
+            HIGH_PASS = 4
+        };
+
+        /**
+         * @param type Filter type.
+         * @param frequency Center or corner frequency in Hz.
+         * @param gain Gain in dB (peaking and shelving filters only).
+         * @param q Quality factor (shelving filters: slope, 1.0 = steepest without overshoot at 0.707).
+         */
+        BiquadStage(Type type, float frequency, float gain, float q);
+
+        const char* name() const override { return "biquad"; }
+
+        void setSampleRate(uint32_t sampleRate) override;
+
+        void reset() override;
+
+        void process(int32_t *samples, size_t frames) override;
+
+    private:
+        Type type_;
+        float frequency_;
+        float gain_;
+        float q_;
+
+        // Coefficients in Q28 (a0 normalized to 1)
+        int32_t b0_, b1_, b2_, a1_, a2_;
+
+        // Previous input and output samples per channel (direct form I)
+        int32_t x1_[2], x2_[2], y1_[2], y2_[2];
+
+        // Truncated fraction of the previous output per channel in Q28
+        int32_t error_[2];
+};
+
+/** Peak limiter without lookahead (instant attack, exponential release), both channels share the gain */
+class LimiterStage : public PcmStage {
+    public:
+        /**
+         * @param threshold Maximum output level in dBFS (e.g. -1.0).
+         * @param release Release time constant in ms.
+         */
+        LimiterStage(float threshold, uint32_t release);
+
+        const char* name() const override { return "limiter"; }
+
+        void setSampleRate(uint32_t sampleRate) override;
+
+        void reset() override;
+
+        void process(int32_t *samples, size_t frames) override;
+
+        /** Lowest gain applied since the last call in Q15 (for monitoring the gain reduction) */
+        int32_t takeMinGain();
+
+    private:
+        // Threshold as sample value
+        int32_t threshold_;
+
+        // Release time in ms
+        uint32_t release_;
+
+        // Release coefficient per sample in Q15
+        int32_t releaseCoef_;
+
+        // Current gain and lowest gain in Q15
+        int32_t gain_;
+        volatile int32_t minGain_;
+};
+
+/** Downmix of both channels to mono (e.g. for a single speaker) */
+class MonoStage : public PcmStage {
+    public:
+        const char* name() const override { return "mono"; }
+
+        void process(int32_t *samples, size_t frames) override;
+};
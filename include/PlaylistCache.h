@@ -0,0 +1,110 @@
+/**
+    PlaylistCache:
+    Persistent cache (NVS) of the stream URLs contained in m3u/pls playlists,
+    so that connecting to a playlist station does not require downloading
+    the playlist each time.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+class PlaylistCache {
+    public:
+        /** Maximum length of a stream URL including the terminating zero */
+        const static size_t kMaxUrlLength = 256;
+
+        /**
+         * @param ttl Time to live of a cache entry in seconds.
+         */
+        PlaylistCache(uint32_t ttl);
+
+        /**
+         * Opens the NVS namespace of the cache.
+         * 
+         * @return false if NVS is not available.
+         */
+        bool begin();
+
+        /**
+         * Checks whether the URL points to a playlist (m3u or pls) instead of an audio stream.
+         */
+        static bool isPlaylistUrl(const char *url);
+
+        /**
+         * Looks up the stream URL for the given playlist URL.
+         * 
+         * @param playlistUrl URL of the playlist.
+         * @param streamUrl Buffer receiving the stream URL (at least 'kMaxUrlLength' bytes).
+         * @param count true = count the access in the hit/miss counters.
+         * @return true if a valid entry has been found.
+         */
+        bool lookup(const char *playlistUrl, char *streamUrl, bool count = true);
+
+        /**
+         * Stores the stream URL for the given playlist URL.
+         * The entry is only written to flash if it has changed or is about to expire.
+         */
+        void store(const char *playlistUrl, const char *streamUrl);
+
+        /**
+         * Removes the entry for the given playlist URL, e.g. after the cached stream URL has failed.
+         */
+        void invalidate(const char *playlistUrl);
+
+        /** Number of lookups that have been served from the cache */
+        uint32_t hits() const { return hits_; }
+
+        /** Number of lookups that have not been served from the cache */
+        uint32_t misses() const { return misses_; }
+
+    private:
+        // Cache entry as stored in NVS
+        struct Entry {
+            uint32_t time; // Time of resolving the playlist (seconds since epoch, 0 = unknown)
+            char url[kMaxUrlLength];
+        };
+
+        // Creates the NVS key for a playlist URL (hash of the URL, at most 15 characters)
+        static void makeKey(const char *playlistUrl, char *key);
+
+        // Current time in seconds since epoch (0 if the clock has not been set yet)
+        static uint32_t now();
+
+        // Reads the entry for the given key
+        bool readEntry(const char *key, Entry &entry);
+
+        // Checks whether an entry is still valid at the given time
+        bool isFresh(const Entry &entry, uint32_t time) const;
+
+        // NVS storage
+        Preferences prefs_;
+
+        // Mutex protecting NVS access (used by audio and standby task)
+        SemaphoreHandle_t mutex_;
+
+        // Time to live in seconds
+        uint32_t ttl_;
+
+        // Hit counter
+        uint32_t hits_;
+
+        // Miss counter
+        uint32_t misses_;
+};
@@ -0,0 +1,70 @@
+/**
+    RadioMessages:
+    Commands sent from the user interface (Arduino loop) to the audio task
+    and events sent back from the audio task (or bluetooth callbacks) to
+    the user interface.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "SpscQueue.h"
+
+/**
+ * Maximum length of the text carried by an event including the terminating zero. The ICY stream titles of real
+ * stations ("artist - title", often with album or show) mostly stay below 200 characters; longer ones are truncated.
+ */
+const size_t kEventTextLength = 256;
+
+// Enumeration with commands for the audio task
+enum CommandType : uint8_t {
+    CMD_SET_VOLUME = 0,     // value = volume (0...21)
+    CMD_SET_STATION = 1,    // value = station index; stops the current stream and connects to the station
+    CMD_PAUSE = 2,          // stops the current stream
+    CMD_RESUME = 3,         // value = station index; connects to the station again
+    CMD_NETWORK_RESTORED = 4, // WiFi is available again after an outage; the stream is checked for stalls again
+    CMD_CAPTURE = 5,        // records the current stream into the capture file
+    CMD_REPLAY = 6          // value = station index; decodes the capture file as benchmark, then connects to the station again
+};
+
+// Command from the user interface to the audio task
+struct Command {
+    CommandType type;
+    uint16_t value;
+    uint32_t time;          // Time in ms at which the command was issued
+};
+
+// Enumeration with events for the user interface
+enum EventType : uint8_t {
+    EVT_STATION_NAME = 0,   // text = station name
+    EVT_SONG_INFO = 1,      // text = song info (artist and title)
+    EVT_UNMUTED = 2,        // audio output has been enabled after connecting
+    EVT_STREAM_ERROR = 3    // the stream could not be connected or provides too little data
+};
+
+// Event from the audio task (or bluetooth callbacks) to the user interface
+struct Event {
+    EventType type;
+    char text[kEventTextLength];
+};
+
+/** Queue for commands: producer = Arduino loop, consumer = audio task */
+typedef SpscQueue<Command, 16> CommandQueue;
+
+/** Queue for events: producer = audio task (radio) or bluetooth task (A2DP), consumer = Arduino loop */
+typedef SpscQueue<Event, 8> EventQueue;
@@ -0,0 +1,116 @@
+/**
+    RadioSettings:
+    Settings that are kept across reboots (NVS): last station, volume,
+    bluetooth latency profile and the WiFi association data used for
+    connecting without a scan.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+class RadioSettings {
+    public:
+        /** Data of a successful WiFi association */
+        struct Association {
+            uint8_t bssid[6]; // MAC address of the access point
+            int32_t channel; // WiFi channel of the access point
+            uint32_t ip; // Own IP address (DHCP lease)
+            uint32_t gateway;
+            uint32_t subnet;
+            uint32_t dns;
+        };
+
+        /**
+         * @param defaultStation Station index used if none has been stored.
+         * @param defaultVolume Volume used if none has been stored.
+         * @param defaultLatencyProfile Latency profile of the bluetooth sink used if none has been stored.
+         */
+        RadioSettings(uint16_t defaultStation, uint8_t defaultVolume, uint8_t defaultLatencyProfile);
+
+        /**
+         * Opens the NVS namespace and loads the settings.
+         * 
+         * @return false if NVS is not available (defaults are used).
+         */
+        bool begin();
+
+        /** Last station index */
+        uint16_t station() const { return station_; }
+
+        /** Last volume */
+        uint8_t volume() const { return volume_; }
+
+        /** Selected latency profile of the bluetooth sink */
+        uint8_t latencyProfile() const { return latencyProfile_; }
+
+        /**
+         * Stores the station index (only written to flash if it has changed).
+         */
+        void setStation(uint16_t index);
+
+        /**
+         * Stores the volume (only written to flash if it has changed).
+         */
+        void setVolume(uint8_t volume);
+
+        /**
+         * Stores the latency profile of the bluetooth sink (only written to flash if it has changed).
+         */
+        void setLatencyProfile(uint8_t profile);
+
+        /**
+         * Provides the data of the last WiFi association.
+         * 
+         * @return false if no association has been stored.
+         */
+        bool association(Association &assoc) const;
+
+        /**
+         * Stores the data of a WiFi association (only written to flash if it has changed).
+         */
+        void setAssociation(const Association &assoc);
+
+        /**
+         * Removes the stored association, e.g. after the access point could not be reached directly.
+         */
+        void clearAssociation();
+
+    private:
+        // NVS storage
+        Preferences prefs_;
+
+        // Flag indicating that NVS is available
+        bool open_;
+
+        // Last station index
+        uint16_t station_;
+
+        // Last volume
+        uint8_t volume_;
+
+        // Selected latency profile of the bluetooth sink
+        uint8_t latencyProfile_;
+
+        // Data of the last WiFi association
+        Association assoc_;
+
+        // Flag indicating that 'assoc_' contains valid data
+        bool assocValid_;
+};
@@ -0,0 +1,99 @@
+/**
+    SpscQueue:
+    Bounded lock-free queue for exactly one producer and one consumer
+    (e.g. two tasks, or an interrupt and a task). No dynamic memory is used.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @tparam T Element type (copied into the queue).
+ * @tparam N Capacity of the queue, must be a power of two.
+ */
+template <typename T, size_t N>
+class SpscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "Capacity must be a power of two");
+
+    public:
+        SpscQueue() : head_(0), tail_(0) {}
+
+        /**
+         * Appends an element to the queue. May only be called by the producer.
+         * 
+         * @return false if the queue is full (the element is not added).
+         */
+        bool push(const T &element) {
+            uint32_t head = head_.load(std::memory_order_relaxed);
+
+            if (head - tail_.load(std::memory_order_acquire) >= N) {
+                return false;
+            }
+
+            buffer_[head & (N - 1)] = element;
+            head_.store(head + 1, std::memory_order_release); // Publish the element
+
+            return true;
+        }
+
+        /**
+         * Removes the oldest element from the queue. May only be called by the consumer.
+         * 
+         * @return false if the queue is empty.
+         */
+        bool pop(T &element) {
+            uint32_t tail = tail_.load(std::memory_order_relaxed);
+
+            if (head_.load(std::memory_order_acquire) == tail) {
+                return false;
+            }
+
+            element = buffer_[tail & (N - 1)];
+            tail_.store(tail + 1, std::memory_order_release); // Release the slot to the producer
+
+            return true;
+        }
+
+        /**
+         * @return true if the queue contains no elements (snapshot, may change immediately).
+         */
+        bool isEmpty() const {
+            return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+        }
+
+        /**
+         * Discards all elements. May only be called while neither producer nor consumer is active.
+         */
+        void clear() {
+            head_.store(0, std::memory_order_relaxed);
+            tail_.store(0, std::memory_order_relaxed);
+        }
+
+    private:
+        // Element storage
+        T buffer_[N];
+
+        // Number of elements pushed so far (written by the producer)
+        std::atomic<uint32_t> head_;
+
+        // Number of elements popped so far (written by the consumer)
+        std::atomic<uint32_t> tail_;
+};
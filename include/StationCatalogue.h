@@ -0,0 +1,119 @@
+/**
+    StationCatalogue:
+    List of radio stations with display name, codec/bitrate hint and
+    alternate stream URLs. The catalogue is kept in a single buffer
+    (packed text with zero terminated fields) plus an offset index, so
+    hundreds of stations need no per-entry heap allocation.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+/**
+ * Text format (one station per line, fields separated by '|', lines starting with '#' are ignored):
+ * 
+ *   name|codec/kbit|url|alternate url|...
+ * 
+ * Example: "Radio Bob|mp3/192|http://streams.radiobob.de/bob-national/mp3-192/streams.radiobob.de/"
+ * The hint may be empty or contain the codec only (e.g. "aac").
+ */
+class StationCatalogue {
+    public:
+        /** Maximum number of stations */
+        const static uint16_t kMaxStations = 1000;
+
+        /** Maximum number of URLs per station (main URL and alternates) */
+        const static uint8_t kMaxUrls = 8;
+
+        StationCatalogue();
+
+        ~StationCatalogue();
+
+        /**
+         * Loads the catalogue from a file, replacing the current content.
+         * 
+         * @param fs File system containing the file.
+         * @param path Path of the catalogue file.
+         * @return false if the file cannot be read or contains no station.
+         */
+        bool load(fs::FS &fs, const char *path);
+
+        /**
+         * Loads the catalogue from a text in memory (e.g. the built-in station list), replacing the current content.
+         * 
+         * @return false if the text contains no station or memory is not available.
+         */
+        bool load(const char *text);
+
+        /** Number of stations */
+        uint16_t count() const { return count_; }
+
+        /** Display name of the station (may be empty) */
+        const char* name(uint16_t index) const;
+
+        /** Codec/bitrate hint of the station as given in the catalogue (may be empty) */
+        const char* hint(uint16_t index) const;
+
+        /** Bitrate in kbit/s taken from the hint (0 = unknown) */
+        uint32_t bitrate(uint16_t index) const;
+
+        /** Number of URLs of the station (at least 1) */
+        uint8_t numUrls(uint16_t index) const;
+
+        /**
+         * URL of the station.
+         * 
+         * @param index Index of the station.
+         * @param alternate 0 = main URL, 1... = alternate URLs.
+         * @return URL or empty string if there is no such URL.
+         */
+        const char* url(uint16_t index, uint8_t alternate = 0) const;
+
+        /** Heap used by the catalogue in bytes */
+        size_t memoryUsage() const;
+
+    private:
+        // Index entry of a station
+        struct Entry {
+            uint32_t offset; // Offset of the name in the buffer (followed by hint and URLs)
+            uint8_t numUrls;
+        };
+
+        // Parses the text in 'pBuffer_' in place and builds the index
+        bool parse();
+
+        // Releases buffer and index
+        void clear();
+
+        // Returns the field following the given zero terminated field
+        static const char* nextField(const char *field) { return field + strlen(field) + 1; }
+
+        // Catalogue text (fields zero terminated after parsing)
+        char *pBuffer_;
+
+        // Size of the buffer in bytes
+        size_t size_;
+
+        // Index of the stations
+        Entry *pIndex_;
+
+        // Number of stations
+        uint16_t count_;
+};
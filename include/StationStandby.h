@@ -0,0 +1,137 @@
+/**
+    StationStandby:
+    Keeps the next station of the web radio in a warm standby state, so that
+    switching to it does not have to wait for the playlist download, the DNS
+    lookup of the stream host and the response of the host (standby
+    connection of the timeshift proxy).
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include "HostCache.h"
+#include "PlaylistCache.h"
+#include "TimeshiftProxy.h"
+
+class StationStandby {
+    public:
+        /** Maximum length of a stream URL including the terminating zero */
+        const static size_t kMaxUrlLength = PlaylistCache::kMaxUrlLength;
+
+        /**
+         * @param bufferSize Memory budget in bytes for the playlist data that is read in standby.
+         * @param pCache Cache for resolved playlists, which is read and updated by the standby task.
+         * @param pHostCache Cache for the addresses of stream hosts, which is updated by the standby task.
+         * @param pProxy Timeshift proxy keeping the standby connection to the stream host (nullptr = none).
+         */
+        StationStandby(size_t bufferSize, PlaylistCache *pCache, HostCache *pHostCache, TimeshiftProxy *pProxy);
+
+        /**
+         * Allocates the standby buffer and starts the background task.
+         * 
+         * @param priority RTOS priority of the standby task.
+         * @param core Core the standby task is pinned to ('tskNO_AFFINITY' = any core).
+         * @param stackSize Stack size of the standby task in bytes.
+         * @return false if the buffer or the task could not be created.
+         */
+        bool begin(UBaseType_t priority, BaseType_t core = tskNO_AFFINITY, uint32_t stackSize = 4096);
+
+        /**
+         * Stops the background task and releases the standby buffer.
+         * A request being processed is completed first, so the task never holds a lock when it ends.
+         * 
+         * @return false if the task has not ended in time; it ends by itself after the request and the buffer is kept.
+         */
+        bool end();
+
+        /**
+         * Requests the standby task to prepare the given station.
+         * A previously prepared station is discarded. The standby connection is renewed while the station is in standby.
+         * 
+         * @param index Index of the station in the station list.
+         * @param url URL of the station as given in the station list (stream or playlist).
+         */
+        void prepare(uint16_t index, const char *url);
+
+        /**
+         * Hands over the prepared stream URL if the given station is in standby.
+         * 
+         * @param index Index of the requested station.
+         * @param url Buffer receiving the stream URL (at least 'kMaxUrlLength' bytes).
+         * @return true if the station was prepared and 'url' has been filled.
+         */
+        bool take(uint16_t index, char *url);
+
+        /** Handle of the standby task (nullptr = not running) */
+        TaskHandle_t taskHandle() const { return pTask_; }
+
+    private:
+        // Entry function of the RTOS standby task
+        static void task(void *p);
+
+        // Processes a single standby request
+        void process();
+
+        // Renews the standby connection of the station in standby before the proxy closes it
+        void renew();
+
+        // Opens the standby connection through the timeshift proxy (plain HTTP streams only)
+        void connectAhead(const char *streamUrl, const IPAddress &ip);
+
+        // Downloads the playlist at 'url' and writes the first stream URL to 'streamUrl'
+        bool resolvePlaylist(const char *url, char *streamUrl);
+
+        // Looks up the IP address of the host contained in 'url', which fills the host cache and the DNS cache of the network stack
+        bool resolveHost(const char *url, IPAddress &ip);
+
+        // Memory budget for the playlist data
+        size_t bufferSize_;
+
+        // Cache for resolved playlists
+        PlaylistCache *pCache_;
+
+        // Cache for the addresses of stream hosts
+        HostCache *pHostCache_;
+
+        // Timeshift proxy keeping the standby connection (nullptr = none)
+        TimeshiftProxy *pProxy_;
+
+        // Buffer for the playlist data
+        char *pBuffer_;
+
+        // Handle to the RTOS standby task (cleared by the task when it ends)
+        TaskHandle_t pTask_;
+
+        // Flag requesting the standby task to end
+        volatile bool stop_;
+
+        // Mutex protecting the request and result data below
+        SemaphoreHandle_t mutex_;
+
+        // Requested station index (0xFFFF = none)
+        uint16_t requestIndex_;
+
+        // Requested station URL
+        char requestUrl_[kMaxUrlLength];
+
+        // Station index that is in standby (0xFFFF = none)
+        uint16_t readyIndex_;
+
+        // Stream URL of the station in standby
+        char readyUrl_[kMaxUrlLength];
+};
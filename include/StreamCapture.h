@@ -0,0 +1,96 @@
+/**
+    StreamCapture:
+    Records the raw bytes of a radio stream into a file, which can be
+    replayed through the decoder as a repeatable benchmark.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include "PlaylistCache.h"
+
+class StreamCapture {
+    public:
+        /** Maximum length of a stream URL including the terminating zero */
+        const static size_t kMaxUrlLength = PlaylistCache::kMaxUrlLength;
+
+        /**
+         * @param fs File system the capture is written to.
+         * @param path Path of the capture file (overwritten by each capture).
+         * @param maxBytes Maximum size of the capture in bytes.
+         * @param maxTime Maximum duration of the capture in ms.
+         */
+        StreamCapture(fs::FS &fs, const char *path, size_t maxBytes, uint32_t maxTime);
+
+        /**
+         * Starts recording the stream in a background task, which opens its own connection to the host
+         * (without ICY metadata, so that the file only contains audio data). The task ends by itself
+         * when the maximum size or duration has been reached or the host closes the connection.
+         * 
+         * @param url Stream URL (not a playlist).
+         * @param priority RTOS priority of the capture task.
+         * @param core Core the capture task is pinned to ('tskNO_AFFINITY' = any core).
+         * @param stackSize Stack size of the capture task in bytes.
+         * @return false if a capture is running already or the task could not be created.
+         */
+        bool start(const char *url, UBaseType_t priority, BaseType_t core = tskNO_AFFINITY, uint32_t stackSize = 4096);
+
+        /**
+         * Stops a running capture and waits until the capture task has closed the file.
+         * 
+         * @return false if the task has not ended in time (the file may be incomplete, the task ends by itself).
+         */
+        bool end();
+
+        /** Capture task is running */
+        bool isRunning() const { return pTask_ != nullptr; }
+
+        /** Number of bytes recorded by the last or the running capture */
+        size_t bytes() const { return bytes_; }
+
+        /** Path of the capture file */
+        const char* path() const { return path_; }
+
+    private:
+        // Entry function of the RTOS capture task
+        static void task(void *p);
+
+        // Records the stream into the capture file
+        void record();
+
+        // File system and path of the capture file
+        fs::FS &fs_;
+        const char *path_;
+
+        // Limits of a capture
+        size_t maxBytes_;
+        uint32_t maxTime_;
+
+        // Stream URL of the running capture
+        char url_[kMaxUrlLength];
+
+        // Handle to the RTOS capture task (cleared by the task when it ends)
+        volatile TaskHandle_t pTask_;
+
+        // Flag requesting the capture task to end
+        volatile bool stop_;
+
+        // Number of bytes recorded
+        volatile size_t bytes_;
+};
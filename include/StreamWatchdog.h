@@ -0,0 +1,163 @@
+/**
+    StreamWatchdog:
+    Detects stalled radio streams from the trend of the buffer fill and
+    schedules reconnects with exponential backoff, failing over to the
+    alternate URLs of the station.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+class StreamWatchdog {
+    public:
+        /** Time in ms without incoming data after which a playing stream is considered stalled */
+        const static uint32_t kStallTime = 5000;
+
+        /** A draining buffer is considered stalled if it is predicted to run empty within this time in ms */
+        const static uint32_t kDrainHorizon = 1500;
+
+        /** Measurement window for the trend of the buffer fill in ms */
+        const static uint32_t kTrendWindow = 500;
+
+        /** Delay of the first reconnect in ms (doubled with each failure) */
+        const static uint32_t kRetryMin = 500;
+
+        /** Maximum delay between reconnects in ms */
+        const static uint32_t kRetryMax = 30000;
+
+        /** Number of consecutive failures of a URL before failing over to the next alternate URL */
+        const static uint8_t kFailuresPerUrl = 2;
+
+        StreamWatchdog();
+
+        /**
+         * Starts watching a new station (or resumes after a pause); pending reconnects are cancelled.
+         * 
+         * @param numUrls Number of URLs of the station (primary and alternates).
+         */
+        void reset(uint8_t numUrls);
+
+        /**
+         * Starts monitoring the buffer fill after a connection has been established.
+         * 
+         * @param time Current time in ms.
+         * @param bufferSize Size of the audio input buffer in bytes.
+         */
+        void start(uint32_t time, uint32_t bufferSize);
+
+        /**
+         * Updates the trend with the current buffer fill level (while playing).
+         * 
+         * @param time Current time in ms.
+         * @param bufferFilled Number of bytes in the audio input buffer.
+         */
+        void update(uint32_t time, uint32_t bufferFilled);
+
+        /**
+         * @param time Current time in ms.
+         * @return true if no data has arrived for 'kStallTime' or the buffer is about to run empty.
+         */
+        bool isStalled(uint32_t time) const;
+
+        /**
+         * Records a failure (connection failed, stream error or stall) and schedules a reconnect.
+         * Ignored while a reconnect is already pending.
+         * 
+         * @param time Current time in ms.
+         * @param reason Text describing the failure (for the log).
+         */
+        void failed(uint32_t time, const char *reason);
+
+        /**
+         * @param time Current time in ms.
+         * @return true if a reconnect is pending and its time has come.
+         */
+        bool isRetryDue(uint32_t time) const;
+
+        /**
+         * @param time Current time in ms.
+         * @return Time in ms until the pending reconnect is due (0 = due or none pending).
+         */
+        uint32_t retryDelay(uint32_t time) const;
+
+        /**
+         * Marks the pending reconnect as started.
+         */
+        void retryStarted();
+
+        /**
+         * Records that audio is playing again. Logs the duration of the outage and resets the backoff.
+         * 
+         * @param time Current time in ms.
+         * @return Duration of the outage in ms (0 = there was no outage).
+         */
+        uint32_t recovered(uint32_t time);
+
+        /** true if a retry is pending */
+        bool isRetryPending() const { return retryPending_; }
+
+        /** true between a failure and the recovery */
+        bool isRecovering() const { return recovering_; }
+
+        /** Index of the URL to connect to (0 = primary URL) */
+        uint8_t alternate() const { return alternate_; }
+
+    private:
+        // Number of URLs of the current station
+        uint8_t numUrls_;
+
+        // Index of the current URL
+        uint8_t alternate_;
+
+        // Consecutive failures since the last recovery and consecutive failures of the current URL
+        uint8_t failures_;
+        uint8_t urlFailures_;
+
+        // Flags indicating a pending reconnect and an outage that has not yet been recovered
+        bool retryPending_;
+        bool recovering_;
+
+        // Time of the pending reconnect in ms
+        uint32_t retryTime_;
+
+        // Time of the first failure of the current outage in ms
+        uint32_t outageStart_;
+
+        // Size of the audio input buffer in bytes
+        uint32_t bufferSize_;
+
+        // Current buffer fill in bytes
+        uint32_t bufferFilled_;
+
+        // Time at which data has arrived the last time in ms
+        uint32_t timeLastData_;
+
+        // Start time and buffer fill of the current trend window
+        uint32_t timeWindow_;
+        uint32_t bufferFilledWindow_;
+
+        // Smoothed change of the buffer fill in bytes/s (incoming data minus data consumed by the decoder)
+        int32_t netRate_;
+
+        // Flag indicating that 'netRate_' contains at least one measurement
+        bool netRateValid_;
+
+        // Flag indicating that the first trend window has been started by 'update'
+        bool windowStarted_;
+};
@@ -0,0 +1,118 @@
+/**
+    TaskTopology:
+    Core affinity, priority and stack size of the RTOS tasks of the radio,
+    organized in profiles that can be chosen at build time or run time,
+    and bookkeeping of the topology benchmark.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+class TaskTopology {
+    public:
+        /** Core affinity, priority and stack size of a task */
+        struct TaskConfig {
+            BaseType_t core; // 0, 1 or 'tskNO_AFFINITY'
+            UBaseType_t priority;
+            uint32_t stackSize; // in bytes
+        };
+
+        /** Configuration of all tasks of the radio */
+        struct Profile {
+            const char *name;
+            TaskConfig audio; // Audio decoding ('audioProcessing')
+            TaskConfig network; // Network work apart from the stream (warm standby)
+            TaskConfig ui; // Display rendering
+            TaskConfig background; // Background work (e.g. sending song titles)
+        };
+
+        /** Result of running one profile in the topology benchmark */
+        struct BenchmarkResult {
+            uint32_t duration; // in ms
+            uint32_t underruns; // Number of times the audio buffer ran empty while playing
+            uint32_t loopGapAvg; // Average time between two audio loop iterations in us
+            uint32_t loopGapMax; // Maximum time between two audio loop iterations in us
+        };
+
+        /** Number of available profiles */
+        const static uint8_t kNumProfiles = 4;
+
+        /** Available profiles (index 0 is the default) */
+        const static Profile kProfiles[kNumProfiles];
+
+        /**
+         * @param defaultIndex Index of the profile used if none has been selected at run time.
+         */
+        TaskTopology(uint8_t defaultIndex);
+
+        /**
+         * Loads the profile selected at run time from NVS.
+         * In benchmark mode the profile of the current benchmark run is used instead.
+         * 
+         * @param benchmark true = run the topology benchmark (one profile per boot).
+         * @return false if NVS is not available (the default profile is used).
+         */
+        bool begin(bool benchmark);
+
+        /** Profile used for creating the tasks */
+        const Profile& profile() const { return kProfiles[index_]; }
+
+        /** Index of the profile used for creating the tasks */
+        uint8_t index() const { return index_; }
+
+        /**
+         * Selects a profile at run time. The selection is stored in NVS and takes effect after a restart.
+         * 
+         * @param index Index of the profile.
+         * @return false if the index is invalid or NVS is not available.
+         */
+        bool select(uint8_t index);
+
+        /**
+         * Creates a task according to the given configuration.
+         * 
+         * @return true if the task has been created.
+         */
+        static bool createTask(TaskFunction_t function, const char *name, const TaskConfig &config, void *param, TaskHandle_t *pHandle);
+
+        /** Checks whether a benchmark run is in progress */
+        bool isBenchmarkRunning() const { return benchmarkRun_ < kNumProfiles; }
+
+        /**
+         * Stores the result of the current benchmark run and advances to the next profile.
+         * After the last run the results of all profiles are logged.
+         * 
+         * @return true if more runs follow (the device has to be restarted).
+         */
+        bool finishBenchmarkRun(const BenchmarkResult &result);
+
+    private:
+        // Logs the results of all benchmark runs
+        void logBenchmarkResults();
+
+        // NVS storage
+        Preferences prefs_;
+
+        // Index of the profile used
+        uint8_t index_;
+
+        // Index of the current benchmark run ('kNumProfiles' = no benchmark running)
+        uint8_t benchmarkRun_;
+};
@@ -0,0 +1,107 @@
+/**
+    TextLine:
+    One line of text on the screen, held as a ring buffer of 1-bit pixel
+    columns and expanded to RGB565 only while it is pushed to the display.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "GlyphAtlas.h"
+
+class TextLine {
+    public:
+        /** Number of pixel rows expanded to RGB565 and pushed at once */
+        const static uint8_t kPushRows = 4;
+
+        /**
+         * @param pAtlas Glyphs used for rendering text.
+         */
+        TextLine(const GlyphAtlas *pAtlas);
+
+        ~TextLine();
+
+        /**
+         * Allocates the column buffer.
+         * 
+         * @param width Width of the line in pixels.
+         * @return false if memory could not be allocated.
+         */
+        bool begin(int16_t width);
+
+        /** Width of the line in pixels */
+        int16_t width() const { return width_; }
+
+        /** Height of the line in pixels */
+        int16_t height() const { return pAtlas_->height(); }
+
+        /**
+         * Clears all pixels.
+         */
+        void clear();
+
+        /**
+         * Clears the line and renders a text (clipped at the right edge).
+         * 
+         * @param x Horizontal position of the text within the line.
+         * @param text Text to be rendered.
+         */
+        void drawText(int16_t x, const char *text);
+
+        /**
+         * Shifts the line one pixel to the left and appends a column at the right edge.
+         * 
+         * @param column Pixels of the new column (bit n = row n).
+         */
+        void scrollIn(uint32_t column);
+
+        /**
+         * Expands the line to RGB565 and pushes it to the display.
+         * 
+         * @param pTft Display.
+         * @param x Horizontal position on the screen.
+         * @param y Vertical position on the screen.
+         * @param fgColor Text color.
+         * @param bgColor Background color.
+         */
+        void push(TFT_eSPI *pTft, int16_t x, int16_t y, uint16_t fgColor, uint16_t bgColor);
+
+        /** Memory used by the line in bytes (without the shared push buffer) */
+        size_t memoryUsage() const;
+
+        /** Size of the push buffer shared by all lines in bytes */
+        static size_t pushBufferSize() { return pushBufferPixels_ * sizeof(uint16_t); }
+
+    private:
+        // Glyphs used for rendering
+        const GlyphAtlas *pAtlas_;
+
+        // Width of the line in pixels
+        int16_t width_;
+
+        // Ring buffer of pixel columns
+        uint32_t *pColumns_;
+
+        // Index of the leftmost column in the ring buffer
+        int16_t head_;
+
+        // RGB565 buffer for 'kPushRows' rows, shared by all lines (all lines are pushed by the same task)
+        static uint16_t *pPushBuffer_;
+
+        // Size of the push buffer in pixels
+        static size_t pushBufferPixels_;
+};
@@ -0,0 +1,244 @@
+/**
+    TimeshiftProxy:
+    Local HTTP proxy between a stream host and the audio library. It keeps
+    receiving the stream while the library does not read (pause) and holds
+    the data in a RAM ring with a spill file on flash, so that playing can
+    resume where it has been paused. After the pause it skips the newer data
+    until the spill file has been played and returns to the live stream.
+    It also keeps a standby connection to the next station, which a station
+    switch takes over without connecting and waiting for the host.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <WiFi.h>
+#include "PlaylistCache.h"
+
+class TimeshiftProxy {
+    public:
+        /** Maximum length of a stream URL including the terminating zero */
+        const static size_t kMaxUrlLength = PlaylistCache::kMaxUrlLength;
+
+        /**
+         * Maximum age in ms of a standby connection: it is not read beyond its buffer, so the host queues the
+         * stream and drops the connection after a while (Icecast: 'queue-size', 512 kB = 32 s at 128 kbit/s)
+         */
+        const static uint32_t kStandbyMaxAge = 20000;
+
+        /**
+         * @param fs File system of the spill file.
+         * @param spillPath Path of the spill file (created by 'begin', removed by 'end').
+         * @param ramSize Size of the RAM ring in bytes.
+         * @param spillSize Maximum size of the spill file in bytes (0 = RAM only).
+         * @param standbySize Size of the buffer of the standby connection in bytes (0 = no standby connection).
+         */
+        TimeshiftProxy(fs::FS &fs, const char *spillPath, size_t ramSize, size_t spillSize, size_t standbySize);
+
+        /**
+         * Allocates the RAM ring, creates the spill file, opens the local port (127.0.0.1) and starts the proxy task.
+         *
+         * @param priority RTOS priority of the proxy task.
+         * @param core Core the proxy task is pinned to ('tskNO_AFFINITY' = any core).
+         * @param stackSize Stack size of the proxy task in bytes.
+         * @return false if the buffer, the port or the task could not be created.
+         */
+        bool begin(UBaseType_t priority, BaseType_t core = tskNO_AFFINITY, uint32_t stackSize = 4096);
+
+        /**
+         * Stops the proxy task, closes the port and releases the buffers.
+         *
+         * @return false if the task has not ended in time (the buffers are kept, the task ends by itself).
+         */
+        bool end();
+
+        /** true if the stream can be served by the proxy (plain HTTP) */
+        static bool isSupportedUrl(const char *url);
+
+        /**
+         * Connects to the stream host and starts a session for the audio library; a previous session is closed.
+         * The host is asked for ICY metadata, its response is passed on unchanged. A standby connection to the
+         * same URL is taken over together with the data it has received, any other standby connection is closed.
+         *
+         * @param url Stream URL (not a playlist).
+         * @param hostIp Address of the stream host, e.g. from the host cache (0.0.0.0 = looked up by the proxy).
+         * @param localUrl Buffer receiving the URL the audio library has to connect to (at least 'kMaxUrlLength' bytes).
+         * @return false if the proxy is not running, the local URL would be truncated or the host cannot be connected.
+         */
+        bool open(const char *url, const IPAddress &hostIp, char *localUrl);
+
+        /** Ends the session: both connections are closed and the buffered data is discarded */
+        void close();
+
+        /**
+         * Opens the standby connection: the host is requested like by 'open' and the start of its response is
+         * received into the standby buffer while the current session plays. A previous standby connection is closed.
+         * Blocks while connecting (called by the standby task); the connection is closed after 'kStandbyMaxAge'.
+         *
+         * @param url Stream URL (not a playlist).
+         * @param hostIp Address of the stream host, e.g. from the host cache (0.0.0.0 = looked up by the proxy).
+         * @return false if the proxy is not running, has no standby buffer, cannot serve the URL or cannot connect.
+         */
+        bool openStandby(const char *url, const IPAddress &hostIp);
+
+        /** true if the session has been started from the standby connection (by the last 'open') */
+        bool isWarm() const { return warm_; }
+
+        /**
+         * Marks the pause of the audio library. Only while paused the stream is stored beyond the RAM ring (spill file).
+         * After the pause the stored part is played while the newer data is skipped until the spill file is empty, so
+         * the flash is not written by normal playing. The stream is spliced at the start of an audio section (ICY).
+         */
+        void setPaused(bool paused);
+
+        /** true while a session is open (the audio library plays through the proxy) */
+        bool isOpen() const { return open_; }
+
+        /** true if the buffer is full, the host is not read anymore */
+        bool isFull() const { return room() == 0; }
+
+        /** Stream data held in RAM in bytes */
+        size_t bufferedRam() const { return ramFill_ + (sendLength_ - sendPos_); }
+
+        /** Stream data held in the spill file in bytes */
+        size_t bufferedSpill() const { return spillFill_; }
+
+        /** Stream data skipped to return to the live stream after pauses in bytes (since 'open') */
+        uint32_t skippedBytes() const { return skipped_; }
+
+        /** Handle of the proxy task (nullptr = not running) */
+        TaskHandle_t taskHandle() const { return pTask_; }
+
+    private:
+        // Entry function of the RTOS proxy task
+        static void task(void *p);
+
+        // Passes the data on between host and audio library (true if data has been moved)
+        bool pump();
+
+        // Accepts the connection of the audio library (rejects other connections while no session is open)
+        void acceptClient();
+
+        // Closes the connections and discards the buffered data (mutex held)
+        void closeSession();
+
+        // Receives the start of the response into the standby buffer, closes the standby connection when it is too old
+        void pumpStandby();
+
+        // Closes the standby connection and discards its data (mutex held)
+        void closeStandby();
+
+        // Splits a stream URL into host name, port and path (false if the URL is not supported or too long)
+        static bool splitUrl(const char *url, char *host, uint16_t &port, char *path);
+
+        // Connects to the stream host and sends the request (blocking, without the mutex)
+        static bool connectHost(WiFiClient &client, const char *host, uint16_t port, const char *path, const IPAddress &hostIp);
+
+        // Appends data to the buffer: RAM ring first, spill file while the spill file holds data
+        size_t bufferWrite(const uint8_t *data, size_t length);
+
+        // Removes the oldest data from the buffer
+        size_t bufferRead(uint8_t *data, size_t length);
+
+        // Free space of the buffer in bytes (the spill file only while paused, only the spill file while it holds data)
+        size_t room() const;
+
+        // Stores or skips data received from the host, following the sections of the response
+        void receive(const uint8_t *data, size_t length);
+
+        // Starts the next audio section: the only point where skipping starts or ends
+        void startAudioSection();
+
+        // File system and path of the spill file
+        fs::FS &fs_;
+        const char *spillPath_;
+
+        // Capacity of the RAM ring and of the spill file in bytes
+        size_t ramSize_;
+        size_t spillSize_;
+
+        // Capacity of the spill file in use (0 = the spill file could not be created)
+        size_t spillCapacity_;
+
+        // RAM ring: storage, position of the oldest byte and number of bytes
+        uint8_t *pRam_;
+        size_t ramStart_;
+        volatile size_t ramFill_;
+
+        // Spill file used as ring: position of the oldest byte and number of bytes
+        File spillFile_;
+        size_t spillStart_;
+        volatile size_t spillFill_;
+
+        // Data taken from the buffer and not yet accepted by the socket of the audio library
+        uint8_t *pSend_;
+        volatile size_t sendLength_;
+        volatile size_t sendPos_;
+
+        // Chunk received from the host
+        uint8_t *pReceive_;
+
+        // Sections of the response: HTTP header, audio data, length byte and text of the ICY metadata
+        enum Section {HEADER, AUDIO, META_LENGTH, META};
+
+        // Section of the next byte received, bytes left in the section and ICY metadata interval (0 = none)
+        Section section_;
+        size_t sectionLeft_;
+        uint32_t metaint_;
+
+        // Current line of the HTTP header (truncated, only the start of the line is evaluated)
+        char headerLine_[32];
+        uint8_t headerLineLength_;
+
+        // Pause state set by the application, flag and count of the data skipped after a pause
+        bool paused_;
+        bool skipping_;
+        volatile uint32_t skipped_;
+
+        // Connection to the stream host
+        WiFiClient host_;
+
+        // Listening socket on 127.0.0.1, its port and the socket of the connection to the audio library
+        int listenFd_;
+        uint16_t port_;
+        int clientFd_;
+
+        // Standby connection: URL, time it has been opened, buffer with its size and the data received ahead
+        WiFiClient standby_;
+        char standbyUrl_[kMaxUrlLength];
+        unsigned long standbyTime_;
+        uint8_t *pStandby_;
+        size_t standbySize_;
+        size_t standbyFill_;
+
+        // Flag indicating that the session has been started from the standby connection
+        volatile bool warm_;
+
+        // Flag indicating an open session
+        volatile bool open_;
+
+        // Handle to the RTOS proxy task (cleared by the task when it ends)
+        TaskHandle_t pTask_;
+
+        // Flag requesting the proxy task to end
+        volatile bool stop_;
+
+        // Mutex protecting the session, taken by the proxy task for each pass
+        SemaphoreHandle_t mutex_;
+};
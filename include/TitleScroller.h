@@ -0,0 +1,97 @@
+/**
+    TitleScroller:
+    Scrolls a single line of text of arbitrary length through a screen-wide
+    ring buffer of pixel columns. Glyph columns are taken from the glyph
+    atlas on demand when they enter the visible window.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "TextLine.h"
+
+class TitleScroller {
+    public:
+        /** Maximum length of the text including the terminating zero */
+        const static size_t kMaxTextLength = 256;
+
+        /**
+         * @param pAtlas Glyphs used for rendering the text.
+         */
+        TitleScroller(const GlyphAtlas *pAtlas);
+
+        /**
+         * Allocates the column ring buffer of the visible window.
+         * 
+         * @param width Width of the visible window in pixels.
+         * @param color Text color.
+         * @return false if memory could not be allocated.
+         */
+        bool begin(int16_t width, uint16_t color);
+
+        /**
+         * Sets a new text and wipes out the previous one. The text starts scrolling at the right edge.
+         * 
+         * @param text Zero terminated text (truncated to 'kMaxTextLength' - 1 characters).
+         */
+        void setText(const char *text);
+
+        /**
+         * Scrolls the text by one pixel to the left and pushes the visible window to the screen.
+         * 
+         * @param pTft Display.
+         * @param x Horizontal position of the window on the screen.
+         * @param y Vertical position of the window on the screen.
+         */
+        void scroll(TFT_eSPI *pTft, int16_t x, int16_t y);
+
+        /**
+         * Pushes the visible window to the screen without scrolling.
+         */
+        void push(TFT_eSPI *pTft, int16_t x, int16_t y);
+
+        /** Memory used by the scroller in bytes (without glyph atlas and text) */
+        size_t memoryUsage() const { return sizeof(*this) + line_.memoryUsage(); }
+
+    private:
+        // Returns the next pixel column of the text (empty columns between repetitions)
+        uint32_t nextColumn();
+
+        // Glyphs used for rendering
+        const GlyphAtlas *pAtlas_;
+
+        // Visible window
+        TextLine line_;
+
+        // Text color
+        uint16_t color_;
+
+        // Text being scrolled
+        char text_[kMaxTextLength];
+
+        // Length of 'text_'
+        uint16_t textLength_;
+
+        // Index of the character of 'text_' currently entering the window
+        uint16_t textIndex_;
+
+        // Column of the current character entering the window
+        uint8_t glyphColumn_;
+
+        // Remaining empty columns before the text starts again
+        int16_t gapColumns_;
+};
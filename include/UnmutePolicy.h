@@ -0,0 +1,125 @@
+/**
+    UnmutePolicy:
+    Decides when the audio output can be unmuted after connecting to a
+    stream, based on the measured data rate of the stream compared to its
+    bitrate and the observed jitter of the incoming data.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+class UnmutePolicy {
+    public:
+        UnmutePolicy();
+
+        /**
+         * Starts a new measurement after connecting to a stream.
+         * 
+         * @param time Current time in ms.
+         * @param bufferSize Size of the audio input buffer in bytes that counts for unmuting (without a reserve that fills while playing).
+         */
+        void reset(uint32_t time, uint32_t bufferSize);
+
+        /**
+         * Sets the bitrate of the stream.
+         * 
+         * @param info Bitrate as reported by the 'esp32-audioI2S' library (bit/s or kbit/s).
+         */
+        void setBitrate(const char *info);
+
+        /**
+         * Updates the measurement with the current buffer fill level.
+         * 
+         * @param time Current time in ms.
+         * @param bufferFilled Number of bytes in the audio input buffer.
+         */
+        void update(uint32_t time, uint32_t bufferFilled);
+
+        /**
+         * @return true if the buffered data is expected to survive the observed jitter.
+         */
+        bool shouldUnmute() const;
+
+        /**
+         * @return true if the stream obviously delivers too little data to be played.
+         */
+        bool isStreamError() const;
+
+        /**
+         * Writes the current decision inputs to the log.
+         * 
+         * @param reason Text describing the decision that has been taken.
+         */
+        void log(const char *reason) const;
+
+        /** Time in ms that the buffer has to cover in addition to the observed jitter */
+        const static uint32_t kBaseHeadroom = 500;
+
+        /** Factor applied to the largest observed gap between incoming data */
+        const static uint32_t kJitterFactor = 2;
+
+        /** Minimum time in ms after connecting before a stream error is reported */
+        const static uint32_t kErrorTimeMin = 3000;
+
+        /** Time in ms after connecting at which a stream error is reported regardless of the data rate */
+        const static uint32_t kErrorTimeMax = 8000;
+
+        /** Measurement window for the data rate in ms */
+        const static uint32_t kRateWindow = 250;
+
+    private:
+        // Required buffer fill in bytes for the current bitrate and jitter
+        uint32_t requiredFill() const;
+
+        // Estimated incoming data rate in bytes/s
+        int32_t incomingRate() const;
+
+        // Stream bitrate in bytes/s (0 = unknown)
+        uint32_t byteRate_;
+
+        // Size of the audio input buffer in bytes
+        uint32_t bufferSize_;
+
+        // Current buffer fill in bytes
+        uint32_t bufferFilled_;
+
+        // Time of connecting in ms
+        uint32_t timeStart_;
+
+        // Time of the last update in ms
+        uint32_t timeNow_;
+
+        // Time at which data has arrived the last time in ms
+        uint32_t timeLastData_;
+
+        // Largest gap between incoming data in ms
+        uint32_t maxGap_;
+
+        // Start time of the current rate measurement window in ms
+        uint32_t timeWindow_;
+
+        // Buffer fill at the start of the current rate measurement window in bytes
+        uint32_t bufferFilledWindow_;
+
+        // Smoothed change of the buffer fill in bytes/s (incoming data minus data consumed by the decoder)
+        int32_t netRate_;
+
+        // Flag indicating that 'netRate_' contains at least one measurement
+        bool netRateValid_;
+};
@@ -0,0 +1,68 @@
+/**
+    A2dpGainControl:
+    Volume control of the bluetooth sink (A2DP) that runs the PCM chain,
+    applies the AVRC volume through the per-sample gain ramp and records the
+    arrival of the audio data for the buffering monitor.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "A2dpGainControl.h"
+
+const uint8_t A2dpGainControl::kVolumeMax;
+
+A2dpGainControl::A2dpGainControl(PcmChain *pChain, GainRamp *pRamp, uint32_t fadeInTime, uint32_t rampTime, BufferingMonitor *pMonitor) :
+    pChain_(pChain),
+    pRamp_(pRamp),
+    pMonitor_(pMonitor),
+    fadeInTime_(fadeInTime),
+    rampTime_(rampTime),
+    volume_(-1)
+{
+}
+
+void A2dpGainControl::reset() {
+    pRamp_->setGain(0);
+    volume_ = -1;
+}
+
+void A2dpGainControl::update_audio_data(Frame* data, uint16_t frameCount, uint8_t volume, bool mono_downmix, bool is_volume_used) {
+    if (data == nullptr || frameCount == 0) {
+        return;
+    }
+
+    pMonitor_->onData(frameCount); // The data is written to I2S right after this call
+
+    // Full volume until the source sets the volume
+    int16_t targetVolume = is_volume_used ? min(volume, kVolumeMax) : kVolumeMax;
+
+    if (targetVolume != volume_) {
+        pRamp_->rampTo(GainRamp::volumeToGain(targetVolume, kVolumeMax), volume_ < 0 ? fadeInTime_ : rampTime_, GainRamp::EXPONENTIAL);
+        volume_ = targetVolume;
+    }
+
+    if (mono_downmix) {
+        for (uint16_t i = 0; i < frameCount; ++i) {
+            int16_t mono = (int16_t) (((int32_t) data[i].channel1 + data[i].channel2) / 2);
+
+            data[i].channel1 = mono;
+            data[i].channel2 = mono;
+        }
+    }
+
+    pChain_->process((int16_t*) data, frameCount);
+    pRamp_->process((int16_t*) data, frameCount);
+}
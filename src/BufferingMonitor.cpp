@@ -0,0 +1,119 @@
+/**
+    BufferingMonitor:
+    Estimates the audio buffered between the arrival of PCM data and its
+    output by the DAC (buffering delay) and detects underruns.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BufferingMonitor.h"
+
+BufferingMonitor::BufferingMonitor() :
+    sampleRate_(44100),
+    dmaFrames_(0),
+    level_(0),
+    lastTime_(0),
+    levelSum_(0),
+    levelCount_(0),
+    levelMin_(INT32_MAX),
+    levelMax_(0),
+    maxGap_(0),
+    underruns_(0),
+    frames_(0),
+    mux_(portMUX_INITIALIZER_UNLOCKED)
+{
+}
+
+void BufferingMonitor::begin(uint32_t sampleRate, uint32_t dmaFrames) {
+    portENTER_CRITICAL(&mux_);
+    sampleRate_ = max(sampleRate, (uint32_t) 1);
+    dmaFrames_ = dmaFrames;
+    level_ = 0;
+    lastTime_ = 0;
+    levelSum_ = 0;
+    levelCount_ = 0;
+    levelMin_ = INT32_MAX;
+    levelMax_ = 0;
+    maxGap_ = 0;
+    underruns_ = 0;
+    frames_ = 0;
+    portEXIT_CRITICAL(&mux_);
+}
+
+void BufferingMonitor::onData(uint32_t frames) {
+    uint32_t now = micros();
+
+    portENTER_CRITICAL(&mux_);
+
+    if (lastTime_ != 0) {
+        uint32_t gap = now - lastTime_;
+
+        // Frames played by the DAC since the last arrival
+        int32_t played = (int32_t) ((uint64_t) gap * sampleRate_ / 1000000);
+
+        level_ -= played;
+
+        if (level_ < 0) {
+            // The DMA buffers ran empty (silence has been played), the output restarts with the new data
+            if (-level_ > (int32_t) (sampleRate_ / 100)) { // Ignore deviations below 10 ms (timing of the callbacks)
+                underruns_++;
+            }
+
+            level_ = 0;
+        }
+
+        maxGap_ = max(maxGap_, gap);
+    }
+
+    // The data is written to the DMA buffers, the writer blocks while they are full,
+    // so the level cannot exceed the DMA capacity plus the new data
+    level_ = min(level_ + (int32_t) frames, (int32_t) (dmaFrames_ + frames));
+    lastTime_ = now;
+
+    levelSum_ += level_;
+    levelCount_++;
+    levelMin_ = min(levelMin_, level_);
+    levelMax_ = max(levelMax_, level_);
+    frames_ += frames;
+
+    portEXIT_CRITICAL(&mux_);
+}
+
+bool BufferingMonitor::takeReport(Report &report) {
+    portENTER_CRITICAL(&mux_);
+
+    uint32_t rate = sampleRate_;
+
+    report.dmaDelay = dmaFrames_ * 1000 / rate;
+    report.delayAvg = levelCount_ > 0 ? (uint32_t) (levelSum_ / levelCount_ * 1000 / rate) : 0;
+    report.delayMin = levelCount_ > 0 ? (uint32_t) levelMin_ * 1000 / rate : 0;
+    report.delayMax = (uint32_t) levelMax_ * 1000 / rate;
+    report.maxGap = maxGap_ / 1000;
+    report.underruns = underruns_;
+    report.frames = frames_;
+
+    levelSum_ = 0;
+    levelCount_ = 0;
+    levelMin_ = INT32_MAX;
+    levelMax_ = 0;
+    maxGap_ = 0;
+    underruns_ = 0;
+    frames_ = 0;
+
+    portEXIT_CRITICAL(&mux_);
+
+    return report.frames > 0;
+}
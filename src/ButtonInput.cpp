@@ -0,0 +1,319 @@
+/**
+    ButtonInput:
+    Interrupt-driven input of the buttons (GPIO) and of the power button of
+    the AXP192 power management IC (IRQ line). Edges are debounced in the
+    interrupt handler and passed to the main loop through a queue, which
+    also wakes up the main loop.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ButtonInput.h"
+#include <Wire.h>
+
+const uint8_t ButtonInput::kMaxButtons;
+const uint32_t ButtonInput::kAxpLongPressTime;
+
+/** Capacity of the edge queue */
+const UBaseType_t kEdgeQueueLength = 16;
+
+/** I2C address of the AXP192 (internal bus 'Wire1') */
+const uint8_t kAxpAddress = 0x34;
+
+/** IRQ enable registers 1 ... 5 of the AXP192 */
+const uint8_t kAxpIrqEnable[] = {0x40, 0x41, 0x42, 0x43, 0x4A};
+
+/** IRQ status registers 1 ... 5 of the AXP192 (cleared by writing 1) */
+const uint8_t kAxpIrqStatus[] = {0x44, 0x45, 0x46, 0x47, 0x4D};
+
+/** IRQ enable and status register 3 contain the power button: bit 1 = short press, bit 0 = long press */
+const uint8_t kAxpIrqPowerButton = 2;
+const uint8_t kAxpShortPress = 0x02;
+const uint8_t kAxpLongPress = 0x01;
+
+/**
+ * Writes a register of the AXP192.
+ */
+static bool writeAxpRegister(uint8_t reg, uint8_t value) {
+    Wire1.beginTransmission(kAxpAddress);
+    Wire1.write(reg);
+    Wire1.write(value);
+
+    return Wire1.endTransmission() == 0;
+}
+
+/**
+ * Reads a register of the AXP192.
+ * 
+ * @return false if the register could not be read.
+ */
+static bool readAxpRegister(uint8_t reg, uint8_t &value) {
+    Wire1.beginTransmission(kAxpAddress);
+    Wire1.write(reg);
+
+    if (Wire1.endTransmission(false) != 0 || Wire1.requestFrom(kAxpAddress, (uint8_t) 1) != 1) {
+        return false;
+    }
+
+    value = Wire1.read();
+
+    return true;
+}
+
+ButtonInput::ButtonInput(uint32_t debounceTime, Histogram *pLatency) :
+    debounceTime_(debounceTime * 1000),
+    pLatency_(pLatency),
+    queue_(nullptr),
+    notifyTask_(nullptr),
+    mux_(portMUX_INITIALIZER_UNLOCKED)
+{
+    for (uint8_t i = 0; i < kMaxButtons; i++) {
+        buttons_[i] = {this, i, 0, false, false, false, false, false, 0, false, 0, 0, false, false};
+    }
+}
+
+void ButtonInput::addButton(uint8_t id, uint8_t pin, bool activeHigh, bool pullUp) {
+    Button &button = buttons_[id];
+
+    button.pin = pin;
+    button.activeHigh = activeHigh;
+    button.pullUp = pullUp;
+    button.axp = false;
+    button.used = true;
+}
+
+void ButtonInput::addAxpButton(uint8_t id, uint8_t irqPin) {
+    Button &button = buttons_[id];
+
+    button.pin = irqPin;
+    button.activeHigh = false; // The IRQ line is pulled low while an event is pending
+    button.pullUp = false;
+    button.axp = true;
+    button.used = true;
+}
+
+bool ButtonInput::begin(TaskHandle_t notifyTask) {
+    if (queue_ == nullptr) {
+        queue_ = xQueueCreate(kEdgeQueueLength, sizeof(Edge));
+    }
+
+    if (queue_ == nullptr) {
+        log_w("Cannot create the button queue.");
+        return false;
+    }
+
+    notifyTask_ = notifyTask;
+
+    for (uint8_t i = 0; i < kMaxButtons; i++) {
+        Button &button = buttons_[i];
+
+        if (!button.used) {
+            continue;
+        }
+
+        pinMode(button.pin, button.pullUp ? INPUT_PULLUP : INPUT);
+
+        if (button.axp) {
+            // Let only the power button pull the IRQ line low and clear pending events
+            for (uint8_t reg = 0; reg < sizeof(kAxpIrqEnable); reg++) {
+                writeAxpRegister(kAxpIrqEnable[reg], reg == kAxpIrqPowerButton ? (kAxpShortPress | kAxpLongPress) : 0x00);
+                writeAxpRegister(kAxpIrqStatus[reg], 0xFF);
+            }
+
+            button.isrTime = micros();
+
+            attachInterruptArg(button.pin, axpIsr, &button, FALLING);
+        }
+        else {
+            button.isrPressed = (digitalRead(button.pin) == HIGH) == button.activeHigh;
+            button.isrTime = micros();
+            button.pressed = button.isrPressed;
+            button.pressTime = button.isrTime;
+
+            attachInterruptArg(button.pin, gpioIsr, &button, CHANGE);
+        }
+    }
+
+    return true;
+}
+
+void ButtonInput::update() {
+    for (uint8_t i = 0; i < kMaxButtons; i++) {
+        buttons_[i].wasPressed = false;
+        buttons_[i].wasReleased = false;
+    }
+
+    if (queue_ == nullptr) {
+        return;
+    }
+
+    Edge edge;
+
+    while (xQueueReceive(queue_, &edge, 0) == pdTRUE) {
+        Button &button = buttons_[edge.id];
+
+        if (button.axp) {
+            readAxp(button, edge.time);
+        }
+        else {
+            apply(edge);
+        }
+
+        if (pLatency_ != nullptr) {
+            pLatency_->observe(micros() - edge.time);
+        }
+    }
+
+    for (uint8_t i = 0; i < kMaxButtons; i++) {
+        if (buttons_[i].used) {
+            resync(buttons_[i]);
+        }
+    }
+}
+
+void ButtonInput::gpioIsr(void *p) {
+    Button *pButton = (Button*) p;
+    ButtonInput *pOwner = pButton->pOwner;
+
+    uint32_t now = micros();
+    bool pressed = (digitalRead(pButton->pin) == HIGH) == pButton->activeHigh;
+    bool accepted = false;
+
+    // Accept a change of the level only after the debounce time (bounces right after an edge are ignored)
+    portENTER_CRITICAL_ISR(&pOwner->mux_);
+
+    if (pressed != pButton->isrPressed && now - pButton->isrTime >= pOwner->debounceTime_) {
+        pButton->isrPressed = pressed;
+        pButton->isrTime = now;
+        accepted = true;
+    }
+
+    portEXIT_CRITICAL_ISR(&pOwner->mux_);
+
+    if (accepted) {
+        Edge edge = {pButton->id, pressed, now};
+
+        pOwner->pushFromIsr(edge);
+    }
+}
+
+void ButtonInput::axpIsr(void *p) {
+    Button *pButton = (Button*) p;
+    ButtonInput *pOwner = pButton->pOwner;
+
+    uint32_t now = micros();
+
+    portENTER_CRITICAL_ISR(&pOwner->mux_);
+    pButton->isrTime = now;
+    portEXIT_CRITICAL_ISR(&pOwner->mux_);
+
+    // The event is read over I2C by the main loop (not possible in the interrupt handler)
+    Edge edge = {pButton->id, true, now};
+
+    pOwner->pushFromIsr(edge);
+}
+
+void ButtonInput::pushFromIsr(const Edge &edge) {
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+    xQueueSendFromISR(queue_, &edge, &higherPriorityTaskWoken); // Dropped if the queue is full
+
+    if (notifyTask_ != nullptr) {
+        vTaskNotifyGiveFromISR(notifyTask_, &higherPriorityTaskWoken);
+    }
+
+    if (higherPriorityTaskWoken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+void ButtonInput::apply(const Edge &edge) {
+    Button &button = buttons_[edge.id];
+
+    if (edge.pressed == button.pressed) {
+        return;
+    }
+
+    button.pressed = edge.pressed;
+
+    if (edge.pressed) {
+        button.pressTime = edge.time;
+        button.wasPressed = true;
+    }
+    else {
+        button.holdTime = (edge.time - button.pressTime) / 1000;
+        button.wasReleased = true;
+    }
+}
+
+void ButtonInput::readAxp(Button &button, uint32_t time) {
+    uint8_t status;
+
+    if ( !readAxpRegister(kAxpIrqStatus[kAxpIrqPowerButton], status) ) {
+        log_w("Cannot read the power button state.");
+        return;
+    }
+
+    // Clear all events, so that the IRQ line is released
+    for (uint8_t reg = 0; reg < sizeof(kAxpIrqStatus); reg++) {
+        writeAxpRegister(kAxpIrqStatus[reg], 0xFF);
+    }
+
+    if ( (status & (kAxpShortPress | kAxpLongPress)) == 0 ) {
+        return;
+    }
+
+    // The AXP192 reports a press after it has ended (short press) or after the long press time: press and release at once
+    button.pressTime = time;
+    button.holdTime = (status & kAxpLongPress) ? kAxpLongPressTime : 0;
+    button.wasPressed = true;
+    button.wasReleased = true;
+}
+
+void ButtonInput::resync(Button &button) {
+    uint32_t now = micros();
+    bool missed = false;
+    bool pressed = (digitalRead(button.pin) == HIGH) == button.activeHigh;
+
+    portENTER_CRITICAL(&mux_);
+
+    if (now - button.isrTime >= debounceTime_) {
+        if (button.axp) {
+            missed = pressed; // IRQ line still low: the falling edge has been missed or the event has not been cleared
+            button.isrTime = now;
+        }
+        else if (pressed != button.isrPressed) {
+            missed = true; // Level changed again within the debounce time
+            button.isrPressed = pressed;
+            button.isrTime = now;
+        }
+    }
+
+    portEXIT_CRITICAL(&mux_);
+
+    if (!missed) {
+        return;
+    }
+
+    if (button.axp) {
+        readAxp(button, now);
+    }
+    else {
+        Edge edge = {button.id, pressed, now};
+
+        apply(edge);
+    }
+}
@@ -0,0 +1,80 @@
+/**
+    CpuLoad:
+    Measures the CPU utilisation of both ESP32 cores from the run time of
+    the FreeRTOS idle tasks (via idle hooks).
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "CpuLoad.h"
+#include <esp_freertos_hooks.h>
+#include <esp_timer.h>
+
+/**
+ * Maximum time in us between two idle hook calls that is counted as idle time.
+ * A longer gap means that the idle task has been preempted by another task.
+ */
+const int64_t kIdleGapMax = 50;
+
+const uint8_t CpuLoad::kNumCores;
+
+volatile int64_t CpuLoad::lastHookTime_[kNumCores] = {0, 0};
+volatile int64_t CpuLoad::idleTime_[kNumCores] = {0, 0};
+int64_t CpuLoad::lastSampleTime_ = 0;
+int64_t CpuLoad::lastIdleTime_[kNumCores] = {0, 0};
+
+bool CpuLoad::begin() {
+    lastSampleTime_ = esp_timer_get_time();
+
+    return (esp_register_freertos_idle_hook_for_cpu(idleHookCore0, 0) == ESP_OK)
+        && (esp_register_freertos_idle_hook_for_cpu(idleHookCore1, 1) == ESP_OK);
+}
+
+void CpuLoad::sample(uint8_t load[kNumCores]) {
+    int64_t curTime = esp_timer_get_time();
+    int64_t elapsed = curTime - lastSampleTime_;
+
+    for (uint8_t core = 0; core < kNumCores; ++core) {
+        int64_t idleTime = idleTime_[core];
+        int64_t idle = idleTime - lastIdleTime_[core];
+
+        load[core] = (elapsed > 0) ? (uint8_t) (100 - constrain(idle * 100 / elapsed, 0, 100)) : 0;
+        lastIdleTime_[core] = idleTime;
+    }
+
+    lastSampleTime_ = curTime;
+}
+
+bool CpuLoad::idleHookCore0() {
+    accumulate(0);
+    return false; // Keep calling the hook instead of waiting for an interrupt
+}
+
+bool CpuLoad::idleHookCore1() {
+    accumulate(1);
+    return false; // Keep calling the hook instead of waiting for an interrupt
+}
+
+void CpuLoad::accumulate(uint8_t core) {
+    int64_t curTime = esp_timer_get_time();
+    int64_t gap = curTime - lastHookTime_[core];
+
+    if (gap < kIdleGapMax) {
+        idleTime_[core] += gap;
+    }
+
+    lastHookTime_[core] = curTime;
+}
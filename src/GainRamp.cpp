@@ -0,0 +1,162 @@
+/**
+    GainRamp:
+    Per-sample gain stage in Q15 fixed point with ramps along selectable
+    curves (fade-in, fade-out and volume changes without audible steps).
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "GainRamp.h"
+
+const int16_t GainRamp::kUnity;
+const uint8_t GainRamp::kCurvePoints;
+
+const int16_t GainRamp::kCurves[3][kCurvePoints] = {
+    // LINEAR
+    {0, 1024, 2048, 3072, 4096, 5120, 6144, 7168, 8192, 9216, 10240, 11264, 12288, 13312, 14336, 15360, 16384,
+     17407, 18431, 19455, 20479, 21503, 22527, 23551, 24575, 25599, 26623, 27647, 28671, 29695, 30719, 31743, 32767},
+    // EXPONENTIAL: -48 dB ... 0 dB, the first point is 0 (mute)
+    {0, 155, 184, 219, 260, 309, 368, 437, 519, 617, 734, 872, 1036, 1232, 1464, 1740, 2067,
+     2457, 2920, 3471, 4125, 4903, 5827, 6925, 8231, 9782, 11626, 13818, 16422, 19518, 23197, 27570, 32767},
+    // S_CURVE: 3x^2 - 2x^3
+    {0, 94, 368, 810, 1408, 2150, 3024, 4018, 5120, 6318, 7600, 8954, 10368, 11830, 13328, 14850, 16384,
+     17917, 19439, 20937, 22399, 23813, 25167, 26449, 27647, 28749, 29743, 30617, 31359, 31957, 32399, 32673, 32767}
+};
+
+GainRamp::GainRamp() :
+    sampleRate_(44100),
+    pending_(false),
+    pendingGain_(0),
+    pendingDuration_(0),
+    pendingCurve_(LINEAR),
+    gain_(0),
+    start_(0),
+    target_(0),
+    pCurve_(kCurves[LINEAR]),
+    phase_(0),
+    increment_(0),
+    ramping_(false),
+    mux_(portMUX_INITIALIZER_UNLOCKED)
+{
+}
+
+void GainRamp::setSampleRate(uint32_t sampleRate) {
+    if (sampleRate > 0) {
+        sampleRate_ = sampleRate;
+    }
+}
+
+void GainRamp::rampTo(int16_t gain, uint32_t duration, Curve curve) {
+    portENTER_CRITICAL(&mux_);
+    pendingGain_ = constrain(gain, (int16_t) 0, kUnity);
+    pendingDuration_ = duration;
+    pendingCurve_ = curve;
+    pending_ = true;
+    portEXIT_CRITICAL(&mux_);
+}
+
+int16_t GainRamp::target() const {
+    portENTER_CRITICAL(&mux_);
+    int16_t gain = pending_ ? pendingGain_ : target_;
+    portEXIT_CRITICAL(&mux_);
+
+    return gain;
+}
+
+void GainRamp::process(int16_t *samples, size_t frames) {
+    if (pending_) {
+        applyPending();
+    }
+
+    // Constant gain: no need to step through the ramp for each frame
+    if (!ramping_) {
+        if (gain_ == kUnity) {
+            return;
+        }
+
+        for (size_t i = 0; i < 2 * frames; ++i) {
+            samples[i] = (int16_t) (((int32_t) samples[i] * gain_) >> 15);
+        }
+
+        return;
+    }
+
+    for (size_t i = 0; i < frames; ++i) {
+        processFrame(samples[2 * i], samples[2 * i + 1]);
+    }
+}
+
+int16_t GainRamp::volumeToGain(uint8_t volume, uint8_t maxVolume) {
+    if (maxVolume == 0 || volume >= maxVolume) {
+        return kUnity;
+    }
+
+    return curveValue(EXPONENTIAL, ((uint32_t) volume << 16) / maxVolume);
+}
+
+int16_t GainRamp::curveValue(Curve curve, uint32_t position) {
+    const int16_t *pCurve = kCurves[curve];
+    uint32_t phase = min(position, (uint32_t) 0x10000) * (kCurvePoints - 1);
+    uint32_t index = phase >> 16;
+
+    if (index >= kCurvePoints - 1) {
+        return pCurve[kCurvePoints - 1];
+    }
+
+    return pCurve[index] + (((int32_t) (pCurve[index + 1] - pCurve[index]) * (int32_t) (phase & 0xFFFF)) >> 16);
+}
+
+void GainRamp::applyPending() {
+    portENTER_CRITICAL(&mux_);
+    int16_t gain = pendingGain_;
+    uint32_t duration = pendingDuration_;
+    Curve curve = pendingCurve_;
+    pending_ = false;
+    portEXIT_CRITICAL(&mux_);
+
+    uint32_t samples = (uint32_t) ((uint64_t) duration * sampleRate_ / 1000);
+
+    if (samples == 0 || gain == gain_) {
+        gain_ = gain;
+        target_ = gain;
+        ramping_ = false;
+        return;
+    }
+
+    // A new ramp starts at the current gain, even if the previous ramp has not been completed
+    start_ = gain_;
+    target_ = gain;
+    pCurve_ = kCurves[curve];
+    phase_ = 0;
+    increment_ = max( (uint32_t) (((uint32_t) (kCurvePoints - 1) << 16) / samples), (uint32_t) 1 );
+    ramping_ = true;
+}
+
+void GainRamp::step() {
+    phase_ += increment_;
+
+    uint32_t index = phase_ >> 16;
+
+    if (index >= kCurvePoints - 1) {
+        gain_ = target_;
+        ramping_ = false;
+        return;
+    }
+
+    int32_t value = pCurve_[index] + (((int32_t) (pCurve_[index + 1] - pCurve_[index]) * (int32_t) (phase_ & 0xFFFF)) >> 16);
+
+    gain_ = start_ + (int16_t) (((int32_t) (target_ - start_) * value) >> 15);
+}
@@ -0,0 +1,130 @@
+/**
+    GlyphAtlas:
+    1-bit per pixel copy of the printable ASCII glyphs of a display font,
+    stored column by column. Built once at startup from the font renderer
+    of the display library.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "GlyphAtlas.h"
+
+const uint8_t GlyphAtlas::kFirstChar;
+const uint8_t GlyphAtlas::kLastChar;
+const uint8_t GlyphAtlas::kMaxHeight;
+const uint8_t GlyphAtlas::kNumGlyphs;
+
+GlyphAtlas::GlyphAtlas() :
+    height_(0),
+    bytesPerColumn_(0),
+    pBits_(nullptr)
+{
+    memset(widths_, 0, sizeof(widths_));
+    memset(offsets_, 0, sizeof(offsets_));
+}
+
+GlyphAtlas::~GlyphAtlas() {
+    free(pBits_);
+}
+
+bool GlyphAtlas::build(TFT_eSPI *pTft, uint8_t font, uint8_t size) {
+    // Temporary sprite for rendering a single glyph
+    TFT_eSprite glyphSprite = TFT_eSprite(pTft);
+
+    glyphSprite.setTextFont(font);
+    glyphSprite.setTextSize(size);
+    glyphSprite.setTextColor(TFT_WHITE);
+
+    height_ = glyphSprite.fontHeight();
+
+    if (height_ == 0 || height_ > kMaxHeight) {
+        log_w("Font %u (size %u) cannot be stored in glyph atlas.", font, size);
+        return false;
+    }
+
+    bytesPerColumn_ = (height_ + 7) / 8;
+
+    // Determine glyph widths and the size of the atlas
+    uint16_t numColumns = 0;
+    uint8_t maxWidth = 0;
+
+    for (uint8_t i = 0; i < kNumGlyphs; ++i) {
+        char str[2] = {(char) (kFirstChar + i), '\0'};
+
+        widths_[i] = glyphSprite.textWidth(str);
+        offsets_[i] = numColumns;
+
+        numColumns += widths_[i];
+        maxWidth = max(maxWidth, widths_[i]);
+    }
+
+    free(pBits_);
+    pBits_ = (uint8_t*) calloc(numColumns, bytesPerColumn_);
+
+    if ( pBits_ == nullptr || glyphSprite.createSprite(maxWidth, height_) == nullptr ) {
+        log_w("Cannot allocate glyph atlas for font %u (size %u).", font, size);
+        return false;
+    }
+
+    // Render each glyph and copy its pixels into the atlas
+    for (uint8_t i = 0; i < kNumGlyphs; ++i) {
+        glyphSprite.fillSprite(TFT_BLACK);
+        glyphSprite.drawChar(kFirstChar + i, 0, 0, font);
+
+        for (uint8_t x = 0; x < widths_[i]; ++x) {
+            uint8_t *pColumn = pBits_ + (offsets_[i] + x) * bytesPerColumn_;
+
+            for (uint8_t y = 0; y < height_; ++y) {
+                if (glyphSprite.readPixel(x, y) != TFT_BLACK) {
+                    pColumn[y / 8] |= 1 << (y % 8);
+                }
+            }
+        }
+    }
+
+    glyphSprite.deleteSprite();
+
+    return true;
+}
+
+uint32_t GlyphAtlas::column(uint8_t c, uint8_t x) const {
+    if (c < kFirstChar || c > kLastChar) {
+        return 0;
+    }
+
+    const uint8_t *pColumn = pBits_ + (offsets_[c - kFirstChar] + x) * bytesPerColumn_;
+    uint32_t bits = 0;
+
+    for (uint8_t i = 0; i < bytesPerColumn_; ++i) {
+        bits |= (uint32_t) pColumn[i] << (8 * i);
+    }
+
+    return bits;
+}
+
+int16_t GlyphAtlas::textWidth(const char *text) const {
+    int16_t w = 0;
+
+    for (const char *p = text; *p != '\0'; ++p) {
+        w += width(*p);
+    }
+
+    return w;
+}
+
+size_t GlyphAtlas::memoryUsage() const {
+    return sizeof(*this) + (offsets_[kNumGlyphs - 1] + widths_[kNumGlyphs - 1]) * bytesPerColumn_;
+}
@@ -0,0 +1,150 @@
+/**
+    HostCache:
+    Times the DNS lookups of stream hosts and keeps the recently resolved
+    hosts with their IP addresses in RAM.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "HostCache.h"
+#include <WiFi.h>
+
+const size_t HostCache::kMaxHostLength;
+const uint8_t HostCache::kNumEntries;
+
+HostCache::HostCache(uint32_t ttl) :
+    mutex_(nullptr),
+    ttl_(ttl * 1000)
+{
+    memset(entries_, 0, sizeof(entries_));
+}
+
+bool HostCache::begin() {
+    if (mutex_ == nullptr) {
+        mutex_ = xSemaphoreCreateMutex();
+    }
+
+    return mutex_ != nullptr;
+}
+
+bool HostCache::parseHost(const char *url, char *host) {
+    const char *pHost = strstr(url, "://");
+
+    if (pHost == nullptr) {
+        return false;
+    }
+
+    pHost += 3;
+
+    // Host name ends at the port separator or at the path
+    size_t hostLen = strcspn(pHost, ":/?");
+
+    if (hostLen == 0 || hostLen >= kMaxHostLength) {
+        return false;
+    }
+
+    memcpy(host, pHost, hostLen);
+    host[hostLen] = '\0';
+
+    return true;
+}
+
+bool HostCache::resolve(const char *host, Result &result) {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    Entry *pEntry = find(host);
+    uint32_t startTime = millis();
+
+    result.recent = (pEntry != nullptr) && (startTime - pEntry->time < ttl_);
+
+    // Resolved within the time to live (e.g. by the standby task): no lookup
+    if (result.recent) {
+        result.ip = pEntry->ip;
+        result.dnsTime = 0;
+
+        xSemaphoreGive(mutex_);
+        return true;
+    }
+
+    xSemaphoreGive(mutex_); // Do not block other tasks during the DNS lookup
+
+    IPAddress dnsIp;
+    bool success = WiFi.hostByName(host, dnsIp) == 1;
+
+    result.dnsTime = millis() - startTime;
+
+    if (!success) {
+        log_w("DNS lookup for '%s' failed after %u ms.", host, result.dnsTime);
+        return false;
+    }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    pEntry = find(host);
+
+    if (pEntry == nullptr) {
+        pEntry = findOldest();
+        strlcpy(pEntry->host, host, kMaxHostLength);
+    }
+
+    pEntry->ip = (uint32_t) dnsIp;
+    pEntry->time = millis();
+
+    xSemaphoreGive(mutex_);
+
+    result.ip = dnsIp;
+
+    return true;
+}
+
+void HostCache::invalidate(const char *host) {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    Entry *pEntry = find(host);
+
+    if (pEntry != nullptr) {
+        pEntry->host[0] = '\0';
+    }
+
+    xSemaphoreGive(mutex_);
+}
+
+HostCache::Entry* HostCache::find(const char *host) {
+    for (uint8_t i = 0; i < kNumEntries; ++i) {
+        if (strcmp(entries_[i].host, host) == 0) {
+            return &entries_[i];
+        }
+    }
+
+    return nullptr;
+}
+
+HostCache::Entry* HostCache::findOldest() {
+    Entry *pOldest = &entries_[0];
+    uint32_t curTime = millis();
+
+    for (uint8_t i = 0; i < kNumEntries; ++i) {
+        if (entries_[i].host[0] == '\0') {
+            return &entries_[i]; // Free entry
+        }
+
+        if (curTime - entries_[i].time > curTime - pOldest->time) {
+            pOldest = &entries_[i];
+        }
+    }
+
+    return pOldest;
+}
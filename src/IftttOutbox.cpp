@@ -0,0 +1,363 @@
+/**
+    IftttOutbox:
+    Queue of song infos for the IFTTT webhook, persisted in NVS and
+    delivered by a background task. Pending entries are sent in batches
+    of up to three (value1...value3), failed deliveries are retried with
+    exponential backoff.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "IftttOutbox.h"
+#include <HTTPClient.h>
+
+const size_t IftttOutbox::kMaxTextLength;
+const uint8_t IftttOutbox::kCapacity;
+const uint8_t IftttOutbox::kBatchSize;
+const uint32_t IftttOutbox::kRetryMin;
+const uint32_t IftttOutbox::kRetryMax;
+const uint32_t IftttOutbox::kSaveInterval;
+const uint32_t IftttOutbox::kStopTimeout;
+
+IftttOutbox::IftttOutbox(const char *url) :
+    url_(url),
+    open_(false),
+    count_(0),
+    dirty_(false),
+    saveTime_(0),
+    mutex_(nullptr),
+    pTask_(nullptr),
+    stop_(false),
+    retryDelay_(0),
+    retryTime_(0)
+{
+    memset(&queue_, 0, sizeof(queue_));
+    body_[0] = '\0';
+}
+
+bool IftttOutbox::begin(UBaseType_t priority, BaseType_t core, uint32_t stackSize) {
+    if (pTask_ != nullptr) {
+        if (stop_) {
+            log_w("Outbox task still stopping.");
+            return false;
+        }
+
+        log_w("Outbox task already running.");
+        return true;
+    }
+
+    if (mutex_ == nullptr) {
+        mutex_ = xSemaphoreCreateMutex();
+
+        if (mutex_ == nullptr) {
+            return false;
+        }
+    }
+
+    // Entries that could not be delivered before the last shutdown
+    if (!open_) {
+        open_ = prefs_.begin("outbox", false);
+
+        if (open_ && prefs_.getBytes("queue", &queue_, sizeof(queue_)) == sizeof(queue_)
+            && queue_.head < kCapacity && queue_.count <= kCapacity) {
+
+            for (uint8_t i = 0; i < kCapacity; ++i) {
+                queue_.text[i][kMaxTextLength - 1] = '\0';
+            }
+
+            if (queue_.count > 0) {
+                log_i("Outbox: %u entries pending from NVS", queue_.count);
+            }
+        }
+        else {
+            memset(&queue_, 0, sizeof(queue_));
+        }
+
+        count_ = queue_.count;
+    }
+
+    retryDelay_ = 0;
+    stop_ = false;
+
+    return xTaskCreatePinnedToCore(task, "IFTTT outbox task", stackSize, this, priority, &pTask_, core) == pdPASS;
+}
+
+bool IftttOutbox::end() {
+    bool stopped = true;
+
+    if (pTask_ != nullptr) {
+        // Let the task complete the current request and end itself
+        stop_ = true;
+        xTaskNotifyGive(pTask_);
+
+        unsigned long startTime = millis();
+
+        while (pTask_ != nullptr && millis() - startTime < kStopTimeout) {
+            vTaskDelay(10 / portTICK_PERIOD_MS);
+        }
+
+        stopped = (pTask_ == nullptr);
+
+        if (!stopped) {
+            log_w("Outbox task has not ended within %u ms.", kStopTimeout);
+        }
+    }
+
+    // Write the changes deferred by the rate limit
+    if (mutex_ != nullptr) {
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+
+        if (dirty_) {
+            save();
+        }
+
+        xSemaphoreGive(mutex_);
+    }
+
+    return stopped;
+}
+
+bool IftttOutbox::add(const char *text) {
+    if (mutex_ == nullptr) {
+        return false;
+    }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    bool added = queue_.count < kCapacity;
+
+    if (added) {
+        uint8_t index = (queue_.head + queue_.count) % kCapacity;
+
+        strlcpy(queue_.text[index], text, kMaxTextLength);
+        queue_.count++;
+        count_ = queue_.count;
+
+        changed();
+    }
+
+    xSemaphoreGive(mutex_);
+
+    if (added && pTask_ != nullptr) {
+        xTaskNotifyGive(pTask_); // Wake up the outbox task
+    }
+
+    return added;
+}
+
+size_t IftttOutbox::escapeJson(const char *text, char *out, size_t size) {
+    size_t len = 0;
+
+    if (size < 3) {
+        if (size > 0) {
+            out[0] = '\0';
+        }
+        return 0;
+    }
+
+    out[len++] = '"';
+
+    for (const char *p = text; *p != '\0'; ++p) {
+        char esc[7];
+        unsigned char c = (unsigned char) *p;
+
+        switch (c) {
+            case '"':  strcpy(esc, "\\\""); break;
+            case '\\': strcpy(esc, "\\\\"); break;
+            case '\b': strcpy(esc, "\\b"); break;
+            case '\f': strcpy(esc, "\\f"); break;
+            case '\n': strcpy(esc, "\\n"); break;
+            case '\r': strcpy(esc, "\\r"); break;
+            case '\t': strcpy(esc, "\\t"); break;
+
+            default:
+                if (c < 0x20) {
+                    snprintf(esc, sizeof(esc), "\\u%04x", c);
+                }
+                else {
+                    esc[0] = (char) c; // UTF-8 sequences are passed through
+                    esc[1] = '\0';
+                }
+                break;
+        }
+
+        size_t escLen = strlen(esc);
+
+        // Keep room for the closing quote and the terminating zero
+        if (len + escLen + 2 > size) {
+            // Do not cut a UTF-8 sequence in the middle
+            while ( len > 1 && ((unsigned char) out[len - 1] & 0xC0) == 0x80 ) {
+                len--;
+            }
+
+            if ( len > 1 && ((unsigned char) out[len - 1] & 0xC0) == 0xC0 ) {
+                len--;
+            }
+            break;
+        }
+
+        memcpy(out + len, esc, escLen);
+        len += escLen;
+    }
+
+    out[len++] = '"';
+    out[len] = '\0';
+
+    return len;
+}
+
+void IftttOutbox::task(void *p) {
+    IftttOutbox *pOutbox = (IftttOutbox*) p;
+    TickType_t waitTicks = 0; // Deliver entries from NVS right away
+
+    while (!pOutbox->stop_) {
+        ulTaskNotifyTake(pdTRUE, waitTicks);
+
+        if (!pOutbox->stop_) {
+            waitTicks = pOutbox->process();
+        }
+    }
+
+    pOutbox->pTask_ = nullptr;
+    vTaskDelete(nullptr);
+}
+
+TickType_t IftttOutbox::process() {
+    TickType_t waitTicks = deliver();
+
+    // Write the changes deferred by the rate limit when the interval has elapsed
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    TickType_t saveTicks = dirty_ ? changed() : portMAX_DELAY;
+
+    xSemaphoreGive(mutex_);
+
+    return min(waitTicks, saveTicks);
+}
+
+TickType_t IftttOutbox::deliver() {
+    if (count_ == 0) {
+        return portMAX_DELAY; // Wait for the next entry
+    }
+
+    uint32_t now = millis();
+
+    // Stay in backoff even if new entries arrive
+    if ( retryDelay_ > 0 && (int32_t) (retryTime_ - now) > 0 ) {
+        return max( (TickType_t) ((retryTime_ - now) / portTICK_PERIOD_MS), (TickType_t) 1 );
+    }
+
+    uint8_t done = (WiFi.status() == WL_CONNECTED) ? sendBatch() : 0;
+
+    if (done > 0) {
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+
+        queue_.head = (queue_.head + done) % kCapacity;
+        queue_.count -= done;
+        count_ = queue_.count;
+
+        changed();
+
+        xSemaphoreGive(mutex_);
+
+        retryDelay_ = 0;
+
+        return 0; // Continue with the next batch
+    }
+
+    retryDelay_ = (retryDelay_ == 0) ? kRetryMin : min(retryDelay_ * 2, kRetryMax);
+    retryTime_ = now + retryDelay_;
+
+    log_d("Outbox: %u entries pending, next attempt in %u ms", count_, retryDelay_);
+
+    return max( (TickType_t) (retryDelay_ / portTICK_PERIOD_MS), (TickType_t) 1 );
+}
+
+uint8_t IftttOutbox::sendBatch() {
+    // Entries are only removed by this task, so the head entries stay valid while the request is sent
+    uint8_t num = min(count_, kBatchSize);
+    size_t len = 0;
+
+    body_[len++] = '{';
+
+    for (uint8_t i = 0; i < num; ++i) {
+        const char *text = queue_.text[(queue_.head + i) % kCapacity];
+
+        len += snprintf(body_ + len, sizeof(body_) - len, "%s\"value%u\":", (i > 0) ? "," : "", i + 1);
+        len += escapeJson(text, body_ + len, min(sizeof(body_) - len - 1, 2 * kMaxTextLength + 2));
+    }
+
+    body_[len++] = '}';
+    body_[len] = '\0';
+
+    log_d("Request body:\n%s\n", body_);
+
+    HTTPClient http;
+
+    if ( !http.begin(url_) ) {
+        return 0;
+    }
+
+    http.setConnectTimeout(5000);
+    http.setTimeout(5000);
+    http.addHeader("Content-Type", "application/json");
+
+    int httpResponseCode = http.POST((uint8_t*) body_, len); // Send data using POST method
+
+    http.end();
+
+    if (httpResponseCode >= 200 && httpResponseCode < 300) { // Success
+        log_d("HTTP response code: %d (%u entries delivered)", httpResponseCode, num);
+        return num;
+    }
+
+    if (httpResponseCode >= 400 && httpResponseCode < 500 && httpResponseCode != 408 && httpResponseCode != 429) {
+        // The request itself is rejected (e.g. invalid key): retrying would block the outbox forever
+        log_w("HTTP response code %d - %u entries discarded.", httpResponseCode, num);
+        return num;
+    }
+
+    if (httpResponseCode > 0) {
+        log_w("HTTP response code %d - retrying later.", httpResponseCode);
+    }
+    else {
+        log_w("Error occurred while sending HTTP POST: %s", http.errorToString(httpResponseCode).c_str());
+    }
+
+    return 0;
+}
+
+TickType_t IftttOutbox::changed() {
+    uint32_t elapsed = millis() - saveTime_;
+
+    dirty_ = true;
+
+    if (elapsed >= kSaveInterval) {
+        save();
+        return portMAX_DELAY;
+    }
+
+    return (kSaveInterval - elapsed) / portTICK_PERIOD_MS + 1;
+}
+
+void IftttOutbox::save() {
+    if (open_) {
+        prefs_.putBytes("queue", &queue_, sizeof(queue_));
+    }
+
+    dirty_ = false;
+    saveTime_ = millis();
+}
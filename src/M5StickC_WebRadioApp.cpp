@@ -26,7 +26,31 @@
 #include "BluetoothA2DPSink.h"
 #include <EEPROM.h>
 #include <HTTPClient.h>
+#include <LITTLEFS.h>
 #include "IftttHook.h"
+#include "A2dpGainControl.h"
+#include "BufferingMonitor.h"
+#include "ButtonInput.h"
+#include "CpuLoad.h"
+#include "GainRamp.h"
+#include "GlyphAtlas.h"
+#include "HostCache.h"
+#include "IftttOutbox.h"
+#include "Metrics.h"
+#include "PcmChain.h"
+#include "PcmStages.h"
+#include "PlaylistCache.h"
+#include "RadioMessages.h"
+#include "RadioSettings.h"
+#include "StationCatalogue.h"
+#include "StationStandby.h"
+#include "StreamCapture.h"
+#include "StreamWatchdog.h"
+#include "TaskTopology.h"
+#include "TimeshiftProxy.h"
+#include "TextLine.h"
+#include "TitleScroller.h"
+#include "UnmutePolicy.h"
 
 const uint8_t kPinI2S_BCLK = GPIO_NUM_0; // yellow (PCM5102A board: BCK)
 const uint8_t kPinI2S_LRCK = GPIO_NUM_26; // brown (PCM5102A board: LRCK)
@@ -34,6 +58,19 @@ const uint8_t kPinI2S_SD = GPIO_NUM_25; // green (PCM5102A board: DIN)
 
 const uint8_t kPinButtonRed = GPIO_NUM_32; // dual button unit: red button
 const uint8_t kPinButtonBlue = GPIO_NUM_33; // dual button unit: blue button
+const uint8_t kPinButtonA = GPIO_NUM_37; // M5StickC Plus: button A
+const uint8_t kPinButtonB = GPIO_NUM_39; // M5StickC Plus: button B
+const uint8_t kPinAxpIrq = GPIO_NUM_35; // M5StickC Plus: IRQ line of the AXP192 (power button)
+
+/** Numbers of the buttons in 'buttons_' */
+const uint8_t kButtonA = 0;
+const uint8_t kButtonB = 1;
+const uint8_t kButtonRed = 2;
+const uint8_t kButtonBlue = 3;
+const uint8_t kButtonPwr = 4;
+
+/** Debounce time of the buttons in ms */
+const uint32_t kButtonDebounceTime = 20;
 
 // Own host name announced to the WiFi / Bluetooth network
 const char* kDeviceName = "ESP32-Webradio";
@@ -41,23 +78,230 @@ const char* kDeviceName = "ESP32-Webradio";
 /** Maximum audio volume that can be set in the 'esp32-audioI2S' library */
 const uint8_t kVolumeMax = 21;
 
-/** Width of the stream title sprite in pixels */
-const int16_t kTitleSpriteWidth = 1000;
-
-/** Web radio stream URLs */
-const String kStationURLs[] = {
-    "http://streams.radiobob.de/bob-national/mp3-192/streams.radiobob.de/",
-    "http://stream.rockantenne.de/rockantenne/stream/mp3",
-    "http://wdr-wdr2-ruhrgebiet.icecast.wdr.de/wdr/wdr2/ruhrgebiet/mp3/128/stream.mp3",
-    "http://www.ndr.de/resources/metadaten/audio/m3u/ndr2.m3u",
-    "http://streams.br.de/bayern1obb_2.m3u",
-    "http://streams.br.de/bayern3_2.m3u",
-    "http://play.antenne.de/antenne.m3u",
-    "http://funkhaus-ingolstadt.stream24.net/radio-in.mp3"
+/** Run the metadata soak test: publish simulated station names and song infos and track the heap (host build: 'test_metadata_soak') */
+const bool kMetadataSoakTest = false;
+
+/** Number of simulated metadata updates of the soak test */
+const uint32_t kMetadataSoakUpdates = 10000;
+
+/** Path of the station catalogue in the flash file system (uploaded from 'data/stations.txt') */
+const char* kStationCataloguePath = "/stations.txt";
+
+/** Built-in station list, used if the catalogue is not available (format see 'StationCatalogue') */
+const char* kBuiltinStations =
+    "Radio Bob National|mp3/192|http://streams.radiobob.de/bob-national/mp3-192/streams.radiobob.de/\n"
+    "Rock Antenne|mp3|http://stream.rockantenne.de/rockantenne/stream/mp3\n"
+    "WDR 2 Ruhrgebiet|mp3/128|http://wdr-wdr2-ruhrgebiet.icecast.wdr.de/wdr/wdr2/ruhrgebiet/mp3/128/stream.mp3\n"
+    "NDR 2|mp3|http://www.ndr.de/resources/metadaten/audio/m3u/ndr2.m3u\n"
+    "Bayern 1|mp3|http://streams.br.de/bayern1obb_2.m3u\n"
+    "Bayern 3|mp3|http://streams.br.de/bayern3_2.m3u\n"
+    "Antenne Bayern|mp3|http://play.antenne.de/antenne.m3u\n"
+    "Radio IN|mp3|http://funkhaus-ingolstadt.stream24.net/radio-in.mp3\n";
+
+/** Keep the next station in warm standby (playlist resolved, host resolved, connected) for fast station switching */
+const bool kStandbyEnabled = true;
+
+/** Memory budget in bytes for the playlist data read by the standby task */
+const size_t kStandbyBufferSize = 1024;
+
+/**
+ * Buffer in bytes for the start of the stream received by the standby connection to the next station (0 = no
+ * connection). The timeshift proxy keeps the connection for HTTP streams only; it is renewed while the station is in
+ * standby, since the host drops a client that does not read.
+ */
+const size_t kStandbyConnectBuffer = 8192;
+
+/** Time to live in seconds of the stream URLs resolved from playlists */
+const uint32_t kPlaylistCacheTtl = 24 * 3600;
+
+/** Time in seconds for which a resolved stream host counts as recent (lookups prepared by the standby task) */
+const uint32_t kHostCacheTtl = 300;
+
+/** Let the audio task wait for commands and stream data instead of polling every millisecond */
+const bool kAudioTaskEventDriven = true;
+
+/** Number of stereo frames in the I2S DMA buffers of the 'esp32-audioI2S' library (lower bound) */
+const uint32_t kI2sDmaFrames = 512;
+
+/** Log the CPU load of both cores periodically (measurement tool: the idle tasks do not enter power saving while enabled) */
+const bool kCpuLoadReport = false;
+
+/** Interval of the CPU load report in ms */
+const uint32_t kCpuLoadReportInterval = 10000;
+
+/** Measure render time and heap use of the text rendering at startup */
+const bool kTextRenderBenchmark = false;
+
+/** Fade-in after a station has been unmuted or the bluetooth stream has started: duration in ms and curve */
+const uint32_t kFadeInTime = 1500;
+const GainRamp::Curve kFadeInCurve = GainRamp::EXPONENTIAL;
+
+/** Fade-out before a station is paused: duration in ms and curve */
+const uint32_t kFadeOutTime = 300;
+const GainRamp::Curve kFadeOutCurve = GainRamp::S_CURVE;
+
+/**
+ * Keep the connection and the audio buffer while paused, so that playing resumes instantly where it has been paused.
+ * HTTP streams are played through the timeshift proxy, which keeps downloading while paused.
+ */
+const bool kTimeshiftPause = true;
+
+/**
+ * Buffer of the timeshift proxy in bytes: RAM ring and spill file on flash (0 = RAM only).
+ * 32 kB + 512 kB = 34 s at 128 kbit/s; the capture file of the decode benchmark needs another 256 kB.
+ * The spill file is written only while paused: after resuming, the proxy skips the newer data until the spill file
+ * has been played and then continues with the live stream.
+ */
+const size_t kTimeshiftRamBuffer = 32768;
+const size_t kTimeshiftSpillBuffer = 524288;
+const char* kTimeshiftSpillPath = "/timeshift.bin";
+
+/** Maximum pause in ms buffered by the timeshift proxy (a full buffer ends the pause earlier) */
+const uint32_t kTimeshiftMaxPause = 60000;
+
+/** Interval in ms for checking the fill level of the timeshift proxy while paused */
+const uint32_t kTimeshiftFullCheck = 500;
+
+/**
+ * Maximum pause in ms for which the connection of a stream not played through the proxy (HTTPS) is kept. The host
+ * stops sending while paused and queues the stream for the client (Icecast: 'queue-size', 512 kB = 32 s at 128 kbit/s).
+ */
+const uint32_t kTimeshiftHostQueue = 30000;
+
+/** Ramp after a volume change in ms (avoids zipper noise) */
+const uint32_t kVolumeRampTime = 50;
+
+/** Measure the CPU cycles per sample of the gain stage at startup */
+const bool kGainRampBenchmark = false;
+
+/** Process the audio by the PCM chain (EQ bands, optional mono downmix, limiter) before the DAC */
+const bool kDspEnabled = true;
+
+/** Mix both channels to mono (e.g. for a single speaker) */
+const bool kDspMono = false;
+
+/** Output limit of the limiter in dBFS and its release time in ms */
+const float kLimiterThreshold = -1.0f;
+const uint32_t kLimiterRelease = 100;
+
+/** CPU cycle budget of the PCM chain per stereo frame (5442 cycles = one frame at 44.1 kHz and 240 MHz) */
+const uint32_t kDspCycleBudget = 1000;
+
+/** CPU cycle budget per stereo frame of the slowest block of the PCM chain (a block of 128 frames is processed at once) */
+const uint32_t kDspBlockCycleBudget = 2000;
+
+/** Measure the CPU cycles per frame of each stage of the PCM chain at startup */
+const bool kDspBenchmark = false;
+
+/** Recorded PCM data for the benchmark (16 bit stereo, raw), synthetic data is used if the file is not available */
+const char* kDspBenchmarkPath = "/pcm_test.raw";
+
+/** NTP server for the clock (used to expire cache entries) */
+const char* kNtpServer = "pool.ntp.org";
+
+/** Maximum time in ms for associating directly with the known access point before falling back to a scan */
+const uint32_t kWifiDirectTimeout = 3000;
+
+/** Reuse the previous DHCP lease as static IP configuration when associating directly (skips DHCP) */
+const bool kWifiStaticIp = false;
+
+/** Interval in ms between reconnect attempts while the WiFi connection is lost */
+const uint32_t kWifiReconnectInterval = 2000;
+
+/** Duration of a WiFi outage in ms after which it is shown on the display */
+const uint32_t kWifiOutageDisplay = 2000;
+
+/** Time in ms after the WiFi connection has been restored until the outage is reported (stream has settled) */
+const uint32_t kWifiOutageReportDelay = 10000;
+
+/** Size of the audio input buffer in bytes without the reserve for WiFi outages ('esp32-audioI2S' default without PSRAM) */
+const uint32_t kAudioBufferSize = 16000;
+
+/** Additional audio input buffer in bytes that keeps the decoder playing during short WiFi outages (about 1 s at 128 kbit/s) */
+const uint32_t kWifiOutageBuffer = 16000;
+
+/** Task topology profile used unless another one has been selected at run time (index into 'TaskTopology::kProfiles') */
+const uint8_t kTaskProfile = 0;
+
+/** Run the task topology benchmark: each profile plays the same station for a fixed time, one profile per boot */
+const bool kTopologyBenchmark = false;
+
+/** Duration of a benchmark run in ms (measured from unmuting the station) */
+const uint32_t kTopologyBenchmarkDuration = 120000;
+
+/** Station played by the task topology benchmark */
+const uint8_t kTopologyBenchmarkStation = 0;
+
+/** Serve the metrics in Prometheus text format on 'http://<device>/metrics' while in radio mode */
+const bool kMetricsServer = true;
+
+/** TCP port of the metrics server */
+const uint16_t kMetricsPort = 80;
+
+/** Interval in ms for sampling heap, buffer fill and stack high-water marks into the metrics */
+const uint32_t kMetricsUpdateInterval = 1000;
+
+/** Capture file for the decode benchmark (serial console: 'c' records the current stream, 'r' replays it) */
+const char* kCapturePath = "/capture.raw";
+
+/** Maximum size in bytes and duration in ms of a capture (256 kB = 16 s at 128 kbit/s) */
+const size_t kCaptureMaxBytes = 262144;
+const uint32_t kCaptureMaxTime = 60000;
+
+/** Samples per frame for the per-frame decode time of the replay (MP3; AAC: 1024) */
+const uint32_t kReplayFrameSamples = 1152;
+
+/** Maximum duration of a replay in ms */
+const uint32_t kReplayTimeout = 60000;
+
+/** Bucket bounds of the metrics histograms */
+const uint32_t kBufferFillBuckets[] = {5, 10, 25, 50, 75, 90, 100};
+const uint32_t kConnectLatencyBuckets[] = {50, 100, 250, 500, 1000, 2500, 5000, 10000};
+const uint32_t kDnsTimeBuckets[] = {1, 5, 10, 25, 50, 100, 250, 1000};
+const uint32_t kTimeToAudioBuckets[] = {250, 500, 1000, 1500, 2000, 3000, 5000, 10000};
+const uint32_t kWifiOutageBuckets[] = {500, 1000, 2000, 5000, 10000, 30000, 60000};
+const uint32_t kRecoveryTimeBuckets[] = {1000, 2000, 5000, 10000, 30000, 60000, 300000};
+const uint32_t kDecodeTimeBuckets[] = {100, 250, 500, 1000, 2000, 5000, 10000, 20000};
+const uint32_t kLoopGapBuckets[] = {1000, 2000, 5000, 10000, 20000, 50000, 100000};
+const uint32_t kFrameTimeBuckets[] = {1000, 2000, 5000, 10000, 20000, 50000};
+const uint32_t kPauseTimeBuckets[] = {1000, 2000, 5000, 10000, 20000, 30000, 60000};
+const uint32_t kButtonLatencyBuckets[] = {500, 1000, 2000, 5000, 10000, 20000, 50000};
+
+/** Frame time of the display task in ms (budget for rendering one frame) */
+const uint32_t kDisplayFrameTime = 20;
+
+/** Interval in ms for reporting the frame statistics of the display task */
+const uint32_t kDisplayReportInterval = 10000;
+
+/** Latency profile of the bluetooth sink: I2S DMA buffering and priority of the task writing to I2S */
+struct A2dpLatencyProfile {
+    const char *name;
+    uint8_t dmaBufCount;        // Number of DMA buffers
+    uint16_t dmaBufLen;         // Frames per DMA buffer
+    UBaseType_t taskPriority;   // Priority of the I2S task of the 'ESP32-A2DP' library
+};
+
+/** Selectable latency profiles of the bluetooth sink (the first one matches the defaults of the 'ESP32-A2DP' library) */
+const A2dpLatencyProfile kA2dpLatencyProfiles[] = {
+    {"standard", 8, 64, configMAX_PRIORITIES - 10},
+    {"low", 4, 64, configMAX_PRIORITIES - 5},
+    {"minimal", 3, 32, configMAX_PRIORITIES - 3},
+    {"robust", 8, 256, configMAX_PRIORITIES - 10}
 };
 
-/** Number of stations */
-const uint8_t kNumStations = sizeof(kStationURLs) / sizeof(kStationURLs[0]);
+const uint8_t kNumA2dpLatencyProfiles = sizeof(kA2dpLatencyProfiles) / sizeof(kA2dpLatencyProfiles[0]);
+
+/** Latency profile of the bluetooth sink unless another one has been selected (red button long press in bluetooth mode) */
+const uint8_t kA2dpLatencyProfile = 0;
+
+/** Interval in ms for reporting the buffering delay of the bluetooth sink */
+const uint32_t kA2dpLatencyReportInterval = 10000;
+
+/** Parts of the display to be rendered by the display task (bits of 'displayDirty_') */
+const uint8_t kDisplayStation = 0x01;
+const uint8_t kDisplaySongInfo = 0x02;
+const uint8_t kDisplayVolume = 0x04;
+const uint8_t kDisplayPlayState = 0x08;
 
 /**
  * Instance of 'Audio' class from 'esp32-audioI2S' library for SPK hat and internal DAC
@@ -76,6 +320,39 @@ Audio *pAudio_ = nullptr;
 // Handle to the RTOS audio task
 TaskHandle_t pAudioTask_ = nullptr;
 
+// Handle to the RTOS display task
+TaskHandle_t pDisplayTask_ = nullptr;
+
+// Core affinity, priorities and stack sizes of the tasks
+TaskTopology topology_ = TaskTopology(kTaskProfile);
+
+// Last station, volume, bluetooth latency profile and WiFi association (kept across reboots)
+RadioSettings settings_ = RadioSettings(0, kVolumeMax, kA2dpLatencyProfile);
+
+// Mutex protecting the display and the display state ('stationStr_', 'infoStr_', 'displayDirty_' etc.), taken by the display task for each frame
+SemaphoreHandle_t displayMutex_ = nullptr;
+
+// Stations that can be chosen with button A
+StationCatalogue catalogue_ = StationCatalogue();
+
+// Persistent cache of the stream URLs resolved from playlists
+PlaylistCache playlistCache_ = PlaylistCache(kPlaylistCacheTtl);
+
+// Recently resolved stream hosts and timing of their DNS lookups
+HostCache hostCache_ = HostCache(kHostCacheTtl);
+
+// Local proxy buffering the stream while paused and keeping the standby connection
+TimeshiftProxy timeshift_ = TimeshiftProxy(LITTLEFS, kTimeshiftSpillPath, kTimeshiftRamBuffer, kTimeshiftSpillBuffer, kStandbyConnectBuffer);
+
+// Warm standby of the next station
+StationStandby standby_ = StationStandby(kStandbyBufferSize, &playlistCache_, &hostCache_, &timeshift_);
+
+// Recording of the current stream for the decode benchmark
+StreamCapture capture_ = StreamCapture(LITTLEFS, kCapturePath, kCaptureMaxBytes, kCaptureMaxTime);
+
+// Song infos to be sent to the IFTTT webhook
+IftttOutbox outbox_ = IftttOutbox(IftttHook::IFTTT_ADD_SONG);
+
 /**
  * Instance of the 'BluetoothA2DPSink' class from the 'ESP32-A2DP' library.
  * Using a pointer and dynamic creation of the instance causes the ESP32 to crash when a2dp_.start() is called.
@@ -90,95 +367,323 @@ typedef enum DeviceMode t_DeviceMode;
 // Current device mode (initialization as 'RADIO')
 t_DeviceMode deviceMode_ = RADIO;
 
-// Button object for red button
-Button buttonRed = Button(kPinButtonRed, false, 40);
-
-// Button object for blue button
-Button buttonBlue = Button(kPinButtonBlue, false, 40);
-
 // Content in audio buffer (provided by esp32-audioI2S library)
 uint32_t audioBufferFilled_ = 0;
 
 // Size of audio buffer (provided by esp32-audioI2S library)
 uint32_t audioBufferSize_ = 0;
 
-// Current station index
-uint8_t stationIndex_ = 0;
+// audioProcessing: URL of the stream the audio task is connected to (recorded by 'CMD_CAPTURE')
+char audioStreamUrl_[StreamCapture::kMaxUrlLength] = "";
 
-// Flag to indicate the user wants to change the station
-bool stationChanged_ = true;
+// audioProcessing: Flag indicating that the capture file is replayed (the output hook replaces I2S by a null sink)
+bool replayActive_ = false;
 
-// Flag to indicate that audio is muted after tuning to a new station
+// audioProcessing: Number of stereo frames decoded by the replay
+uint32_t replayFrames_ = 0;
+
+// Commands from the user interface to the audio task
+CommandQueue commandQueue_;
+
+// Events from the audio task (or bluetooth callbacks) to the user interface
+EventQueue eventQueue_;
+
+// main: Current station index
+uint16_t stationIndex_ = 0;
+
+// audioProcessing: Index of the station the audio task is connected to
+uint16_t audioStationIndex_ = 0;
+
+// audioProcessing: Flag to indicate that audio is muted after tuning to a new station
 bool stationChangedMute_ = true;
 
-// Name of the current station as provided by the stream header data
-String stationStr_ = "";
+// main: Flag to indicate that audio is muted after requesting a new station (cleared by 'EVT_UNMUTED')
+bool audioMuted_ = true;
+
+// Name of the current station as provided by the stream header data (published via 'publishStationName')
+char stationStr_[kEventTextLength] = "";
+
+// Parts of the display that have changed and need to be rendered (bit mask of 'kDisplay...')
+uint8_t displayDirty_ = 0;
+
+// Volume shown on the display
+uint8_t displayVolume_ = 0;
 
-// Flag indicating the station name has changed
-bool stationDisplayFlag_ = false;
+// Play state shown on the display
+bool displayPlaying_ = false;
+
+// Error message shown instead of the station name (nullptr = no error)
+const char *displayError_ = nullptr;
+
+// displayProcessing: Average and maximum render time of a frame in us
+uint32_t frameTimeAvg_ = 0;
+uint32_t frameTimeMax_ = 0;
 
 // audioProcessing: Flag indicating that the connection to a host could not be established
 bool connectError_ = false;
 
+// Flag indicating that the WiFi connection is up (cleared by the disconnect event, set again by the main loop)
+volatile bool wifiOnline_ = false;
+
+// Time at which the current WiFi outage has started (0 = no outage)
+volatile unsigned long wifiOutageStart_ = 0;
+
+// main: Time of the last reconnect attempt during a WiFi outage
+unsigned long wifiReconnectTime_ = 0;
+
+// main: Time at which the WiFi connection has been restored (0 = no outage to be reported)
+unsigned long wifiRestoreTime_ = 0;
+
+// main: Duration of the last WiFi outage in ms
+uint32_t wifiOutageDuration_ = 0;
+
+// main: Number of underruns and stalls before the last WiFi outage (to detect audible loss)
+uint32_t wifiOutageUnderruns_ = 0;
+uint32_t wifiOutageStalls_ = 0;
+
+// main: Flag indicating that a stream error has occurred during the last WiFi outage or while the stream settled afterwards
+bool wifiOutageMuted_ = false;
+
 // audioProcessing: Flag indicating that the current radio stream provides too little or no data
 bool streamError_ = false;
 
+// main: Flag indicating that a stream error is shown on the display (set by 'EVT_STREAM_ERROR')
+bool streamErrorDisplay_ = false;
+
 // main: Status indicating the user has paused the current radio stream
 bool userStationPause_ = false;
 
-/* Flag indicating that 'userStationPause_' has changed
-     main: set
-     audioProcessing: clear
-*/
-bool userStationPauseChanged_ = false;
+// audioProcessing: Status indicating the stream has been stopped by a pause command
+bool audioPaused_ = false;
+
+// audioProcessing: Status indicating the audio task has left the stream processing after the radio mode has ended
+bool audioTaskParked_ = false;
+
+// Free heap after tearing down the previous mode during the last mode switch (0 = no mode switch yet)
+uint32_t modeSwitchHeap_ = 0;
+
+// Time at which the CPU load has been reported
+unsigned long cpuLoadReportTime_ = 0;
+
+// audioProcessing: Time of the previous audio loop iteration in us (0 = not playing)
+uint32_t audioLoopTime_ = 0;
+
+// Time at which the metrics have been sampled
+unsigned long metricsUpdateTime_ = 0;
+
+// Metrics of the streaming pipeline (written in this order by 'Metric::writeAll')
+Counter metricUnderruns_("radio_underruns_total", "Times the audio buffer ran empty while playing");
+Counter metricConnects_("radio_connects_total", "Connection attempts to stream hosts");
+Counter metricConnectFailures_("radio_connect_failures_total", "Failed connection attempts to stream hosts");
+Counter metricReconnects_("radio_reconnects_total", "Connections retried after a failure or a stream error");
+Counter metricStreamErrors_("radio_stream_errors_total", "Streams delivering too little data to start playing");
+Counter metricStalls_("radio_stream_stalls_total", "Playing streams stalled (detected by the stream watchdog)");
+Counter metricResumesTimeshift_("radio_pause_resumes_total", "Paused streams resumed", "mode=\"timeshift\"");
+Counter metricResumesReconnect_("radio_pause_resumes_total", "Paused streams resumed", "mode=\"reconnect\"");
+Histogram metricTimeshiftPause_("radio_timeshift_pause_ms", "Duration of pauses resumed from the kept connection",
+    kPauseTimeBuckets, sizeof(kPauseTimeBuckets) / sizeof(kPauseTimeBuckets[0]));
+Gauge metricTimeshiftBuffer_("radio_timeshift_buffer_bytes", "Stream data held in RAM (audio buffer and timeshift proxy) ahead of playing");
+Gauge metricTimeshiftSpill_("radio_timeshift_spill_bytes", "Stream data held in the spill file of the timeshift proxy");
+Gauge metricTimeshiftAge_("radio_timeshift_age_ms", "Time the stream has been paused with the connection kept");
+Counter metricWifiOutages_("radio_wifi_outages_total", "WiFi outages while playing", "audio_lost=\"no\"");
+Counter metricWifiOutagesLost_("radio_wifi_outages_total", "WiFi outages while playing", "audio_lost=\"yes\"");
+Histogram metricWifiOutage_("radio_wifi_outage_ms", "Duration of WiFi outages",
+    kWifiOutageBuckets, sizeof(kWifiOutageBuckets) / sizeof(kWifiOutageBuckets[0]));
+Counter metricDnsRecent_("radio_dns_lookups_total", "Stream hosts resolved before connecting (recent: from the host cache, no lookup)", "host=\"recent\"");
+Counter metricDnsNew_("radio_dns_lookups_total", "Stream hosts resolved before connecting (recent: from the host cache, no lookup)", "host=\"new\"");
+Counter metricDnsFailures_("radio_dns_failures_total", "Failed DNS lookups of stream hosts");
+Histogram metricDnsTime_("radio_dns_time_ms", "Duration of the DNS lookup of a stream host before connecting",
+    kDnsTimeBuckets, sizeof(kDnsTimeBuckets) / sizeof(kDnsTimeBuckets[0]));
+Counter metricPlaylistHits_("radio_playlist_cache_total", "Playlist cache lookups", "result=\"hit\"");
+Counter metricPlaylistMisses_("radio_playlist_cache_total", "Playlist cache lookups", "result=\"miss\"");
+Histogram metricBufferFill_("radio_buffer_fill_percent", "Fill level of the audio buffer while playing (sampled)",
+    kBufferFillBuckets, sizeof(kBufferFillBuckets) / sizeof(kBufferFillBuckets[0]));
+Histogram metricConnectLatency_("radio_connect_latency_ms", "DNS lookup, TCP connect and HTTP request of a stream",
+    kConnectLatencyBuckets, sizeof(kConnectLatencyBuckets) / sizeof(kConnectLatencyBuckets[0]));
+Histogram metricTimeToAudio_("radio_time_to_audio_ms", "Time from a station request until audio is unmuted",
+    kTimeToAudioBuckets, sizeof(kTimeToAudioBuckets) / sizeof(kTimeToAudioBuckets[0]));
+Histogram metricRecoveryTime_("radio_recovery_time_ms", "Time from a stream failure until audio plays again",
+    kRecoveryTimeBuckets, sizeof(kRecoveryTimeBuckets) / sizeof(kRecoveryTimeBuckets[0]));
+Histogram metricDecodeTime_("radio_decode_time_us", "CPU time of one iteration of the audio library (read, decode, output)",
+    kDecodeTimeBuckets, sizeof(kDecodeTimeBuckets) / sizeof(kDecodeTimeBuckets[0]));
+Histogram metricLoopGap_("radio_audio_loop_gap_us", "Time between two audio loop iterations while playing",
+    kLoopGapBuckets, sizeof(kLoopGapBuckets) / sizeof(kLoopGapBuckets[0]));
+Gauge metricLoopGapMax_("radio_audio_loop_gap_max_us", "Maximum time between two audio loop iterations while playing");
+Counter metricFrames_("radio_display_frames_total", "Frames rendered by the display task");
+Counter metricFramesDropped_("radio_display_frames_dropped_total", "Frames dropped because the frame budget was exceeded");
+Histogram metricFrameTime_("radio_display_frame_time_us", "Render time of a display frame",
+    kFrameTimeBuckets, sizeof(kFrameTimeBuckets) / sizeof(kFrameTimeBuckets[0]));
+Gauge metricDspCycles_("radio_dsp_cycles_per_frame", "Average CPU cycles per stereo frame of the PCM chain");
+Gauge metricDspBlockMax_("radio_dsp_block_max_cycles_per_frame", "CPU cycles per stereo frame of the slowest block of the PCM chain in the last second");
+Counter metricDspOverBudget_("radio_dsp_budget_exceeded_total", "Seconds in which the PCM chain exceeded its cycle budget (average or slowest block)");
+Gauge metricLimiterGain_("radio_limiter_gain_min_percent", "Lowest gain applied by the limiter in the last second");
+Gauge metricReplayFrameTime_("radio_replay_decode_us_per_frame", "Decode and output time per frame of the last capture replay");
+Gauge metricReplayHeadroom_("radio_replay_realtime_headroom_percent", "Share of the playing time left over by the decoder in the last capture replay");
+Gauge metricReplayLoopMax_("radio_replay_loop_max_us", "Longest audio loop iteration of the last capture replay");
+Gauge metricReplayHeapPeak_("radio_replay_heap_peak_bytes", "Heap used in addition by the decoder in the last capture replay");
+Gauge metricReplayMargin_("radio_replay_underrun_margin_us", "Time left of the DMA buffers after the longest audio loop iteration of the last capture replay");
+Counter metricReplays_("radio_replays_total", "Capture replays completed (the gauges 'radio_replay_*' are set)");
+Gauge metricA2dpDmaDelay_("radio_a2dp_dma_delay_ms", "Delay of the full I2S DMA buffers of the bluetooth sink");
+Gauge metricA2dpDelayAvg_("radio_a2dp_buffer_delay_ms", "Buffering delay of the bluetooth sink", "stat=\"avg\"");
+Gauge metricA2dpDelayMin_("radio_a2dp_buffer_delay_ms", "Buffering delay of the bluetooth sink", "stat=\"min\"");
+Gauge metricA2dpDelayMax_("radio_a2dp_buffer_delay_ms", "Buffering delay of the bluetooth sink", "stat=\"max\"");
+Gauge metricA2dpGapMax_("radio_a2dp_data_gap_max_ms", "Longest time between two blocks of bluetooth audio data");
+Counter metricA2dpUnderruns_("radio_a2dp_underruns_total", "Times the I2S buffers of the bluetooth sink ran empty");
+Gauge metricCpuLoadCore0_("radio_cpu_load_percent", "CPU load per core", "core=\"0\"");
+Gauge metricCpuLoadCore1_("radio_cpu_load_percent", "CPU load per core", "core=\"1\"");
+Gauge metricHeapFree_("radio_heap_free_bytes", "Free heap");
+Gauge metricHeapMinFree_("radio_heap_min_free_bytes", "Lowest free heap since boot");
+Gauge metricHeapMaxAlloc_("radio_heap_largest_block_bytes", "Largest allocatable heap block");
+Gauge metricStackAudio_("radio_task_stack_free_bytes", "Stack high-water mark (never used stack) per task", "task=\"audio\"");
+Gauge metricStackDisplay_("radio_task_stack_free_bytes", "Stack high-water mark (never used stack) per task", "task=\"display\"");
+Gauge metricStackStandby_("radio_task_stack_free_bytes", "Stack high-water mark (never used stack) per task", "task=\"standby\"");
+Gauge metricStackOutbox_("radio_task_stack_free_bytes", "Stack high-water mark (never used stack) per task", "task=\"outbox\"");
+Gauge metricStackMetrics_("radio_task_stack_free_bytes", "Stack high-water mark (never used stack) per task", "task=\"metrics\"");
+Gauge metricStackLoop_("radio_task_stack_free_bytes", "Stack high-water mark (never used stack) per task", "task=\"loop\"");
+Gauge metricUptime_("radio_uptime_seconds", "Time since boot");
+Histogram metricButtonLatency_("radio_button_latency_us", "Time from a button interrupt until the main loop has processed the event",
+    kButtonLatencyBuckets, sizeof(kButtonLatencyBuckets) / sizeof(kButtonLatencyBuckets[0]));
+
+// Buttons A and B, dual button unit and power button (interrupt-driven, taken by the main loop)
+ButtonInput buttons_ = ButtonInput(kButtonDebounceTime, &metricButtonLatency_);
+
+// HTTP endpoint for scraping the metrics (served by a low-priority task of its own)
+MetricsServer metricsServer_ = MetricsServer(kMetricsPort);
+
+// main: Time at which the current topology benchmark run has started playing (0 = not yet started)
+unsigned long benchmarkStartTime_ = 0;
+
+// Glyphs for the station name (font 1, size 2)
+GlyphAtlas stationAtlas_ = GlyphAtlas();
+
+// Glyphs for the song info (font 2)
+GlyphAtlas titleAtlas_ = GlyphAtlas();
+
+// Glyphs for the status line with volume and play state (font 1)
+GlyphAtlas statusAtlas_ = GlyphAtlas();
+
+// Line for rendering the station name on the display
+TextLine stationLine_ = TextLine(&stationAtlas_);
+
+// Line for rendering the volume on the display
+TextLine volumeLine_ = TextLine(&statusAtlas_);
+
+// Line for rendering the play state on the display
+TextLine playStateLine_ = TextLine(&statusAtlas_);
+
+// Info about current song as provided by the stream meta data or from AVRC data (published via 'publishSongInfo')
+char infoStr_[kEventTextLength] = "";
+
+// Song artist provided by AVRC data (bluetooth callback only)
+char artistStr_[kEventTextLength] = "";
+
+// Song title provided by AVRC data (bluetooth callback only)
+char titleStr_[kEventTextLength] = "";
+
+// main: Number of simulated metadata updates done by the soak test
+uint32_t soakUpdates_ = 0;
+
+// main: Heap at the start of the soak test and the smallest maximum allocatable block seen during the test
+uint32_t soakFreeHeapStart_ = 0;
+uint32_t soakMaxAllocStart_ = 0;
+uint32_t soakMaxAllocMin_ = 0;
+
+// Scroller for rendering the song title on the screen
+TitleScroller titleScroller_ = TitleScroller(&titleAtlas_);
+
+// main: Volume shown on the display (0 while muted, the fade-in is done by the gain stage)
+uint8_t volumeCurrent_ = 0;
 
-// Time at which the state of the power button has been read
-unsigned long pwrBtnCheckTime_ = 0;
+// audioProcessing: Volume applied by the gain stage while playing (set by 'CMD_SET_VOLUME')
+uint8_t audioVolume_ = 0;
 
-// Sprite for rendering the station name on the display
-TFT_eSprite stationSprite_ = TFT_eSprite(&M5.Lcd);
+// audioProcessing: Flag indicating that the stream is faded out before it is paused
+bool pauseFadeOut_ = false;
+
+// audioProcessing: Time at which the stream has been paused with the connection kept for resuming (0 = not held)
+volatile unsigned long timeshiftStart_ = 0;
+
+// Audio volume that is set during normal operation
+uint8_t volumeNormal_ = kVolumeMax;
 
-// Info about current song as provided by the stream meta data or from AVRC data
-String infoStr_ = "";
+// Time in milliseconds at which the connection to the chosen stream has been established
+uint64_t timeConnect_ = 0;
 
-// Song artist provided by AVRC data (bluetooth)
-String artistStr_ = "";
+// audioProcessing: Time in milliseconds at which the user requested a new station or resumed playing (0 = device boot)
+uint64_t timeStationRequest_ = 0;
 
-// Song title provided by AVRC data (bluetooth)
-String titleStr_ = "";
+// Flag indicating that audio has not yet been unmuted since the device has booted
+bool firstAudioAfterBoot_ = true;
 
-// Flag indicating the song title has changed
-bool infoDisplayFlag_ = false;
+// Flag indicating that the current station has been taken over from the warm standby
+bool connectWarm_ = false;
 
-// Sprite for rendering the song title on the screen
-TFT_eSprite titleSprite_ = TFT_eSprite(&M5.Lcd);
+// Flag indicating that the current station has been connected via its playlist (stream URL not known before)
+bool connectViaPlaylist_ = false;
 
-// Width of the song title in pixels
-int16_t titleTextWidth_ = 0;
+// Duration of the DNS lookup in ms when connecting to the current stream
+uint32_t connectTimeDns_ = 0;
 
-// Position of the song title sprite on the screen (used for scrolling)
-int16_t titlePosX_ = M5.Lcd.width();
+// Flag indicating that the current stream host has been resolved shortly before (e.g. by the standby task)
+bool connectDnsRecent_ = false;
 
-// Audio volume to be set by the audio task
-uint8_t volumeCurrent_ = 0;
+// Duration of 'connecttohost' in ms when connecting to the current stream: the lookup of the library
+// (answered by the resolver cache after 'connectToUrl' has resolved the host), TCP connect and HTTP request
+uint32_t connectTimeTcp_ = 0;
 
-// Volume as float value for fading
-float_t volumeCurrentF_ = 0.0f;
+// Time in milliseconds at which the first data of the current stream has arrived (0 = no data yet)
+uint64_t timeFirstByte_ = 0;
 
-// Flag indicating the volume needs to be set by the audio task
-bool volumeCurrentChangedFlag_ = true;
+// Gain stage in the PCM output path (radio: 'audio_process_i2s', bluetooth: 'a2dpGain_'); fades and volume
+GainRamp gainRamp_ = GainRamp();
 
-// Audio volume that is set during normal operation
-uint8_t volumeNormal_ = kVolumeMax;
+// EQ bands of the PCM chain: speaker protection and loudness compensation of the speakers
+BiquadStage eqBands_[] = {
+    BiquadStage(BiquadStage::HIGH_PASS, 60.0f, 0.0f, 0.707f),
+    BiquadStage(BiquadStage::LOW_SHELF, 150.0f, 4.0f, 0.707f),
+    BiquadStage(BiquadStage::PEAKING, 3000.0f, -2.0f, 1.0f)
+};
 
-// Time in milliseconds at which the connection to the chosen stream has been established
-uint64_t timeConnect_ = 0;
+// Mono downmix stage of the PCM chain
+MonoStage monoStage_ = MonoStage();
+
+// Limiter stage of the PCM chain (keeps EQ boosts from clipping)
+LimiterStage limiter_ = LimiterStage(kLimiterThreshold, kLimiterRelease);
+
+// PCM processing in front of the gain stage (radio: 'audio_process_i2s', bluetooth: 'a2dpGain_')
+PcmChain pcmChain_ = PcmChain(kDspCycleBudget, kDspBlockCycleBudget);
+
+// Buffering delay of the bluetooth sink between the arrival of the audio data and the DAC
+BufferingMonitor a2dpMonitor_ = BufferingMonitor();
+
+// Volume control of the bluetooth sink applying the PCM chain and the AVRC volume via the gain stage
+A2dpGainControl a2dpGain_ = A2dpGainControl(&pcmChain_, &gainRamp_, kFadeInTime, kVolumeRampTime, &a2dpMonitor_);
+
+// Capacity of the I2S DMA buffers of the bluetooth sink in frames (depends on the latency profile)
+uint32_t a2dpDmaFrames_ = 0;
+
+// Volume set by the bluetooth source (set by 'avrc_volume_change_callback', -1 = already shown)
+volatile int16_t a2dpVolume_ = -1;
+
+// main: Time at which the buffering delay of the bluetooth sink has been reported
+unsigned long a2dpLatencyReportTime_ = 0;
+
+// Decides when audio is unmuted after connecting to a stream (used by the audio task)
+UnmutePolicy unmutePolicy_ = UnmutePolicy();
+
+// Detects stalled streams and schedules reconnects (used by the audio task)
+StreamWatchdog watchdog_ = StreamWatchdog();
 
 /**
  * Function that is executed by the audio processing task in internet radio mode.
  */
 void audioProcessing(void *p);
 
+/**
+ * Function that is executed by the display task (renders the display state at a fixed frame rate).
+ */
+void displayProcessing(void *p);
+
 /**
  * Meta data callback function in bluetooth sink mode.
  * Creates the song info string from metadata received via AVRC.
@@ -196,6 +701,42 @@ void a2dp_connection_state_changed(esp_a2d_connection_state_t state, void*);
  */
 void wifiCallbackStaDisconnected(WiFiEvent_t event, WiFiEventInfo_t info);
 
+/**
+ * Sends a command to the audio task.
+ * 
+ * @param type Type of the command.
+ * @param value Parameter of the command (see 'CommandType').
+ */
+void sendCommand(CommandType type, uint16_t value = 0) {
+    Command cmd = {type, value, (uint32_t) millis()};
+
+    if ( !commandQueue_.push(cmd) ) {
+        log_w("Command queue full, command %u dropped.", type);
+    }
+
+    // Wake up the audio task
+    if (pAudioTask_ != nullptr) {
+        xTaskNotifyGive(pAudioTask_);
+    }
+}
+
+/**
+ * Sends an event to the user interface.
+ * 
+ * @param type Type of the event.
+ * @param text Text of the event (truncated to 'kEventTextLength').
+ */
+void sendEvent(EventType type, const char *text = "") {
+    Event evt;
+
+    evt.type = type;
+    strlcpy(evt.text, text, kEventTextLength);
+
+    if ( !eventQueue_.push(evt) ) {
+        log_w("Event queue full, event %u dropped.", type);
+    }
+}
+
 /**
  * Shows a welcome message at startup of the device on the TFT display.
  */
@@ -221,46 +762,36 @@ void showWelcomeMessage() {
  * Displays the current station name contained in 'stationStr_' on the TFT screen.
  */
 void showStation() {
-    stationSprite_.fillSprite(TFT_BLACK);
+    uint16_t color = (deviceMode_ == RADIO) ? TFT_ORANGE : TFT_BLUE;
 
-    if (deviceMode_ == RADIO) {
-        stationSprite_.setTextColor(TFT_ORANGE);
-    }
-    else {
-        stationSprite_.setTextColor(TFT_BLUE);
-    }
-    
-    stationSprite_.setCursor(4, 0);
-    stationSprite_.print(stationStr_);
-    stationSprite_.pushSprite(0, 2); // Render sprite to screen
+    stationLine_.drawText(4, stationStr_);
+    stationLine_.push(&M5.Lcd, 0, 2, color, TFT_BLACK); // Render line to screen
+}
+
+/**
+ * Displays an error message instead of the station name on the TFT screen.
+ * 
+ * @param message Text of the error message.
+ */
+void showError(const char *message) {
+    stationLine_.drawText(4, message);
+    stationLine_.push(&M5.Lcd, 0, 2, TFT_WHITE, TFT_RED); // Render line to screen
 }
 
 /**
  * Displays the current song information contained in 'infoStr_' on the TFT screen.
  * Each time the song info is updated, it starts scrolling from the right edge.
+ * 
+ * @param changed true = song info has changed since the last call.
  */
-void showSongInfo() {
-    // Update the song title if flag is raised
-    if (infoDisplayFlag_) {
-        titleSprite_.fillSprite(TFT_BLACK);
-        titleSprite_.pushSprite(0, 40); // Wipe out the previous title from the screen
-
-        titleSprite_.setCursor(0, 0);
-        titleSprite_.print(infoStr_);
-
-        titlePosX_ = M5.Lcd.width(); // Start scrolling at right side of screen
-        titleTextWidth_ = min( titleSprite_.textWidth(infoStr_), kTitleSpriteWidth ); // width of the title required for scrolling
-
-        infoDisplayFlag_ = false; // Clear update flag
+void showSongInfo(bool changed) {
+    // Update the song title if it has changed
+    if (changed) {
+        titleScroller_.setText(infoStr_); // Start scrolling at right side of screen
+        titleScroller_.push(&M5.Lcd, 0, 40); // Wipe out the previous title from the screen
     }
     else {
-        titlePosX_-= 1; // Move sprite one pixel to the left
-        titleSprite_.pushSprite(titlePosX_, 40); // Render sprite to screen
-
-        // After the sprite has passed by completely...
-        if (titlePosX_ < -titleTextWidth_) {
-            titlePosX_ = M5.Lcd.width(); // ...let the sprite start again at the right side of the screen 
-        }
+        titleScroller_.scroll(&M5.Lcd, 0, 40); // Move title one pixel to the left and render it to screen
     }
 }
 
@@ -270,11 +801,12 @@ void showSongInfo() {
  * @param volume Volume to be displayed on the TFT screen.
  */
 void showVolume(uint8_t volume) {
-    M5.Lcd.setTextFont(1);
-    M5.Lcd.setTextSize(1);
-    M5.Lcd.setCursor(3, M5.Lcd.height() - M5.Lcd.fontHeight() - 3);
-    M5.Lcd.setTextColor(TFT_GREEN, TFT_BLACK);
-    M5.Lcd.printf("Vol: %03u", volume);
+    char text[10];
+
+    snprintf(text, sizeof(text), "Vol: %03u", volume);
+
+    volumeLine_.drawText(0, text);
+    volumeLine_.push(&M5.Lcd, 3, M5.Lcd.height() - volumeLine_.height() - 3, TFT_GREEN, TFT_BLACK);
 }
 
 /**
@@ -283,109 +815,548 @@ void showVolume(uint8_t volume) {
  * @param isPlaying true = 'playing', false = 'stopped'
  */
 void showPlayState(bool isPlaying) {
-    M5.Lcd.setTextFont(1);
-    M5.Lcd.setTextSize(1);
-    M5.Lcd.setCursor( (M5.Lcd.width() - M5.Lcd.textWidth("1234567")) / 2, M5.Lcd.height() - M5.Lcd.fontHeight() - 3);
+    int16_t x = (M5.Lcd.width() - playStateLine_.width()) / 2;
+    int16_t y = M5.Lcd.height() - playStateLine_.height() - 3;
 
     if (isPlaying) {
-        M5.Lcd.setTextColor(TFT_GREEN, TFT_BLACK);
-        M5.Lcd.print("Playing");
+        playStateLine_.drawText(0, "Playing");
+        playStateLine_.push(&M5.Lcd, x, y, TFT_GREEN, TFT_BLACK);
     }
     else {
-        M5.Lcd.setTextColor(TFT_YELLOW, TFT_BLACK);
-        M5.Lcd.print("Stopped");
+        playStateLine_.drawText(0, "Stopped");
+        playStateLine_.push(&M5.Lcd, x, y, TFT_YELLOW, TFT_BLACK);
     }
 }
 
 /**
- * Starts WiFi connection and waits for a specified amount of time for the WiFi status to become 'WL_CONNECTED'.
- * 
- * @param maxInterval Maximum waiting time in ms.
+ * Locks the display and the display state (blocks while the display task renders a frame).
  */
-bool connectWiFi(uint32_t maxInterval = 5000) {
-    log_d("WiFi status before WiFi.begin = %u", WiFi.status());
-
-    wl_status_t wifiStatus = WiFi.begin(WifiCredentials::SSID, WifiCredentials::PASSWORD);
-
-    log_d("WiFi status after WiFi.begin = %u", wifiStatus);
-
-    /*  wl_status_t:
-
-        WL_IDLE_STATUS      = 0,
-        WL_NO_SSID_AVAIL    = 1,
-        WL_SCAN_COMPLETED   = 2,
-        WL_CONNECTED        = 3,
-        WL_CONNECT_FAILED   = 4,
-        WL_CONNECTION_LOST  = 5,
-        WL_DISCONNECTED     = 6
-    */
-    
-    unsigned long startTime = millis();
-    unsigned long passedTime = 0;
-
-    while ( wifiStatus != WL_CONNECTED && (passedTime < maxInterval) ) {
-        int i = 0;
-        
-        while ( wifiStatus != WL_CONNECTED && i < 10) {
-            vTaskDelay(100 / portTICK_PERIOD_MS);
-            wifiStatus = WiFi.status();
-            ++i;
-        }
-        
-        passedTime = millis() - startTime;
-
-        log_d("WiFi status after %lu ms = %u", passedTime, wifiStatus);
+void lockDisplay() {
+    if (displayMutex_ != nullptr) {
+        xSemaphoreTake(displayMutex_, portMAX_DELAY);
     }
-
-    return wifiStatus == WL_CONNECTED;
 }
 
 /**
- * Connects to the specified WiFi network and starts the device in internet radio mode.
- * Audio task is started.
+ * Unlocks the display and the display state.
  */
-void startRadio() {
-    log_d("Begin: free heap = %d, max alloc heap = %d", ESP.getFreeHeap(), ESP.getMaxAllocHeap());
-    if (pAudio_ == nullptr) {
-        showWelcomeMessage();
-        M5.Lcd.printf(" MAC: %s\n", WiFi.macAddress().c_str()); // Own network mac address
-
-        M5.Lcd.println(" Connecting to WiFi...");
-        M5.Lcd.printf(" SSID: %s\n", WifiCredentials::SSID); // WiFi network name
-
-        // Initialize WiFi and connect to network
-        WiFi.mode(WIFI_STA);
-        WiFi.setHostname(kDeviceName);
-        WiFi.onEvent(wifiCallbackStaDisconnected, SYSTEM_EVENT_STA_DISCONNECTED); // Register callback for disconnect events
-        
-        // Connect to WiFi station
-        while ( !connectWiFi(10000) );
+void unlockDisplay() {
+    if (displayMutex_ != nullptr) {
+        xSemaphoreGive(displayMutex_);
+    }
+}
 
-        // Display own IP address after connecting
-        M5.Lcd.println(" Connected to WiFi");
-        M5.Lcd.printf(" IP: %s", WiFi.localIP().toString().c_str());
+/**
+ * Marks parts of the display for rendering by the display task.
+ * 
+ * @param parts Bit mask of 'kDisplay...' values.
+ */
+void setDisplayDirty(uint8_t parts) {
+    lockDisplay();
+    displayDirty_ |= parts;
+    unlockDisplay();
+}
 
-        pAudio_ = new Audio(false); // Use external DAC
+/**
+ * Sets the volume shown on the display.
+ * 
+ * @param volume Volume to be displayed.
+ */
+void setDisplayVolume(uint8_t volume) {
+    lockDisplay();
+    if (volume != displayVolume_) {
+        displayVolume_ = volume;
+        displayDirty_ |= kDisplayVolume;
+    }
+    unlockDisplay();
+}
 
-        // Setup audio
-        pAudio_->setVolume(0); // 0...21
-        pAudio_->setPinout(kPinI2S_BCLK, kPinI2S_LRCK, kPinI2S_SD);
+/**
+ * Sets the play state shown on the display.
+ * 
+ * @param isPlaying true = 'playing', false = 'stopped'
+ */
+void setDisplayPlayState(bool isPlaying) {
+    lockDisplay();
+    if (isPlaying != displayPlaying_) {
+        displayPlaying_ = isPlaying;
+        displayDirty_ |= kDisplayPlayState;
+    }
+    unlockDisplay();
+}
 
-        deviceMode_ = RADIO;
+/**
+ * Sets the error message shown instead of the station name.
+ * 
+ * @param message Text of the error message (nullptr = no error, station name is shown again).
+ */
+void setDisplayError(const char *message) {
+    lockDisplay();
+    if (message != displayError_) {
+        displayError_ = message;
+        displayDirty_ |= kDisplayStation;
+    }
+    unlockDisplay();
+}
 
-        // Start the audio processing task
-        xTaskCreate(audioProcessing, "Audio processing task", 4096, nullptr, configMAX_PRIORITIES - 4, &pAudioTask_);
+/**
+ * Publishes a new station name to the display task.
+ * 
+ * @param name Station name (truncated to 'kEventTextLength' - 1 characters).
+ */
+void publishStationName(const char *name) {
+    lockDisplay();
+    strlcpy(stationStr_, name, sizeof(stationStr_));
+    displayDirty_ |= kDisplayStation; // Let the display task render the station name
+    unlockDisplay();
+}
 
-        // Wait some time before wiping out the startup screen
-        vTaskDelay(2000 / portTICK_PERIOD_MS);
+/**
+ * Publishes a new song info to the display task.
+ * 
+ * @param info Song info (truncated to 'kEventTextLength' - 1 characters).
+ */
+void publishSongInfo(const char *info) {
+    lockDisplay();
+    strlcpy(infoStr_, info, sizeof(infoStr_));
+    displayDirty_ |= kDisplaySongInfo; // Let the display task render the song info
+    unlockDisplay();
+}
 
-        M5.Lcd.fillScreen(TFT_BLACK);
+/**
+ * Combines artist and title to the song info ("artist - title", or only one of them if the other is empty).
+ * 
+ * @param artist Song artist.
+ * @param title Song title.
+ * @param info Buffer receiving the song info.
+ * @param size Size of the buffer.
+ */
+void formatSongInfo(const char *artist, const char *title, char *info, size_t size) {
+    if (artist[0] == '\0') {
+        strlcpy(info, title, size);
     }
     else {
-        log_w("'pAudio_' not cleaned up!");
+        if (title[0] == '\0') {
+            strlcpy(info, artist, size);
+        }
+        else {
+            snprintf(info, size, "%s - %s", artist, title);
+        }
     }
-
-    log_d("End: free heap = %d, max alloc heap = %d, min free heap = %d", ESP.getFreeHeap(), ESP.getMaxAllocHeap(), ESP.getMinFreeHeap());
+}
+
+/**
+ * Clears the screen and resets the display state (used when a device mode ends).
+ */
+void clearDisplay() {
+    lockDisplay();
+    stationStr_[0] = '\0';
+    infoStr_[0] = '\0';
+    titleScroller_.setText(infoStr_);
+    displayDirty_ = 0;
+    displayError_ = nullptr;
+    displayVolume_ = 0;
+    displayPlaying_ = false;
+
+    M5.Lcd.fillScreen(TFT_BLACK);
+    unlockDisplay();
+}
+
+/**
+ * Renders all changed parts of the display and scrolls the song info (called by the display task with the display locked).
+ */
+void renderDisplay() {
+    uint8_t dirty = displayDirty_;
+
+    displayDirty_ = 0;
+
+    if (dirty & kDisplayStation) {
+        if (displayError_ != nullptr) {
+            showError(displayError_);
+        }
+        else {
+            showStation();
+        }
+    }
+
+    if (dirty & kDisplayVolume) {
+        showVolume(displayVolume_);
+    }
+
+    if (dirty & kDisplayPlayState) {
+        showPlayState(displayPlaying_);
+    }
+
+    showSongInfo(dirty & kDisplaySongInfo);
+}
+
+/**
+ * Compares render time and heap use of the glyph atlas with a 16 bpp sprite for the station name.
+ */
+void benchmarkTextRendering() {
+    const uint16_t kRuns = 100;
+    const char *text = "Benchmark Radio";
+
+    // 16 bpp sprite, rendered by the font renderer of the display library
+    uint32_t freeHeap = ESP.getFreeHeap();
+
+    TFT_eSprite sprite = TFT_eSprite(&M5.Lcd);
+    sprite.setTextFont(1);
+    sprite.setTextSize(2);
+    sprite.setTextColor(TFT_ORANGE);
+    sprite.setTextWrap(false);
+    sprite.createSprite(M5.Lcd.width(), sprite.fontHeight());
+
+    uint32_t spriteHeap = freeHeap - ESP.getFreeHeap();
+    uint32_t startTime = micros();
+
+    for (uint16_t i = 0; i < kRuns; ++i) {
+        sprite.fillSprite(TFT_BLACK);
+        sprite.setCursor(4, 0);
+        sprite.print(text);
+        sprite.pushSprite(0, 2);
+    }
+
+    uint32_t spriteTime = (micros() - startTime) / kRuns;
+
+    sprite.deleteSprite();
+
+    // 1 bpp glyph atlas, expanded to RGB565 while pushing
+    startTime = micros();
+
+    for (uint16_t i = 0; i < kRuns; ++i) {
+        stationLine_.drawText(4, text);
+        stationLine_.push(&M5.Lcd, 0, 2, TFT_ORANGE, TFT_BLACK);
+    }
+
+    uint32_t atlasTime = (micros() - startTime) / kRuns;
+    uint32_t atlasHeap = stationAtlas_.memoryUsage() + stationLine_.memoryUsage() + TextLine::pushBufferSize();
+
+    log_i("Text rendering: sprite %u us, %u bytes; glyph atlas %u us, %u bytes", spriteTime, spriteHeap, atlasTime, atlasHeap);
+
+    M5.Lcd.fillRect(0, 2, M5.Lcd.width(), stationLine_.height(), TFT_BLACK);
+}
+
+/**
+ * Measures the CPU cycles per sample of the gain stage for constant gain and for ramps along each curve.
+ * The stage is run on a block of test data of typical DMA buffer size.
+ */
+void benchmarkGainRamp() {
+    const uint16_t kFrames = 512;
+    const uint16_t kRuns = 100;
+    const char *names[] = {"linear", "exponential", "s-curve"};
+
+    int16_t *samples = (int16_t*) malloc(2 * kFrames * sizeof(int16_t));
+
+    if (samples == nullptr) {
+        log_w("Gain stage benchmark: out of memory.");
+        return;
+    }
+
+    GainRamp ramp = GainRamp();
+
+    for (uint16_t i = 0; i < 2 * kFrames; ++i) {
+        samples[i] = (int16_t) (i * 97);
+    }
+
+    // Constant gain (block loop)
+    ramp.setGain(GainRamp::kUnity / 2);
+
+    uint32_t startCycles = ESP.getCycleCount();
+
+    for (uint16_t run = 0; run < kRuns; ++run) {
+        ramp.process(samples, kFrames);
+    }
+
+    log_i("Gain stage: constant gain %u cycles/frame", (ESP.getCycleCount() - startCycles) / (kRuns * kFrames));
+
+    // Ramps (per frame as in the radio path), long enough to stay in the ramp for all runs
+    for (uint8_t curve = 0; curve < 3; ++curve) {
+        ramp.setGain(0);
+        ramp.rampTo(GainRamp::kUnity, 10000, (GainRamp::Curve) curve);
+
+        startCycles = ESP.getCycleCount();
+
+        for (uint16_t run = 0; run < kRuns; ++run) {
+            for (uint16_t i = 0; i < kFrames; ++i) {
+                ramp.processFrame(samples[2 * i], samples[2 * i + 1]);
+            }
+        }
+
+        log_i("Gain stage: %s ramp %u cycles/frame", names[curve], (ESP.getCycleCount() - startCycles) / (kRuns * kFrames));
+    }
+
+    free(samples);
+}
+
+/**
+ * Measures the CPU cycles per frame of each stage of the PCM chain and of the whole chain
+ * on recorded PCM data (or on synthetic data if no recording is available).
+ * Must be called before the audio output is started (uses the stages of the chain).
+ */
+void benchmarkPcmChain() {
+    const size_t kFrames = 2048;
+
+    int16_t *recording = (int16_t*) malloc(2 * kFrames * sizeof(int16_t));
+    int16_t *samples = (int16_t*) malloc(2 * kFrames * sizeof(int16_t));
+
+    if (recording == nullptr || samples == nullptr) {
+        log_w("PCM chain benchmark: out of memory.");
+        free(recording);
+        free(samples);
+        return;
+    }
+
+    File file = LITTLEFS.open(kDspBenchmarkPath, "r");
+    size_t frames = 0;
+
+    if (file) {
+        frames = file.read((uint8_t*) recording, 2 * kFrames * sizeof(int16_t)) / (2 * sizeof(int16_t));
+        file.close();
+    }
+
+    const char *source = kDspBenchmarkPath;
+
+    // Synthetic data: two sines and some noise near full scale
+    if (frames == 0) {
+        for (size_t i = 0; i < kFrames; ++i) {
+            float t = (float) i / 44100.0f;
+            int32_t noise = (int32_t) (esp_random() % 2001) - 1000;
+
+            recording[2 * i] = (int16_t) (16000.0f * sinf(2.0f * PI * 100.0f * t) + 12000.0f * sinf(2.0f * PI * 3000.0f * t) + noise);
+            recording[2 * i + 1] = recording[2 * i];
+        }
+
+        frames = kFrames;
+        source = "synthetic";
+    }
+
+    // Each stage separately
+    for (PcmStage *pStage = pcmChain_.first(); pStage != nullptr; pStage = PcmChain::next(pStage)) {
+        memcpy(samples, recording, 2 * frames * sizeof(int16_t));
+        pStage->reset();
+
+        uint32_t startCycles = ESP.getCycleCount();
+
+        PcmChain::processStage(pStage, samples, frames);
+
+        log_i("PCM chain benchmark (%s): %s %u cycles/frame", source, pStage->name(), (uint32_t) ((ESP.getCycleCount() - startCycles) / frames));
+    }
+
+    // Whole chain including the conversion and the budget check
+    uint32_t cyclesPerFrame;
+    uint32_t maxCyclesPerFrame;
+
+    memcpy(samples, recording, 2 * frames * sizeof(int16_t));
+    pcmChain_.reset();
+    pcmChain_.checkBudget(cyclesPerFrame, maxCyclesPerFrame); // Discard previous measurements
+    pcmChain_.process(samples, frames);
+
+    bool withinBudget = pcmChain_.checkBudget(cyclesPerFrame, maxCyclesPerFrame);
+
+    log_i("PCM chain benchmark (%s): chain %u cycles/frame, slowest block %u cycles/frame for %u frames (%s budget of %u/%u)",
+        source, cyclesPerFrame, maxCyclesPerFrame, (uint32_t) frames, withinBudget ? "within" : "exceeds", kDspCycleBudget,
+        kDspBlockCycleBudget);
+
+    pcmChain_.reset();
+
+    free(recording);
+    free(samples);
+}
+
+/**
+ * Logs the time since boot at which a boot phase has been completed.
+ * 
+ * @param phase Name of the boot phase.
+ */
+void logBootPhase(const char *phase) {
+    log_i("Boot phase '%s' completed after %lu ms", phase, millis());
+}
+
+/**
+ * Starts WiFi connection and waits for a specified amount of time for the WiFi status to become 'WL_CONNECTED'.
+ * If a previous association is known, the access point is contacted directly without scanning.
+ * 
+ * @param maxInterval Maximum waiting time in ms.
+ */
+bool connectWiFi(uint32_t maxInterval = 5000) {
+    log_d("WiFi status before WiFi.begin = %u", WiFi.status());
+
+    RadioSettings::Association assoc;
+    bool direct = settings_.association(assoc);
+    uint32_t waitInterval = maxInterval; // The direct association gets less time, the scan after it the full time
+    wl_status_t wifiStatus;
+
+    if (direct) {
+        if (kWifiStaticIp) {
+            WiFi.config(IPAddress(assoc.ip), IPAddress(assoc.gateway), IPAddress(assoc.subnet), IPAddress(assoc.dns));
+        }
+
+        wifiStatus = WiFi.begin(WifiCredentials::SSID, WifiCredentials::PASSWORD, assoc.channel, assoc.bssid);
+        waitInterval = min(maxInterval, kWifiDirectTimeout);
+    }
+    else {
+        wifiStatus = WiFi.begin(WifiCredentials::SSID, WifiCredentials::PASSWORD);
+    }
+
+    log_d("WiFi status after WiFi.begin = %u", wifiStatus);
+
+    /*  wl_status_t:
+
+        WL_IDLE_STATUS      = 0,
+        WL_NO_SSID_AVAIL    = 1,
+        WL_SCAN_COMPLETED   = 2,
+        WL_CONNECTED        = 3,
+        WL_CONNECT_FAILED   = 4,
+        WL_CONNECTION_LOST  = 5,
+        WL_DISCONNECTED     = 6
+    */
+    
+    unsigned long startTime = millis();
+    unsigned long passedTime = 0;
+
+    while ( wifiStatus != WL_CONNECTED && (passedTime < waitInterval) ) {
+        int i = 0;
+        
+        while ( wifiStatus != WL_CONNECTED && i < 10) {
+            vTaskDelay(100 / portTICK_PERIOD_MS);
+            wifiStatus = WiFi.status();
+            ++i;
+        }
+        
+        passedTime = millis() - startTime;
+
+        log_d("WiFi status after %lu ms = %u", passedTime, wifiStatus);
+    }
+
+    if (wifiStatus == WL_CONNECTED) {
+        // Remember the association for the next connection
+        memset(&assoc, 0, sizeof(assoc)); // Defined padding bytes, the stored data is compared bytewise
+        memcpy(assoc.bssid, WiFi.BSSID(), sizeof(assoc.bssid));
+        assoc.channel = WiFi.channel();
+        assoc.ip = WiFi.localIP();
+        assoc.gateway = WiFi.gatewayIP();
+        assoc.subnet = WiFi.subnetMask();
+        assoc.dns = WiFi.dnsIP();
+
+        settings_.setAssociation(assoc);
+    }
+    else if (direct) {
+        // The access point may have changed its channel or been replaced: forget it and scan
+        log_w("WiFi: direct association failed - scanning.");
+
+        settings_.clearAssociation();
+        WiFi.disconnect();
+
+        if (kWifiStaticIp) {
+            WiFi.config(IPAddress((uint32_t) 0), IPAddress((uint32_t) 0), IPAddress((uint32_t) 0)); // Back to DHCP
+        }
+
+        return connectWiFi(maxInterval);
+    }
+
+    return wifiStatus == WL_CONNECTED;
+}
+
+/**
+ * Connects to the specified WiFi network and starts the device in internet radio mode.
+ * Audio task is started.
+ * 
+ * @param boot true = device boot (startup screen is shown, latency is measured from boot),
+ *             false = switch from another mode (display task is already running).
+ */
+void startRadio(bool boot) {
+    log_d("Begin: free heap = %d, max alloc heap = %d", ESP.getFreeHeap(), ESP.getMaxAllocHeap());
+    if (pAudio_ == nullptr) {
+        if (boot) {
+            showWelcomeMessage();
+            M5.Lcd.printf(" MAC: %s\n", WiFi.macAddress().c_str()); // Own network mac address
+
+            M5.Lcd.println(" Connecting to WiFi...");
+            M5.Lcd.printf(" SSID: %s\n", WifiCredentials::SSID); // WiFi network name
+        }
+
+        // Initialize WiFi and connect to network
+        WiFi.mode(WIFI_STA);
+        WiFi.setHostname(kDeviceName);
+        WiFi.setAutoReconnect(false); // Reconnecting after an outage is done by the disconnect callback and the main loop
+        WiFi.onEvent(wifiCallbackStaDisconnected, SYSTEM_EVENT_STA_DISCONNECTED); // Register callback for disconnect events
+        
+        // Connect to WiFi station
+        while ( !connectWiFi(10000) );
+
+        wifiOnline_ = true;
+        wifiOutageStart_ = 0;
+        wifiRestoreTime_ = 0;
+
+        if (boot) {
+            logBootPhase("WiFi");
+
+            // Display own IP address after connecting
+            M5.Lcd.println(" Connected to WiFi");
+            M5.Lcd.printf(" IP: %s", WiFi.localIP().toString().c_str());
+        }
+
+        configTime(0, 0, kNtpServer); // Set the clock in the background
+
+        pAudio_ = new Audio(false); // Use external DAC
+
+        // Enlarge the input buffer, so the decoder can play on from the buffer during short WiFi outages (before the first connect)
+        if ( !pAudio_->setBufsize(kAudioBufferSize + kWifiOutageBuffer, 0) ) {
+            log_w("Audio buffer size could not be set.");
+        }
+
+        // Setup audio
+        pAudio_->setVolume(kVolumeMax); // Full scale, the volume is applied by the gain stage
+        gainRamp_.setGain(0);
+        pAudio_->setPinout(kPinI2S_BCLK, kPinI2S_LRCK, kPinI2S_SD);
+
+        deviceMode_ = RADIO;
+        audioTaskParked_ = false;
+
+        // Let the audio task connect to the current station; latency is measured from boot (time 0) or from now
+        Command volumeCmd = {CMD_SET_VOLUME, volumeNormal_, (uint32_t) millis()};
+        commandQueue_.push(volumeCmd);
+
+        Command cmd = {CMD_SET_STATION, stationIndex_, boot ? 0 : (uint32_t) millis()};
+        commandQueue_.push(cmd);
+
+        // Start the audio processing task
+        TaskTopology::createTask(audioProcessing, "Audio processing task", topology_.profile().audio, nullptr, &pAudioTask_);
+
+        // Start the standby task for the next station
+        const TaskTopology::TaskConfig &network = topology_.profile().network;
+
+        if (kStandbyEnabled && !standby_.begin(network.priority, network.core, network.stackSize)) {
+            log_w("Warm standby not available.");
+        }
+
+        if (kTimeshiftPause && !timeshift_.begin(network.priority, network.core, network.stackSize)) {
+            log_w("Timeshift proxy not available (pauses are queued by the host).");
+        }
+
+        // Start delivering song infos to the IFTTT webhook (including those from before the last shutdown)
+        const TaskTopology::TaskConfig &background = topology_.profile().background;
+
+        if ( !outbox_.begin(background.priority, background.core, background.stackSize) ) {
+            log_w("IFTTT outbox not available.");
+        }
+
+        if (kMetricsServer && !metricsServer_.begin(background.priority, background.core, background.stackSize)) {
+            log_w("Metrics server not available.");
+        }
+
+        if (boot) {
+            logBootPhase("Audio task");
+
+            M5.Lcd.fillScreen(TFT_BLACK); // The station appears as soon as the stream delivers its name
+        }
+    }
+    else {
+        log_w("'pAudio_' not cleaned up!");
+    }
+
+    log_d("End: free heap = %d, max alloc heap = %d, min free heap = %d", ESP.getFreeHeap(), ESP.getMaxAllocHeap(), ESP.getMinFreeHeap());
 }
 
 /**
@@ -396,9 +1367,19 @@ void stopRadio() {
 
     if (pAudio_ != nullptr) {
         deviceMode_ = NONE;
-        vTaskDelay(100 / portTICK_PERIOD_MS);
 
         if (pAudioTask_ != nullptr) {
+            // Wait until the audio task has left the stream processing, so it does not hold any locks when deleted
+            xTaskNotifyGive(pAudioTask_);
+
+            for (uint8_t i = 0; i < 100 && !audioTaskParked_; ++i) {
+                vTaskDelay(10 / portTICK_PERIOD_MS);
+            }
+
+            if (!audioTaskParked_) {
+                log_w("Audio task still busy - deleting it anyway.");
+            }
+
             vTaskDelete(pAudioTask_);
             pAudioTask_ = nullptr;
         }
@@ -406,318 +1387,1388 @@ void stopRadio() {
             log_w("Cannot clean up 'pAudioTask_'!");
         }
 
+        standby_.end();
+        timeshift_.end();
+        outbox_.end();
+        capture_.end();
+        metricsServer_.end();
+
         pAudio_->stopSong();
 
-        delete pAudio_;
+        delete pAudio_;
+
+        pAudio_ = nullptr;
+
+        // Release WiFi (needed by bluetooth)
+        WiFi.removeEvent(wifiCallbackStaDisconnected, SYSTEM_EVENT_STA_DISCONNECTED);
+        wifiOnline_ = false;
+        wifiOutageStart_ = 0;
+        WiFi.disconnect(true);
+        WiFi.mode(WIFI_OFF);
+
+        // Set variables to default values
+        audioBufferFilled_ = 0;
+        audioBufferSize_ = 0;
+        // stationIndex_ = 0;
+        commandQueue_.clear();
+        eventQueue_.clear();
+        stationChangedMute_ = true;
+        audioMuted_ = true;
+        streamError_ = false;
+        streamErrorDisplay_ = false;
+        connectError_ = false;
+        userStationPause_ = false;
+        audioPaused_ = false;
+        volumeCurrent_ = 0;
+        pauseFadeOut_ = false;
+        timeshiftStart_ = 0;
+
+        clearDisplay();
+    }
+    else {
+        log_w("Cannot clean up 'pAudio_'!");
+    }
+
+    log_d("End: free heap = %d, max alloc heap = %d", ESP.getFreeHeap(), ESP.getMaxAllocHeap());
+}
+
+/**
+ * Starts the device in bluetooth sink (A2DP) mode.
+ * 
+ * @param boot true = device boot (startup screen is shown), false = switch from another mode.
+ */
+void startA2dp(bool boot) {
+    log_d("Begin: free heap = %d, max alloc heap = %d", ESP.getFreeHeap(), ESP.getMaxAllocHeap());
+
+    i2s_pin_config_t pinConfig = {
+        .bck_io_num = kPinI2S_BCLK,
+        .ws_io_num = kPinI2S_LRCK,
+        .data_out_num = kPinI2S_SD,
+        .data_in_num = I2S_PIN_NO_CHANGE
+    };
+
+    a2dp_.set_pin_config(pinConfig);
+
+    a2dp_.set_avrc_metadata_attribute_mask(ESP_AVRC_MD_ATTR_TITLE | ESP_AVRC_MD_ATTR_ARTIST);
+    a2dp_.set_avrc_metadata_callback(avrc_metadata_callback);
+
+    // PCM chain, volume and fade-in are applied by the volume control (44.1 kHz assumed, as used by most sources)
+    pcmChain_.setSampleRate(44100);
+    pcmChain_.reset();
+    gainRamp_.setSampleRate(44100);
+    a2dpGain_.reset();
+    a2dp_.set_volume_control(&a2dpGain_);
+    a2dp_.set_on_connection_state_changed(a2dp_connection_state_changed);
+    a2dp_.set_on_volumechange(avrc_volume_change_callback);
+
+    // I2S DMA buffering and task priority of the selected latency profile
+    const A2dpLatencyProfile &profile = kA2dpLatencyProfiles[settings_.latencyProfile() % kNumA2dpLatencyProfiles];
+
+    i2s_config_t i2sConfig = {
+        .mode = (i2s_mode_t) (I2S_MODE_MASTER | I2S_MODE_TX),
+        .sample_rate = 44100,
+        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+        .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
+        .communication_format = (i2s_comm_format_t) (I2S_COMM_FORMAT_I2S | I2S_COMM_FORMAT_I2S_MSB),
+        .intr_alloc_flags = 0,
+        .dma_buf_count = profile.dmaBufCount,
+        .dma_buf_len = profile.dmaBufLen,
+        .use_apll = false,
+        .tx_desc_auto_clear = true // Output silence instead of old data on underruns
+    };
+
+    a2dp_.set_i2s_config(i2sConfig);
+    a2dp_.set_task_priority(profile.taskPriority);
+
+    a2dpDmaFrames_ = (uint32_t) profile.dmaBufCount * profile.dmaBufLen;
+    a2dpMonitor_.begin(44100, a2dpDmaFrames_);
+    a2dpLatencyReportTime_ = millis();
+
+    log_i("A2DP latency profile '%s': %u x %u frames DMA (%u ms), task priority %u",
+        profile.name, profile.dmaBufCount, profile.dmaBufLen, a2dpDmaFrames_ * 1000 / 44100, profile.taskPriority);
+    
+    if (boot) {
+        showWelcomeMessage();
+        M5.Lcd.println(" Starting bluetooth");
+    }
+
+    a2dp_.start(kDeviceName);
+    deviceMode_ = A2DP;
+    
+    esp_bt_controller_status_t btStatus = esp_bt_controller_get_status();
+
+    if (btStatus != ESP_BT_CONTROLLER_STATUS_ENABLED) {
+        log_w("Bluetooth controller status = %d", (uint8_t) btStatus);
+    }
+
+    if (boot) {
+        if (btStatus == ESP_BT_CONTROLLER_STATUS_ENABLED) {
+            M5.Lcd.println(" Ok");
+        }
+        else {
+            M5.Lcd.printf(" Error (%d)\n", (uint8_t) btStatus);
+        }
+    }
+
+    publishStationName("Bluetooth");
+
+    if (boot) {
+        logBootPhase("Bluetooth");
+
+        M5.Lcd.fillScreen(TFT_BLACK);
+    }
+
+    log_d("End: free heap = %d, max alloc heap = %d, min free heap = %d", ESP.getFreeHeap(), ESP.getMaxAllocHeap(), ESP.getMinFreeHeap());
+}
+
+/**
+ * Stops the bluetooth sink (A2DP) mode.
+ * The memory of the bluetooth controller is kept, otherwise bluetooth could not be started again.
+ */
+void stopA2dp() {
+    log_d("Begin: free heap = %d, max alloc heap = %d", ESP.getFreeHeap(), ESP.getMaxAllocHeap());
+
+    if (deviceMode_ == A2DP) {
+        deviceMode_ = NONE;
+
+        a2dp_.end(false); // Disconnect, shut down bluedroid and the controller, uninstall the I2S driver
+
+        // Set variables to default values
+        eventQueue_.clear();
+        artistStr_[0] = '\0';
+        titleStr_[0] = '\0';
+        volumeCurrent_ = 0;
+
+        clearDisplay();
+    }
+    else {
+        log_w("A2DP mode not running!");
+    }
+
+    log_d("End: free heap = %d, max alloc heap = %d", ESP.getFreeHeap(), ESP.getMaxAllocHeap());
+}
+
+/**
+ * Switches between internet radio and bluetooth sink (A2DP) mode without rebooting the device.
+ * The new mode is also stored in the EEPROM for the next boot.
+ */
+void switchMode() {
+    unsigned long startTime = millis();
+    uint32_t heapBefore = ESP.getFreeHeap();
+    t_DeviceMode newMode = (deviceMode_ == RADIO) ? A2DP : RADIO;
+
+    EEPROM.writeByte(0, (uint8_t) newMode); // Enter the new mode after restart
+    EEPROM.commit();
+
+    if (deviceMode_ == RADIO) {
+        stopRadio(); // Close connections and clean up
+    }
+    else {
+        stopA2dp();
+    }
+
+    unsigned long teardownTime = millis();
+    uint32_t heapIdle = ESP.getFreeHeap();
+
+    // Both modes torn down: the free heap must be the same after each switch, otherwise something leaks
+    if (modeSwitchHeap_ != 0) {
+        log_i("Mode switch: free heap without any mode = %u (%d bytes since previous switch)", heapIdle, (int32_t) (heapIdle - modeSwitchHeap_));
+    }
+
+    modeSwitchHeap_ = heapIdle;
+
+    if (newMode == RADIO) {
+        startRadio(false);
+    }
+    else {
+        startA2dp(false);
+    }
+
+    log_i("Mode switch to %s: teardown %lu ms, start %lu ms, free heap %u -> %u -> %u, max alloc heap %u",
+        (newMode == RADIO) ? "radio" : "A2DP", teardownTime - startTime, millis() - teardownTime,
+        heapBefore, heapIdle, ESP.getFreeHeap(), ESP.getMaxAllocHeap());
+}
+
+/**
+ * Queues the current content of 'infoStr_' for the IFTTT webhook specified by 'IftttHook::IFTTT_ADD_SONG'.
+ * The outbox task delivers it in the background.
+ */
+void sendTitle() {
+    char infoIfttt[IftttOutbox::kMaxTextLength];
+
+    // Create local copy of current info
+    lockDisplay();
+    strlcpy(infoIfttt, infoStr_, sizeof(infoIfttt));
+    unlockDisplay();
+    
+    if (infoIfttt[0] == '\0') { // Prevent sending empty info
+        log_d("Not sending title to IFTTT because it is empty.");
+        return;
+    }
+
+    log_d("Queueing title for IFTTT");
+
+    if ( !outbox_.add(infoIfttt) ) {
+        log_w("IFTTT outbox full - title dropped.");
+    }
+}
+
+/**
+ * Enable or disable the shutdown circuit of the amplifier.
+ * Amplifier: M5Stack SPK hat with PAM8303.
+ * - b = true  --> GPIO_0 = 0 : Shutdown enabled
+ * - b = false --> GPIO_0 = 1 : Shutdown disabled
+ */
+void setAudioShutdown(bool b) {
+    /*
+    if (b) {
+        gpio_set_level(GPIO_NUM_0, 0); // Enable shutdown circuit
+    }
+    else {
+        gpio_set_level(GPIO_NUM_0, 1); // Disable shutdown circuit
+    }
+    */
+}
+
+/**
+ * Connects the audio library to the given URL.
+ * The stream host is resolved beforehand by the host cache (no lookup for recently resolved hosts), which measures
+ * the DNS lookup separately. The timeshift proxy connects to the address from the cache; the audio library connects
+ * by host name (HTTPS, playlists), answered by the DNS cache of the network stack. Durations of DNS lookup and
+ * connection setup are recorded.
+ * 
+ * @param url Stream or playlist URL.
+ * @return true if the connection has been established.
+ */
+bool connectToUrl(const char *url) {
+    char host[HostCache::kMaxHostLength];
+    HostCache::Result hostResult;
+    bool hasHost = HostCache::parseHost(url, host);
+
+    hostResult.ip = IPAddress();
+    connectTimeDns_ = 0;
+    connectDnsRecent_ = false;
+    connectTimeTcp_ = 0;
+    timeFirstByte_ = 0;
+
+    metricConnects_.inc();
+
+    if (hasHost) {
+        if ( !hostCache_.resolve(host, hostResult) ) {
+            metricDnsFailures_.inc();
+            metricConnectFailures_.inc();
+            return false;
+        }
+
+        connectTimeDns_ = hostResult.dnsTime;
+        connectDnsRecent_ = hostResult.recent;
+
+        if (!connectDnsRecent_) {
+            metricDnsTime_.observe(connectTimeDns_);
+        }
+
+        (connectDnsRecent_ ? metricDnsRecent_ : metricDnsNew_).inc();
+    }
+
+    uint64_t timeStart = millis();
+
+    // Play HTTP streams through the timeshift proxy (playlists are resolved by the audio library)
+    char localUrl[TimeshiftProxy::kMaxUrlLength];
+    bool proxyUrl = timeshift_.taskHandle() != nullptr && TimeshiftProxy::isSupportedUrl(url) && !PlaylistCache::isPlaylistUrl(url);
+    bool proxied = proxyUrl && timeshift_.open(url, hostResult.ip, localUrl);
+
+    if (!proxied) {
+        timeshift_.close();
+    }
+
+    bool success = pAudio_->connecttohost( proxied ? localUrl : url ); // May fail due to wrong host address, socket error or timeout
+
+    connectTimeTcp_ = (uint32_t) (millis() - timeStart);
+
+    if (success) {
+        metricConnectLatency_.observe(connectTimeDns_ + connectTimeTcp_);
+    }
+    else {
+        metricConnectFailures_.inc();
+    }
+
+    // The cached address may be outdated (the audio library connects by host name)
+    if ( connectDnsRecent_ && (!success || (proxyUrl && !proxied)) ) {
+        hostCache_.invalidate(host);
+    }
+
+    return success;
+}
+
+/**
+ * Connects to the current station ('audioStationIndex_'). A failed connection is reported to the stream watchdog.
+ * 
+ * @param alternate Index of the station URL (0 = primary URL, others = alternate URLs from the catalogue).
+ */
+void connectToStation(uint8_t alternate = 0) {
+    // Establish HTTP connection to requested stream URL
+    const char *stationUrl = catalogue_.url(audioStationIndex_, alternate);
+    const char *streamUrl = stationUrl;
+
+    // Use the stream URL prepared by the standby task if the station is in standby (primary URL only),
+    // otherwise the stream URL of a playlist station may be in the cache
+    char resolvedUrl[PlaylistCache::kMaxUrlLength];
+    bool isPlaylist = PlaylistCache::isPlaylistUrl(stationUrl);
+
+    connectWarm_ = (alternate == 0) && standby_.take(audioStationIndex_, resolvedUrl);
+
+    if (connectWarm_ || ( isPlaylist && playlistCache_.lookup(stationUrl, resolvedUrl) )) {
+        streamUrl = resolvedUrl;
+    }
+
+    if (isPlaylist) {
+        log_d("Playlist cache: %u hits, %u misses", playlistCache_.hits(), playlistCache_.misses());
+
+        metricPlaylistHits_.set(playlistCache_.hits());
+        metricPlaylistMisses_.set(playlistCache_.misses());
+    }
+
+    connectViaPlaylist_ = isPlaylist && (streamUrl == stationUrl);
+
+    bool success = connectToUrl( streamUrl );
+
+    // Fall back to the URL from the station list if the resolved URL has become invalid
+    if (!success && streamUrl != stationUrl) {
+        log_d("Resolved URL '%s' failed, falling back to station list.", streamUrl);
+
+        if (isPlaylist) {
+            playlistCache_.invalidate(stationUrl);
+        }
+
+        connectWarm_ = false;
+        connectViaPlaylist_ = isPlaylist;
+        streamUrl = stationUrl;
+        metricReconnects_.inc();
+        success = connectToUrl( streamUrl );
+    }
+
+    if (success) {
+        streamError_ = false; // Clear in case a connection error occured before
+        strlcpy(audioStreamUrl_, streamUrl, sizeof(audioStreamUrl_));
+
+        timeConnect_ = millis(); // Store time in order to detect stream errors after connecting
+    }
+    else {
+        streamError_ = true; // Raise connection error flag
+        sendEvent(EVT_STREAM_ERROR);
+
+        log_d("Failed to connect to host '%s'. WiFi status: %u", streamUrl, WiFi.status());
+
+        watchdog_.failed(millis(), "connect failed");
+    }
+
+    // Update buffer state variables
+    audioBufferFilled_ = pAudio_->inBufferFilled(); // 0 after connecting
+    audioBufferSize_ = pAudio_->inBufferFree() + audioBufferFilled_;
+
+    watchdog_.start(millis(), audioBufferSize_);
+
+    // Start measuring the incoming data. Unmuting is decided on the normal buffer size, so the reserve for
+    // WiFi outages neither delays the start nor lets a slowly filling stream run into the stream error timeout;
+    // the reserve fills up while playing from the data the host sends faster than real time.
+    unmutePolicy_.reset(millis(), min(audioBufferSize_, kAudioBufferSize));
+
+    // Use the bitrate from the catalogue until the stream reports it
+    if (catalogue_.bitrate(audioStationIndex_) > 0) {
+        char bitrate[12];
+
+        snprintf(bitrate, sizeof(bitrate), "%u", catalogue_.bitrate(audioStationIndex_));
+        unmutePolicy_.setBitrate(bitrate);
+    }
+}
+
+/**
+ * Logs the time from the last station request (or device boot) until audio has been unmuted.
+ * The total is split up into the time needed to connect and the time needed to fill the buffer.
+ */
+void logAudioLatency() {
+    uint64_t timeUnmute = millis();
+
+    uint32_t connectMs = (uint32_t) (timeConnect_ - timeStationRequest_);
+    uint32_t bufferMs = (uint32_t) (timeUnmute - timeConnect_);
+    uint32_t totalMs = (uint32_t) (timeUnmute - timeStationRequest_);
+
+    metricTimeToAudio_.observe(totalMs);
+
+    if (firstAudioAfterBoot_) {
+        log_i("Time to first audio after boot: %u ms (connect: %u ms, buffer: %u ms)", totalMs, connectMs, bufferMs);
+        firstAudioAfterBoot_ = false;
+    }
+    else {
+        log_i("Station switch latency: %u ms (connect: %u ms, buffer: %u ms, warm standby: %s)",
+            totalMs, connectMs, bufferMs, timeshift_.isWarm() ? "connected" : (connectWarm_ ? "resolved" : "no"));
+    }
+}
+
+void stopPlaying() {
+    gainRamp_.setGain(0); // Silent until the next fade-in
+    pcmChain_.reset();
+    pauseFadeOut_ = false;
+    timeshiftStart_ = 0;
+
+    pAudio_->stopSong();
+    timeshift_.close();
+    setAudioShutdown(true); // Turn off amplifier
+    stationChangedMute_ = true; // Mute audio until stream becomes stable
+}
+
+/**
+ * Maximum pause in ms: buffered by the timeshift proxy or queued by the host.
+ */
+uint32_t maxPauseTime() {
+    return timeshift_.isOpen() ? kTimeshiftMaxPause : kTimeshiftHostQueue;
+}
+
+/**
+ * Pauses the faded out stream. With 'kTimeshiftPause' decoding is suspended while the connection and the
+ * content of the audio buffer are kept for resuming (the timeshift proxy keeps downloading), otherwise the
+ * stream is stopped.
+ */
+void pauseStream() {
+    if ( kTimeshiftPause && pAudio_->isRunning() && pAudio_->pauseResume() ) {
+        timeshift_.setPaused(true);
+        pauseFadeOut_ = false;
+        setAudioShutdown(true); // Turn off amplifier
+
+        unsigned long now = millis();
+        timeshiftStart_ = (now != 0) ? now : 1;
+
+        log_i("Pause: connection kept for up to %u ms, %u bytes buffered (%s)", maxPauseTime(), audioBufferFilled_,
+            timeshift_.isOpen() ? "timeshift proxy" : "queued by the host");
+    }
+    else {
+        stopPlaying();
+    }
+}
+
+/**
+ * Resumes a stream paused by 'pauseStream' from the kept connection.
+ * 
+ * @return false if the connection has not been kept (the caller has to reconnect).
+ */
+bool resumeStream() {
+    if (timeshiftStart_ == 0 || pAudio_->isRunning()) {
+        return false;
+    }
+
+    uint32_t pauseTime = (uint32_t) (millis() - timeshiftStart_);
+
+    timeshiftStart_ = 0;
+    timeshift_.setPaused(false); // The proxy returns to the live stream once the stored part has been played
+
+    if ( !pAudio_->pauseResume() ) {
+        return false;
+    }
+
+    metricTimeshiftPause_.observe(pauseTime);
+    metricResumesTimeshift_.inc();
+
+    setAudioShutdown(false);
+    sendEvent(EVT_UNMUTED);
+
+    gainRamp_.rampTo(GainRamp::volumeToGain(audioVolume_, kVolumeMax), kFadeInTime, kFadeInCurve);
+    watchdog_.start(millis(), audioBufferSize_); // The host may have dropped the connection in the meantime
+
+    log_i("Resume after %u ms pause: %u bytes buffered (timeshift proxy: %u bytes), latency %u ms", pauseTime,
+        audioBufferFilled_, (uint32_t) (timeshift_.bufferedRam() + timeshift_.bufferedSpill()), (uint32_t) (millis() - timeStationRequest_));
+
+    return true;
+}
+
+/**
+ * Decodes the capture file as fast as possible through the output path of the radio (PCM chain and gain stage)
+ * with a null sink instead of I2S and reports the decode cost (executed by the audio task, blocks it until the end).
+ * The decode time includes reading the file from flash instead of the network buffer.
+ */
+void replayCapture() {
+    stopPlaying();
+
+    if ( !LITTLEFS.exists(kCapturePath) ) {
+        log_w("Replay: no capture '%s' (record one with 'c')", kCapturePath);
+        return;
+    }
+
+    uint32_t heapBefore = ESP.getFreeHeap();
+    uint32_t heapMin = heapBefore;
+
+    replayFrames_ = 0;
+    replayActive_ = true;
+
+    if ( !pAudio_->connecttoFS(LITTLEFS, kCapturePath) ) {
+        replayActive_ = false;
+        log_w("Replay: cannot open '%s'", kCapturePath);
+        return;
+    }
+
+    uint64_t decodeTime = 0; // in us
+    uint32_t loopMax = 0;
+    uint32_t loops = 0;
+    uint32_t sampleRate = 0;
+    unsigned long startTime = millis();
+
+    // The library stops by itself at the end of the file
+    while ( pAudio_->isRunning() && millis() - startTime < kReplayTimeout ) {
+        uint32_t loopStart = micros();
+
+        pAudio_->loop();
+
+        uint32_t loopTime = micros() - loopStart;
+
+        decodeTime += loopTime;
+        loopMax = max(loopMax, loopTime);
+        heapMin = min(heapMin, ESP.getFreeHeap());
+        sampleRate = max(sampleRate, pAudio_->getSampleRate());
+
+        // Let the idle task run now and then (not counted as decode time)
+        if (++loops % 16 == 0) {
+            vTaskDelay(1);
+        }
+    }
+
+    pAudio_->stopSong();
+    replayActive_ = false;
+
+    uint32_t frames = replayFrames_ / kReplayFrameSamples;
+
+    if (frames == 0 || sampleRate == 0) {
+        log_w("Replay: no audio decoded from '%s'", kCapturePath);
+        return;
+    }
+
+    uint32_t frameTime = (uint32_t) (decodeTime / frames); // in us
+    uint32_t audioTime = (uint32_t) ((uint64_t) replayFrames_ * 1000 / sampleRate); // in ms
+    int32_t headroom = 100 - (int32_t) (decodeTime / 10 / max(audioTime, (uint32_t) 1));
+
+    // An underrun occurs if a single loop iteration takes longer than the DMA buffers last
+    int32_t underrunMargin = (int32_t) (kI2sDmaFrames * 1000000 / sampleRate) - (int32_t) loopMax;
+
+    log_i("Replay: %u frames (%u ms audio at %u Hz) in %u ms: %u.%03u ms/frame, real-time headroom %d%%",
+        frames, audioTime, sampleRate, (uint32_t) (decodeTime / 1000), frameTime / 1000, frameTime % 1000, headroom);
+    log_i("Replay: longest loop %u us (underrun margin %d us), peak heap %u bytes",
+        loopMax, underrunMargin, heapBefore - heapMin);
+
+    metricReplayFrameTime_.set(frameTime);
+    metricReplayHeadroom_.set(headroom);
+    metricReplayLoopMax_.set(loopMax);
+    metricReplayHeapPeak_.set(heapBefore - heapMin);
+    metricReplayMargin_.set(underrunMargin);
+    metricReplays_.inc();
+}
+
+/**
+ * Processes all pending commands from the user interface (executed by the audio task).
+ */
+void processCommands() {
+    Command cmd;
+
+    while ( commandQueue_.pop(cmd) ) {
+        switch (cmd.type) {
+            case CMD_SET_VOLUME:
+                audioVolume_ = min( (uint8_t) cmd.value, kVolumeMax );
+
+                // While muted the volume is applied by the next fade-in
+                if (!stationChangedMute_ && !audioPaused_) {
+                    gainRamp_.rampTo(GainRamp::volumeToGain(audioVolume_, kVolumeMax), kVolumeRampTime, GainRamp::LINEAR);
+                }
+                break;
+
+            case CMD_SET_STATION:
+                audioStationIndex_ = cmd.value;
+                timeStationRequest_ = cmd.time; // Start of latency measurement
+                audioPaused_ = false;
+
+                stopPlaying();
+                watchdog_.reset( catalogue_.numUrls(audioStationIndex_) );
+                connectToStation();
+                break;
+
+            case CMD_PAUSE:
+                audioPaused_ = true;
+
+                // Fade out before stopping the stream ('audioProcessing' stops it when the ramp has ended)
+                if (stationChangedMute_) {
+                    stopPlaying();
+                }
+                else {
+                    gainRamp_.rampTo(0, kFadeOutTime, kFadeOutCurve);
+                    pauseFadeOut_ = true;
+                }
+
+                watchdog_.reset( catalogue_.numUrls(audioStationIndex_) ); // No reconnects while paused
+                break;
+
+            case CMD_RESUME:
+                timeStationRequest_ = cmd.time; // Start of latency measurement
+                audioPaused_ = false;
+
+                // Continue where the stream has been paused if the connection has been kept
+                if (cmd.value == audioStationIndex_ && resumeStream()) {
+                    break;
+                }
+
+                audioStationIndex_ = cmd.value;
+                metricResumesReconnect_.inc();
+
+                stopPlaying(); // Ends a fade-out that is still in progress
+                watchdog_.reset( catalogue_.numUrls(audioStationIndex_) );
+                connectToStation();
+                break;
+
+            case CMD_NETWORK_RESTORED:
+                // The TCP connection may have survived the outage: give the stream time to deliver data again
+                watchdog_.start(millis(), audioBufferSize_);
+                break;
+
+            case CMD_CAPTURE:
+                if (audioStreamUrl_[0] != '\0') {
+                    const TaskTopology::TaskConfig &network = topology_.profile().network;
+
+                    capture_.start(audioStreamUrl_, network.priority, network.core, network.stackSize);
+                }
+                break;
+
+            case CMD_REPLAY:
+                // The file must be complete
+                if ( capture_.end() ) {
+                    replayCapture();
+                }
+                else {
+                    log_w("Replay: capture still running - skipped.");
+                }
+
+                audioStationIndex_ = cmd.value;
+                timeStationRequest_ = millis();
+                audioPaused_ = false;
+
+                watchdog_.reset( catalogue_.numUrls(audioStationIndex_) );
+                connectToStation();
+                break;
+        }
+    }
+}
+
+/**
+ * Blocks the audio task until there is work to do: a command has arrived, stream data is
+ * arriving or the I2S DMA buffers need to be refilled.
+ * 
+ * @param bufferFilledBefore Content of the audio buffer before the last call of 'pAudio_->loop()'.
+ */
+void waitForAudioWork(uint32_t bufferFilledBefore) {
+    TickType_t waitTicks;
+
+    if ( watchdog_.isRetryPending() && !wifiOnline_ ) {
+        waitTicks = 100 / portTICK_PERIOD_MS; // Reconnect as soon as WiFi is back ('CMD_NETWORK_RESTORED' wakes up earlier)
+    }
+    else if ( watchdog_.isRetryPending() ) {
+        waitTicks = max( (TickType_t) (watchdog_.retryDelay(millis()) / portTICK_PERIOD_MS), (TickType_t) 1 ); // Wake up for the reconnect
+    }
+    else if (timeshiftStart_ != 0) {
+        // Wake up when the connection kept for the pause is to be closed (the proxy buffer is checked periodically)
+        uint32_t pauseTime = (uint32_t) (millis() - timeshiftStart_);
+        uint32_t maxPause = maxPauseTime();
+
+        waitTicks = (pauseTime < maxPause) ? (maxPause - pauseTime) / portTICK_PERIOD_MS + 1 : 1;
+
+        if (timeshift_.isOpen()) {
+            waitTicks = min(waitTicks, (TickType_t) (kTimeshiftFullCheck / portTICK_PERIOD_MS));
+        }
+    }
+    else if ( (audioPaused_ && !pauseFadeOut_) || !pAudio_->isRunning() ) {
+        waitTicks = portMAX_DELAY; // Nothing to do until the next command
+    }
+    else if ( audioBufferFilled_ > bufferFilledBefore ) {
+        waitTicks = 1; // Data is arriving: continue reading soon
+    }
+    else {
+        // Wake up when half of the DMA buffers have been played
+        uint32_t sampleRate = max(pAudio_->getSampleRate(), (uint32_t) 8000);
+
+        waitTicks = max( (TickType_t) (kI2sDmaFrames * 1000 / sampleRate / 2 / portTICK_PERIOD_MS), (TickType_t) 1 );
+    }
+
+    ulTaskNotifyTake(pdTRUE, waitTicks); // Returns early when a command is sent
+}
+
+void audioProcessing(void *p) {
+    while (true) {
+        if (deviceMode_ != RADIO) {
+            audioTaskParked_ = true; // Radio mode has ended: wait here until the task is deleted
+            vTaskDelay(200 / portTICK_PERIOD_MS);
+            continue;
+        }
+
+        // Process requested changes of volume, station and pause state
+        processCommands();
+
+        // After the buffer has been filled up sufficiently enable audio output
+        if (stationChangedMute_ && !audioPaused_) {
+            unmutePolicy_.update(millis(), audioBufferFilled_);
+
+            if ( unmutePolicy_.shouldUnmute() ) {
+                unmutePolicy_.log("Unmute");
+
+                setAudioShutdown(false);
+                stationChangedMute_ = false;
+                streamError_ = false;
+                sendEvent(EVT_UNMUTED);
+
+                // Fade in sample by sample in the output path
+                pcmChain_.setSampleRate( pAudio_->getSampleRate() );
+                gainRamp_.setSampleRate( pAudio_->getSampleRate() );
+                gainRamp_.rampTo(GainRamp::volumeToGain(audioVolume_, kVolumeMax), kFadeInTime, kFadeInCurve);
+
+                if ( watchdog_.isRecovering() ) {
+                    metricRecoveryTime_.observe( watchdog_.recovered(millis()) );
+                }
+                else {
+                    logAudioLatency();
+                }
+
+                // Prepare the next station while the current one is playing (not a second connection to the current one)
+                uint16_t nextIndex = (audioStationIndex_ + 1) % catalogue_.count();
+
+                if (nextIndex != audioStationIndex_) {
+                    standby_.prepare(nextIndex, catalogue_.url(nextIndex));
+                }
+            }
+            else {
+                // If the stream does not deliver enough data something is wrong with the connection
+                if ( unmutePolicy_.isStreamError() ) {
+                    if (!streamError_) {
+                        unmutePolicy_.log("Audio buffer low");
+                        metricStreamErrors_.inc();
+                        streamError_ = true; // Raise connection error flag
+                        sendEvent(EVT_STREAM_ERROR);
+
+                        watchdog_.failed(millis(), "too little data");
+                    }
+                }
+            }
+        }
+        else if (!audioPaused_ && wifiOnline_) {
+            // Detect a stalled stream while playing from the trend of the buffer fill (during a WiFi outage the decoder plays on from the buffer)
+            watchdog_.update(millis(), audioBufferFilled_);
+
+            if ( watchdog_.isStalled(millis()) ) {
+                metricStalls_.inc();
+
+                stopPlaying();
+                streamError_ = true;
+                sendEvent(EVT_STREAM_ERROR);
+
+                watchdog_.failed(millis(), "stream stalled");
+            }
+        }
+
+        // Reconnect after a failure (backoff time elapsed)
+        if ( !audioPaused_ && wifiOnline_ && watchdog_.isRetryDue(millis()) ) {
+            watchdog_.retryStarted();
+            metricReconnects_.inc();
+
+            stopPlaying();
+            connectToStation( watchdog_.alternate() );
+        }
+
+        uint32_t bufferFilledBefore = pAudio_->inBufferFilled();
+
+        uint32_t decodeStart = micros();
+
+        // Let 'esp32-audioI2S' library process the web radio stream data
+        pAudio_->loop();
+
+        uint32_t decodeTime = micros() - decodeStart;
+
+        audioBufferFilled_ = pAudio_->inBufferFilled(); // Update used buffer capacity
+
+        // Pause the stream as soon as the pause fade-out has been played
+        if ( pauseFadeOut_ && !gainRamp_.isRamping() ) {
+            pauseStream();
+        }
+
+        // Close the connection if the pause lasts longer than it can be buffered
+        if ( timeshiftStart_ != 0 && timeshift_.isFull() ) {
+            log_i("Timeshift buffer full after %lu ms pause: connection closed", millis() - timeshiftStart_);
+
+            stopPlaying();
+        }
+        else if ( timeshiftStart_ != 0 && millis() - timeshiftStart_ > maxPauseTime() ) {
+            log_i("Pause longer than %u ms: connection closed", maxPauseTime());
+
+            stopPlaying();
+        }
+
+        // Record decode time, underruns and loop jitter while playing (also used by the topology benchmark)
+        if (!stationChangedMute_ && !audioPaused_) {
+            uint32_t loopTime = micros();
+
+            metricDecodeTime_.observe(decodeTime);
+
+            if (audioLoopTime_ != 0) {
+                uint32_t gap = loopTime - audioLoopTime_;
+
+                metricLoopGap_.observe(gap);
+                metricLoopGapMax_.setMax(gap);
+            }
+
+            audioLoopTime_ = loopTime;
+
+            if (audioBufferFilled_ == 0 && bufferFilledBefore > 0) {
+                metricUnderruns_.inc();
+            }
+        }
+        else {
+            audioLoopTime_ = 0;
+        }
+
+        // Log the connection timing as soon as the first data of a new stream has arrived
+        if (timeFirstByte_ == 0 && audioBufferFilled_ > 0) {
+            timeFirstByte_ = millis();
+
+            log_i("Connect timing: DNS %u ms (host %s), TCP connect and request %u ms, first byte %u ms",
+                connectTimeDns_, connectDnsRecent_ ? "recent" : "new", connectTimeTcp_, (uint32_t) (timeFirstByte_ - timeConnect_));
+        }
+
+        if (kAudioTaskEventDriven) {
+            waitForAudioWork(bufferFilledBefore);
+        }
+        else {
+            vTaskDelay(1 / portTICK_PERIOD_MS); // Let other tasks execute
+        }
+    }
+}
+
+void displayProcessing(void *p) {
+    const TickType_t frameTicks = max( (TickType_t) (kDisplayFrameTime / portTICK_PERIOD_MS), (TickType_t) 1 );
+    TickType_t lastWake = xTaskGetTickCount();
+    unsigned long reportTime = millis();
+
+    while (true) {
+        uint32_t frameStart = micros();
+
+        lockDisplay();
+        renderDisplay();
+        unlockDisplay();
+
+        uint32_t frameTime = micros() - frameStart;
+
+        frameTimeAvg_ = (frameTimeAvg_ * 15 + frameTime) / 16; // Moving average
+        frameTimeMax_ = max(frameTimeMax_, frameTime);
+
+        metricFrames_.inc();
+        metricFrameTime_.observe(frameTime);
+
+        // If the frame budget has been exceeded skip the missed frames instead of catching up in a burst
+        TickType_t elapsed = xTaskGetTickCount() - lastWake;
+
+        if (elapsed > frameTicks) {
+            metricFramesDropped_.inc((elapsed - 1) / frameTicks);
+            lastWake = xTaskGetTickCount();
+        }
+
+        if (millis() - reportTime > kDisplayReportInterval) {
+            reportTime = millis();
+
+            log_i("Display: %u frames, %u dropped, frame time avg %u us, max %u us",
+                metricFrames_.value(), metricFramesDropped_.value(), frameTimeAvg_, frameTimeMax_);
+
+            frameTimeMax_ = 0;
+        }
+
+        vTaskDelayUntil(&lastWake, frameTicks);
+    }
+}
+
+void setup() {
+    /*
+    // Setup GPIO ports for SPK hat
+    gpio_set_direction(GPIO_NUM_0, GPIO_MODE_OUTPUT); // Shutdown circuit of M5Stack SPK hat
+    setAudioShutdown(true);
+
+    gpio_set_direction(GPIO_NUM_26, GPIO_MODE_OUTPUT_OD); // Configure GPIO_26 for DAC output (DAC_CHANNEL_2)
+    //dac_output_enable(DAC_CHANNEL_2);
+    //dac_output_voltage(DAC_CHANNEL_2, 0);
+    */
+
+    log_d("IDF version = %s", ESP.getSdkVersion());
+    log_d("Total heap = %d", ESP.getHeapSize());
+    log_d("Free heap = %d", ESP.getFreeHeap());
+    log_d("Max alloc heap = %d", ESP.getMaxAllocHeap());
+
+    // Initialize M5StickC
+    M5.begin();
+    M5.Lcd.setRotation(3);
+
+    displayMutex_ = xSemaphoreCreateMutex();
+
+    logBootPhase("M5");
+
+    // Load the station catalogue from flash, fall back to the built-in station list
+    if ( !LITTLEFS.begin(false) || !catalogue_.load(LITTLEFS, kStationCataloguePath) ) {
+        log_w("Station catalogue not available - using built-in station list.");
+        catalogue_.load(kBuiltinStations);
+    }
+
+    log_i("Station catalogue: %u stations, %u bytes", catalogue_.count(), (uint32_t) catalogue_.memoryUsage());
+
+    // Build the PCM chain (before the audio output is started)
+    if (kDspEnabled) {
+        for (uint8_t i = 0; i < sizeof(eqBands_) / sizeof(eqBands_[0]); ++i) {
+            pcmChain_.add(&eqBands_[i]);
+        }
+
+        if (kDspMono) {
+            pcmChain_.add(&monoStage_);
+        }
+
+        pcmChain_.add(&limiter_);
+        pcmChain_.setSampleRate(44100);
+
+        if (kDspBenchmark) {
+            benchmarkPcmChain();
+        }
+    }
+
+    if ( settings_.begin() ) {
+        stationIndex_ = settings_.station() % catalogue_.count();
+        volumeNormal_ = min(settings_.volume(), kVolumeMax);
+    }
+    else {
+        log_w("Settings not available.");
+    }
+
+    if ( !topology_.begin(kTopologyBenchmark) ) {
+        log_w("Task topology selection not available.");
+    }
+
+    if ( !playlistCache_.begin() ) {
+        log_w("Playlist cache not available.");
+    }
+
+    if ( !hostCache_.begin() ) {
+        log_w("Host cache not available.");
+    }
+
+    if ( topology_.isBenchmarkRunning() ) {
+        stationIndex_ = kTopologyBenchmarkStation; // All profiles are benchmarked with the same stream
+    }
+    
+    if ( EEPROM.begin(1) ) {
+        uint8_t mode = EEPROM.readByte(0);
+
+        log_d("EEPROM.readByte(0) = %d", mode);
+
+        if (mode == 2 && !topology_.isBenchmarkRunning()) {
+            startA2dp(true);
+        }
+        else {
+            startRadio(true);
+        }
+    }
+    else {
+        log_w("EEPROM.begin() returned 'false'!");
+        startRadio(true);
+    }
+
+    // Button interrupts wake up the main loop; pending power button events are discarded
+    buttons_.addButton(kButtonA, kPinButtonA, false, false);
+    buttons_.addButton(kButtonB, kPinButtonB, false, false);
+    buttons_.addButton(kButtonRed, kPinButtonRed, true, true);
+    buttons_.addButton(kButtonBlue, kPinButtonBlue, true, true);
+    buttons_.addAxpButton(kButtonPwr, kPinAxpIrq);
+    buttons_.begin( xTaskGetCurrentTaskHandle() );
+
+    // Build 1 bpp glyphs of all fonts used for station name, stream info (artist/song etc.) and status line
+    bool displayOk = stationAtlas_.build(&M5.Lcd, 1, 2) && titleAtlas_.build(&M5.Lcd, 2, 1) && statusAtlas_.build(&M5.Lcd, 1, 1);
+
+    displayOk = displayOk
+        && stationLine_.begin(M5.Lcd.width())
+        && titleScroller_.begin(M5.Lcd.width(), TFT_CYAN)
+        && volumeLine_.begin(statusAtlas_.textWidth("Vol: 000"))
+        && playStateLine_.begin(statusAtlas_.textWidth("1234567"));
+
+    if (!displayOk) {
+        log_w("Cannot allocate memory for the display.");
+    }
+    else {
+        log_d("Glyph atlases: %u bytes", (uint32_t) (stationAtlas_.memoryUsage() + titleAtlas_.memoryUsage() + statusAtlas_.memoryUsage()));
+
+        if (kTextRenderBenchmark) {
+            benchmarkTextRendering();
+        }
+    }
+
+    M5.Axp.ScreenBreath(9);
 
-        pAudio_ = nullptr;
+    // Start the display task (by default on the core not used by the audio task)
+    if (displayMutex_ == nullptr
+        || !TaskTopology::createTask(displayProcessing, "Display task", topology_.profile().ui, nullptr, &pDisplayTask_)) {
+        log_w("Cannot start the display task.");
+    }
 
-        // Set variables to default values
-        audioBufferFilled_ = 0;
-        audioBufferSize_ = 0;
-        // stationIndex_ = 0;
-        stationChanged_ = true;
-        stationChangedMute_ = true;
-        String stationStr_ = "";
-        stationDisplayFlag_ = false;
-        streamError_ = false;
-        infoStr_ = "";
-        infoDisplayFlag_ = false;
-        titleTextWidth_ = 0;
-        titlePosX_ = M5.Lcd.width();
-        volumeCurrent_ = 0;
-        volumeCurrentF_ = 0.0f;
-        volumeCurrentChangedFlag_ = true;
+    logBootPhase("Display");
 
-        M5.Lcd.fillScreen(TFT_BLACK);
-    }
-    else {
-        log_w("Cannot clean up 'pAudio_'!");
+    if (kGainRampBenchmark) {
+        benchmarkGainRamp();
     }
 
-    log_d("End: free heap = %d, max alloc heap = %d", ESP.getFreeHeap(), ESP.getMaxAllocHeap());
+    if (kCpuLoadReport && !CpuLoad::begin()) {
+        log_w("CPU load measurement not available.");
+    }
 }
 
 /**
- * Starts the device in bluetooth sink (A2DP) mode.
+ * Logs the CPU load of both cores together with the scheduling mode of the audio task.
  */
-void startA2dp() {
-    log_d("Begin: free heap = %d, max alloc heap = %d", ESP.getFreeHeap(), ESP.getMaxAllocHeap());
+void reportCpuLoad() {
+    uint8_t load[CpuLoad::kNumCores];
 
-    i2s_pin_config_t pinConfig = {
-        .bck_io_num = kPinI2S_BCLK,
-        .ws_io_num = kPinI2S_LRCK,
-        .data_out_num = kPinI2S_SD,
-        .data_in_num = I2S_PIN_NO_CHANGE
-    };
+    CpuLoad::sample(load);
 
-    a2dp_.set_pin_config(pinConfig);
+    metricCpuLoadCore0_.set(load[0]);
+    metricCpuLoadCore1_.set(load[1]);
 
-    a2dp_.set_avrc_metadata_attribute_mask(ESP_AVRC_MD_ATTR_TITLE | ESP_AVRC_MD_ATTR_ARTIST);
-    a2dp_.set_avrc_metadata_callback(avrc_metadata_callback);
-    //a2dp_.set_on_connection_state_changed(a2dp_connection_state_changed);
-    //a2dp_.set_on_volumechange(avrc_volume_change_callback);
-    
-    showWelcomeMessage();
-    M5.Lcd.println(" Starting bluetooth");
+    log_i("CPU load: core 0 = %u%%, core 1 = %u%% (audio task: %s, topology: %s)",
+        load[0], load[1], kAudioTaskEventDriven ? "event-driven" : "1 ms polling", topology_.profile().name);
+}
 
-    a2dp_.start(kDeviceName);
-    deviceMode_ = A2DP;
-    
-    esp_bt_controller_status_t btStatus = esp_bt_controller_get_status();
+/**
+ * Supervises the WiFi connection in radio mode: retries reconnecting during an outage, tells the audio task when
+ * the connection is back and reports the duration of the outage and whether audio has been lost once the stream has settled.
+ * The first reconnect attempt is started by the disconnect callback.
+ */
+void superviseWiFi() {
+    unsigned long outageStart = wifiOutageStart_;
 
-    if (btStatus == ESP_BT_CONTROLLER_STATUS_ENABLED) {
-        M5.Lcd.println(" Ok");
-    }
-    else {
-        M5.Lcd.printf(" Error (%d)\n", (uint8_t) btStatus);
+    if (!wifiOnline_ && outageStart != 0) {
+        if (WiFi.status() == WL_CONNECTED) {
+            wifiOutageDuration_ = millis() - outageStart;
+            wifiRestoreTime_ = millis();
+            wifiOutageStart_ = 0;
+            wifiOnline_ = true;
+            connectError_ = false;
+
+            log_i("WiFi: connection restored after %u ms (buffer %u of %u bytes)", wifiOutageDuration_, audioBufferFilled_, audioBufferSize_);
+
+            sendCommand(CMD_NETWORK_RESTORED);
+        }
+        else {
+            if (millis() - wifiReconnectTime_ > kWifiReconnectInterval) {
+                wifiReconnectTime_ = millis();
+                WiFi.reconnect();
+            }
+
+            connectError_ = (millis() - outageStart > kWifiOutageDisplay);
+            wifiOutageMuted_ = wifiOutageMuted_ || streamErrorDisplay_;
+        }
     }
+    else if (wifiRestoreTime_ != 0) {
+        wifiOutageMuted_ = wifiOutageMuted_ || streamErrorDisplay_;
 
-    stationStr_ = "Bluetooth";
-    stationDisplayFlag_ = true;
+        if (millis() - wifiRestoreTime_ < kWifiOutageReportDelay) {
+            return;
+        }
 
-    vTaskDelay(2000 / portTICK_PERIOD_MS);
+        // Audio has been lost if the buffer ran empty, the stream stalled or could not be played
+        bool lost = metricUnderruns_.value() != wifiOutageUnderruns_ || metricStalls_.value() != wifiOutageStalls_ || wifiOutageMuted_;
 
-    M5.Lcd.fillScreen(TFT_BLACK);
+        log_i("WiFi outage: %u ms, audio lost: %s", wifiOutageDuration_, lost ? "yes" : "no");
 
-    log_d("End: free heap = %d, max alloc heap = %d, min free heap = %d", ESP.getFreeHeap(), ESP.getMaxAllocHeap(), ESP.getMinFreeHeap());
+        metricWifiOutage_.observe(wifiOutageDuration_);
+        (lost ? metricWifiOutagesLost_ : metricWifiOutages_).inc();
+
+        wifiRestoreTime_ = 0;
+    }
 }
 
 /**
- * Currently the API does not support stopping the A2DP mode.
+ * Logs the buffering delay of the bluetooth sink measured since the last report and updates the metrics.
+ * This is the delay added by the sink; the delay of the bluetooth link and the source cannot be measured here.
  */
-void stopA2dp() {
-    log_w("Not possible to stop and cleanup 'a2dp_'!");
+void reportA2dpLatency() {
+    BufferingMonitor::Report report;
+
+    if ( !a2dpMonitor_.takeReport(report) ) {
+        return; // No audio data received
+    }
+
+    log_i("A2DP buffering delay: avg %u ms, min %u ms, max %u ms (DMA %u ms), max data gap %u ms, %u underruns",
+        report.delayAvg, report.delayMin, report.delayMax, report.dmaDelay, report.maxGap, report.underruns);
+
+    metricA2dpDmaDelay_.set(report.dmaDelay);
+    metricA2dpDelayAvg_.set(report.delayAvg);
+    metricA2dpDelayMin_.set(report.delayMin);
+    metricA2dpDelayMax_.set(report.delayMax);
+    metricA2dpGapMax_.set(report.maxGap);
+    metricA2dpUnderruns_.inc(report.underruns);
 }
 
 /**
- * Sends the current content of 'infoStr_' to the IFTTT webhook specified by 'IftttHook::IFTTT_ADD_SONG'.
+ * Samples heap, buffer fill and the stack high-water marks of the tasks into the metrics.
+ * The other metrics are updated where the events occur.
  */
-void sendTitle() {
-    String infoIfttt = infoStr_; // Create local copy of current info
-    
-    if (infoIfttt.isEmpty()) { // Prevent sending empty info
-        log_d("Not sending title to IFTTT because it is empty.");
-        return;
+void updateMetrics() {
+    metricHeapFree_.set(ESP.getFreeHeap());
+    metricHeapMinFree_.set(ESP.getMinFreeHeap());
+    metricHeapMaxAlloc_.set(ESP.getMaxAllocHeap());
+    metricUptime_.set(millis() / 1000);
+
+    if (deviceMode_ == RADIO && !audioMuted_ && !userStationPause_ && audioBufferSize_ > 0) {
+        metricBufferFill_.observe( (uint32_t) ((uint64_t) audioBufferFilled_ * 100 / audioBufferSize_) );
+    }
+
+    unsigned long timeshiftStart = timeshiftStart_;
+
+    // Occupancy while the stream is paused or played time-shifted through the proxy
+    if (deviceMode_ == RADIO && (timeshiftStart != 0 || timeshift_.isOpen())) {
+        metricTimeshiftBuffer_.set(audioBufferFilled_ + timeshift_.bufferedRam());
+        metricTimeshiftSpill_.set(timeshift_.bufferedSpill());
+    }
+    else {
+        metricTimeshiftBuffer_.set(0);
+        metricTimeshiftSpill_.set(0);
     }
 
-    log_d("Sending title to IFTTT");
+    metricTimeshiftAge_.set( (deviceMode_ == RADIO && timeshiftStart != 0) ? (int32_t) (millis() - timeshiftStart) : 0 );
 
-    if ( WiFi.status() == WL_CONNECTED ) {
-        HTTPClient http;
+    // The high-water mark of the ESP-IDF FreeRTOS port is given in bytes; tasks not running keep their last value
+    if (pAudioTask_ != nullptr) {
+        metricStackAudio_.set( uxTaskGetStackHighWaterMark(pAudioTask_) );
+    }
+
+    if (pDisplayTask_ != nullptr) {
+        metricStackDisplay_.set( uxTaskGetStackHighWaterMark(pDisplayTask_) );
+    }
 
-        http.begin(IftttHook::IFTTT_ADD_SONG); // pass IFTTT webhook URL to HTTP client
-        http.addHeader("Content-Type", "application/json");
+    if (standby_.taskHandle() != nullptr) {
+        metricStackStandby_.set( uxTaskGetStackHighWaterMark(standby_.taskHandle()) );
+    }
 
-        String requestBody = "{ \"value1\" : \"" + infoIfttt + "\" }"; // Create json payload
+    if (outbox_.taskHandle() != nullptr) {
+        metricStackOutbox_.set( uxTaskGetStackHighWaterMark(outbox_.taskHandle()) );
+    }
 
-        log_d("Request body:\n%s\n", requestBody.c_str());
+    if (metricsServer_.taskHandle() != nullptr) {
+        metricStackMetrics_.set( uxTaskGetStackHighWaterMark(metricsServer_.taskHandle()) );
+    }
 
-        int httpResponseCode = http.POST(requestBody); // Send data using POST method
+    metricStackLoop_.set( uxTaskGetStackHighWaterMark(nullptr) );
 
-        if (httpResponseCode > 0) { // Success
-       
-            String response = http.getString(); // Retrieve response
-            
-            log_d("HTTP response code: %d", httpResponseCode);
-            log_v("HTTP response:\n%s\n", response.c_str());
-        }
-        else { // Fail
-            log_w("Error occurred while sending HTTP POST: %s\n", http.errorToString(httpResponseCode).c_str());
+    if ( pcmChain_.isActive() ) {
+        uint32_t cyclesPerFrame;
+        uint32_t maxCyclesPerFrame;
+
+        if ( !pcmChain_.checkBudget(cyclesPerFrame, maxCyclesPerFrame) ) {
+            metricDspOverBudget_.inc();
         }
+
+        metricDspCycles_.set(cyclesPerFrame);
+        metricDspBlockMax_.set(maxCyclesPerFrame);
+        metricLimiterGain_.set( limiter_.takeMinGain() * 100 / 32768 );
     }
 }
 
 /**
- * Enable or disable the shutdown circuit of the amplifier.
- * Amplifier: M5Stack SPK hat with PAM8303.
- * - b = true  --> GPIO_0 = 0 : Shutdown enabled
- * - b = false --> GPIO_0 = 1 : Shutdown disabled
+ * Soak test for the metadata strings: publishes a batch of simulated station names and song infos
+ * of varying length the same way as real metadata and tracks the largest allocatable heap block.
+ * Called by the Arduino loop until 'kMetadataSoakUpdates' updates have been done.
  */
-void setAudioShutdown(bool b) {
-    /*
-    if (b) {
-        gpio_set_level(GPIO_NUM_0, 0); // Enable shutdown circuit
-    }
-    else {
-        gpio_set_level(GPIO_NUM_0, 1); // Disable shutdown circuit
+void runMetadataSoakTest() {
+    const uint32_t kBatch = 50; // Updates per loop cycle
+    const char *kSoakText = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+    if (soakUpdates_ == 0) {
+        soakFreeHeapStart_ = ESP.getFreeHeap();
+        soakMaxAllocStart_ = ESP.getMaxAllocHeap();
+        soakMaxAllocMin_ = soakMaxAllocStart_;
     }
-    */
-}
 
-void connectToStation() {
-    // Establish HTTP connection to requested stream URL
-    const char *streamUrl = kStationURLs[stationIndex_].c_str();
+    for (uint32_t i = 0; i < kBatch && soakUpdates_ < kMetadataSoakUpdates; ++i, ++soakUpdates_) {
+        char artist[kEventTextLength];
+        char title[kEventTextLength];
+        char info[kEventTextLength];
 
-    bool success = pAudio_->connecttohost( streamUrl ); // May fail due to wrong host address, socket error or timeout
+        // Lengths vary from a few characters up to more than the capacity (artist and title together)
+        snprintf(artist, sizeof(artist), "Artist %u %.*s", soakUpdates_, (int) (soakUpdates_ % 151), kSoakText);
+        snprintf(title, sizeof(title), "Title %u %.*s", soakUpdates_ * 7, (int) ((soakUpdates_ * 13) % 139), kSoakText);
 
-    if (success) {
-        stationChanged_ = false; // Clear flag
-        streamError_ = false; // Clear in case a connection error occured before
+        formatSongInfo(artist, title, info, sizeof(info));
+        publishSongInfo(info);
 
-        timeConnect_ = millis(); // Store time in order to detect stream errors after connecting
-    }
-    else {
-        stationChanged_ = false; // Clear flag
-        streamError_ = true; // Raise connection error flag
+        if (soakUpdates_ % 10 == 0) {
+            publishStationName(artist);
+        }
 
-        log_d("Failed to connect to host '%s'. WiFi status: %u", streamUrl, WiFi.status());
+        soakMaxAllocMin_ = min(soakMaxAllocMin_, ESP.getMaxAllocHeap());
     }
 
-    // Update buffer state variables
-    audioBufferFilled_ = pAudio_->inBufferFilled(); // 0 after connecting
-    audioBufferSize_ = pAudio_->inBufferFree() + audioBufferFilled_;
+    if (soakUpdates_ % 1000 == 0 || soakUpdates_ == kMetadataSoakUpdates) {
+        log_i("Metadata soak test: %u updates, free heap %u -> %u, max alloc heap %u -> %u (min %u)",
+            soakUpdates_, soakFreeHeapStart_, ESP.getFreeHeap(), soakMaxAllocStart_, ESP.getMaxAllocHeap(), soakMaxAllocMin_);
+    }
 }
 
-void stopPlaying() {
-    pAudio_->stopSong();
-    setAudioShutdown(true); // Turn off amplifier
-    stationChangedMute_ = true; // Mute audio until stream becomes stable
-}
+/**
+ * Processes all pending events from the audio task or the bluetooth callbacks (executed by the Arduino loop).
+ */
+void processEvents() {
+    Event evt;
+
+    while ( eventQueue_.pop(evt) ) {
+        switch (evt.type) {
+            case EVT_STATION_NAME:
+                // Prefer the name from the catalogue (radio mode only)
+                if (deviceMode_ == RADIO && catalogue_.name(stationIndex_)[0] != '\0') {
+                    publishStationName( catalogue_.name(stationIndex_) );
+                }
+                else {
+                    publishStationName(evt.text);
+                }
 
-void audioProcessing(void *p) {
-    while (true) {
-        if (deviceMode_ != RADIO) {
-            vTaskDelay(200 / portTICK_PERIOD_MS);
-            continue;
-        }
+                if (deviceMode_ == RADIO) {
+                    setDisplayPlayState(true);
+                }
+                break;
 
-        // Process requested change of audio volume
-        if (volumeCurrentChangedFlag_) {
-            pAudio_->setVolume(volumeCurrent_);
-            volumeCurrentChangedFlag_ = false; // Clear flag
-        }
-        
-        // Proces requested station change
-        if (stationChanged_) {
-            stopPlaying();
-            connectToStation();
-        }
+            case EVT_SONG_INFO:
+                publishSongInfo(evt.text);
+                break;
 
-        if (userStationPauseChanged_) {
-            if (userStationPause_) {
-                stopPlaying();
-            }
-            else {
-                connectToStation();
-            }
-            userStationPauseChanged_ = false;
-        }
+            case EVT_UNMUTED:
+                audioMuted_ = false; // The audio task fades in to the normal volume
+                streamErrorDisplay_ = false;
 
-        // After the buffer has been filled up sufficiently enable audio output
-        if (stationChangedMute_ && !userStationPause_) {
-            if ( audioBufferFilled_ > 0.9f * audioBufferSize_) {
-                setAudioShutdown(false);
-                stationChangedMute_ = false;
-                streamError_ = false;
-            }
-            else {
-                // If the stream does not build up within a few seconds something is wrong with the connection
-                if ( millis() - timeConnect_ > 3000 ) {
-                    if (!streamError_) {
-                        Serial.printf("Audio buffer low: %u of %u bytes.\n", audioBufferFilled_, audioBufferSize_);
-                        streamError_ = true; // Raise connection error flag
-                    }
+                volumeCurrent_ = volumeNormal_;
+                setDisplayVolume(volumeCurrent_);
+
+                // The station plays: restore it after the next boot
+                settings_.setStation(stationIndex_);
+                settings_.setVolume(volumeNormal_);
+                break;
+
+            case EVT_STREAM_ERROR:
+                streamErrorDisplay_ = true;
+
+                // The audio task fades in again after the stream watchdog has recovered the stream
+                if (!audioMuted_) {
+                    audioMuted_ = true;
+                    volumeCurrent_ = 0;
+
+                    setDisplayVolume(volumeCurrent_);
                 }
-            }
+                break;
         }
+    }
+}
 
-        // Let 'esp32-audioI2S' library process the web radio stream data
-        pAudio_->loop();
+void loop() {
+    // Take the button events queued by the interrupt handlers
+    buttons_.update();
 
-        audioBufferFilled_ = pAudio_->inBufferFilled(); // Update used buffer capacity
-        
-        vTaskDelay(1 / portTICK_PERIOD_MS); // Let other tasks execute
+    // Take over station name, song info and stream state
+    processEvents();
+
+    if (kMetadataSoakTest && soakUpdates_ < kMetadataSoakUpdates) {
+        runMetadataSoakTest();
     }
-}
 
-void setup() {
-    /*
-    // Setup GPIO ports for SPK hat
-    gpio_set_direction(GPIO_NUM_0, GPIO_MODE_OUTPUT); // Shutdown circuit of M5Stack SPK hat
-    setAudioShutdown(true);
+    if ( kCpuLoadReport && (millis() - cpuLoadReportTime_ > kCpuLoadReportInterval) ) {
+        cpuLoadReportTime_ = millis();
+        reportCpuLoad();
+    }
 
-    gpio_set_direction(GPIO_NUM_26, GPIO_MODE_OUTPUT_OD); // Configure GPIO_26 for DAC output (DAC_CHANNEL_2)
-    //dac_output_enable(DAC_CHANNEL_2);
-    //dac_output_voltage(DAC_CHANNEL_2, 0);
-    */
+    if (millis() - metricsUpdateTime_ > kMetricsUpdateInterval) {
+        metricsUpdateTime_ = millis();
+        updateMetrics();
+    }
 
-    log_d("IDF version = %s", ESP.getSdkVersion());
-    log_d("Total heap = %d", ESP.getHeapSize());
-    log_d("Free heap = %d", ESP.getFreeHeap());
-    log_d("Max alloc heap = %d", ESP.getMaxAllocHeap());
+    // Serial console: 'm' prints the metrics, 'c' records the current stream, 'r' replays the recording as decode benchmark
+    if (Serial.available() > 0) {
+        switch ( Serial.read() ) {
+            case 'm':
+                Metric::writeAll(Serial);
+                break;
 
-    // Initialize M5StickC
-    M5.begin();
-    M5.Lcd.setRotation(3);
-    
-    if ( EEPROM.begin(1) ) {
-        uint8_t mode = EEPROM.readByte(0);
+            case 'c':
+                if (deviceMode_ == RADIO && !userStationPause_) {
+                    sendCommand(CMD_CAPTURE);
+                }
+                break;
 
-        log_d("EEPROM.readByte(0) = %d", mode);
+            case 'r':
+                if (deviceMode_ == RADIO && !userStationPause_) {
+                    sendCommand(CMD_REPLAY, stationIndex_);
 
-        if (mode == 2) {
-            startA2dp();
-        }
-        else {
-            startRadio();
+                    audioMuted_ = true; // Set until the audio task has unmuted the station again
+                    volumeCurrent_ = 0;
+                    setDisplayVolume(volumeCurrent_);
+                }
+                break;
         }
     }
-    else {
-        log_w("EEPROM.begin() returned 'false'!");
-        startRadio();
-    }
 
-    // Update button state
-    buttonBlue.read();
-    buttonRed.read();
-    M5.Axp.GetBtnPress();
+    if (deviceMode_ == RADIO) {
+        superviseWiFi();
+    }
 
-    // Initialize sprite for station name
-    stationSprite_.setTextFont(1);
-    stationSprite_.setTextSize(2);
-    stationSprite_.setTextColor(TFT_ORANGE);
-    stationSprite_.setTextWrap(false);
-    stationSprite_.createSprite(M5.Lcd.width(), stationSprite_.fontHeight());
+    // Button B: switch mode (internet radio <-> a2dp sink)
+    if (buttons_.wasReleased(kButtonB)) {
+        log_d("Button B press detected.");
 
-    // Initialize sprite for stream info (artist/song etc.)
-    titleSprite_.setTextFont(2);
-    titleSprite_.setTextSize(1);
-    titleSprite_.setTextColor(TFT_CYAN);
-    titleSprite_.setTextWrap(false);
-    titleSprite_.createSprite(kTitleSpriteWidth, titleSprite_.fontHeight());
+        switchMode();
+    }
 
-    M5.Axp.ScreenBreath(9);
-}
+    // Red button (long press): bluetooth mode: select the next latency profile and restart the sink,
+    // otherwise: select the next task topology profile and reboot device
+    if (buttons_.wasReleasefor(kButtonRed, 2000)) {
+        log_d("Button 'red' long press detected.");
 
-void loop() {
-    // Let M5StickC update its state
-    M5.update();
-    buttonBlue.read();
-    buttonRed.read();
+        if (deviceMode_ == A2DP) {
+            settings_.setLatencyProfile((settings_.latencyProfile() + 1) % kNumA2dpLatencyProfiles);
 
-    // Button B: switch mode and reboot device (internet radio <-> a2dp sink)
-    if (M5.BtnB.wasReleased()) {
-        log_d("Button B press detected.")
+            stopA2dp();
+            startA2dp(false);
+        }
+        else {
+            topology_.select((topology_.index() + 1) % TaskTopology::kNumProfiles);
 
-        if (deviceMode_ == RADIO) {
-            EEPROM.writeByte(0, 2); // Enter A2DP mode after restart
-            EEPROM.commit();
+            if (deviceMode_ == RADIO) {
+                stopRadio(); // Close connections and clean up
+            }
+            ESP.restart();
+        }
+    }
 
-            stopRadio(); // Close connections and clean up
+    // Finish the current topology benchmark run after a fixed time of playing
+    if (topology_.isBenchmarkRunning() && !audioMuted_) {
+        if (benchmarkStartTime_ == 0) {
+            benchmarkStartTime_ = millis();
         }
-        else {
-            EEPROM.writeByte(0, 1); // Enter internet radio mode after restart
-            EEPROM.commit();
+        else if (millis() - benchmarkStartTime_ > kTopologyBenchmarkDuration) {
+            TaskTopology::BenchmarkResult result = {
+                (uint32_t) (millis() - benchmarkStartTime_),
+                metricUnderruns_.value(),
+                metricLoopGap_.count() > 0 ? (uint32_t) (metricLoopGap_.sum() / metricLoopGap_.count()) : 0,
+                (uint32_t) metricLoopGapMax_.value()
+            };
+
+            if ( topology_.finishBenchmarkRun(result) ) {
+                stopRadio(); // Continue with the next profile after reboot
+                ESP.restart();
+            }
         }
-        ESP.restart();
     }
 
     // Is the device mode 'internet radio' ?
     if (deviceMode_ == RADIO) {
 
         // Button A: Switch to next station
-        if (M5.BtnA.wasPressed()) {
+        if (buttons_.wasPressed(kButtonA)) {
 
             log_d("Button A press detected.");
             
@@ -728,12 +2779,12 @@ void loop() {
                 // WiFi may have become idle
                 if (WiFi.status() == WL_CONNECTED) {
                     userStationPause_ = false;
-                    userStationPauseChanged_ = true;
+                    sendCommand(CMD_RESUME, stationIndex_);
                 }
                 else {
                     if ( connectWiFi(10000) ) {
                         userStationPause_ = false;
-                        userStationPauseChanged_ = true;
+                        sendCommand(CMD_RESUME, stationIndex_);
 
                         connectError_ = false;
                     }
@@ -745,149 +2796,123 @@ void loop() {
             else {
                 log_d("Change station.");
 
-                // Turn down volume
+                // Muted by the audio task until the new station fades in
                 volumeCurrent_ = 0;
-                volumeCurrentF_ = 0.0f;
-                volumeCurrentChangedFlag_ = true; // Raise flag for the audio task
 
-                showVolume(volumeCurrent_);
+                setDisplayVolume(volumeCurrent_);
 
                 // Advance station index to next station
-                stationIndex_ = (stationIndex_ + 1) % kNumStations;
-                stationChanged_ = true; // Raise flag for the audio task
+                stationIndex_ = (stationIndex_ + 1) % catalogue_.count();
+                sendCommand(CMD_SET_STATION, stationIndex_);
 
-                // Erase station name
-                stationStr_ = "";
-                stationDisplayFlag_ = true; // Raise flag for display update routine
+                audioMuted_ = true; // Set until the audio task has unmuted the new station
+                streamErrorDisplay_ = false;
 
-                // Erase stream info
-                infoStr_ = "";
-                infoDisplayFlag_ = true; // Raise flag for display update routine
+                // Show the name from the catalogue right away (empty if the catalogue has none)
+                publishStationName( catalogue_.name(stationIndex_) );
 
-                showPlayState(false);
-            }
-        }
-        else {
-            // Increase volume gradually after station change
-            if (!stationChangedMute_ && volumeCurrent_ < volumeNormal_) {
-                volumeCurrentF_ += 0.25;
-                volumeCurrent_ = (uint8_t) volumeCurrentF_;
-                volumeCurrentChangedFlag_ = true; // Raise flag for the audio task
+                // Erase stream info
+                publishSongInfo("");
 
-                showVolume(volumeCurrent_);
+                setDisplayPlayState(false);
             }
         }
 
-        unsigned long curTime = millis();
-
-        // Check every 200 ms whether power button has been pressed
-        if (curTime - pwrBtnCheckTime_ > 200) {
-            uint8_t pwrBtnState = M5.Axp.GetBtnPress();
-
-            pwrBtnCheckTime_ = curTime;
-
-            if (pwrBtnState & 0x01) {
-                log_d("Pwr button long press detected.");
-            }
-
-            if (pwrBtnState & 0x02) {
-                log_d("Pwr button press detected.");
-            }
-
-            // Stop playing if (press XOR long press) has been detected
-            if ( !(pwrBtnState & 0x01) != !(pwrBtnState & 0x02) ) { // if both occur simultaneously it is an i2c error
+        // Power button (press or long press): pause playing
+        if (buttons_.wasPressed(kButtonPwr)) {
+            log_d("Pwr button press detected.");
 
-                log_d("Pause.");
-                
-                if (!userStationPause_) {
-                    userStationPause_ = true; // Set status to 'pause'
-                    userStationPauseChanged_ = true; // Raise flag that status has changed
+            log_d("Pause.");
+            
+            if (!userStationPause_) {
+                userStationPause_ = true; // Set status to 'pause'
+                sendCommand(CMD_PAUSE);
 
-                    // Turn down volume while paused
-                    volumeCurrent_ = 0;
-                    volumeCurrentF_ = 0.0f;
-                    volumeCurrentChangedFlag_ = true; // Raise flag for the audio task
+                audioMuted_ = true; // Set until the audio task has unmuted the resumed station
 
-                    showVolume(volumeCurrent_); // Show volume on display
+                // The audio task fades out and pauses the stream
+                volumeCurrent_ = 0;
 
-                    // Erase stream info
-                    infoStr_ = "";
-                    infoDisplayFlag_ = true; // Raise flag for display update routine
+                setDisplayVolume(volumeCurrent_); // Show volume on display
 
-                    showPlayState(false);
+                // Erase stream info (kept for a timeshift pause, which continues the song)
+                if (!kTimeshiftPause) {
+                    publishSongInfo("");
                 }
-                else {
-                    log_d("Already paused - nothing to do.");
-                }
-            }
-        }
 
-        // Notify user in case no data arrives through the stream
-        if (connectError_ || streamError_) {
-            if (connectError_) {
-                stationSprite_.print("WiFi unavailable");
+                setDisplayPlayState(false);
             }
-
-            if (streamError_) {
-                stationSprite_.print("Stream unavailable");
+            else {
+                log_d("Already paused - nothing to do.");
             }
+        }
 
-            stationSprite_.fillSprite(TFT_RED);
-            stationSprite_.setTextColor(TFT_WHITE);
-            stationSprite_.setCursor(4, 0);
-
-            stationSprite_.pushSprite(0, 2); // Render sprite to screen
-
-            vTaskDelay(200 / portTICK_PERIOD_MS); // Wait until next cycle
+        // Notify user in case no data arrives through the stream
+        if (connectError_) {
+            setDisplayError("WiFi unavailable");
+        }
+        else if (streamErrorDisplay_) {
+            setDisplayError("Stream unavailable");
         }
         else {
-            // Update the station name if flag is raised
-            if (stationDisplayFlag_) {
-                showStation();
-                stationDisplayFlag_ = false; // Clear update flag
-
-                showPlayState(true);
-            }
-
-            // Update song info (usually artist and title)
-            showSongInfo();
+            setDisplayError(nullptr);
 
             // Send song info to IFTTT webhook after the blue button was pressed
-            if (buttonBlue.wasPressed()) {
-                log_d("Button 'blue' press detected.")
+            if (buttons_.wasPressed(kButtonBlue)) {
+                log_d("Button 'blue' press detected.");
 
                 sendTitle();
             }
-
-            vTaskDelay(20 / portTICK_PERIOD_MS); // Wait until next cycle
         }
+
+        ulTaskNotifyTake(pdTRUE, 20 / portTICK_PERIOD_MS); // Wait until next cycle (a button event wakes up earlier)
     }
     else {
         // Is the device in bluetooth a2dp sink mode?
         if (deviceMode_ == A2DP) {
-            // Update the station name if flag is raised
-            if (stationDisplayFlag_) {
-                showStation();
-                stationDisplayFlag_ = false; // Clear update flag
+            // Show the volume set by the bluetooth source (scaled to the volume steps of the radio)
+            int16_t a2dpVolume = a2dpVolume_;
+
+            if (a2dpVolume >= 0) {
+                a2dpVolume_ = -1;
+                volumeCurrent_ = (uint8_t) (a2dpVolume * kVolumeMax / A2dpGainControl::kVolumeMax);
+                setDisplayVolume(volumeCurrent_);
             }
 
-            showSongInfo();
+            if (millis() - a2dpLatencyReportTime_ > kA2dpLatencyReportInterval) {
+                a2dpLatencyReportTime_ = millis();
+                reportA2dpLatency();
+            }
 
-            /*if (volumeCurrentChangedFlag_) {
-                showVolume(volumeCurrent_);
-            }*/
-            
-            showPlayState(a2dp_.get_audio_state() == ESP_A2D_AUDIO_STATE_STARTED);
-            vTaskDelay(20 / portTICK_PERIOD_MS); // Wait until next cycle
+            setDisplayPlayState(a2dp_.get_audio_state() == ESP_A2D_AUDIO_STATE_STARTED);
+            ulTaskNotifyTake(pdTRUE, 20 / portTICK_PERIOD_MS); // Wait until next cycle (a button event wakes up earlier)
         }
         else {
             // Neither radio mode nor A2DP mode
-            vTaskDelay(200 / portTICK_PERIOD_MS);
+            ulTaskNotifyTake(pdTRUE, 200 / portTICK_PERIOD_MS);
         }
     }
 }
 
 // optional
+/**
+ * Sample hook of the 'esp32-audioI2S' library: applies the PCM chain and the gain stage to each stereo frame before it is written to I2S.
+ * The library hands over frame by frame; the PCM chain collects them and processes a block at a time ('PcmChain::kBlockFrames' delay).
+ */
+void audio_process_i2s(uint32_t *sample, bool *continueI2S) {
+    int16_t *pFrame = (int16_t*) sample;
+
+    pcmChain_.processFrame(pFrame[0], pFrame[1]);
+    gainRamp_.processFrame(pFrame[0], pFrame[1]);
+
+    // Null sink while the capture is replayed ('replayCapture')
+    if (replayActive_) {
+        ++replayFrames_;
+    }
+
+    *continueI2S = !replayActive_; // Let the library write the frame
+}
+
 void audio_info(const char *info){
     Serial.print("info        "); Serial.println(info);
 }
@@ -898,18 +2923,18 @@ void audio_eof_mp3(const char *info){  //end of file
     // Serial.print("eof_mp3     ");Serial.println(info);
 }
 void audio_showstation(const char *info){
-    stationStr_ = info;
-    stationDisplayFlag_ = true; // Raise flag for the display update routine
+    sendEvent(EVT_STATION_NAME, info); // Pass station name to the display update routine
 
     // Serial.print("station     ");Serial.println(info);
 }
 void audio_showstreamtitle(const char *info){
-    infoStr_ = info;
-    infoDisplayFlag_ = true; // Raise flag for the display update routine
+    sendEvent(EVT_SONG_INFO, info); // Pass song info to the display update routine
 
     // Serial.print("streamtitle ");Serial.println(info);
 }
 void audio_bitrate(const char *info){
+    unmutePolicy_.setBitrate(info); // Reference for the data rate measurement of the unmute policy
+
     // Serial.print("bitrate     ");Serial.println(info);
 }
 void audio_commercial(const char *info){  //duration in sec
@@ -919,6 +2944,12 @@ void audio_icyurl(const char *info){  //homepage
     // Serial.print("icyurl      ");Serial.println(info);
 }
 void audio_lasthost(const char *info){  //stream URL played
+    // Remember the stream URL the library has taken from the playlist of the current station
+    if ( connectViaPlaylist_ && !PlaylistCache::isPlaylistUrl(info) ) {
+        playlistCache_.store(catalogue_.url(audioStationIndex_), info);
+        connectViaPlaylist_ = false;
+    }
+
     // Serial.print("lasthost    ");Serial.println(info);
 }
 void audio_eof_speech(const char *info){
@@ -928,27 +2959,19 @@ void audio_eof_speech(const char *info){
 void avrc_metadata_callback(uint8_t id, const uint8_t *text) {
     switch (id) {
         case ESP_AVRC_MD_ATTR_TITLE:
-            titleStr_ = (char*) text;
+            strlcpy(titleStr_, (const char*) text, sizeof(titleStr_));
             break;
         
         case ESP_AVRC_MD_ATTR_ARTIST:
-            artistStr_ = (char*) text;
+            strlcpy(artistStr_, (const char*) text, sizeof(artistStr_));
             break;
     }    
 
-    if ( artistStr_.isEmpty() ) {
-        infoStr_ = titleStr_;
-    }
-    else {
-        if ( titleStr_.isEmpty() ) {
-            infoStr_ = artistStr_;
-        }
-        else {
-            infoStr_ = artistStr_ + " - " + titleStr_;
-        }
-    }
+    char info[kEventTextLength];
+
+    formatSongInfo(artistStr_, titleStr_, info, sizeof(info));
     
-    infoDisplayFlag_ = true; // Raise flag for the display update routine
+    sendEvent(EVT_SONG_INFO, info); // Pass song info to the display update routine
     // Serial.printf("==> AVRC metadata rsp: attribute id 0x%x, %s\n", id, text);
 }
 
@@ -956,17 +2979,32 @@ void a2dp_connection_state_changed(esp_a2d_connection_state_t state, void*) {
 
     log_d("Connection state: %d", state);
 
-    if (state != ESP_A2D_CONNECTION_STATE_CONNECTED) {
-        infoStr_ = "not connected";
-        infoDisplayFlag_ = true; // Raise flag for the display update routine
+    if (state == ESP_A2D_CONNECTION_STATE_CONNECTED) {
+        // Fade in and measure the buffering of the new link from the start
+        a2dpGain_.reset();
+        a2dpMonitor_.begin(44100, a2dpDmaFrames_);
+    }
+    else {
+        sendEvent(EVT_SONG_INFO, "not connected"); // Pass info to the display update routine
     }
 }
 
 void avrc_volume_change_callback(int vol) {
-    volumeCurrent_ = vol;
-    volumeCurrentChangedFlag_ = true;
+    a2dpVolume_ = constrain(vol, 0, (int) A2dpGainControl::kVolumeMax); // Shown by the main loop
 }
 
 void wifiCallbackStaDisconnected(WiFiEvent_t event, WiFiEventInfo_t info) {
     log_d("WiFi: Station disconnected. Reason: %u", info.disconnected.reason);
+
+    // Start reconnecting right away while the audio task plays on from the buffer (further attempts by 'superviseWiFi')
+    if (deviceMode_ == RADIO && wifiOnline_) {
+        wifiOutageUnderruns_ = metricUnderruns_.value();
+        wifiOutageStalls_ = metricStalls_.value();
+        wifiOutageMuted_ = false;
+        wifiReconnectTime_ = millis();
+        wifiOutageStart_ = max(millis(), 1UL);
+        wifiOnline_ = false;
+
+        WiFi.reconnect();
+    }
 }
\ No newline at end of file
@@ -0,0 +1,308 @@
+/**
+    Metrics:
+    Counters, gauges and histograms of the streaming pipeline, written
+    in the Prometheus text format (serial console and HTTP '/metrics').
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <WebServer.h>
+#include "Metrics.h"
+
+Metric *Metric::pFirst_ = nullptr;
+Metric *Metric::pLast_ = nullptr;
+
+const uint8_t Histogram::kMaxBuckets;
+
+Metric::Metric(const char *name, const char *help, const char *type, const char *labels) :
+    pNext_(nullptr),
+    name_(name),
+    help_(help),
+    type_(type),
+    labels_(labels)
+{
+    // Append to the list, so the metrics are written in the order of definition
+    if (pLast_ == nullptr) {
+        pFirst_ = this;
+    }
+    else {
+        pLast_->pNext_ = this;
+    }
+
+    pLast_ = this;
+}
+
+void Metric::writeAll(Print &out) {
+    const char *prevName = "";
+
+    for (const Metric *pMetric = pFirst_; pMetric != nullptr; pMetric = pMetric->pNext_) {
+        // Metrics with several label sets are described once
+        if (strcmp(pMetric->name_, prevName) != 0) {
+            char line[160];
+
+            snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n", pMetric->name_, pMetric->help_, pMetric->name_, pMetric->type_);
+            out.print(line);
+
+            prevName = pMetric->name_;
+        }
+
+        pMetric->writeSamples(out);
+    }
+}
+
+void Metric::writeSample(Print &out, const char *suffix, const char *extraLabel, long long value) const {
+    char line[160];
+    bool hasLabels = (labels_ != nullptr);
+    bool hasExtra = (extraLabel != nullptr);
+
+    snprintf(line, sizeof(line), "%s%s%s%s%s%s%s %lld\n",
+        name_, suffix,
+        (hasLabels || hasExtra) ? "{" : "",
+        hasLabels ? labels_ : "",
+        (hasLabels && hasExtra) ? "," : "",
+        hasExtra ? extraLabel : "",
+        (hasLabels || hasExtra) ? "}" : "",
+        value);
+
+    out.print(line);
+}
+
+Counter::Counter(const char *name, const char *help, const char *labels) :
+    Metric(name, help, "counter", labels),
+    value_(0)
+{
+}
+
+void Counter::writeSamples(Print &out) const {
+    writeSample(out, "", nullptr, value_);
+}
+
+Gauge::Gauge(const char *name, const char *help, const char *labels) :
+    Metric(name, help, "gauge", labels),
+    value_(0)
+{
+}
+
+void Gauge::setMax(int32_t value) {
+    int32_t current = value_;
+
+    while ( value > current && !value_.compare_exchange_weak(current, value) );
+}
+
+void Gauge::writeSamples(Print &out) const {
+    writeSample(out, "", nullptr, value_);
+}
+
+Histogram::Histogram(const char *name, const char *help, const uint32_t *bounds, uint8_t numBounds) :
+    Metric(name, help, "histogram", nullptr),
+    bounds_(bounds),
+    numBounds_(min(numBounds, kMaxBuckets)),
+    count_(0),
+    sum_(0),
+    mux_(portMUX_INITIALIZER_UNLOCKED)
+{
+    memset(counts_, 0, sizeof(counts_));
+}
+
+void Histogram::observe(uint32_t value) {
+    uint8_t bucket = 0;
+
+    while (bucket < numBounds_ && value > bounds_[bucket]) {
+        ++bucket;
+    }
+
+    portENTER_CRITICAL(&mux_);
+    counts_[bucket]++;
+    count_++;
+    sum_ += value;
+    portEXIT_CRITICAL(&mux_);
+}
+
+uint32_t Histogram::count() const {
+    portENTER_CRITICAL(&mux_);
+    uint32_t count = count_;
+    portEXIT_CRITICAL(&mux_);
+
+    return count;
+}
+
+uint64_t Histogram::sum() const {
+    portENTER_CRITICAL(&mux_);
+    uint64_t sum = sum_;
+    portEXIT_CRITICAL(&mux_);
+
+    return sum;
+}
+
+void Histogram::writeSamples(Print &out) const {
+    uint32_t counts[kMaxBuckets + 1];
+    uint32_t count;
+    uint64_t sum;
+
+    // Consistent snapshot (printing is too slow for a critical section)
+    portENTER_CRITICAL(&mux_);
+    memcpy(counts, counts_, sizeof(counts));
+    count = count_;
+    sum = sum_;
+    portEXIT_CRITICAL(&mux_);
+
+    uint32_t cumulative = 0;
+    char label[24];
+
+    for (uint8_t i = 0; i < numBounds_; ++i) {
+        cumulative += counts[i];
+
+        snprintf(label, sizeof(label), "le=\"%u\"", bounds_[i]);
+        writeSample(out, "_bucket", label, cumulative);
+    }
+
+    writeSample(out, "_bucket", "le=\"+Inf\"", count);
+    writeSample(out, "_sum", nullptr, sum);
+    writeSample(out, "_count", nullptr, count);
+}
+
+/**
+ * Collects the output in a small buffer and sends it as HTTP chunks,
+ * so the response does not need to be assembled in memory.
+ */
+class ChunkWriter : public Print {
+    public:
+        ChunkWriter(WebServer &server) : server_(server), length_(0) {}
+
+        ~ChunkWriter() { sendChunk(); }
+
+        size_t write(uint8_t c) override {
+            if (length_ == sizeof(buffer_)) {
+                sendChunk();
+            }
+
+            buffer_[length_++] = (char) c;
+
+            return 1;
+        }
+
+    private:
+        // Sends the buffered output as one chunk
+        void sendChunk() {
+            if (length_ > 0) {
+                server_.sendContent_P(buffer_, length_);
+                length_ = 0;
+            }
+        }
+
+        WebServer &server_;
+        char buffer_[512];
+        size_t length_;
+};
+
+const uint32_t MetricsServer::kPollInterval;
+const uint32_t MetricsServer::kStopTimeout;
+
+MetricsServer::MetricsServer(uint16_t port) :
+    port_(port),
+    pServer_(nullptr),
+    pTask_(nullptr),
+    stop_(false)
+{
+}
+
+bool MetricsServer::begin(UBaseType_t priority, BaseType_t core, uint32_t stackSize) {
+    if (pTask_ != nullptr) {
+        if (stop_) {
+            log_w("Metrics server task still stopping.");
+            return false;
+        }
+
+        return true;
+    }
+
+    if (pServer_ == nullptr) {
+        pServer_ = new WebServer(port_);
+
+        pServer_->on("/metrics", HTTP_GET, [this]() { handleMetrics(); });
+        pServer_->begin();
+    }
+
+    stop_ = false;
+
+    TaskHandle_t pTask = nullptr;
+
+    if (xTaskCreatePinnedToCore(task, "Metrics server task", stackSize, this, priority, &pTask, core) != pdPASS) {
+        return false;
+    }
+
+    pTask_ = pTask;
+
+    log_i("Metrics available on port %u", port_);
+
+    return true;
+}
+
+bool MetricsServer::end() {
+    if (pTask_ != nullptr) {
+        // Let the task complete the current request and end itself
+        stop_ = true;
+        xTaskNotifyGive(pTask_);
+
+        unsigned long startTime = millis();
+
+        while (pTask_ != nullptr && millis() - startTime < kStopTimeout) {
+            vTaskDelay(10 / portTICK_PERIOD_MS);
+        }
+
+        // The task may still use the server
+        if (pTask_ != nullptr) {
+            log_w("Metrics server task has not ended within %u ms.", kStopTimeout);
+            return false;
+        }
+    }
+
+    if (pServer_ != nullptr) {
+        pServer_->stop();
+
+        delete pServer_;
+        pServer_ = nullptr;
+    }
+
+    return true;
+}
+
+void MetricsServer::task(void *p) {
+    MetricsServer *pMetricsServer = (MetricsServer*) p;
+    const TickType_t pollTicks = max( (TickType_t) (kPollInterval / portTICK_PERIOD_MS), (TickType_t) 1 );
+
+    while (!pMetricsServer->stop_) {
+        pMetricsServer->pServer_->handleClient();
+
+        ulTaskNotifyTake(pdTRUE, pollTicks); // 'end' wakes up early
+    }
+
+    pMetricsServer->pTask_ = nullptr;
+    vTaskDelete(nullptr);
+}
+
+void MetricsServer::handleMetrics() {
+    pServer_->setContentLength(CONTENT_LENGTH_UNKNOWN);
+    pServer_->send(200, "text/plain; version=0.0.4", "");
+
+    {
+        ChunkWriter writer(*pServer_);
+
+        Metric::writeAll(writer);
+    }
+
+    pServer_->sendContent(""); // Terminating chunk
+}
@@ -0,0 +1,198 @@
+/**
+    PcmChain:
+    Chain of fixed-point processing stages applied to the PCM data before
+    it is written to the DAC, with a check of the CPU cycle budget.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PcmChain.h"
+
+const size_t PcmChain::kBlockFrames;
+
+PcmChain::PcmChain(uint32_t cycleBudget, uint32_t blockCycleBudget) :
+    pFirst_(nullptr),
+    pLast_(nullptr),
+    sampleRate_(0),
+    cycleBudget_(cycleBudget),
+    blockCycleBudget_(blockCycleBudget),
+    cycles_(0),
+    frames_(0),
+    maxCycles_(0),
+    overBudget_(false),
+    framePos_(0)
+{
+    memset(frameOutput_, 0, sizeof(frameOutput_));
+}
+
+void PcmChain::add(PcmStage *pStage) {
+    pStage->pNext_ = nullptr;
+
+    if (pLast_ == nullptr) {
+        pFirst_ = pStage;
+    }
+    else {
+        pLast_->pNext_ = pStage;
+    }
+
+    pLast_ = pStage;
+
+    if (sampleRate_ > 0) {
+        pStage->setSampleRate(sampleRate_);
+    }
+}
+
+void PcmChain::setSampleRate(uint32_t sampleRate) {
+    if (sampleRate == 0 || sampleRate == sampleRate_) {
+        return;
+    }
+
+    sampleRate_ = sampleRate;
+
+    for (PcmStage *pStage = pFirst_; pStage != nullptr; pStage = pStage->pNext_) {
+        pStage->setSampleRate(sampleRate);
+    }
+}
+
+void PcmChain::reset() {
+    for (PcmStage *pStage = pFirst_; pStage != nullptr; pStage = pStage->pNext_) {
+        pStage->reset();
+    }
+
+    memset(frameOutput_, 0, sizeof(frameOutput_));
+    framePos_ = 0;
+}
+
+void PcmChain::process(int16_t *samples, size_t frames) {
+    if (pFirst_ == nullptr) {
+        return;
+    }
+
+    for (size_t offset = 0; offset < frames; offset += kBlockFrames) {
+        size_t count = min(frames - offset, kBlockFrames);
+        int16_t *pSamples = samples + 2 * offset;
+        uint32_t startCycles = ESP.getCycleCount();
+
+        for (size_t i = 0; i < 2 * count; ++i) {
+            block_[i] = pSamples[i];
+        }
+
+        run(block_, count);
+
+        for (size_t i = 0; i < 2 * count; ++i) {
+            pSamples[i] = saturate(block_[i]);
+        }
+
+        measure(ESP.getCycleCount() - startCycles, count);
+    }
+}
+
+void PcmChain::processFrame(int16_t &left, int16_t &right) {
+    if (pFirst_ == nullptr) {
+        return;
+    }
+
+    // Swap the new frame for the processed one at the same position of the previous block
+    size_t index = 2 * framePos_;
+
+    frameBlock_[index] = left;
+    frameBlock_[index + 1] = right;
+    left = frameOutput_[index];
+    right = frameOutput_[index + 1];
+
+    if (++framePos_ < kBlockFrames) {
+        return;
+    }
+
+    // Block complete: run the stages once for all frames
+    uint32_t startCycles = ESP.getCycleCount();
+
+    run(frameBlock_, kBlockFrames);
+
+    for (size_t i = 0; i < 2 * kBlockFrames; ++i) {
+        frameOutput_[i] = saturate(frameBlock_[i]);
+    }
+
+    measure(ESP.getCycleCount() - startCycles, kBlockFrames);
+    framePos_ = 0;
+}
+
+void PcmChain::processStage(PcmStage *pStage, int16_t *samples, size_t frames) {
+    int32_t block[2 * kBlockFrames];
+
+    for (size_t offset = 0; offset < frames; offset += kBlockFrames) {
+        size_t count = min(frames - offset, kBlockFrames);
+        int16_t *pSamples = samples + 2 * offset;
+
+        for (size_t i = 0; i < 2 * count; ++i) {
+            block[i] = pSamples[i];
+        }
+
+        pStage->process(block, count);
+
+        for (size_t i = 0; i < 2 * count; ++i) {
+            pSamples[i] = saturate(block[i]);
+        }
+    }
+}
+
+bool PcmChain::checkBudget(uint32_t &cyclesPerFrame, uint32_t &maxCyclesPerFrame) {
+    // Read without locking: the counters are only a measurement, a frame more or less does not matter
+    uint32_t cycles = cycles_;
+    uint32_t frames = frames_;
+
+    maxCyclesPerFrame = maxCycles_;
+
+    cycles_ = 0;
+    frames_ = 0;
+    maxCycles_ = 0;
+
+    cyclesPerFrame = frames > 0 ? cycles / frames : 0;
+
+    bool overBudget = (cyclesPerFrame > cycleBudget_ || maxCyclesPerFrame > blockCycleBudget_);
+
+    // Log only when the state changes, the check is done periodically
+    if (overBudget && !overBudget_) {
+        log_w("PCM chain: %u cycles/frame (slowest block %u) exceed the budget of %u cycles/frame (block %u)",
+            cyclesPerFrame, maxCyclesPerFrame, cycleBudget_, blockCycleBudget_);
+    }
+    else if (!overBudget && overBudget_ && frames > 0) {
+        log_i("PCM chain: back within the budget (%u cycles/frame, slowest block %u)", cyclesPerFrame, maxCyclesPerFrame);
+    }
+
+    if (frames > 0) {
+        overBudget_ = overBudget;
+    }
+
+    return !overBudget;
+}
+
+void PcmChain::run(int32_t *samples, size_t frames) {
+    for (PcmStage *pStage = pFirst_; pStage != nullptr; pStage = pStage->pNext_) {
+        pStage->process(samples, frames);
+    }
+}
+
+void PcmChain::measure(uint32_t cycles, size_t frames) {
+    uint32_t cyclesPerFrame = cycles / frames;
+
+    cycles_ += cycles;
+    frames_ += frames;
+
+    if (cyclesPerFrame > maxCycles_) {
+        maxCycles_ = cyclesPerFrame;
+    }
+}
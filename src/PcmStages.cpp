@@ -0,0 +1,220 @@
+/**
+    PcmStages:
+    Fixed-point processing stages for the PCM chain: biquad EQ,
+    peak limiter and stereo-to-mono downmix.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PcmStages.h"
+
+// Scale of the biquad coefficients (Q28 allows coefficients up to +/-8)
+static const float kCoefScale = (float) (1 << 28);
+
+BiquadStage::BiquadStage(Type type, float frequency, float gain, float q) :
+    type_(type),
+    frequency_(frequency),
+    gain_(gain),
+    q_(q),
+    b0_(1 << 28), // Pass-through until the sample rate is known
+    b1_(0),
+    b2_(0),
+    a1_(0),
+    a2_(0)
+{
+    reset();
+}
+
+void BiquadStage::setSampleRate(uint32_t sampleRate) {
+    // Coefficients are calculated in floating point once, the filter runs in fixed point
+    float a = powf(10.0f, gain_ / 40.0f);
+    float w0 = 2.0f * PI * min(frequency_, 0.49f * sampleRate) / sampleRate;
+    float cosW0 = cosf(w0);
+    float alpha = sinf(w0) / (2.0f * q_);
+    float b0, b1, b2, a0, a1, a2;
+
+    switch (type_) {
+        case PEAKING:
+            b0 = 1.0f + alpha * a;
+            b1 = -2.0f * cosW0;
+            b2 = 1.0f - alpha * a;
+            a0 = 1.0f + alpha / a;
+            a1 = -2.0f * cosW0;
+            a2 = 1.0f - alpha / a;
+            break;
+
+        case LOW_SHELF: {
+            float beta = 2.0f * sqrtf(a) * alpha;
+
+            b0 = a * ((a + 1.0f) - (a - 1.0f) * cosW0 + beta);
+            b1 = 2.0f * a * ((a - 1.0f) - (a + 1.0f) * cosW0);
+            b2 = a * ((a + 1.0f) - (a - 1.0f) * cosW0 - beta);
+            a0 = (a + 1.0f) + (a - 1.0f) * cosW0 + beta;
+            a1 = -2.0f * ((a - 1.0f) + (a + 1.0f) * cosW0);
+            a2 = (a + 1.0f) + (a - 1.0f) * cosW0 - beta;
+            break;
+        }
+
+        case HIGH_SHELF: {
+            float beta = 2.0f * sqrtf(a) * alpha;
+
+            b0 = a * ((a + 1.0f) + (a - 1.0f) * cosW0 + beta);
+            b1 = -2.0f * a * ((a - 1.0f) + (a + 1.0f) * cosW0);
+            b2 = a * ((a + 1.0f) + (a - 1.0f) * cosW0 - beta);
+            a0 = (a + 1.0f) - (a - 1.0f) * cosW0 + beta;
+            a1 = 2.0f * ((a - 1.0f) - (a + 1.0f) * cosW0);
+            a2 = (a + 1.0f) - (a - 1.0f) * cosW0 - beta;
+            break;
+        }
+
+        case LOW_PASS:
+            b0 = (1.0f - cosW0) / 2.0f;
+            b1 = 1.0f - cosW0;
+            b2 = (1.0f - cosW0) / 2.0f;
+            a0 = 1.0f + alpha;
+            a1 = -2.0f * cosW0;
+            a2 = 1.0f - alpha;
+            break;
+
+        case HIGH_PASS:
+        default:
+            b0 = (1.0f + cosW0) / 2.0f;
+            b1 = -(1.0f + cosW0);
+            b2 = (1.0f + cosW0) / 2.0f;
+            a0 = 1.0f + alpha;
+            a1 = -2.0f * cosW0;
+            a2 = 1.0f - alpha;
+            break;
+    }
+
+    b0_ = (int32_t) lroundf(b0 / a0 * kCoefScale);
+    b1_ = (int32_t) lroundf(b1 / a0 * kCoefScale);
+    b2_ = (int32_t) lroundf(b2 / a0 * kCoefScale);
+    a1_ = (int32_t) lroundf(a1 / a0 * kCoefScale);
+    a2_ = (int32_t) lroundf(a2 / a0 * kCoefScale);
+
+    reset();
+}
+
+void BiquadStage::reset() {
+    for (uint8_t ch = 0; ch < 2; ++ch) {
+        x1_[ch] = 0;
+        x2_[ch] = 0;
+        y1_[ch] = 0;
+        y2_[ch] = 0;
+        error_[ch] = 0;
+    }
+}
+
+void BiquadStage::process(int32_t *samples, size_t frames) {
+    for (uint8_t ch = 0; ch < 2; ++ch) {
+        int32_t x1 = x1_[ch], x2 = x2_[ch], y1 = y1_[ch], y2 = y2_[ch], error = error_[ch];
+        int32_t *pSample = samples + ch;
+
+        for (size_t i = 0; i < frames; ++i, pSample += 2) {
+            int32_t x = *pSample;
+
+            // The truncated fraction is fed back (error feedback), otherwise the output would get stuck
+            // in a dead band around the correct value (amplified by the feedback of low-frequency filters)
+            int64_t acc = (int64_t) b0_ * x + (int64_t) b1_ * x1 + (int64_t) b2_ * x2
+                - (int64_t) a1_ * y1 - (int64_t) a2_ * y2 + error;
+
+            int32_t y = (int32_t) (acc >> 28);
+
+            error = (int32_t) (acc - ((int64_t) y << 28));
+
+            x2 = x1;
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+
+            *pSample = y;
+        }
+
+        x1_[ch] = x1;
+        x2_[ch] = x2;
+        y1_[ch] = y1;
+        y2_[ch] = y2;
+        error_[ch] = error;
+    }
+}
+
+LimiterStage::LimiterStage(float threshold, uint32_t release) :
+    threshold_( (int32_t) (32767.0f * powf(10.0f, threshold / 20.0f)) ),
+    release_(release),
+    releaseCoef_(0),
+    gain_(32768),
+    minGain_(32768)
+{
+    setSampleRate(44100);
+}
+
+void LimiterStage::setSampleRate(uint32_t sampleRate) {
+    float samples = max(release_ * sampleRate / 1000.0f, 1.0f);
+
+    releaseCoef_ = (int32_t) (32768.0f * (1.0f - expf(-1.0f / samples)));
+    releaseCoef_ = max(releaseCoef_, (int32_t) 1);
+}
+
+void LimiterStage::reset() {
+    gain_ = 32768;
+}
+
+void LimiterStage::process(int32_t *samples, size_t frames) {
+    int32_t gain = gain_;
+    int32_t minGain = minGain_;
+
+    for (size_t i = 0; i < frames; ++i) {
+        int32_t left = samples[2 * i];
+        int32_t right = samples[2 * i + 1];
+        int32_t peak = max(abs(left), abs(right));
+
+        // Gain that keeps this frame at the threshold (1.0 = 32768)
+        int32_t target = peak > threshold_ ? (int32_t) (((int64_t) threshold_ << 15) / peak) : 32768;
+
+        if (target < gain) {
+            gain = target; // Instant attack
+        }
+        else {
+            gain += ((target - gain) * releaseCoef_ + 32767) >> 15; // Rounded up, so the gain reaches 1.0
+        }
+
+        samples[2 * i] = (int32_t) (((int64_t) left * gain) >> 15);
+        samples[2 * i + 1] = (int32_t) (((int64_t) right * gain) >> 15);
+
+        minGain = min(minGain, gain);
+    }
+
+    gain_ = gain;
+    minGain_ = minGain;
+}
+
+int32_t LimiterStage::takeMinGain() {
+    int32_t minGain = minGain_;
+
+    minGain_ = 32768;
+
+    return minGain;
+}
+
+void MonoStage::process(int32_t *samples, size_t frames) {
+    for (size_t i = 0; i < frames; ++i) {
+        int32_t mono = (samples[2 * i] + samples[2 * i + 1]) / 2;
+
+        samples[2 * i] = mono;
+        samples[2 * i + 1] = mono;
+    }
+}
@@ -0,0 +1,157 @@
+/**
+    PlaylistCache:
+    Persistent cache (NVS) of the stream URLs contained in m3u/pls playlists,
+    so that connecting to a playlist station does not require downloading
+    the playlist each time.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PlaylistCache.h"
+#include <time.h>
+
+const size_t PlaylistCache::kMaxUrlLength;
+
+/** Times before this value (2021-01-01) indicate that the clock has not been set via NTP */
+const time_t kTimeValid = 1609459200;
+
+PlaylistCache::PlaylistCache(uint32_t ttl) :
+    mutex_(nullptr),
+    ttl_(ttl),
+    hits_(0),
+    misses_(0)
+{
+}
+
+bool PlaylistCache::begin() {
+    if (mutex_ == nullptr) {
+        mutex_ = xSemaphoreCreateMutex();
+    }
+
+    return (mutex_ != nullptr) && prefs_.begin("playlists", false);
+}
+
+bool PlaylistCache::isPlaylistUrl(const char *url) {
+    size_t len = strlen(url);
+
+    if (len < 4) {
+        return false;
+    }
+
+    const char *ext = url + len - 4;
+
+    return (strcasecmp(ext, ".m3u") == 0) || (strcasecmp(ext, ".pls") == 0);
+}
+
+bool PlaylistCache::lookup(const char *playlistUrl, char *streamUrl, bool count) {
+    char key[16];
+    Entry entry;
+
+    makeKey(playlistUrl, key);
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    bool found = readEntry(key, entry) && isFresh(entry, now());
+    xSemaphoreGive(mutex_);
+
+    if (found) {
+        strlcpy(streamUrl, entry.url, kMaxUrlLength);
+    }
+
+    if (count) {
+        if (found) {
+            ++hits_;
+        }
+        else {
+            ++misses_;
+        }
+    }
+
+    return found;
+}
+
+void PlaylistCache::store(const char *playlistUrl, const char *streamUrl) {
+    char key[16];
+    Entry entry;
+    uint32_t time = now();
+
+    makeKey(playlistUrl, key);
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    // Spare the flash if the entry is unchanged and not yet halfway to expiry
+    bool unchanged = readEntry(key, entry) && (strcmp(entry.url, streamUrl) == 0)
+        && (entry.time == 0 || time == 0 || time - entry.time < ttl_ / 2);
+
+    if (!unchanged) {
+        entry.time = time;
+        strlcpy(entry.url, streamUrl, kMaxUrlLength);
+
+        prefs_.putBytes(key, &entry, sizeof(entry));
+
+        log_d("Playlist cache: stored '%s' -> '%s'", playlistUrl, streamUrl);
+    }
+
+    xSemaphoreGive(mutex_);
+}
+
+void PlaylistCache::invalidate(const char *playlistUrl) {
+    char key[16];
+
+    makeKey(playlistUrl, key);
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    prefs_.remove(key);
+    xSemaphoreGive(mutex_);
+
+    log_d("Playlist cache: removed '%s'", playlistUrl);
+}
+
+void PlaylistCache::makeKey(const char *playlistUrl, char *key) {
+    // FNV-1a hash of the URL
+    uint32_t hash = 2166136261u;
+
+    for (const char *p = playlistUrl; *p != '\0'; ++p) {
+        hash = (hash ^ (uint8_t) *p) * 16777619u;
+    }
+
+    snprintf(key, 16, "p%08x", hash);
+}
+
+uint32_t PlaylistCache::now() {
+    time_t t = time(nullptr);
+
+    return (t < kTimeValid) ? 0 : (uint32_t) t;
+}
+
+bool PlaylistCache::readEntry(const char *key, Entry &entry) {
+    if (prefs_.getBytesLength(key) != sizeof(entry)) {
+        return false;
+    }
+
+    prefs_.getBytes(key, &entry, sizeof(entry));
+    entry.url[kMaxUrlLength - 1] = '\0';
+
+    return true;
+}
+
+bool PlaylistCache::isFresh(const Entry &entry, uint32_t time) const {
+    // Without a valid clock the age is unknown; a failing URL is removed by the caller
+    if (entry.time == 0 || time == 0) {
+        return true;
+    }
+
+    return time - entry.time < ttl_;
+}
@@ -0,0 +1,109 @@
+/**
+    RadioSettings:
+    Settings that are kept across reboots (NVS): last station, volume,
+    bluetooth latency profile and the WiFi association data used for
+    connecting without a scan.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "RadioSettings.h"
+
+RadioSettings::RadioSettings(uint16_t defaultStation, uint8_t defaultVolume, uint8_t defaultLatencyProfile) :
+    open_(false),
+    station_(defaultStation),
+    volume_(defaultVolume),
+    latencyProfile_(defaultLatencyProfile),
+    assocValid_(false)
+{
+    memset(&assoc_, 0, sizeof(assoc_));
+}
+
+bool RadioSettings::begin() {
+    if (!open_) {
+        open_ = prefs_.begin("settings", false);
+
+        if (open_) {
+            station_ = prefs_.getUShort("station", station_);
+            volume_ = prefs_.getUChar("volume", volume_);
+            latencyProfile_ = prefs_.getUChar("latency", latencyProfile_);
+            assocValid_ = prefs_.getBytes("assoc", &assoc_, sizeof(assoc_)) == sizeof(assoc_);
+        }
+    }
+
+    return open_;
+}
+
+void RadioSettings::setStation(uint16_t index) {
+    if (index != station_) {
+        station_ = index;
+
+        if (open_) {
+            prefs_.putUShort("station", station_);
+        }
+    }
+}
+
+void RadioSettings::setVolume(uint8_t volume) {
+    if (volume != volume_) {
+        volume_ = volume;
+
+        if (open_) {
+            prefs_.putUChar("volume", volume_);
+        }
+    }
+}
+
+void RadioSettings::setLatencyProfile(uint8_t profile) {
+    if (profile != latencyProfile_) {
+        latencyProfile_ = profile;
+
+        if (open_) {
+            prefs_.putUChar("latency", latencyProfile_);
+        }
+    }
+}
+
+bool RadioSettings::association(Association &assoc) const {
+    if (assocValid_) {
+        assoc = assoc_;
+    }
+
+    return assocValid_;
+}
+
+void RadioSettings::setAssociation(const Association &assoc) {
+    if ( assocValid_ && memcmp(&assoc, &assoc_, sizeof(assoc_)) == 0 ) {
+        return;
+    }
+
+    assoc_ = assoc;
+    assocValid_ = true;
+
+    if (open_) {
+        prefs_.putBytes("assoc", &assoc_, sizeof(assoc_));
+    }
+}
+
+void RadioSettings::clearAssociation() {
+    if (assocValid_) {
+        assocValid_ = false;
+
+        if (open_) {
+            prefs_.remove("assoc");
+        }
+    }
+}
@@ -0,0 +1,193 @@
+/**
+    StationCatalogue:
+    List of radio stations with display name, codec/bitrate hint and
+    alternate stream URLs. The catalogue is kept in a single buffer
+    (packed text with zero terminated fields) plus an offset index, so
+    hundreds of stations need no per-entry heap allocation.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "StationCatalogue.h"
+
+const uint16_t StationCatalogue::kMaxStations;
+const uint8_t StationCatalogue::kMaxUrls;
+
+StationCatalogue::StationCatalogue() :
+    pBuffer_(nullptr),
+    size_(0),
+    pIndex_(nullptr),
+    count_(0)
+{
+}
+
+StationCatalogue::~StationCatalogue() {
+    clear();
+}
+
+bool StationCatalogue::load(fs::FS &fs, const char *path) {
+    File file = fs.open(path, "r");
+
+    if (!file) {
+        return false;
+    }
+
+    clear();
+
+    size_t fileSize = file.size();
+
+    pBuffer_ = (char*) malloc(fileSize + 1);
+
+    if (pBuffer_ == nullptr) {
+        log_w("Cannot allocate %u bytes for the station catalogue.", (uint32_t) (fileSize + 1));
+        file.close();
+        return false;
+    }
+
+    size_ = file.read((uint8_t*) pBuffer_, fileSize);
+    pBuffer_[size_] = '\0';
+    size_++;
+
+    file.close();
+
+    return parse();
+}
+
+bool StationCatalogue::load(const char *text) {
+    clear();
+
+    size_ = strlen(text) + 1;
+    pBuffer_ = (char*) malloc(size_);
+
+    if (pBuffer_ == nullptr) {
+        size_ = 0;
+        return false;
+    }
+
+    memcpy(pBuffer_, text, size_);
+
+    return parse();
+}
+
+const char* StationCatalogue::name(uint16_t index) const {
+    return (index < count_) ? pBuffer_ + pIndex_[index].offset : "";
+}
+
+const char* StationCatalogue::hint(uint16_t index) const {
+    return (index < count_) ? nextField(name(index)) : "";
+}
+
+uint32_t StationCatalogue::bitrate(uint16_t index) const {
+    const char *slash = strchr(hint(index), '/');
+
+    return (slash != nullptr) ? strtoul(slash + 1, nullptr, 10) : 0;
+}
+
+uint8_t StationCatalogue::numUrls(uint16_t index) const {
+    return (index < count_) ? pIndex_[index].numUrls : 0;
+}
+
+const char* StationCatalogue::url(uint16_t index, uint8_t alternate) const {
+    if (alternate >= numUrls(index)) {
+        return "";
+    }
+
+    const char *field = nextField(hint(index));
+
+    for (uint8_t i = 0; i < alternate; ++i) {
+        field = nextField(field);
+    }
+
+    return field;
+}
+
+size_t StationCatalogue::memoryUsage() const {
+    return size_ + count_ * sizeof(Entry);
+}
+
+bool StationCatalogue::parse() {
+    // Upper bound of the number of stations: number of lines
+    size_t lines = 1;
+
+    for (size_t i = 0; i < size_; ++i) {
+        if (pBuffer_[i] == '\n') {
+            lines++;
+        }
+    }
+
+    pIndex_ = (Entry*) malloc(min(lines, (size_t) kMaxStations) * sizeof(Entry));
+
+    if (pIndex_ == nullptr) {
+        clear();
+        return false;
+    }
+
+    char *line = pBuffer_;
+    char *end = pBuffer_ + size_ - 1; // Terminating zero
+
+    while (line < end && count_ < kMaxStations) {
+        char *lineEnd = strchr(line, '\n');
+
+        if (lineEnd == nullptr) {
+            lineEnd = end;
+        }
+
+        // Fields become zero terminated strings in place
+        uint8_t fields = 1;
+
+        for (char *p = line; p < lineEnd; ++p) {
+            if (*p == '|') {
+                *p = '\0';
+                fields++;
+            }
+            else if (*p == '\r') {
+                *p = '\0'; // Also removes trailing characters of lines in DOS format
+                break;
+            }
+        }
+
+        *lineEnd = '\0';
+
+        // Name, hint and at least one URL
+        if (line[0] != '#' && fields >= 3 && nextField(nextField(line))[0] != '\0') {
+            Entry &entry = pIndex_[count_];
+
+            entry.offset = line - pBuffer_;
+            entry.numUrls = min(fields - 2, (int) kMaxUrls);
+
+            count_++;
+        }
+
+        line = lineEnd + 1;
+    }
+
+    if (count_ == 0) {
+        clear();
+        return false;
+    }
+
+    return true;
+}
+
+void StationCatalogue::clear() {
+    free(pBuffer_);
+    free(pIndex_);
+
+    pBuffer_ = nullptr;
+    pIndex_ = nullptr;
+    size_ = 0;
+    count_ = 0;
+}
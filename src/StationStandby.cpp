@@ -0,0 +1,329 @@
+/**
+    StationStandby:
+    Keeps the next station of the web radio in a warm standby state, so that
+    switching to it does not have to wait for the playlist download, the DNS
+    lookup of the stream host and the response of the host (standby
+    connection of the timeshift proxy).
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "StationStandby.h"
+#include <WiFi.h>
+#include <HTTPClient.h>
+
+const size_t StationStandby::kMaxUrlLength;
+
+/** Marker for 'no station' */
+const uint16_t kNoStation = 0xFFFF;
+
+/** Maximum time in ms for downloading a playlist */
+const uint32_t kPlaylistTimeout = 3000;
+
+/** Maximum time in ms 'end' waits for the standby task (DNS lookup, connection and playlist download of a request) */
+const uint32_t kStandbyStopTimeout = 10000;
+
+/** Interval in ms for renewing the standby connection (shorter than 'TimeshiftProxy::kStandbyMaxAge') */
+const uint32_t kStandbyRenewal = 15000;
+
+StationStandby::StationStandby(size_t bufferSize, PlaylistCache *pCache, HostCache *pHostCache, TimeshiftProxy *pProxy) :
+    bufferSize_(bufferSize),
+    pCache_(pCache),
+    pHostCache_(pHostCache),
+    pProxy_(pProxy),
+    pBuffer_(nullptr),
+    pTask_(nullptr),
+    stop_(false),
+    mutex_(nullptr),
+    requestIndex_(kNoStation),
+    readyIndex_(kNoStation)
+{
+    requestUrl_[0] = '\0';
+    readyUrl_[0] = '\0';
+}
+
+bool StationStandby::begin(UBaseType_t priority, BaseType_t core, uint32_t stackSize) {
+    if (pTask_ != nullptr) {
+        if (stop_) {
+            log_w("Standby task still stopping.");
+            return false;
+        }
+
+        log_w("Standby task already running.");
+        return true;
+    }
+
+    if (mutex_ == nullptr) {
+        mutex_ = xSemaphoreCreateMutex();
+    }
+
+    if (pBuffer_ == nullptr) {
+        pBuffer_ = (char*) malloc(bufferSize_);
+    }
+
+    if (mutex_ == nullptr || pBuffer_ == nullptr) {
+        log_w("Cannot allocate standby buffer of %u bytes.", (uint32_t) bufferSize_);
+        return false;
+    }
+
+    stop_ = false;
+
+    return xTaskCreatePinnedToCore(task, "Station standby task", stackSize, this, priority, &pTask_, core) == pdPASS;
+}
+
+bool StationStandby::end() {
+    if (pTask_ != nullptr) {
+        // Let the task complete the current request and end itself
+        stop_ = true;
+        xTaskNotifyGive(pTask_);
+
+        unsigned long startTime = millis();
+
+        while (pTask_ != nullptr && millis() - startTime < kStandbyStopTimeout) {
+            vTaskDelay(10 / portTICK_PERIOD_MS);
+        }
+
+        // The task may still use the buffer
+        if (pTask_ != nullptr) {
+            log_w("Standby task has not ended within %u ms.", kStandbyStopTimeout);
+            return false;
+        }
+    }
+
+    free(pBuffer_);
+    pBuffer_ = nullptr;
+
+    requestIndex_ = kNoStation;
+    readyIndex_ = kNoStation;
+
+    return true;
+}
+
+void StationStandby::prepare(uint16_t index, const char *url) {
+    if (pTask_ == nullptr) {
+        return;
+    }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    requestIndex_ = index;
+    strlcpy(requestUrl_, url, kMaxUrlLength);
+    readyIndex_ = kNoStation; // Discard previous standby station
+
+    xSemaphoreGive(mutex_);
+
+    xTaskNotifyGive(pTask_); // Wake up the standby task
+}
+
+bool StationStandby::take(uint16_t index, char *url) {
+    if (pTask_ == nullptr) {
+        return false;
+    }
+
+    bool ready = false;
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    if (readyIndex_ == index) {
+        strlcpy(url, readyUrl_, kMaxUrlLength);
+        readyIndex_ = kNoStation; // The standby state is handed over only once
+        ready = true;
+    }
+
+    xSemaphoreGive(mutex_);
+
+    return ready;
+}
+
+void StationStandby::task(void *p) {
+    StationStandby *pStandby = (StationStandby*) p;
+
+    while (!pStandby->stop_) {
+        // Wait for the next request, renew the standby connection in between
+        uint32_t notified = ulTaskNotifyTake(pdTRUE, (pStandby->pProxy_ != nullptr) ? kStandbyRenewal / portTICK_PERIOD_MS : portMAX_DELAY);
+
+        if (pStandby->stop_) {
+            break;
+        }
+
+        if (notified > 0) {
+            pStandby->process();
+        }
+        else {
+            pStandby->renew();
+        }
+    }
+
+    pStandby->pTask_ = nullptr;
+    vTaskDelete(nullptr);
+}
+
+void StationStandby::process() {
+    char url[kMaxUrlLength];
+    char streamUrl[kMaxUrlLength];
+    IPAddress ip;
+
+    // Fetch request
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    uint16_t index = requestIndex_;
+    strlcpy(url, requestUrl_, kMaxUrlLength);
+    requestIndex_ = kNoStation;
+
+    xSemaphoreGive(mutex_);
+
+    if (index == kNoStation || WiFi.status() != WL_CONNECTED) {
+        return;
+    }
+
+    if ( PlaylistCache::isPlaylistUrl(url) ) {
+        // Download the playlist only if it is not in the cache
+        if ( !pCache_->lookup(url, streamUrl, false) ) {
+            if ( !resolvePlaylist(url, streamUrl) ) {
+                log_d("Standby: cannot resolve playlist '%s'", url);
+                return;
+            }
+
+            pCache_->store(url, streamUrl);
+        }
+    }
+    else {
+        strlcpy(streamUrl, url, kMaxUrlLength);
+    }
+
+    if ( !resolveHost(streamUrl, ip) ) {
+        log_d("Standby: cannot resolve host of '%s'", streamUrl);
+        return;
+    }
+
+    connectAhead(streamUrl, ip);
+
+    // Publish result unless a newer request has arrived in the meantime
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    if (requestIndex_ == kNoStation) {
+        readyIndex_ = index;
+        strlcpy(readyUrl_, streamUrl, kMaxUrlLength);
+    }
+
+    xSemaphoreGive(mutex_);
+
+    log_d("Standby: station %u ready: %s", index, streamUrl);
+}
+
+void StationStandby::renew() {
+    char streamUrl[kMaxUrlLength];
+    IPAddress ip;
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    bool ready = (readyIndex_ != kNoStation);
+    strlcpy(streamUrl, readyUrl_, kMaxUrlLength);
+
+    xSemaphoreGive(mutex_);
+
+    if ( ready && WiFi.status() == WL_CONNECTED && resolveHost(streamUrl, ip) ) {
+        connectAhead(streamUrl, ip);
+    }
+}
+
+void StationStandby::connectAhead(const char *streamUrl, const IPAddress &ip) {
+    if ( pProxy_ == nullptr || pProxy_->taskHandle() == nullptr || !TimeshiftProxy::isSupportedUrl(streamUrl) ) {
+        return;
+    }
+
+    if ( !pProxy_->openStandby(streamUrl, ip) ) {
+        log_d("Standby: no standby connection to '%s'", streamUrl);
+    }
+}
+
+bool StationStandby::resolvePlaylist(const char *url, char *streamUrl) {
+    HTTPClient http;
+
+    http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
+
+    if ( !http.begin(url) ) {
+        return false;
+    }
+
+    int httpResponseCode = http.GET();
+
+    if (httpResponseCode != HTTP_CODE_OK) {
+        log_d("Standby: HTTP response code %d for '%s'", httpResponseCode, url);
+        http.end();
+        return false;
+    }
+
+    // Read the playlist into the standby buffer (truncated to the memory budget)
+    WiFiClient *pStream = http.getStreamPtr();
+    int contentSize = http.getSize(); // -1 if unknown
+    size_t len = 0;
+    unsigned long startTime = millis();
+
+    while ( http.connected() && (len < bufferSize_ - 1) && (millis() - startTime < kPlaylistTimeout) ) {
+        size_t avail = pStream->available();
+
+        if (avail > 0) {
+            len += pStream->readBytes(pBuffer_ + len, min(avail, bufferSize_ - 1 - len));
+
+            if (contentSize > 0 && len >= (size_t) contentSize) {
+                break;
+            }
+        }
+        else {
+            vTaskDelay(10 / portTICK_PERIOD_MS);
+        }
+    }
+
+    http.end();
+
+    pBuffer_[len] = '\0';
+
+    // Find the first stream URL: plain line in m3u files, 'FileN=' entry in pls files
+    char *pLine = strtok(pBuffer_, "\r\n");
+
+    while (pLine != nullptr) {
+        while (*pLine == ' ' || *pLine == '\t') {
+            ++pLine;
+        }
+
+        if (strncasecmp(pLine, "File", 4) == 0 && strchr(pLine, '=') != nullptr) {
+            pLine = strchr(pLine, '=') + 1;
+        }
+
+        if (strncasecmp(pLine, "http://", 7) == 0 || strncasecmp(pLine, "https://", 8) == 0) {
+            strlcpy(streamUrl, pLine, kMaxUrlLength);
+            return true;
+        }
+
+        pLine = strtok(nullptr, "\r\n");
+    }
+
+    return false;
+}
+
+bool StationStandby::resolveHost(const char *url, IPAddress &ip) {
+    char host[HostCache::kMaxHostLength];
+    HostCache::Result result;
+
+    if ( !HostCache::parseHost(url, host) || !pHostCache_->resolve(host, result) ) {
+        return false;
+    }
+
+    ip = result.ip;
+
+    return true;
+}
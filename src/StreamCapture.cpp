@@ -0,0 +1,167 @@
+/**
+    StreamCapture:
+    Records the raw bytes of a radio stream into a file, which can be
+    replayed through the decoder as a repeatable benchmark.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "StreamCapture.h"
+#include <WiFi.h>
+#include <HTTPClient.h>
+
+const size_t StreamCapture::kMaxUrlLength;
+
+/** Size of the blocks written to the file */
+const size_t kCaptureChunkSize = 1024;
+
+/** Maximum time in ms without data before the capture is ended */
+const uint32_t kCaptureDataTimeout = 3000;
+
+/** Maximum time in ms 'end' waits for the capture task (the connection setup cannot be interrupted) */
+const uint32_t kCaptureStopTimeout = 8000;
+
+StreamCapture::StreamCapture(fs::FS &fs, const char *path, size_t maxBytes, uint32_t maxTime) :
+    fs_(fs),
+    path_(path),
+    maxBytes_(maxBytes),
+    maxTime_(maxTime),
+    pTask_(nullptr),
+    stop_(false),
+    bytes_(0)
+{
+    url_[0] = '\0';
+}
+
+bool StreamCapture::start(const char *url, UBaseType_t priority, BaseType_t core, uint32_t stackSize) {
+    if (pTask_ != nullptr) {
+        log_w("Capture already running.");
+        return false;
+    }
+
+    strlcpy(url_, url, kMaxUrlLength);
+    stop_ = false;
+    bytes_ = 0;
+
+    TaskHandle_t pTask = nullptr;
+
+    if (xTaskCreatePinnedToCore(task, "Stream capture task", stackSize, this, priority, &pTask, core) != pdPASS) {
+        return false;
+    }
+
+    pTask_ = pTask;
+
+    return true;
+}
+
+bool StreamCapture::end() {
+    if (pTask_ == nullptr) {
+        return true;
+    }
+
+    stop_ = true;
+
+    unsigned long startTime = millis();
+
+    while (pTask_ != nullptr && millis() - startTime < kCaptureStopTimeout) {
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+
+    if (pTask_ != nullptr) {
+        log_w("Capture task has not ended within %u ms.", kCaptureStopTimeout);
+        return false;
+    }
+
+    return true;
+}
+
+void StreamCapture::task(void *p) {
+    StreamCapture *pCapture = (StreamCapture*) p;
+
+    pCapture->record();
+
+    pCapture->pTask_ = nullptr;
+    vTaskDelete(nullptr);
+}
+
+void StreamCapture::record() {
+    uint8_t *pChunk = (uint8_t*) malloc(kCaptureChunkSize);
+
+    if (pChunk == nullptr) {
+        log_w("Capture: cannot allocate %u bytes.", (uint32_t) kCaptureChunkSize);
+        return;
+    }
+
+    HTTPClient http;
+
+    http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
+
+    int httpResponseCode = http.begin(url_) ? http.GET() : -1;
+
+    if (httpResponseCode != HTTP_CODE_OK) {
+        log_w("Capture: HTTP response code %d for '%s'", httpResponseCode, url_);
+        http.end();
+        free(pChunk);
+        return;
+    }
+
+    File file = fs_.open(path_, "w");
+
+    if (!file) {
+        log_w("Capture: cannot create '%s'", path_);
+        http.end();
+        free(pChunk);
+        return;
+    }
+
+    log_i("Capture: recording '%s' to '%s' (up to %u bytes, %u ms)", url_, path_, (uint32_t) maxBytes_, maxTime_);
+
+    WiFiClient *pStream = http.getStreamPtr();
+    unsigned long startTime = millis();
+    unsigned long dataTime = startTime;
+    bool writeError = false;
+
+    while ( !stop_ && http.connected() && bytes_ < maxBytes_ && (millis() - startTime < maxTime_) ) {
+        size_t avail = pStream->available();
+
+        if (avail > 0) {
+            size_t len = pStream->readBytes(pChunk, min( min(avail, kCaptureChunkSize), maxBytes_ - bytes_ ));
+
+            if (file.write(pChunk, len) != len) {
+                writeError = true; // File system full
+                break;
+            }
+
+            bytes_ += len;
+            dataTime = millis();
+        }
+        else if (millis() - dataTime > kCaptureDataTimeout) {
+            break;
+        }
+        else {
+            vTaskDelay(10 / portTICK_PERIOD_MS);
+        }
+    }
+
+    uint32_t duration = (uint32_t) (millis() - startTime);
+
+    file.close();
+    http.end();
+    free(pChunk);
+
+    log_i("Capture: %u bytes in %u ms (%u kbit/s)%s", (uint32_t) bytes_, duration,
+        duration > 0 ? (uint32_t) ((uint64_t) bytes_ * 8 / duration) : 0, writeError ? ", file system full" : "");
+}
@@ -0,0 +1,176 @@
+/**
+    StreamWatchdog:
+    Detects stalled radio streams from the trend of the buffer fill and
+    schedules reconnects with exponential backoff, failing over to the
+    alternate URLs of the station.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "StreamWatchdog.h"
+
+const uint32_t StreamWatchdog::kStallTime;
+const uint32_t StreamWatchdog::kDrainHorizon;
+const uint32_t StreamWatchdog::kTrendWindow;
+const uint32_t StreamWatchdog::kRetryMin;
+const uint32_t StreamWatchdog::kRetryMax;
+const uint8_t StreamWatchdog::kFailuresPerUrl;
+
+StreamWatchdog::StreamWatchdog() :
+    numUrls_(1),
+    alternate_(0),
+    failures_(0),
+    urlFailures_(0),
+    retryPending_(false),
+    recovering_(false),
+    retryTime_(0),
+    outageStart_(0),
+    bufferSize_(0),
+    bufferFilled_(0),
+    timeLastData_(0),
+    timeWindow_(0),
+    bufferFilledWindow_(0),
+    netRate_(0),
+    netRateValid_(false),
+    windowStarted_(false)
+{
+}
+
+void StreamWatchdog::reset(uint8_t numUrls) {
+    numUrls_ = max(numUrls, (uint8_t) 1);
+    alternate_ = 0;
+    failures_ = 0;
+    urlFailures_ = 0;
+    retryPending_ = false;
+    recovering_ = false;
+}
+
+void StreamWatchdog::start(uint32_t time, uint32_t bufferSize) {
+    bufferSize_ = bufferSize;
+    bufferFilled_ = 0;
+    timeLastData_ = time;
+    timeWindow_ = time;
+    bufferFilledWindow_ = 0;
+    netRate_ = 0;
+    netRateValid_ = false;
+    windowStarted_ = false;
+}
+
+void StreamWatchdog::update(uint32_t time, uint32_t bufferFilled) {
+    // A (nearly) full buffer accepts little data, which is not a stall either
+    if (bufferFilled > bufferFilled_ || bufferFilled >= bufferSize_ - bufferSize_ / 16) {
+        timeLastData_ = time;
+    }
+
+    bufferFilled_ = bufferFilled;
+
+    // The first window starts with the first fill level reported while playing, so the data received
+    // before unmuting (e.g. the burst of the host after connecting) does not count as incoming rate
+    if (!windowStarted_) {
+        timeWindow_ = time;
+        bufferFilledWindow_ = bufferFilled;
+        windowStarted_ = true;
+        return;
+    }
+
+    uint32_t elapsed = time - timeWindow_;
+
+    if (elapsed >= kTrendWindow) {
+        int32_t rate = ((int32_t) bufferFilled - (int32_t) bufferFilledWindow_) * 1000 / (int32_t) elapsed;
+
+        netRate_ = netRateValid_ ? (netRate_ * 3 + rate) / 4 : rate; // Smoothing
+        netRateValid_ = true;
+
+        timeWindow_ = time;
+        bufferFilledWindow_ = bufferFilled;
+    }
+}
+
+bool StreamWatchdog::isStalled(uint32_t time) const {
+    if (time - timeLastData_ > kStallTime) {
+        return true;
+    }
+
+    // A full buffer does not accept data, so only a draining buffer in its lower quarter indicates a stall
+    if (netRateValid_ && netRate_ < 0 && bufferFilled_ < bufferSize_ / 4) {
+        return (uint32_t) -netRate_ * kDrainHorizon / 1000 > bufferFilled_;
+    }
+
+    return false;
+}
+
+void StreamWatchdog::failed(uint32_t time, const char *reason) {
+    if (retryPending_) {
+        return;
+    }
+
+    if (!recovering_) {
+        recovering_ = true;
+        outageStart_ = time;
+    }
+
+    // Fail over to the next URL of the station if the current one keeps failing
+    if (++urlFailures_ >= kFailuresPerUrl && numUrls_ > 1) {
+        alternate_ = (alternate_ + 1) % numUrls_;
+        urlFailures_ = 0;
+    }
+
+    // Exponential backoff, half of the delay is random so that many devices do not reconnect in lockstep
+    uint32_t delay = min(kRetryMin << min(failures_, (uint8_t) 16), kRetryMax);
+
+    delay = delay / 2 + esp_random() % (delay / 2 + 1);
+
+    if (failures_ < 0xFF) {
+        failures_++;
+    }
+
+    retryTime_ = time + delay;
+    retryPending_ = true;
+
+    log_i("Stream watchdog: %s, retry %u in %u ms with URL %u/%u (outage %u ms)",
+        reason, failures_, delay, alternate_ + 1, numUrls_, time - outageStart_);
+}
+
+bool StreamWatchdog::isRetryDue(uint32_t time) const {
+    return retryPending_ && (int32_t) (time - retryTime_) >= 0;
+}
+
+uint32_t StreamWatchdog::retryDelay(uint32_t time) const {
+    return isRetryDue(time) || !retryPending_ ? 0 : retryTime_ - time;
+}
+
+void StreamWatchdog::retryStarted() {
+    retryPending_ = false;
+}
+
+uint32_t StreamWatchdog::recovered(uint32_t time) {
+    if (!recovering_) {
+        return 0;
+    }
+
+    uint32_t outage = time - outageStart_;
+
+    log_i("Stream watchdog: recovered after %u ms and %u attempts with URL %u/%u",
+        outage, failures_, alternate_ + 1, numUrls_);
+
+    // Stay with the working URL until the station is changed
+    failures_ = 0;
+    urlFailures_ = 0;
+    retryPending_ = false;
+    recovering_ = false;
+
+    return outage;
+}
@@ -0,0 +1,150 @@
+/**
+    TaskTopology:
+    Core affinity, priority and stack size of the RTOS tasks of the radio,
+    organized in profiles that can be chosen at build time or run time,
+    and bookkeeping of the topology benchmark.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TaskTopology.h"
+
+const uint8_t TaskTopology::kNumProfiles;
+
+/** The WiFi and bluetooth stacks run on core 0, the Arduino loop on core 1 (priority 1) */
+const TaskTopology::Profile TaskTopology::kProfiles[kNumProfiles] = {
+    // Audio on core 1, display on core 0, network and background work on any core
+    {"pinned",
+        {1, configMAX_PRIORITIES - 4, 4096},
+        {tskNO_AFFINITY, tskIDLE_PRIORITY + 1, 4096},
+        {0, tskIDLE_PRIORITY + 2, 4096},
+        {tskNO_AFFINITY, tskIDLE_PRIORITY + 1, 4096}},
+
+    // No core affinity at all (the scheduler picks the core)
+    {"unpinned",
+        {tskNO_AFFINITY, configMAX_PRIORITIES - 4, 4096},
+        {tskNO_AFFINITY, tskIDLE_PRIORITY + 1, 4096},
+        {tskNO_AFFINITY, tskIDLE_PRIORITY + 2, 4096},
+        {tskNO_AFFINITY, tskIDLE_PRIORITY + 1, 4096}},
+
+    // Core 1 exclusively for audio, everything else on core 0 next to the WiFi stack
+    {"isolated",
+        {1, configMAX_PRIORITIES - 2, 4096},
+        {0, tskIDLE_PRIORITY + 1, 4096},
+        {0, tskIDLE_PRIORITY + 2, 4096},
+        {0, tskIDLE_PRIORITY + 1, 4096}},
+
+    // Audio next to the WiFi stack on core 0, user interface on core 1 next to the Arduino loop
+    {"audio-core0",
+        {0, configMAX_PRIORITIES - 4, 4096},
+        {1, tskIDLE_PRIORITY + 1, 4096},
+        {1, tskIDLE_PRIORITY + 2, 4096},
+        {1, tskIDLE_PRIORITY + 1, 4096}}
+};
+
+TaskTopology::TaskTopology(uint8_t defaultIndex) :
+    index_(defaultIndex < kNumProfiles ? defaultIndex : 0),
+    benchmarkRun_(kNumProfiles)
+{
+}
+
+bool TaskTopology::begin(bool benchmark) {
+    if ( !prefs_.begin("topology", false) ) {
+        return false;
+    }
+
+    uint8_t index = prefs_.getUChar("profile", index_);
+
+    if (index < kNumProfiles) {
+        index_ = index;
+    }
+
+    if (benchmark) {
+        benchmarkRun_ = prefs_.getUChar("run", kNumProfiles);
+
+        if (benchmarkRun_ >= kNumProfiles) {
+            // Start a new benchmark with the first profile
+            benchmarkRun_ = 0;
+            prefs_.putUChar("run", benchmarkRun_);
+            prefs_.remove("results");
+        }
+
+        index_ = benchmarkRun_;
+
+        log_i("Topology benchmark: run %u of %u, profile '%s'", benchmarkRun_ + 1, kNumProfiles, profile().name);
+    }
+    else {
+        log_i("Task topology: profile '%s'", profile().name);
+    }
+
+    return true;
+}
+
+bool TaskTopology::select(uint8_t index) {
+    if (index >= kNumProfiles) {
+        return false;
+    }
+
+    log_i("Task topology: profile '%s' selected (effective after restart)", kProfiles[index].name);
+
+    return prefs_.putUChar("profile", index) == sizeof(uint8_t);
+}
+
+bool TaskTopology::createTask(TaskFunction_t function, const char *name, const TaskConfig &config, void *param, TaskHandle_t *pHandle) {
+    return xTaskCreatePinnedToCore(function, name, config.stackSize, param, config.priority, pHandle, config.core) == pdPASS;
+}
+
+bool TaskTopology::finishBenchmarkRun(const BenchmarkResult &result) {
+    if ( !isBenchmarkRunning() ) {
+        return false;
+    }
+
+    BenchmarkResult results[kNumProfiles];
+
+    if (prefs_.getBytes("results", results, sizeof(results)) != sizeof(results)) {
+        memset(results, 0, sizeof(results));
+    }
+
+    results[benchmarkRun_] = result;
+    prefs_.putBytes("results", results, sizeof(results));
+
+    benchmarkRun_++;
+
+    if (benchmarkRun_ < kNumProfiles) {
+        prefs_.putUChar("run", benchmarkRun_);
+        return true;
+    }
+
+    // Last run: report and start over at the next boot
+    prefs_.remove("run");
+    logBenchmarkResults();
+
+    return false;
+}
+
+void TaskTopology::logBenchmarkResults() {
+    BenchmarkResult results[kNumProfiles];
+
+    if (prefs_.getBytes("results", results, sizeof(results)) != sizeof(results)) {
+        log_w("Topology benchmark: no results.");
+        return;
+    }
+
+    for (uint8_t i = 0; i < kNumProfiles; i++) {
+        log_i("Topology benchmark: profile '%s': %u s, %u underruns, loop gap avg %u us, max %u us",
+            kProfiles[i].name, results[i].duration / 1000, results[i].underruns, results[i].loopGapAvg, results[i].loopGapMax);
+    }
+}
@@ -0,0 +1,115 @@
+/**
+    TextLine:
+    One line of text on the screen, held as a ring buffer of 1-bit pixel
+    columns and expanded to RGB565 only while it is pushed to the display.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TextLine.h"
+
+const uint8_t TextLine::kPushRows;
+
+uint16_t *TextLine::pPushBuffer_ = nullptr;
+size_t TextLine::pushBufferPixels_ = 0;
+
+TextLine::TextLine(const GlyphAtlas *pAtlas) :
+    pAtlas_(pAtlas),
+    width_(0),
+    pColumns_(nullptr),
+    head_(0)
+{
+}
+
+TextLine::~TextLine() {
+    free(pColumns_);
+}
+
+bool TextLine::begin(int16_t width) {
+    free(pColumns_);
+
+    width_ = width;
+    head_ = 0;
+    pColumns_ = (uint32_t*) calloc(width_, sizeof(uint32_t));
+
+    // The shared push buffer grows to the widest line
+    size_t pixels = width_ * kPushRows;
+
+    if (pixels > pushBufferPixels_) {
+        free(pPushBuffer_);
+        pPushBuffer_ = (uint16_t*) malloc(pixels * sizeof(uint16_t));
+        pushBufferPixels_ = (pPushBuffer_ != nullptr) ? pixels : 0;
+    }
+
+    return (pColumns_ != nullptr) && (pPushBuffer_ != nullptr);
+}
+
+void TextLine::clear() {
+    memset(pColumns_, 0, width_ * sizeof(uint32_t));
+    head_ = 0;
+}
+
+void TextLine::drawText(int16_t x, const char *text) {
+    clear();
+
+    for (const char *p = text; *p != '\0' && x < width_; ++p) {
+        uint8_t w = pAtlas_->width(*p); // 0 for characters that are not in the atlas
+
+        for (uint8_t i = 0; i < w && x < width_; ++i, ++x) {
+            if (x >= 0) {
+                pColumns_[x] = pAtlas_->column(*p, i);
+            }
+        }
+    }
+}
+
+void TextLine::scrollIn(uint32_t column) {
+    // The leftmost column is dropped and its slot becomes the rightmost column
+    pColumns_[head_] = column;
+    head_ = (head_ + 1) % width_;
+}
+
+void TextLine::push(TFT_eSPI *pTft, int16_t x, int16_t y, uint16_t fgColor, uint16_t bgColor) {
+    // The display expects the high byte first
+    uint16_t fg = (fgColor >> 8) | (fgColor << 8);
+    uint16_t bg = (bgColor >> 8) | (bgColor << 8);
+
+    int16_t h = height();
+
+    for (int16_t row = 0; row < h; row += kPushRows) {
+        int16_t rows = min((int16_t) kPushRows, (int16_t) (h - row));
+        uint16_t *pPixel = pPushBuffer_;
+
+        for (int16_t r = row; r < row + rows; ++r) {
+            uint32_t mask = (uint32_t) 1 << r;
+            int16_t col = head_;
+
+            for (int16_t i = 0; i < width_; ++i) {
+                *pPixel++ = (pColumns_[col] & mask) ? fg : bg;
+
+                if (++col == width_) {
+                    col = 0;
+                }
+            }
+        }
+
+        pTft->pushImage(x, y + row, width_, rows, pPushBuffer_);
+    }
+}
+
+size_t TextLine::memoryUsage() const {
+    return sizeof(*this) + width_ * sizeof(uint32_t);
+}
@@ -0,0 +1,746 @@
+/**
+    TimeshiftProxy:
+    Local HTTP proxy between a stream host and the audio library. It keeps
+    receiving the stream while the library does not read (pause) and holds
+    the data in a RAM ring with a spill file on flash, so that playing can
+    resume where it has been paused. After the pause it skips the newer data
+    until the spill file has been played and returns to the live stream.
+    It also keeps a standby connection to the next station, which a station
+    switch takes over without connecting and waiting for the host.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TimeshiftProxy.h"
+#include "HostCache.h"
+#include <lwip/sockets.h>
+
+const size_t TimeshiftProxy::kMaxUrlLength;
+const uint32_t TimeshiftProxy::kStandbyMaxAge;
+
+/** Size of the chunks passed from the host to the buffer and from the buffer to the audio library */
+const size_t kProxyChunkSize = 2048;
+
+/** Maximum data in bytes passed in each direction by one pass of the proxy task (limits the time the mutex is held) */
+const size_t kProxyPassLimit = 16384;
+
+/** Maximum time in ms the proxy task waits for its sockets when no data could be moved */
+const uint32_t kProxyIdleDelay = 20;
+
+/** Maximum time in ms 'end' waits for the proxy task (one pass of the task) */
+const uint32_t kProxyStopTimeout = 1000;
+
+/** Maximum time in ms for connecting to the stream host */
+const int32_t kProxyConnectTimeout = 3000;
+
+/** Length of the audio sections of a stream without ICY metadata in bytes (a multiple of the 16 bit stereo frame) */
+const size_t kProxySectionLength = 4096;
+
+TimeshiftProxy::TimeshiftProxy(fs::FS &fs, const char *spillPath, size_t ramSize, size_t spillSize, size_t standbySize) :
+    fs_(fs),
+    spillPath_(spillPath),
+    ramSize_(ramSize),
+    spillSize_(spillSize),
+    spillCapacity_(0),
+    pRam_(nullptr),
+    ramStart_(0),
+    ramFill_(0),
+    spillStart_(0),
+    spillFill_(0),
+    pSend_(nullptr),
+    sendLength_(0),
+    sendPos_(0),
+    pReceive_(nullptr),
+    section_(HEADER),
+    sectionLeft_(0),
+    metaint_(0),
+    headerLineLength_(0),
+    paused_(false),
+    skipping_(false),
+    skipped_(0),
+    listenFd_(-1),
+    port_(0),
+    clientFd_(-1),
+    standbyTime_(0),
+    pStandby_(nullptr),
+    standbySize_(min(standbySize, ramSize)), // The data received ahead is moved to the RAM ring by 'open'
+    standbyFill_(0),
+    warm_(false),
+    open_(false),
+    pTask_(nullptr),
+    stop_(false),
+    mutex_(nullptr)
+{
+    standbyUrl_[0] = '\0';
+}
+
+bool TimeshiftProxy::begin(UBaseType_t priority, BaseType_t core, uint32_t stackSize) {
+    if (pTask_ != nullptr) {
+        if (stop_) {
+            log_w("Timeshift proxy task still stopping.");
+            return false;
+        }
+
+        log_w("Timeshift proxy task already running.");
+        return true;
+    }
+
+    if (mutex_ == nullptr) {
+        mutex_ = xSemaphoreCreateMutex();
+    }
+
+    if (pRam_ == nullptr) {
+        pRam_ = (uint8_t*) malloc(ramSize_);
+        pSend_ = (uint8_t*) malloc(kProxyChunkSize);
+        pReceive_ = (uint8_t*) malloc(kProxyChunkSize);
+        pStandby_ = (standbySize_ > 0) ? (uint8_t*) malloc(standbySize_) : nullptr;
+    }
+
+    if ( mutex_ == nullptr || pRam_ == nullptr || pSend_ == nullptr || pReceive_ == nullptr
+         || (standbySize_ > 0 && pStandby_ == nullptr) ) {
+        log_w("Cannot allocate timeshift buffer of %u bytes.", (uint32_t) (ramSize_ + 2 * kProxyChunkSize + standbySize_));
+        end();
+        return false;
+    }
+
+    // Local port of the proxy (chosen by the stack)
+    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+
+    struct sockaddr_in address;
+    socklen_t addressLen = sizeof(address);
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+
+    if ( listenFd_ < 0
+         || bind(listenFd_, (struct sockaddr*) &address, sizeof(address)) != 0
+         || listen(listenFd_, 1) != 0
+         || getsockname(listenFd_, (struct sockaddr*) &address, &addressLen) != 0 ) {
+        log_w("Timeshift proxy: cannot open local port (errno %d).", errno);
+        end();
+        return false;
+    }
+
+    fcntl(listenFd_, F_SETFL, fcntl(listenFd_, F_GETFL, 0) | O_NONBLOCK);
+    port_ = ntohs(address.sin_port);
+
+    // Without the spill file a pause is buffered in RAM only
+    spillCapacity_ = 0;
+
+    if (spillSize_ > 0) {
+        spillFile_ = fs_.open(spillPath_, "w+");
+
+        if (spillFile_) {
+            spillCapacity_ = spillSize_;
+        }
+        else {
+            log_w("Timeshift proxy: cannot create '%s', pauses are buffered in RAM only.", spillPath_);
+        }
+    }
+
+    stop_ = false;
+
+    if (xTaskCreatePinnedToCore(task, "Timeshift proxy task", stackSize, this, priority, &pTask_, core) != pdPASS) {
+        pTask_ = nullptr;
+        end();
+        return false;
+    }
+
+    log_i("Timeshift proxy on port %u: %u bytes RAM, %u bytes spill file, %u bytes standby",
+        port_, (uint32_t) ramSize_, (uint32_t) spillCapacity_, (uint32_t) standbySize_);
+
+    return true;
+}
+
+bool TimeshiftProxy::end() {
+    if (pTask_ != nullptr) {
+        stop_ = true;
+
+        unsigned long startTime = millis();
+
+        while (pTask_ != nullptr && millis() - startTime < kProxyStopTimeout) {
+            vTaskDelay(10 / portTICK_PERIOD_MS);
+        }
+
+        // The task may still use the buffers
+        if (pTask_ != nullptr) {
+            log_w("Timeshift proxy task has not ended within %u ms.", kProxyStopTimeout);
+            return false;
+        }
+    }
+
+    if (mutex_ != nullptr) {
+        closeSession();
+        closeStandby();
+    }
+
+    if (listenFd_ >= 0) {
+        ::close(listenFd_);
+        listenFd_ = -1;
+    }
+
+    if (spillFile_) {
+        spillFile_.close();
+        fs_.remove(spillPath_);
+    }
+
+    spillCapacity_ = 0;
+
+    free(pRam_);
+    free(pSend_);
+    free(pReceive_);
+    free(pStandby_);
+    pRam_ = nullptr;
+    pSend_ = nullptr;
+    pReceive_ = nullptr;
+    pStandby_ = nullptr;
+
+    return true;
+}
+
+bool TimeshiftProxy::isSupportedUrl(const char *url) {
+    return strncasecmp(url, "http://", 7) == 0;
+}
+
+bool TimeshiftProxy::open(const char *url, const IPAddress &hostIp, char *localUrl) {
+    char host[HostCache::kMaxHostLength];
+    char path[kMaxUrlLength];
+    uint16_t port;
+
+    close();
+
+    if ( pTask_ == nullptr || !isSupportedUrl(url) ) {
+        return false;
+    }
+
+    // The URL of the proxy is longer than the stream URL: the stream is connected directly if it does not fit
+    if ( !splitUrl(url, host, port, path)
+         || snprintf(localUrl, kMaxUrlLength, "http://127.0.0.1:%u%s", port_, path) >= (int) kMaxUrlLength ) {
+        log_d("Timeshift proxy: URL too long for the proxy: '%s'", url);
+        return false;
+    }
+
+    // Take over the standby connection of the same URL, the data received ahead goes to the RAM ring
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    bool warm = (standbyUrl_[0] != '\0') && (strcmp(standbyUrl_, url) == 0);
+
+    if (warm) {
+        host_ = standby_;
+        receive(pStandby_, standbyFill_);
+        open_ = true;
+    }
+
+    closeStandby();
+    warm_ = warm;
+
+    xSemaphoreGive(mutex_);
+
+    if (warm) {
+        log_d("Timeshift proxy: '%s' served as '%s' from the standby connection", url, localUrl);
+        return true;
+    }
+
+    WiFiClient client;
+
+    if ( !connectHost(client, host, port, path, hostIp) ) {
+        log_d("Timeshift proxy: cannot connect to '%s'", url);
+        return false;
+    }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    host_ = client;
+    open_ = true;
+
+    xSemaphoreGive(mutex_);
+
+    log_d("Timeshift proxy: '%s' served as '%s'", url, localUrl);
+
+    return true;
+}
+
+bool TimeshiftProxy::openStandby(const char *url, const IPAddress &hostIp) {
+    char host[HostCache::kMaxHostLength];
+    char path[kMaxUrlLength];
+    uint16_t port;
+
+    if ( pTask_ == nullptr || pStandby_ == nullptr || !isSupportedUrl(url) || !splitUrl(url, host, port, path) ) {
+        return false;
+    }
+
+    WiFiClient client;
+
+    if ( !connectHost(client, host, port, path, hostIp) ) {
+        log_d("Timeshift proxy: cannot open standby connection to '%s'", url);
+        return false;
+    }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    closeStandby();
+    standby_ = client;
+    strlcpy(standbyUrl_, url, kMaxUrlLength);
+    standbyTime_ = millis();
+
+    xSemaphoreGive(mutex_);
+
+    log_d("Timeshift proxy: standby connection to '%s'", url);
+
+    return true;
+}
+
+void TimeshiftProxy::close() {
+    if (mutex_ == nullptr) {
+        return;
+    }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    closeSession();
+
+    xSemaphoreGive(mutex_);
+}
+
+void TimeshiftProxy::setPaused(bool paused) {
+    if (mutex_ == nullptr) {
+        return;
+    }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    paused_ = paused;
+
+    xSemaphoreGive(mutex_);
+}
+
+void TimeshiftProxy::task(void *p) {
+    TimeshiftProxy *pProxy = (TimeshiftProxy*) p;
+
+    while (!pProxy->stop_) {
+        xSemaphoreTake(pProxy->mutex_, portMAX_DELAY);
+
+        bool moved = pProxy->pump();
+
+        // Sockets to wait for: connection of the audio library, data from the host, the audio library reading
+        fd_set readSet;
+        fd_set writeSet;
+        int maxFd = pProxy->listenFd_;
+
+        FD_ZERO(&readSet);
+        FD_ZERO(&writeSet);
+        FD_SET(pProxy->listenFd_, &readSet);
+
+        if (pProxy->open_ && pProxy->room() > 0 && pProxy->host_.fd() >= 0) {
+            FD_SET(pProxy->host_.fd(), &readSet);
+            maxFd = max(maxFd, pProxy->host_.fd());
+        }
+
+        if (pProxy->clientFd_ >= 0) {
+            FD_SET(pProxy->clientFd_, &readSet);
+            maxFd = max(maxFd, pProxy->clientFd_);
+
+            if (pProxy->sendPos_ < pProxy->sendLength_ || pProxy->ramFill_ + pProxy->spillFill_ > 0) {
+                FD_SET(pProxy->clientFd_, &writeSet);
+            }
+        }
+
+        xSemaphoreGive(pProxy->mutex_);
+
+        vTaskDelay(1); // One tick: lets the audio task decode
+
+        if (!moved) {
+            struct timeval timeout = {0, (long) kProxyIdleDelay * 1000};
+
+            select(maxFd + 1, &readSet, &writeSet, nullptr, &timeout);
+        }
+    }
+
+    pProxy->pTask_ = nullptr;
+    vTaskDelete(nullptr);
+}
+
+bool TimeshiftProxy::pump() {
+    acceptClient();
+    pumpStandby();
+
+    if (!open_) {
+        return false;
+    }
+
+    size_t moved = 0;
+
+    // Receive from the host while there is room in the buffer (otherwise the host queues the stream)
+    while (moved < kProxyPassLimit) {
+        size_t space = room();
+        int avail = host_.available();
+
+        if (space == 0 || avail <= 0) {
+            break;
+        }
+
+        int len = host_.read(pReceive_, min( min((size_t) avail, kProxyChunkSize), space ));
+
+        if (len <= 0) {
+            break;
+        }
+
+        receive(pReceive_, len);
+        moved += len;
+    }
+
+    if (clientFd_ < 0) {
+        return moved > 0;
+    }
+
+    // The request of the audio library is not needed (the host has been requested by 'open')
+    uint8_t request[64];
+    ssize_t requestLen = recv(clientFd_, request, sizeof(request), MSG_DONTWAIT);
+
+    if (requestLen == 0 || (requestLen < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        log_d("Timeshift proxy: connection closed by the audio library");
+        closeSession();
+        return true;
+    }
+
+    // Pass the oldest data on as far as the audio library reads (nothing while paused)
+    size_t sent = 0;
+
+    while (sent < kProxyPassLimit) {
+        if (sendPos_ == sendLength_) {
+            sendLength_ = bufferRead(pSend_, kProxyChunkSize);
+            sendPos_ = 0;
+        }
+
+        if (sendPos_ == sendLength_) {
+            if ( sent == 0 && !host_.connected() ) {
+                // End of stream: everything received has been passed on
+                log_d("Timeshift proxy: stream ended by the host");
+                closeSession();
+                return true;
+            }
+
+            break;
+        }
+
+        ssize_t len = send(clientFd_, pSend_ + sendPos_, sendLength_ - sendPos_, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+        if (len > 0) {
+            sendPos_ += len;
+            sent += len;
+        }
+        else if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            log_d("Timeshift proxy: connection to the audio library lost");
+            closeSession();
+            return true;
+        }
+        else {
+            break; // The audio library has not read yet
+        }
+    }
+
+    return moved + sent > 0;
+}
+
+void TimeshiftProxy::acceptClient() {
+    int fd = accept(listenFd_, nullptr, nullptr);
+
+    if (fd < 0) {
+        return;
+    }
+
+    if (!open_ || clientFd_ >= 0) {
+        ::close(fd); // Only the audio library of the open session is served
+        return;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    // Keep the stream in the buffer instead of the socket, so the buffer metrics are accurate; send the
+    // chunks right away (no wait for the acknowledgement of the previous chunk)
+    int sendBuffer = kProxyChunkSize;
+    int noDelay = 1;
+
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    clientFd_ = fd;
+}
+
+void TimeshiftProxy::closeSession() {
+    host_.stop();
+
+    if (clientFd_ >= 0) {
+        ::close(clientFd_);
+        clientFd_ = -1;
+    }
+
+    ramStart_ = 0;
+    ramFill_ = 0;
+    spillStart_ = 0;
+    spillFill_ = 0;
+    sendLength_ = 0;
+    sendPos_ = 0;
+    section_ = HEADER;
+    metaint_ = 0;
+    headerLineLength_ = 0;
+    paused_ = false;
+    skipping_ = false;
+    skipped_ = 0;
+    warm_ = false;
+    open_ = false;
+}
+
+void TimeshiftProxy::pumpStandby() {
+    if (standbyUrl_[0] == '\0') {
+        return;
+    }
+
+    if (millis() - standbyTime_ >= kStandbyMaxAge) {
+        log_d("Timeshift proxy: standby connection to '%s' expired", standbyUrl_);
+        closeStandby();
+        return;
+    }
+
+    // Only the start of the response is received, the host queues the rest until the connection is taken over
+    int avail = standby_.available();
+
+    if (avail > 0) {
+        if (standbyFill_ < standbySize_) {
+            int len = standby_.read(pStandby_ + standbyFill_, min((size_t) avail, standbySize_ - standbyFill_));
+
+            if (len > 0) {
+                standbyFill_ += len;
+            }
+        }
+    }
+    else if ( !standby_.connected() ) {
+        log_d("Timeshift proxy: standby connection to '%s' closed by the host", standbyUrl_);
+        closeStandby();
+    }
+}
+
+void TimeshiftProxy::closeStandby() {
+    standby_.stop();
+    standbyUrl_[0] = '\0';
+    standbyFill_ = 0;
+}
+
+bool TimeshiftProxy::splitUrl(const char *url, char *host, uint16_t &port, char *path) {
+    if ( !HostCache::parseHost(url, host) ) {
+        return false;
+    }
+
+    // Port and path follow the host name
+    const char *pPath = url + 7 + strlen(host);
+
+    port = 80;
+
+    if (*pPath == ':') {
+        port = (uint16_t) atoi(pPath + 1);
+        pPath += strspn(pPath + 1, "0123456789") + 1;
+    }
+
+    return snprintf(path, kMaxUrlLength, "%s%s", (*pPath == '/') ? "" : "/", pPath) < (int) kMaxUrlLength;
+}
+
+bool TimeshiftProxy::connectHost(WiFiClient &client, const char *host, uint16_t port, const char *path, const IPAddress &hostIp) {
+    bool connected = ((uint32_t) hostIp != 0) ? client.connect(hostIp, port, kProxyConnectTimeout)
+        : client.connect(host, port, kProxyConnectTimeout);
+
+    if (!connected) {
+        return false;
+    }
+
+    // Request of the audio library, the response of the host is passed on
+    char request[kMaxUrlLength + HostCache::kMaxHostLength + 128];
+    int requestLen = snprintf(request, sizeof(request),
+        "GET %s HTTP/1.1\r\nHost: %s\r\nIcy-MetaData:1\r\nAccept: */*\r\nUser-Agent: VLC/3.0.8 LibVLC/3.0.8\r\nConnection: close\r\n\r\n",
+        path, host);
+
+    if (client.write((const uint8_t*) request, requestLen) != (size_t) requestLen) {
+        client.stop();
+        return false;
+    }
+
+    return true;
+}
+
+void TimeshiftProxy::receive(const uint8_t *data, size_t length) {
+    while (length > 0) {
+        // The header is passed byte by byte, the other sections as a whole
+        size_t len = (section_ == HEADER || section_ == META_LENGTH) ? 1 : min(length, sectionLeft_);
+
+        if (skipping_) {
+            skipped_ += len;
+        }
+        else {
+            bufferWrite(data, len);
+        }
+
+        switch (section_) {
+            case HEADER:
+                if (*data == '\n') {
+                    headerLine_[headerLineLength_] = '\0';
+
+                    if (headerLineLength_ == 0 || strcmp(headerLine_, "\r") == 0) {
+                        startAudioSection(); // End of the header
+                    }
+                    else if (strncasecmp(headerLine_, "icy-metaint:", 12) == 0) {
+                        metaint_ = (uint32_t) atoi(headerLine_ + 12);
+                    }
+
+                    headerLineLength_ = 0;
+                }
+                else if (headerLineLength_ < sizeof(headerLine_) - 1) {
+                    headerLine_[headerLineLength_++] = (char) *data;
+                }
+
+                break;
+
+            case AUDIO:
+                sectionLeft_ -= len;
+
+                if (sectionLeft_ == 0) {
+                    if (metaint_ > 0) {
+                        section_ = META_LENGTH;
+                    }
+                    else {
+                        startAudioSection();
+                    }
+                }
+
+                break;
+
+            case META_LENGTH:
+                sectionLeft_ = *data * 16;
+                section_ = META;
+
+                if (sectionLeft_ == 0) {
+                    startAudioSection();
+                }
+
+                break;
+
+            case META:
+                sectionLeft_ -= len;
+
+                if (sectionLeft_ == 0) {
+                    startAudioSection();
+                }
+
+                break;
+        }
+
+        data += len;
+        length -= len;
+    }
+}
+
+void TimeshiftProxy::startAudioSection() {
+    section_ = AUDIO;
+    sectionLeft_ = (metaint_ > 0) ? metaint_ : kProxySectionLength;
+
+    // Skip the newer data after a pause while the stored part of the stream is played from the spill file
+    bool skip = !paused_ && spillFill_ > 0;
+
+    if (skipping_ && !skip) {
+        log_i("Timeshift proxy: back to the live stream, %u bytes skipped", (uint32_t) skipped_);
+    }
+
+    skipping_ = skip;
+}
+
+size_t TimeshiftProxy::bufferWrite(const uint8_t *data, size_t length) {
+    size_t written = 0;
+
+    // RAM ring (newer data must not overtake the data in the spill file)
+    while (spillFill_ == 0 && ramFill_ < ramSize_ && written < length) {
+        size_t pos = (ramStart_ + ramFill_) % ramSize_;
+        size_t len = min( min(length - written, ramSize_ - ramFill_), ramSize_ - pos );
+
+        memcpy(pRam_ + pos, data + written, len);
+        ramFill_ += len;
+        written += len;
+    }
+
+    // Spill file used as ring: while paused (and for the rest of the audio section in which the pause has ended)
+    while ((paused_ || spillFill_ > 0) && spillFill_ < spillCapacity_ && written < length) {
+        size_t pos = (spillStart_ + spillFill_) % spillCapacity_;
+        size_t len = min( min(length - written, spillCapacity_ - spillFill_), spillCapacity_ - pos );
+
+        if ( !spillFile_.seek(pos) || spillFile_.write(data + written, len) != len ) {
+            // File system full: the spill file keeps its size (the ring has not wrapped before the file has grown)
+            if (spillStart_ + spillFill_ <= spillCapacity_) {
+                spillCapacity_ = spillStart_ + spillFill_;
+            }
+
+            log_w("Timeshift proxy: cannot write '%s', spill file limited to %u bytes, %u bytes dropped.",
+                spillPath_, (uint32_t) spillCapacity_, (uint32_t) (length - written));
+            break;
+        }
+
+        spillFill_ += len;
+        written += len;
+    }
+
+    return written;
+}
+
+size_t TimeshiftProxy::bufferRead(uint8_t *data, size_t length) {
+    size_t read = 0;
+
+    // RAM ring holds the oldest data
+    while (ramFill_ > 0 && read < length) {
+        size_t len = min( min(length - read, (size_t) ramFill_), ramSize_ - ramStart_ );
+
+        memcpy(data + read, pRam_ + ramStart_, len);
+        ramStart_ = (ramStart_ + len) % ramSize_;
+        ramFill_ -= len;
+        read += len;
+    }
+
+    while (ramFill_ == 0 && spillFill_ > 0 && read < length) {
+        size_t len = min( min(length - read, (size_t) spillFill_), spillCapacity_ - spillStart_ );
+
+        if ( !spillFile_.seek(spillStart_) || spillFile_.read(data + read, len) != len ) {
+            log_w("Timeshift proxy: cannot read '%s', %u bytes lost.", spillPath_, (uint32_t) spillFill_);
+            spillFill_ = 0;
+            break;
+        }
+
+        spillStart_ = (spillStart_ + len) % spillCapacity_;
+        spillFill_ -= len;
+        read += len;
+    }
+
+    if (spillFill_ == 0) {
+        spillStart_ = 0; // The spill file is written from the beginning again
+    }
+
+    return read;
+}
+
+size_t TimeshiftProxy::room() const {
+    if (spillFill_ > 0) {
+        // After the pause the RAM ring takes the data when the spill file has been played
+        return paused_ ? spillCapacity_ - spillFill_ : min(ramSize_ - ramFill_, spillCapacity_ - spillFill_);
+    }
+
+    return ramSize_ - ramFill_ + (paused_ ? spillCapacity_ : 0);
+}
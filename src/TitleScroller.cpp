@@ -0,0 +1,97 @@
+/**
+    TitleScroller:
+    Scrolls a single line of text of arbitrary length through a screen-wide
+    ring buffer of pixel columns. Glyph columns are taken from the glyph
+    atlas on demand when they enter the visible window.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TitleScroller.h"
+
+const size_t TitleScroller::kMaxTextLength;
+
+TitleScroller::TitleScroller(const GlyphAtlas *pAtlas) :
+    pAtlas_(pAtlas),
+    line_(pAtlas),
+    color_(TFT_WHITE),
+    textLength_(0),
+    textIndex_(0),
+    glyphColumn_(0),
+    gapColumns_(0)
+{
+    text_[0] = '\0';
+}
+
+bool TitleScroller::begin(int16_t width, uint16_t color) {
+    color_ = color;
+
+    return line_.begin(width);
+}
+
+void TitleScroller::setText(const char *text) {
+    strlcpy(text_, text, kMaxTextLength);
+    textLength_ = strlen(text_);
+    textIndex_ = 0;
+    glyphColumn_ = 0;
+    gapColumns_ = 0;
+
+    line_.clear(); // The text enters the empty window from the right edge
+}
+
+void TitleScroller::scroll(TFT_eSPI *pTft, int16_t x, int16_t y) {
+    line_.scrollIn( nextColumn() ); // Render only the column entering the window
+    push(pTft, x, y);
+}
+
+void TitleScroller::push(TFT_eSPI *pTft, int16_t x, int16_t y) {
+    line_.push(pTft, x, y, color_, TFT_BLACK);
+}
+
+uint32_t TitleScroller::nextColumn() {
+    uint16_t len = textLength_;
+
+    if (len == 0 || gapColumns_ > 0) {
+        if (gapColumns_ > 0) {
+            --gapColumns_;
+        }
+
+        return 0;
+    }
+
+    // Skip characters that are not contained in the atlas (e.g. UTF-8 sequences)
+    while (textIndex_ < len && pAtlas_->width(text_[textIndex_]) == 0) {
+        ++textIndex_;
+    }
+
+    if (textIndex_ >= len) {
+        // After the end of the text, the window runs empty before the text starts again
+        textIndex_ = 0;
+        gapColumns_ = line_.width() - 1;
+
+        return 0;
+    }
+
+    uint8_t c = text_[textIndex_];
+    uint32_t column = pAtlas_->column(c, glyphColumn_);
+
+    if (++glyphColumn_ >= pAtlas_->width(c)) {
+        glyphColumn_ = 0;
+        ++textIndex_;
+    }
+
+    return column;
+}
@@ -0,0 +1,148 @@
+/**
+    UnmutePolicy:
+    Decides when the audio output can be unmuted after connecting to a
+    stream, based on the measured data rate of the stream compared to its
+    bitrate and the observed jitter of the incoming data.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "UnmutePolicy.h"
+
+const uint32_t UnmutePolicy::kBaseHeadroom;
+const uint32_t UnmutePolicy::kJitterFactor;
+const uint32_t UnmutePolicy::kErrorTimeMin;
+const uint32_t UnmutePolicy::kErrorTimeMax;
+const uint32_t UnmutePolicy::kRateWindow;
+
+UnmutePolicy::UnmutePolicy() :
+    byteRate_(0),
+    bufferSize_(0),
+    bufferFilled_(0),
+    timeStart_(0),
+    timeNow_(0),
+    timeLastData_(0),
+    maxGap_(0),
+    timeWindow_(0),
+    bufferFilledWindow_(0),
+    netRate_(0),
+    netRateValid_(false)
+{
+}
+
+void UnmutePolicy::reset(uint32_t time, uint32_t bufferSize) {
+    byteRate_ = 0; // The bitrate is reported again for the new stream
+    bufferSize_ = bufferSize;
+    bufferFilled_ = 0;
+    timeStart_ = time;
+    timeNow_ = time;
+    timeLastData_ = time;
+    maxGap_ = 0;
+    timeWindow_ = time;
+    bufferFilledWindow_ = 0;
+    netRate_ = 0;
+    netRateValid_ = false;
+}
+
+void UnmutePolicy::setBitrate(const char *info) {
+    uint32_t bitrate = strtoul(info, nullptr, 10);
+
+    // Stream headers ('icy-br') report kbit/s, the decoder reports bit/s
+    if (bitrate < 10000) {
+        bitrate *= 1000;
+    }
+
+    byteRate_ = bitrate / 8;
+}
+
+void UnmutePolicy::update(uint32_t time, uint32_t bufferFilled) {
+    if (bufferFilled > bufferFilled_) {
+        uint32_t gap = time - timeLastData_;
+
+        // The first data after connecting is part of the connection setup, not jitter
+        if (bufferFilled_ > 0 && gap > maxGap_) {
+            maxGap_ = gap;
+        }
+
+        timeLastData_ = time;
+    }
+
+    // Measure the change of the buffer fill over the rate window
+    uint32_t window = time - timeWindow_;
+
+    if (window >= kRateWindow) {
+        int32_t rate = (int32_t) ((int64_t) ((int32_t) bufferFilled - (int32_t) bufferFilledWindow_) * 1000 / window);
+
+        netRate_ = netRateValid_ ? (3 * netRate_ + rate) / 4 : rate; // Exponential smoothing
+        netRateValid_ = true;
+
+        timeWindow_ = time;
+        bufferFilledWindow_ = bufferFilled;
+    }
+
+    bufferFilled_ = bufferFilled;
+    timeNow_ = time;
+}
+
+bool UnmutePolicy::shouldUnmute() const {
+    // Buffer almost full: there is nothing to gain by waiting any longer
+    if (bufferFilled_ > 0.9f * bufferSize_) {
+        return true;
+    }
+
+    // Without the bitrate there is no reference for the data rate
+    if (byteRate_ == 0) {
+        return false;
+    }
+
+    // The stream has to deliver data at least as fast as it is played, i.e. the buffer must not shrink
+    if (!netRateValid_ || netRate_ < 0) {
+        return false;
+    }
+
+    return bufferFilled_ >= requiredFill();
+}
+
+bool UnmutePolicy::isStreamError() const {
+    uint32_t elapsed = timeNow_ - timeStart_;
+
+    if (elapsed > kErrorTimeMax) {
+        return true;
+    }
+
+    if (elapsed > kErrorTimeMin) {
+        // No data at all, or data arriving clearly slower than the bitrate
+        return (bufferFilled_ == 0) || (byteRate_ > 0 && incomingRate() < (int32_t) (byteRate_ * 3 / 4));
+    }
+
+    return false;
+}
+
+void UnmutePolicy::log(const char *reason) const {
+    log_i("%s: fill = %u/%u bytes, required = %u bytes, bitrate = %u bytes/s, incoming = %d bytes/s, net = %d bytes/s, max gap = %u ms, elapsed = %u ms",
+        reason, bufferFilled_, bufferSize_, requiredFill(), byteRate_, incomingRate(), netRate_, maxGap_, timeNow_ - timeStart_);
+}
+
+uint32_t UnmutePolicy::requiredFill() const {
+    uint32_t headroom = kBaseHeadroom + kJitterFactor * maxGap_; // ms
+
+    return (uint32_t) ((uint64_t) byteRate_ * headroom / 1000);
+}
+
+int32_t UnmutePolicy::incomingRate() const {
+    // While buffering, the decoder already consumes data at the bitrate of the stream
+    return netRate_ + (int32_t) byteRate_;
+}
@@ -0,0 +1,181 @@
+/**
+    test_gain_ramp:
+    Host benchmark of the gain stage: time per stereo frame and cycles per
+    sample for a constant gain (block loop) and for each ramp curve (per
+    frame as in the radio path), with a check of the ramp timing and shape.
+    The cycles on the device are logged by 'benchmarkGainRamp' of the app.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+#include "GainRamp.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/** Sample rate of the tests in Hz */
+const uint32_t kSampleRate = 44100;
+
+/** Frames per block (size of a DMA buffer) and number of blocks of the benchmark */
+const uint16_t kFrames = 512;
+const uint16_t kRuns = 2000;
+
+/** Upper limit of the time per frame on the host in ns (a frame lasts 22676 ns at 44.1 kHz) */
+const uint32_t kMaxFrameTime = 200;
+
+static const char* const kCurveNames[] = {"linear", "exponential", "s-curve"};
+
+static int16_t samples_[2 * kFrames];
+
+// Prevents the compiler from removing the processing
+static volatile int32_t checksum_;
+
+static void fillSamples() {
+    for (uint16_t i = 0; i < 2 * kFrames; ++i) {
+        samples_[i] = (int16_t) (i * 97);
+    }
+}
+
+/** Time stamp counter of the CPU (0 if not available) */
+static uint64_t cycleCount() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/** Measurement of the processing time of 'kRuns' blocks */
+struct Measurement {
+    std::chrono::steady_clock::time_point startTime;
+    uint64_t startCycles;
+
+    Measurement() : startTime(std::chrono::steady_clock::now()), startCycles(cycleCount()) {}
+
+    /**
+     * Logs the time per frame and the cycles per sample.
+     *
+     * @return Time in ns per frame.
+     */
+    uint32_t report(const char *name) const {
+        uint64_t cycles = cycleCount() - startCycles;
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+        double frames = (double) kRuns * kFrames;
+        char message[100];
+
+        snprintf(message, sizeof(message), "Gain stage: %s %.2f ns/frame, %.2f cycles/sample", name,
+            ns / frames, cycles / (2 * frames));
+        TEST_MESSAGE(message);
+
+        return (uint32_t) (ns / frames);
+    }
+};
+
+void setUp(void) {
+    fillSamples();
+}
+
+void tearDown(void) {
+}
+
+void test_ramp_reaches_target_in_time(void) {
+    const uint32_t kDuration = 100;
+    const uint32_t kRampFrames = kDuration * kSampleRate / 1000;
+
+    for (uint8_t curve = 0; curve < 3; ++curve) {
+        GainRamp ramp;
+
+        ramp.setSampleRate(kSampleRate);
+        ramp.setGain(0);
+        ramp.rampTo(GainRamp::kUnity, kDuration, (GainRamp::Curve) curve);
+
+        uint32_t frames = 0;
+        int16_t previous = 0;
+
+        do {
+            int16_t left = GainRamp::kUnity;
+            int16_t right = GainRamp::kUnity;
+
+            ramp.processFrame(left, right);
+            ++frames;
+
+            // Fade-in without steps back
+            TEST_ASSERT_GREATER_OR_EQUAL(previous, left);
+            TEST_ASSERT_EQUAL_INT16(left, right);
+            previous = left;
+        } while (ramp.isRamping() && frames < 2 * kRampFrames);
+
+        // The increment per frame is rounded down, so the ramp takes slightly longer
+        TEST_ASSERT_UINT32_WITHIN(kRampFrames / 100, kRampFrames, frames);
+        TEST_ASSERT_INT_WITHIN(1, GainRamp::kUnity, previous); // Q15 unity is slightly below 1.0
+    }
+}
+
+void test_benchmark_constant_gain(void) {
+    GainRamp ramp;
+
+    ramp.setSampleRate(kSampleRate);
+    ramp.setGain(GainRamp::kUnity / 2);
+
+    Measurement measurement;
+
+    for (uint16_t run = 0; run < kRuns; ++run) {
+        ramp.process(samples_, kFrames);
+        checksum_ += samples_[run % (2 * kFrames)];
+    }
+
+    TEST_ASSERT_LESS_THAN_UINT32(kMaxFrameTime, measurement.report("constant gain"));
+}
+
+void test_benchmark_ramps(void) {
+    for (uint8_t curve = 0; curve < 3; ++curve) {
+        GainRamp ramp;
+
+        // Long enough to stay in the ramp for all runs
+        ramp.setSampleRate(kSampleRate);
+        ramp.setGain(0);
+        ramp.rampTo(GainRamp::kUnity, 60000, (GainRamp::Curve) curve);
+
+        Measurement measurement;
+
+        for (uint16_t run = 0; run < kRuns; ++run) {
+            for (uint16_t i = 0; i < kFrames; ++i) {
+                ramp.processFrame(samples_[2 * i], samples_[2 * i + 1]);
+            }
+
+            checksum_ += samples_[run % (2 * kFrames)];
+        }
+
+        char name[32];
+
+        snprintf(name, sizeof(name), "%s ramp", kCurveNames[curve]);
+        TEST_ASSERT_LESS_THAN_UINT32(kMaxFrameTime, measurement.report(name));
+        TEST_ASSERT_TRUE(ramp.isRamping());
+    }
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_ramp_reaches_target_in_time);
+    RUN_TEST(test_benchmark_constant_gain);
+    RUN_TEST(test_benchmark_ramps);
+
+    return UNITY_END();
+}
@@ -0,0 +1,173 @@
+/**
+    test_ifttt_outbox:
+    Tests of the IFTTT outbox against a webhook of the stand-in server:
+    JSON escaping of the entries, retries with exponential backoff while
+    the host fails, delivery in batches of the entries kept in NVS across
+    'begin' and discarding of entries rejected by the host.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <Arduino.h>
+#include <TestBench.h>
+#include <WiFi.h>
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "IftttOutbox.h"
+
+/** Path of the webhook on the stand-in server */
+const char kWebhookPath[] = "/trigger/song/json/with/key/test";
+
+/** Number of entries added while the host fails (more than one batch) */
+const uint8_t kEntries = 5;
+
+/** Number of failed attempts observed for the backoff */
+const uint8_t kAttempts = 3;
+
+/** Maximum time in ms for the WiFi connection */
+const uint32_t kConnectTimeout = 5000;
+
+/** Maximum time in ms for delivering the entries once the host accepts them */
+const uint32_t kDeliveryTimeout = 5000;
+
+static std::string url_;
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+/** Checks the escaped 'text' written to a buffer of 'size' bytes and the returned length */
+static void checkEscaped(const char *expected, const char *text, size_t size) {
+    char out[64];
+    size_t len = IftttOutbox::escapeJson(text, out, size);
+
+    TEST_ASSERT_EQUAL_STRING(expected, out);
+    TEST_ASSERT_EQUAL_UINT32(strlen(expected), len);
+}
+
+void test_escape_json(void) {
+    checkEscaped("\"Artist - Title\"", "Artist - Title", 64);
+    checkEscaped("\"Say \\\"hi\\\" \\\\ ok\"", "Say \"hi\" \\ ok", 64);
+    checkEscaped("\"a\\nb\\tc\\u0001\"", "a\nb\tc\x01", 64);
+    checkEscaped("\"Caf\xC3\xA9\"", "Caf\xC3\xA9", 64);
+
+    // Truncated at an escape sequence boundary, not within a UTF-8 sequence
+    checkEscaped("\"abc\"", "abc\"def", 7);
+    checkEscaped("\"a\"", "a\xC3\xBC", 5);
+    checkEscaped("", "abc", 2);
+}
+
+void test_retry_with_backoff(void) {
+    IftttOutbox outbox(url_.c_str());
+
+    standin_.addWebhook(kWebhookPath, 503);
+
+    TEST_ASSERT_TRUE(outbox.begin(1));
+
+    char text[IftttOutbox::kMaxTextLength];
+
+    for (uint8_t i = 1; i <= kEntries; ++i) {
+        snprintf(text, sizeof(text), "Entry %u", i);
+        TEST_ASSERT_TRUE(outbox.add(text));
+    }
+
+    // Time of each failed attempt
+    std::vector<unsigned long> attempts;
+    uint32_t timeout = 4 * (1 << kAttempts) * IftttOutbox::kRetryMin;
+    unsigned long start = millis();
+
+    while (attempts.size() < kAttempts && millis() - start < timeout) {
+        if (standin_.posts(kWebhookPath).size() > attempts.size()) {
+            attempts.push_back(millis());
+        }
+
+        delay(1);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(kAttempts, attempts.size(), "Failed requests not retried");
+    TEST_ASSERT_EQUAL_UINT32(kEntries, outbox.pending());
+
+    uint32_t firstDelay = (uint32_t) (attempts[1] - attempts[0]);
+    uint32_t secondDelay = (uint32_t) (attempts[2] - attempts[1]);
+    char message[80];
+
+    snprintf(message, sizeof(message), "Retries after %u ms and %u ms", firstDelay, secondDelay);
+    TEST_MESSAGE(message);
+
+    // The delay is doubled with each failure
+    TEST_ASSERT_UINT32_WITHIN(IftttOutbox::kRetryMin / 4, IftttOutbox::kRetryMin, firstDelay);
+    TEST_ASSERT_UINT32_WITHIN(IftttOutbox::kRetryMin / 2, 2 * IftttOutbox::kRetryMin, secondDelay);
+
+    // The pending entries are written to NVS
+    TEST_ASSERT_TRUE(outbox.end());
+}
+
+void test_deliver_batches_after_begin(void) {
+    // Like after a restart: a new outbox loads the entries from NVS and sends them right away
+    IftttOutbox outbox(url_.c_str());
+    size_t failed = standin_.posts(kWebhookPath).size();
+
+    standin_.addWebhook(kWebhookPath, 200);
+
+    TEST_ASSERT_TRUE(outbox.begin(1));
+    TEST_ASSERT_TRUE_MESSAGE(TestBench::waitFor([&] { return outbox.pending() == 0; }, kDeliveryTimeout),
+        "Entries not delivered");
+
+    std::vector<std::string> posts = standin_.posts(kWebhookPath);
+
+    TEST_ASSERT_EQUAL_UINT32(failed + 2, posts.size());
+    TEST_ASSERT_EQUAL_STRING("{\"value1\":\"Entry 1\",\"value2\":\"Entry 2\",\"value3\":\"Entry 3\"}", posts[failed].c_str());
+    TEST_ASSERT_EQUAL_STRING("{\"value1\":\"Entry 4\",\"value2\":\"Entry 5\"}", posts[failed + 1].c_str());
+
+    // A rejected request is not retried: the entry is discarded
+    standin_.addWebhook(kWebhookPath, 400);
+
+    TEST_ASSERT_TRUE(outbox.add("Say \"hi\"\n"));
+    TEST_ASSERT_TRUE_MESSAGE(TestBench::waitFor([&] { return outbox.pending() == 0; }, kDeliveryTimeout),
+        "Rejected entry not discarded");
+
+    posts = standin_.posts(kWebhookPath);
+
+    TEST_ASSERT_EQUAL_UINT32(failed + 3, posts.size());
+    TEST_ASSERT_EQUAL_STRING("{\"value1\":\"Say \\\"hi\\\"\\n\"}", posts.back().c_str());
+
+    TEST_ASSERT_TRUE(outbox.end());
+}
+
+int main(int argc, char **argv) {
+    if ( !TestBench::begin("ifttt_outbox", argv[0]) ) {
+        return 1;
+    }
+
+    standin_.addWebhook(kWebhookPath, 200);
+    url_ = standin_.url(kWebhookPath);
+
+    WiFi.begin("Stand-in", "password");
+
+    if ( !TestBench::waitFor([] { return WiFi.status() == WL_CONNECTED; }, kConnectTimeout) ) {
+        return 1;
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_escape_json);
+    RUN_TEST(test_retry_with_backoff);
+    RUN_TEST(test_deliver_batches_after_begin);
+
+    TestBench::exit(UNITY_END());
+}
@@ -0,0 +1,186 @@
+/**
+    test_latency:
+    Benchmark of the native build: runs the radio against the stand-in server
+    and reports the time from boot to the first audio and from a press of
+    button A to unmuting the next station (median and maximum).
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <Arduino.h>
+#include <NativeHal.h>
+#include <TestBench.h>
+#include <unity.h>
+#include <algorithm>
+#include <vector>
+#include "Metrics.h"
+#include "TimeshiftProxy.h"
+
+extern Histogram metricTimeToAudio_;
+extern TimeshiftProxy timeshift_;
+
+/** Number of stations (three tone streams and a slow host) */
+const uint8_t kStations = 4;
+
+/** Number of station switches measured */
+const uint8_t kSwitches = 8;
+
+/** Time in ms a station plays before the next switch */
+const uint32_t kPlayTime = 1000;
+
+/** Upper limits of the latencies in ms (the WiFi model needs 1700 ms for scan, association and DHCP) */
+const uint32_t kMaxBootToAudio = 5000;
+const uint32_t kMaxButtonToUnmute = 1500;
+
+/** Time in ms the slow host needs to respond (shorter than 'kPlayTime', so the standby connection has received the response) */
+const uint32_t kSlowConnectDelay = 800;
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_boot_to_first_audio(void) {
+    TEST_ASSERT_TRUE_MESSAGE(TestBench::waitForAudio(1), "No audio after boot");
+
+    uint32_t ms = (uint32_t) metricTimeToAudio_.sum();
+    char message[80];
+
+    snprintf(message, sizeof(message), "Boot to first audio: %u ms", ms);
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_LESS_THAN_UINT32(kMaxBootToAudio, ms);
+}
+
+void test_button_to_unmute(void) {
+    std::vector<uint32_t> latencies;
+    uint32_t underruns = NativeHal::i2sStats().underruns;
+
+    for (uint8_t i = 0; i < kSwitches; ++i) {
+        uint32_t count = metricTimeToAudio_.count();
+
+        delay(kPlayTime);
+
+        unsigned long press = millis();
+
+        NativeHal::setPin(TestBench::kPinButtonA, LOW);
+
+        // The station may start playing while the button is held down
+        while (metricTimeToAudio_.count() == count && millis() - press < TestBench::kAudioTimeout) {
+            if (millis() - press >= TestBench::kPressTime) {
+                NativeHal::setPin(TestBench::kPinButtonA, HIGH);
+            }
+
+            delay(1);
+        }
+
+        latencies.push_back((uint32_t) (millis() - press));
+
+        TEST_ASSERT_TRUE_MESSAGE(metricTimeToAudio_.count() > count, "No audio after the station switch");
+
+        if (millis() - press < TestBench::kPressTime) {
+            delay(TestBench::kPressTime - (millis() - press));
+        }
+
+        NativeHal::setPin(TestBench::kPinButtonA, HIGH);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+
+    uint32_t median = latencies[latencies.size() / 2];
+    uint32_t maximum = latencies.back();
+    char message[120];
+
+    snprintf(message, sizeof(message), "Button to unmute: median %u ms, max %u ms (%u switches, %u underruns)",
+        median, maximum, (uint32_t) latencies.size(), NativeHal::i2sStats().underruns - underruns);
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_LESS_THAN_UINT32(kMaxButtonToUnmute, median);
+}
+
+void test_standby_connection_hides_slow_host(void) {
+    uint32_t requests = standin_.requests("/slow");
+
+    // Switch on until the station before the slow host plays: the standby task connects to the slow host
+    for (uint8_t i = 0; i < kStations && standin_.requests("/slow") == requests; ++i) {
+        uint32_t count = metricTimeToAudio_.count();
+
+        TestBench::pressButtonA();
+
+        TEST_ASSERT_TRUE_MESSAGE(TestBench::waitForAudio(count + 1), "No audio after the station switch");
+
+        TestBench::waitFor([&] { return standin_.requests("/slow") > requests; }, 500);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(requests + 1, standin_.requests("/slow"), "No standby connection to the slow host");
+
+    delay(kSlowConnectDelay + 200); // The slow host has responded
+
+    uint32_t count = metricTimeToAudio_.count();
+    double sum = metricTimeToAudio_.sum();
+
+    TestBench::pressButtonA();
+
+    TEST_ASSERT_TRUE_MESSAGE(TestBench::waitForAudio(count + 1), "No audio of the slow host");
+
+    uint32_t ms = (uint32_t) (metricTimeToAudio_.sum() - sum);
+    char message[120];
+
+    snprintf(message, sizeof(message), "Switch to a host responding after %u ms: %u ms", kSlowConnectDelay, ms);
+    TEST_MESSAGE(message);
+
+    // The standby connection has been taken over, the host has not been connected again
+    TEST_ASSERT_TRUE_MESSAGE(timeshift_.isWarm(), "Standby connection not taken over");
+    TEST_ASSERT_EQUAL_UINT32(requests + 1, standin_.requests("/slow"));
+    TEST_ASSERT_LESS_THAN_UINT32(kSlowConnectDelay, ms);
+}
+
+/**
+ * The stations are tone streams of the stand-in server, so the latencies depend on the application only; the last
+ * host responds slowly.
+ */
+int main(int argc, char **argv) {
+    if ( !TestBench::begin("latency", argv[0]) ) {
+        return 1;
+    }
+
+    for (const char *name : {"/a", "/b", "/c"}) {
+        standin_.addStream(StandinServer::toneStream(name, name + 1));
+
+        if ( !TestBench::addStation((std::string("Tone ") + (name + 1)).c_str(), standin_.url(name)) ) {
+            return 1;
+        }
+    }
+
+    StandinServer::Stream slow = StandinServer::toneStream("/slow", "Slow");
+
+    slow.connectDelay = kSlowConnectDelay;
+    standin_.addStream(slow);
+
+    if ( !TestBench::addStation("Slow", standin_.url("/slow")) ) {
+        return 1;
+    }
+
+    TestBench::startRadio();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_boot_to_first_audio);
+    RUN_TEST(test_button_to_unmute);
+    RUN_TEST(test_standby_connection_hides_slow_host);
+
+    TestBench::exit(UNITY_END());
+}
@@ -0,0 +1,157 @@
+/**
+    test_metadata_soak:
+    Plays a station of the stand-in server with a long stream title, which
+    has to reach the display untruncated, and runs the metadata soak test of
+    the radio while the station plays: thousands of simulated station names
+    and song infos must neither allocate from the heap nor reduce the largest
+    allocatable heap block.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <Arduino.h>
+#include <NativeHal.h>
+#include <TestBench.h>
+#include <unity.h>
+#include <new>
+#include "RadioMessages.h"
+
+extern char infoStr_[kEventTextLength];
+extern uint32_t soakUpdates_;
+extern uint32_t soakMaxAllocStart_;
+extern uint32_t soakMaxAllocMin_;
+
+void lockDisplay();
+void unlockDisplay();
+void runMetadataSoakTest();
+
+/** Number of simulated metadata updates ('kMetadataSoakUpdates' of the radio) */
+const uint32_t kSoakUpdates = 10000;
+
+/** Heap in bytes the tasks of the playing radio may take temporarily while the soak test runs */
+const uint32_t kHeapTolerance = 65536;
+
+// Flag enabling the count of allocations by the thread of the soak test (the heap model does not show fragmentation)
+static thread_local bool countAllocations_ = false;
+
+// Allocations with 'new' counted while enabled
+static uint32_t allocations_ = 0;
+
+void *operator new(size_t size) {
+    if (countAllocations_) {
+        ++allocations_;
+    }
+
+    void *p = malloc((size > 0) ? size : 1);
+
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+/** Stream title of a real station, longer than the 127 characters of earlier versions */
+const char *kLongTitle = "Nils Frahm, Olafur Arnalds & The Kronos Quartet - Ambre (Live at the Funkhaus Berlin, "
+    "Extended Version) | Now playing on Late Night Sessions with Anne Example | www.example-radio.de";
+
+/** true if the song info published to the display equals the text */
+static bool songInfoIs(const char *text) {
+    lockDisplay();
+
+    bool equal = (strcmp(infoStr_, text) == 0);
+
+    unlockDisplay();
+
+    return equal;
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_long_stream_title(void) {
+    TEST_ASSERT_TRUE_MESSAGE(TestBench::waitForAudio(1), "No audio after boot");
+
+    // The title is sent with each metadata block of the stream (every 8192 bytes)
+    TEST_ASSERT_TRUE_MESSAGE(TestBench::waitFor([] { return songInfoIs(kLongTitle); }, 3000), "Stream title not shown untruncated");
+}
+
+void test_soak_keeps_max_alloc_heap(void) {
+    uint32_t updates;
+
+    // Batches like in the loop of the radio, until all updates have been done
+    do {
+        updates = soakUpdates_;
+
+        countAllocations_ = true;
+        runMetadataSoakTest();
+        countAllocations_ = false;
+
+        delay(1);
+    } while (soakUpdates_ > updates);
+
+    char message[160];
+
+    snprintf(message, sizeof(message), "Metadata soak test: %u updates, %u allocations, max alloc heap %u at the start, min %u, %u at the end",
+        soakUpdates_, allocations_, soakMaxAllocStart_, soakMaxAllocMin_, ESP.getMaxAllocHeap());
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_EQUAL_UINT32(kSoakUpdates, soakUpdates_);
+    TEST_ASSERT_EQUAL_UINT32(0, allocations_);
+    TEST_ASSERT_GREATER_THAN_UINT32(soakMaxAllocStart_ - kHeapTolerance, soakMaxAllocMin_);
+
+    // The song info is bounded by the capacity
+    lockDisplay();
+
+    size_t length = strlen(infoStr_);
+
+    unlockDisplay();
+
+    TEST_ASSERT_LESS_THAN_UINT32(kEventTextLength, (uint32_t) length);
+}
+
+/**
+ * The station is a tone stream of the stand-in server with a long stream title.
+ */
+int main(int argc, char **argv) {
+    if ( !TestBench::begin("metadata_soak", argv[0]) ) {
+        return 1;
+    }
+
+    StandinServer::Stream stream = StandinServer::toneStream("/a", "A");
+
+    stream.title = kLongTitle;
+    standin_.addStream(stream);
+
+    if ( !TestBench::addStation("Tone A", standin_.url("/a")) ) {
+        return 1;
+    }
+
+    TestBench::startRadio();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_long_stream_title);
+    RUN_TEST(test_soak_keeps_max_alloc_heap);
+
+    TestBench::exit(UNITY_END());
+}
@@ -0,0 +1,268 @@
+/**
+    test_pcm_chain:
+    Host benchmark of the PCM chain on a raw PCM capture: time per stereo
+    frame and cycles per sample of each stage (biquad EQ bands, limiter,
+    mono downmix) and of the whole chain, block by block ('process') and
+    frame by frame ('processFrame', bluetooth path), with the slowest block
+    of the budget check. The capture is 'data/pcm_test.raw' (16 bit stereo,
+    like 'benchmarkPcmChain' of the app) or the file given as argument;
+    synthetic data is used if it is not available.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <unity.h>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "PcmChain.h"
+#include "PcmStages.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/** Sample rate of the tests in Hz */
+const uint32_t kSampleRate = 44100;
+
+/** Maximum number of frames taken from the capture and number of runs over them */
+const size_t kFrames = 8192;
+const uint16_t kRuns = 200;
+
+/** Upper limit of the time per frame of the whole chain on the host in ns (a frame lasts 22676 ns at 44.1 kHz) */
+const uint32_t kMaxFrameTime = 2000;
+
+/** Cycle budgets as in the app (average and slowest block per frame), checked by the chain */
+const uint32_t kCycleBudget = 1000;
+const uint32_t kBlockCycleBudget = 2000;
+
+/** Default capture (relative to the project directory) */
+const char kPcmCapturePath[] = "data/pcm_test.raw";
+
+static const char *source_ = "synthetic";
+
+static int16_t capture_[2 * kFrames];
+static size_t frames_;
+
+static int16_t samples_[2 * kFrames];
+
+// Prevents the compiler from removing the processing
+static volatile int32_t checksum_;
+
+/**
+ * Stages of the PCM chain configured like in the app ('eqBands_', 'limiter_'), with the mono downmix ('kDspMono').
+ */
+struct Stages {
+    BiquadStage highPass = BiquadStage(BiquadStage::HIGH_PASS, 60.0f, 0.0f, 0.707f);
+    BiquadStage lowShelf = BiquadStage(BiquadStage::LOW_SHELF, 150.0f, 4.0f, 0.707f);
+    BiquadStage peaking = BiquadStage(BiquadStage::PEAKING, 3000.0f, -2.0f, 1.0f);
+    MonoStage mono;
+    LimiterStage limiter = LimiterStage(-1.0f, 100);
+
+    /** Adds the stages to the chain and sets the sample rate */
+    void addTo(PcmChain &chain) {
+        for (PcmStage *pStage : {(PcmStage*) &highPass, (PcmStage*) &lowShelf, (PcmStage*) &peaking, (PcmStage*) &mono, (PcmStage*) &limiter}) {
+            chain.add(pStage);
+        }
+
+        chain.setSampleRate(kSampleRate);
+    }
+};
+
+/**
+ * Loads the capture or creates synthetic data: two sines and some noise near full scale (like the app).
+ */
+static void loadCapture(const char *path) {
+    FILE *pFile = fopen(path, "rb");
+
+    if (pFile != nullptr) {
+        frames_ = fread(capture_, 2 * sizeof(int16_t), kFrames, pFile);
+        fclose(pFile);
+    }
+
+    if (frames_ > 0) {
+        source_ = path;
+        return;
+    }
+
+    srand(1);
+
+    for (size_t i = 0; i < kFrames; ++i) {
+        float t = (float) i / kSampleRate;
+        int32_t noise = rand() % 2001 - 1000;
+
+        capture_[2 * i] = (int16_t) (16000.0f * sinf(2.0f * PI * 100.0f * t) + 12000.0f * sinf(2.0f * PI * 3000.0f * t) + noise);
+        capture_[2 * i + 1] = capture_[2 * i];
+    }
+
+    frames_ = kFrames;
+}
+
+/** Time stamp counter of the CPU (0 if not available) */
+static uint64_t cycleCount() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/** Measurement of the processing time of 'kRuns' passes over the capture */
+struct Measurement {
+    std::chrono::steady_clock::time_point startTime;
+    uint64_t startCycles;
+
+    Measurement() : startTime(std::chrono::steady_clock::now()), startCycles(cycleCount()) {}
+
+    /**
+     * Logs the time per frame and the cycles per sample.
+     *
+     * @return Time in ns per frame.
+     */
+    uint32_t report(const char *name) const {
+        uint64_t cycles = cycleCount() - startCycles;
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+        double frames = (double) kRuns * frames_;
+        char message[120];
+
+        snprintf(message, sizeof(message), "PCM chain (%s): %s %.2f ns/frame, %.2f cycles/sample", source_, name,
+            ns / frames, cycles / (2 * frames));
+        TEST_MESSAGE(message);
+
+        return (uint32_t) (ns / frames);
+    }
+};
+
+void setUp(void) {
+    memcpy(samples_, capture_, 2 * frames_ * sizeof(int16_t));
+}
+
+void tearDown(void) {
+}
+
+void test_benchmark_stages(void) {
+    Stages stages;
+    PcmChain chain(kCycleBudget, kBlockCycleBudget);
+
+    stages.addTo(chain);
+
+    for (PcmStage *pStage = chain.first(); pStage != nullptr; pStage = PcmChain::next(pStage)) {
+        pStage->reset();
+
+        Measurement measurement;
+
+        for (uint16_t run = 0; run < kRuns; ++run) {
+            memcpy(samples_, capture_, 2 * frames_ * sizeof(int16_t));
+            PcmChain::processStage(pStage, samples_, frames_);
+            checksum_ += samples_[run % (2 * frames_)];
+        }
+
+        TEST_ASSERT_LESS_THAN_UINT32(kMaxFrameTime, measurement.report(pStage->name()));
+    }
+}
+
+void test_benchmark_process(void) {
+    Stages stages;
+    PcmChain chain(kCycleBudget, kBlockCycleBudget);
+    uint32_t cyclesPerFrame;
+    uint32_t maxCyclesPerFrame;
+
+    stages.addTo(chain);
+    chain.reset();
+
+    Measurement measurement;
+
+    for (uint16_t run = 0; run < kRuns; ++run) {
+        memcpy(samples_, capture_, 2 * frames_ * sizeof(int16_t));
+        chain.process(samples_, frames_);
+        checksum_ += samples_[run % (2 * frames_)];
+    }
+
+    uint32_t frameTime = measurement.report("process");
+
+    // Host time in cycles of the device clock (240 MHz): the slowest block against the average
+    chain.checkBudget(cyclesPerFrame, maxCyclesPerFrame);
+
+    char message[120];
+
+    snprintf(message, sizeof(message), "PCM chain (%s): %u cycles/frame, slowest block %u cycles/frame (host time at 240 MHz)",
+        source_, cyclesPerFrame, maxCyclesPerFrame);
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_LESS_THAN_UINT32(kMaxFrameTime, frameTime);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(cyclesPerFrame, maxCyclesPerFrame);
+
+    // The measurements are taken by the check
+    chain.checkBudget(cyclesPerFrame, maxCyclesPerFrame);
+    TEST_ASSERT_EQUAL_UINT32(0, cyclesPerFrame);
+    TEST_ASSERT_EQUAL_UINT32(0, maxCyclesPerFrame);
+}
+
+void test_benchmark_process_frame(void) {
+    Stages blockStages;
+    Stages frameStages;
+    PcmChain blockChain(kCycleBudget, kBlockCycleBudget);
+    PcmChain frameChain(kCycleBudget, kBlockCycleBudget);
+
+    blockStages.addTo(blockChain);
+    frameStages.addTo(frameChain);
+
+    // Frame by frame the output is the processed frame from one block earlier
+    static int16_t expected[2 * kFrames];
+    size_t frames = frames_ - frames_ % PcmChain::kBlockFrames;
+
+    memcpy(expected, capture_, 2 * frames * sizeof(int16_t));
+    blockChain.reset();
+    blockChain.process(expected, frames);
+    frameChain.reset();
+
+    for (size_t i = 0; i < frames; ++i) {
+        int16_t left = capture_[2 * i];
+        int16_t right = capture_[2 * i + 1];
+
+        frameChain.processFrame(left, right);
+
+        if (i >= PcmChain::kBlockFrames) {
+            TEST_ASSERT_EQUAL_INT16(expected[2 * (i - PcmChain::kBlockFrames)], left);
+            TEST_ASSERT_EQUAL_INT16(expected[2 * (i - PcmChain::kBlockFrames) + 1], right);
+        }
+    }
+
+    Measurement measurement;
+
+    for (uint16_t run = 0; run < kRuns; ++run) {
+        for (size_t i = 0; i < frames_; ++i) {
+            frameChain.processFrame(samples_[2 * i], samples_[2 * i + 1]);
+        }
+
+        checksum_ += samples_[run % (2 * frames_)];
+    }
+
+    TEST_ASSERT_LESS_THAN_UINT32(kMaxFrameTime, measurement.report("processFrame"));
+}
+
+int main(int argc, char **argv) {
+    loadCapture(argc > 1 ? argv[1] : kPcmCapturePath);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_benchmark_stages);
+    RUN_TEST(test_benchmark_process);
+    RUN_TEST(test_benchmark_process_frame);
+
+    return UNITY_END();
+}
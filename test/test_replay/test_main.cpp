@@ -0,0 +1,123 @@
+/**
+    test_replay:
+    Records a stream of the stand-in server with the capture of the radio
+    ('c' on the serial console) and replays it as decode benchmark ('r'):
+    reports ms per frame, real-time headroom, underrun margin and peak heap,
+    and checks that the station plays again afterwards.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <Arduino.h>
+#include <NativeHal.h>
+#include <TestBench.h>
+#include <unity.h>
+#include "Metrics.h"
+#include "StreamCapture.h"
+
+extern StreamCapture capture_;
+extern Histogram metricTimeToAudio_;
+extern Counter metricReplays_;
+extern Gauge metricReplayFrameTime_;
+extern Gauge metricReplayHeadroom_;
+extern Gauge metricReplayLoopMax_;
+extern Gauge metricReplayMargin_;
+extern Gauge metricReplayHeapPeak_;
+
+/** Maximum time in ms for recording the capture (the host sends as fast as possible) */
+const uint32_t kCaptureTimeout = 10000;
+
+/** Maximum time in ms for the replay */
+const uint32_t kReplayTimeout = 30000;
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_capture(void) {
+    TEST_ASSERT_TRUE_MESSAGE(TestBench::waitForAudio(1), "No audio after boot");
+
+    NativeHal::serialInput("c");
+
+    unsigned long start = millis();
+
+    // The capture task is started by the audio task
+    while (!capture_.isRunning() && capture_.bytes() == 0 && millis() - start < kCaptureTimeout) {
+        delay(1);
+    }
+
+    while (capture_.isRunning() && millis() - start < kCaptureTimeout) {
+        delay(10);
+    }
+
+    TEST_ASSERT_FALSE_MESSAGE(capture_.isRunning(), "Capture not completed");
+    TEST_ASSERT_GREATER_THAN_UINT32(0, capture_.bytes());
+}
+
+void test_replay(void) {
+    uint32_t audioCount = metricTimeToAudio_.count();
+
+    NativeHal::serialInput("r");
+
+    unsigned long start = millis();
+
+    while (metricReplays_.value() == 0 && millis() - start < kReplayTimeout) {
+        delay(10);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, metricReplays_.value(), "Replay not completed");
+
+    char message[160];
+
+    snprintf(message, sizeof(message),
+        "Replay of %u bytes: %d.%03d ms/frame, headroom %d%%, longest loop %d us, underrun margin %d us, peak heap %d bytes",
+        (uint32_t) capture_.bytes(), metricReplayFrameTime_.value() / 1000, metricReplayFrameTime_.value() % 1000,
+        metricReplayHeadroom_.value(), metricReplayLoopMax_.value(), metricReplayMargin_.value(), metricReplayHeapPeak_.value());
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_GREATER_THAN(0, metricReplayFrameTime_.value());
+    TEST_ASSERT_GREATER_THAN(0, metricReplayHeadroom_.value());
+    TEST_ASSERT_GREATER_THAN(0, metricReplayMargin_.value());
+
+    // The station is played again after the replay
+    TEST_ASSERT_TRUE_MESSAGE(TestBench::waitForAudio(audioCount + 1), "No audio after the replay");
+}
+
+int main(int argc, char **argv) {
+    if ( !TestBench::begin("replay", argv[0]) ) {
+        return 1;
+    }
+
+    // Sent as fast as possible, so that the capture reaches its maximum size right away
+    StandinServer::Stream tone = StandinServer::toneStream("/tone", "Tone");
+
+    tone.byteRate = 0;
+    standin_.addStream(tone);
+
+    if ( !TestBench::addStation("Tone", standin_.url("/tone")) ) {
+        return 1;
+    }
+
+    TestBench::startRadio();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_capture);
+    RUN_TEST(test_replay);
+
+    TestBench::exit(UNITY_END());
+}
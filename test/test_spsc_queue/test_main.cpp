@@ -0,0 +1,163 @@
+/**
+    test_spsc_queue:
+    Tests of the lock-free queue between the tasks: full and empty queue,
+    wrap-around of the ring and the order of the elements with a producer
+    and a consumer on different threads.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <unity.h>
+#include <thread>
+#include "SpscQueue.h"
+
+/** Number of elements passed between the threads */
+const uint32_t kThreadedElements = 1000000;
+
+struct Element {
+    uint32_t sequence;
+    uint32_t check;     // Derived from the sequence number to detect torn copies
+};
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_empty_queue(void) {
+    SpscQueue<uint32_t, 4> queue;
+    uint32_t value = 42;
+
+    TEST_ASSERT_TRUE(queue.isEmpty());
+    TEST_ASSERT_FALSE(queue.pop(value));
+    TEST_ASSERT_EQUAL_UINT32(42, value);
+}
+
+void test_full_queue(void) {
+    SpscQueue<uint32_t, 4> queue;
+
+    for (uint32_t i = 0; i < 4; ++i) {
+        TEST_ASSERT_TRUE(queue.push(i));
+    }
+
+    TEST_ASSERT_FALSE(queue.push(4));
+    TEST_ASSERT_FALSE(queue.isEmpty());
+
+    // The rejected element must not have overwritten the oldest one
+    uint32_t value;
+
+    for (uint32_t i = 0; i < 4; ++i) {
+        TEST_ASSERT_TRUE(queue.pop(value));
+        TEST_ASSERT_EQUAL_UINT32(i, value);
+    }
+
+    TEST_ASSERT_TRUE(queue.isEmpty());
+    TEST_ASSERT_FALSE(queue.pop(value));
+}
+
+void test_wrap_around(void) {
+    SpscQueue<uint32_t, 4> queue;
+    uint32_t next = 0;
+    uint32_t expected = 0;
+    uint32_t value;
+
+    // Fill levels 1 to 4 at every position of the ring
+    for (uint32_t round = 0; round < 100; ++round) {
+        uint32_t fill = 1 + round % 4;
+
+        for (uint32_t i = 0; i < fill; ++i) {
+            TEST_ASSERT_TRUE(queue.push(next++));
+        }
+
+        if (fill == 4) {
+            TEST_ASSERT_FALSE(queue.push(next));
+        }
+
+        for (uint32_t i = 0; i < fill; ++i) {
+            TEST_ASSERT_TRUE(queue.pop(value));
+            TEST_ASSERT_EQUAL_UINT32(expected++, value);
+        }
+
+        TEST_ASSERT_TRUE(queue.isEmpty());
+    }
+}
+
+void test_clear(void) {
+    SpscQueue<uint32_t, 4> queue;
+    uint32_t value;
+
+    queue.push(1);
+    queue.push(2);
+    queue.clear();
+
+    TEST_ASSERT_TRUE(queue.isEmpty());
+    TEST_ASSERT_FALSE(queue.pop(value));
+
+    for (uint32_t i = 0; i < 4; ++i) {
+        TEST_ASSERT_TRUE(queue.push(i));
+    }
+
+    TEST_ASSERT_FALSE(queue.push(4));
+}
+
+void test_producer_consumer_order(void) {
+    static SpscQueue<Element, 16> queue;
+
+    std::thread producer([]() {
+        for (uint32_t i = 0; i < kThreadedElements; ++i) {
+            Element element = {i, ~i};
+
+            while ( !queue.push(element) ) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    uint32_t errors = 0;
+    Element element;
+
+    while (expected < kThreadedElements) {
+        if ( !queue.pop(element) ) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        if (element.sequence != expected || element.check != ~expected) {
+            ++errors;
+        }
+
+        ++expected;
+    }
+
+    producer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, errors);
+    TEST_ASSERT_TRUE(queue.isEmpty());
+    TEST_ASSERT_FALSE(queue.pop(element));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_queue);
+    RUN_TEST(test_full_queue);
+    RUN_TEST(test_wrap_around);
+    RUN_TEST(test_clear);
+    RUN_TEST(test_producer_consumer_order);
+
+    return UNITY_END();
+}
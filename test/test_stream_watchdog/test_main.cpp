@@ -0,0 +1,125 @@
+/**
+    test_stream_watchdog:
+    Runs the radio against a stand-in host that drops the connection after
+    a few seconds: the stall must be detected before the audio buffer runs
+    empty. When the host then breaks right after connecting, the station
+    must fail over to its alternate URL.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <Arduino.h>
+#include <NativeHal.h>
+#include <TestBench.h>
+#include <unity.h>
+#include "Metrics.h"
+#include "StreamWatchdog.h"
+
+extern Counter metricStalls_;
+extern Counter metricReconnects_;
+extern Histogram metricRecoveryTime_;
+
+/** Bytes sent by the dropping host per connection (2 s burst and 1 s in real time) */
+const uint32_t kDropAfter = 3 * StandinServer::kToneSampleRate;
+
+/** Bytes sent per connection by the broken host (less than needed for unmuting) */
+const uint32_t kBrokenAfter = StandinServer::kToneSampleRate / 4;
+
+/** Maximum time in ms until the stall is expected to be detected (after boot) */
+const uint32_t kStallTimeout = 15000;
+
+/** Maximum time in ms until the station is expected to play again from the alternate URL */
+const uint32_t kRecoveryTimeout = 30000;
+
+/** Time in ms the alternate is checked for dropouts */
+const uint32_t kPlayTime = 3000;
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_stall_detected_before_underrun(void) {
+    unsigned long start = millis();
+
+    while (metricStalls_.value() == 0 && millis() - start < kStallTimeout) {
+        delay(1);
+    }
+
+    TEST_ASSERT_TRUE_MESSAGE(metricStalls_.value() > 0, "Dropped connection not detected");
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(1, standin_.requests("/drop"));
+
+    // The stream has been stopped before the decoder ran out of data
+    TEST_ASSERT_EQUAL_UINT32(0, NativeHal::i2sStats().underruns);
+}
+
+void test_fail_over_to_alternate(void) {
+    StandinServer::Stream broken = StandinServer::toneStream("/drop", "Broken Host");
+
+    broken.burst = 0;
+    broken.dropAfter = kBrokenAfter;
+    standin_.addStream(broken);
+
+    unsigned long start = millis();
+
+    while (metricRecoveryTime_.count() == 0 && millis() - start < kRecoveryTimeout) {
+        delay(1);
+    }
+
+    TEST_ASSERT_TRUE_MESSAGE(metricRecoveryTime_.count() > 0, "Station not recovered");
+
+    // The primary URL is retried (on the broken host) until it has failed 'kFailuresPerUrl' times
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(1, standin_.requests("/drop"));
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(StreamWatchdog::kFailuresPerUrl, metricReconnects_.value());
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(1, standin_.requests("/tone"));
+
+    // The alternate plays without dropouts (the broken host has underrun while muted)
+    uint32_t underruns = NativeHal::i2sStats().underruns;
+
+    delay(kPlayTime);
+    TEST_ASSERT_EQUAL_UINT32(underruns, NativeHal::i2sStats().underruns);
+
+    char message[100];
+
+    snprintf(message, sizeof(message), "Failed over after %u ms (%u stalls, %u reconnects)",
+        (uint32_t) metricRecoveryTime_.sum(), metricStalls_.value(), metricReconnects_.value());
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv) {
+    if ( !TestBench::begin("watchdog", argv[0]) ) {
+        return 1;
+    }
+
+    StandinServer::Stream drop = StandinServer::toneStream("/drop", "Dropping Host");
+
+    drop.dropAfter = kDropAfter;
+    standin_.addStream(drop);
+    standin_.addStream(StandinServer::toneStream("/tone", "Alternate Host"));
+
+    if ( !TestBench::addStation("Dropping Host", standin_.url("/drop") + "|" + standin_.url("/tone")) ) {
+        return 1;
+    }
+
+    TestBench::startRadio();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_stall_detected_before_underrun);
+    RUN_TEST(test_fail_over_to_alternate);
+
+    TestBench::exit(UNITY_END());
+}
@@ -0,0 +1,171 @@
+/**
+    test_timeshift:
+    Pauses the radio against the stand-in server: the timeshift proxy keeps
+    downloading into its RAM ring and spill file while paused, resuming plays
+    on from the buffer without reconnecting and returns to the live stream
+    once the spill file has been played, and a full buffer ends the pause.
+    
+    Copyright (C) 2022 by Ernst Sikora
+    
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <Arduino.h>
+#include <NativeHal.h>
+#include <TestBench.h>
+#include <unity.h>
+#include "Metrics.h"
+#include "TimeshiftProxy.h"
+
+extern Histogram metricTimeToAudio_;
+extern Counter metricResumesTimeshift_;
+extern Counter metricResumesReconnect_;
+extern Counter metricStreamErrors_;
+extern Gauge metricTimeshiftBuffer_;
+extern Gauge metricTimeshiftSpill_;
+extern TimeshiftProxy timeshift_;
+
+/** Duration of the pause in ms */
+const uint32_t kPauseTime = 6000;
+
+/** Data rate of the tone stream in bytes/s */
+const uint32_t kByteRate = StandinServer::kToneSampleRate;
+
+/** Maximum time in ms from the press of button A to resuming from the buffer */
+const uint32_t kMaxResumeTime = 500;
+
+/** Stream data buffered ahead of playing (sampled by the metrics every second) */
+static uint32_t buffered() {
+    return metricTimeshiftBuffer_.value() + metricTimeshiftSpill_.value();
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_pause_keeps_downloading(void) {
+    TEST_ASSERT_TRUE_MESSAGE(TestBench::waitForAudio(1), "No audio after boot");
+    TEST_ASSERT_TRUE_MESSAGE(timeshift_.isOpen(), "Stream not played through the timeshift proxy");
+
+    delay(2000); // The connect burst has been played
+
+    NativeHal::pressPowerButton(false);
+    delay(1500); // Fade-out and a metrics update
+
+    uint32_t bufferedBefore = buffered();
+
+    delay(kPauseTime - 1500);
+
+    uint32_t bufferedAfter = buffered();
+    char message[120];
+
+    snprintf(message, sizeof(message), "Paused: %u bytes buffered after %u ms (%u bytes in the spill file)",
+        bufferedAfter, kPauseTime, (uint32_t) metricTimeshiftSpill_.value());
+    TEST_MESSAGE(message);
+
+    // The stream has been received at its data rate while paused, beyond the RAM ring
+    TEST_ASSERT_GREATER_THAN_UINT32(bufferedBefore + kByteRate * 2, bufferedAfter);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, (uint32_t) metricTimeshiftSpill_.value());
+}
+
+void test_resume_from_pause_point(void) {
+    uint32_t resumes = metricResumesTimeshift_.value();
+    uint32_t requests = standin_.requests("/a");
+    uint32_t underruns = NativeHal::i2sStats().underruns;
+    uint32_t streamErrors = metricStreamErrors_.value();
+    unsigned long press = millis();
+
+    TestBench::pressButtonA();
+
+    TEST_ASSERT_TRUE_MESSAGE(TestBench::waitFor([&] { return metricResumesTimeshift_.value() > resumes; }, kMaxResumeTime),
+        "Not resumed from the buffer");
+
+    uint32_t resumeTime = (uint32_t) (millis() - press);
+
+    delay(1500);
+
+    // Playing continues behind the live stream by the length of the pause
+    uint32_t bufferedShifted = buffered();
+
+    TEST_ASSERT_GREATER_THAN_UINT32(kByteRate * 2, bufferedShifted);
+
+    // The newer data is skipped until the spill file has been played, then the station plays live
+    TEST_ASSERT_TRUE_MESSAGE(TestBench::waitFor([] { return timeshift_.bufferedSpill() == 0 && timeshift_.skippedBytes() > 0; },
+        kPauseTime + TestBench::kAudioTimeout), "Not returned to the live stream");
+
+    delay(1500);
+
+    char message[160];
+
+    snprintf(message, sizeof(message), "Resumed after %u ms, %u bytes buffered behind live, %u bytes skipped to return to live, %u underruns",
+        resumeTime, bufferedShifted, timeshift_.skippedBytes(), NativeHal::i2sStats().underruns - underruns);
+    TEST_MESSAGE(message);
+
+    // No new connection, no broken stream (the ICY sections are intact)
+    TEST_ASSERT_EQUAL_UINT32(requests, standin_.requests("/a"));
+    TEST_ASSERT_EQUAL_UINT32(0, (uint32_t) timeshift_.bufferedSpill());
+    TEST_ASSERT_LESS_THAN_UINT32(kByteRate, (uint32_t) timeshift_.bufferedRam());
+    TEST_ASSERT_EQUAL_UINT32(streamErrors, metricStreamErrors_.value());
+    TEST_ASSERT_EQUAL_UINT32(underruns, NativeHal::i2sStats().underruns);
+}
+
+void test_full_buffer_ends_pause(void) {
+    uint32_t count = metricTimeToAudio_.count();
+
+    TestBench::pressButtonA(); // Next station: stream faster than played, the buffer fills up
+
+    TEST_ASSERT_TRUE_MESSAGE(TestBench::waitForAudio(count + 1), "No audio of the fast stream");
+
+    NativeHal::pressPowerButton(false);
+
+    TEST_ASSERT_TRUE_MESSAGE(TestBench::waitFor([] { return !timeshift_.isOpen(); }, TestBench::kAudioTimeout), "Full buffer has not ended the pause");
+
+    uint32_t reconnects = metricResumesReconnect_.value();
+
+    TestBench::pressButtonA();
+
+    TEST_ASSERT_TRUE_MESSAGE(TestBench::waitFor([&] { return metricResumesReconnect_.value() > reconnects; }, TestBench::kAudioTimeout),
+        "Not resumed by reconnecting");
+}
+
+/**
+ * The stations are tone streams of the stand-in server: one at 128 kbit/s and one sent as fast as possible.
+ */
+int main(int argc, char **argv) {
+    if ( !TestBench::begin("timeshift", argv[0]) ) {
+        return 1;
+    }
+
+    StandinServer::Stream fast = StandinServer::toneStream("/fast", "Fast");
+
+    fast.byteRate = 0;
+
+    standin_.addStream(StandinServer::toneStream("/a", "A"));
+    standin_.addStream(fast);
+
+    if ( !TestBench::addStation("Tone A", standin_.url("/a")) || !TestBench::addStation("Fast", standin_.url("/fast")) ) {
+        return 1;
+    }
+
+    TestBench::startRadio();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_pause_keeps_downloading);
+    RUN_TEST(test_resume_from_pause_point);
+    RUN_TEST(test_full_buffer_ends_pause);
+
+    TestBench::exit(UNITY_END());
+}